@@ -22,6 +22,12 @@
 
 #include "bcrypt_internal.h"
 
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define HAVE_SHA_NI
+#endif
+
 static DWORD ror(DWORD n, int k) { return (n >> k) | (n << (32-k)); }
 #define Ch(x,y,z)  (z ^ (x & (y ^ z)))
 #define Maj(x,y,z) ((x & y) | (z & (x | y)))
@@ -91,6 +97,106 @@ static void processblock(SHA256_CTX *ctx, const UCHAR *buffer)
     ctx->h[7] += h;
 }
 
+#ifdef HAVE_SHA_NI
+
+static inline void do_cpuid( unsigned int ax, unsigned int cx, unsigned int *p )
+{
+#ifdef __i386__
+    __asm__("pushl %%ebx\n\t"
+            "cpuid\n\t"
+            "movl %%ebx, %%esi\n\t"
+            "popl %%ebx"
+            : "=a" (p[0]), "=S" (p[1]), "=c" (p[2]), "=d" (p[3])
+            : "0" (ax), "2" (cx));
+#else
+    __asm__("cpuid"
+            : "=a" (p[0]), "=b" (p[1]), "=c" (p[2]), "=d" (p[3])
+            : "0" (ax), "2" (cx));
+#endif
+}
+
+static BOOL have_sha_ni(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        unsigned int regs[4];
+
+        supported = 0;
+        do_cpuid( 0, 0, regs );
+        if (regs[0] >= 7)
+        {
+            unsigned int ecx;
+
+            do_cpuid( 1, 0, regs );
+            ecx = regs[2];
+            do_cpuid( 7, 0, regs );
+            /* SSSE3, SSE4.1 and SHA */
+            supported = (ecx & (1 << 9)) && (ecx & (1 << 19)) && (regs[1] & (1 << 29));
+        }
+    }
+    return supported;
+}
+
+/* Process whole blocks with the SHA extensions. The state is kept in the
+   ABEF/CDGH layout expected by sha256rnds2 for the duration of the call. */
+static void __attribute__((target("sha,sse4.1"))) processblocks_sha_ni(DWORD *h, const UCHAR *buffer, ULONG count)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, abef, cdgh, msg[4], tmp;
+    int i;
+
+    tmp    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]), 0x1b);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; count; count--, buffer += 64)
+    {
+        abef = state0;
+        cdgh = state1;
+
+        for (i = 0; i < 16; i++)
+        {
+            if (i < 4)
+                msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buffer + 16 * i)), mask);
+            else
+            {
+                tmp = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+                msg[i & 3] = _mm_sha256msg2_epu32(tmp, msg[(i + 3) & 3]);
+            }
+            tmp = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i *)&K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, tmp);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(tmp, 0x0e));
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    _mm_storeu_si128((__m128i *)&h[0], _mm_blend_epi16(tmp, state1, 0xf0));
+    _mm_storeu_si128((__m128i *)&h[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#endif /* HAVE_SHA_NI */
+
+static void processblocks(SHA256_CTX *ctx, const UCHAR *buffer, ULONG count)
+{
+#ifdef HAVE_SHA_NI
+    if (have_sha_ni())
+    {
+        processblocks_sha_ni(ctx->h, buffer, count);
+        return;
+    }
+#endif
+    for (; count; count--, buffer += 64)
+        processblock(ctx, buffer);
+}
+
 static void pad(SHA256_CTX *ctx)
 {
     ULONG64 r = ctx->len % 64;
@@ -101,7 +207,7 @@ static void pad(SHA256_CTX *ctx)
     {
         memset(ctx->buf + r, 0, 64 - r);
         r = 0;
-        processblock(ctx, ctx->buf);
+        processblocks(ctx, ctx->buf, 1);
     }
 
     memset(ctx->buf + r, 0, 56 - r);
@@ -115,7 +221,7 @@ static void pad(SHA256_CTX *ctx)
     ctx->buf[62] = ctx->len >> 8;
     ctx->buf[63] = ctx->len;
 
-    processblock(ctx, ctx->buf);
+    processblocks(ctx, ctx->buf, 1);
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -147,10 +253,14 @@ void sha256_update(SHA256_CTX *ctx, const UCHAR *buffer, ULONG len)
         memcpy(ctx->buf + r, p, 64 - r);
         len -= 64 - r;
         p += 64 - r;
-        processblock(ctx, ctx->buf);
+        processblocks(ctx, ctx->buf, 1);
+    }
+    if (len >= 64)
+    {
+        processblocks(ctx, p, len / 64);
+        p += len & ~63;
+        len &= 63;
     }
-    for (; len >= 64; len -= 64, p += 64)
-        processblock(ctx, p);
     memcpy(ctx->buf, p, len);
 }
 
@@ -359,6 +359,82 @@ static void test_hashes(void)
         test_hash(tests+i);
 }
 
+static void test_hash_blocks(void)
+{
+    static const struct
+    {
+        const char *alg;
+        unsigned hash_size;
+        const char *hash;
+    }
+    tests[] =
+    {
+        {
+            "SHA256",
+            32,
+            "1e9bc38cbf860b9ec31918b065f9b52476c549a782e0e7990bed8ce3868d2371"
+        },
+        {
+            "SHA384",
+            48,
+            "94c38db521ca733b8904c2d14b6e82d33dcfcc26e1318c579dbee1fc2f472019"
+            "034e792263b9d46e90e700de2f6e7e91"
+        },
+        {
+            "SHA512",
+            64,
+            "00e36fccf193e59697a92b5ab24666ce6326d7fa16bf10832d0991ddc591112e"
+            "9dfa6a636950ed9c4d67344a760654c2ff7785e1d60094d651038735b5dccabd"
+        }
+    };
+    static const ULONG chunks[] = { 1000, 1, 7, 63, 64, 65, 128, 200 };
+    BCRYPT_ALG_HANDLE alg;
+    BCRYPT_HASH_HANDLE hash;
+    UCHAR buf[512], data[1000], hash_buf[64];
+    WCHAR alg_name[64];
+    char str[129];
+    NTSTATUS ret;
+    ULONG i, j, pos, len;
+
+    for (i = 0; i < sizeof(data); i++) data[i] = i * 7 + 3;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        MultiByteToWideChar(CP_ACP, 0, tests[i].alg, -1, alg_name, ARRAY_SIZE(alg_name));
+
+        alg = NULL;
+        ret = pBCryptOpenAlgorithmProvider(&alg, alg_name, MS_PRIMITIVE_PROVIDER, 0);
+        ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+        /* the result must not depend on how the input is split into blocks */
+        for (j = 0; j < ARRAY_SIZE(chunks); j++)
+        {
+            hash = NULL;
+            ret = pBCryptCreateHash(alg, &hash, buf, sizeof(buf), NULL, 0, 0);
+            ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+            for (pos = 0; pos < sizeof(data); pos += len)
+            {
+                len = min(chunks[j], sizeof(data) - pos);
+                ret = pBCryptHashData(hash, data + pos, len, 0);
+                ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+            }
+
+            memset(hash_buf, 0, sizeof(hash_buf));
+            ret = pBCryptFinishHash(hash, hash_buf, tests[i].hash_size, 0);
+            ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+            format_hash( hash_buf, tests[i].hash_size, str );
+            ok(!strcmp(str, tests[i].hash), "%s chunk %u: got %s\n", tests[i].alg, chunks[j], str);
+
+            ret = pBCryptDestroyHash(hash);
+            ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+        }
+
+        ret = pBCryptCloseAlgorithmProvider(alg, 0);
+        ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    }
+}
+
 static void test_BcryptHash(void)
 {
     static const char expected[] =
@@ -1690,6 +1766,7 @@ START_TEST(bcrypt)
     test_BCryptGenRandom();
     test_BCryptGetFipsAlgorithmMode();
     test_hashes();
+    test_hash_blocks();
     test_rng();
     test_aes();
     test_BCryptGenerateSymmetricKey();
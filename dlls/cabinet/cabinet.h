@@ -528,4 +528,9 @@ typedef struct {
     struct FILELIST *FilterList;
 } SESSION;
 
+/* worker threads for cabinet (de)compression, see cabinet_get_thread_count */
+#define CAB_MAX_THREADS 16
+
+extern unsigned int cabinet_get_thread_count(void) DECLSPEC_HIDDEN;
+
 #endif /* __WINE_CABINET_H */
@@ -22,6 +22,7 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "windef.h"
@@ -69,6 +70,27 @@ HRESULT WINAPI DllGetVersion (DLLVERSIONINFO *pdvi)
 
 /* FDI callback functions */
 
+/***********************************************************************
+ * cabinet_get_thread_count
+ *
+ * Number of worker threads FDI and FCI may use, 0 to do all the work on
+ * the calling thread.  Controlled by the WINE_CABINET_THREADS environment
+ * variable and limited to the number of processors.
+ */
+unsigned int cabinet_get_thread_count(void)
+{
+    SYSTEM_INFO si;
+    char buffer[16];
+    unsigned int count;
+
+    if (!GetEnvironmentVariableA("WINE_CABINET_THREADS", buffer, sizeof(buffer)))
+        return 0;
+    count = atoi(buffer);
+    GetSystemInfo(&si);
+    if (count > si.dwNumberOfProcessors) count = si.dwNumberOfProcessors;
+    return min(count, CAB_MAX_THREADS);
+}
+
 static void * CDECL mem_alloc(ULONG cb)
 {
     return HeapAlloc(GetProcessHeap(), 0, cb);
@@ -140,8 +140,44 @@ struct data_block
     struct list entry;
     cab_UWORD   compressed;
     cab_UWORD   uncompressed;
+    cab_ULONG   csum;        /* checksum of the compressed data */
+    BOOL        csum_valid;  /* FALSE once the block has been split */
+    cab_UBYTE  *data;        /* compressed data kept in memory, NULL if in the temp file */
 };
 
+struct FCI_Int;
+
+/* a data block being compressed by the thread pool */
+struct compress_job
+{
+    cab_UWORD   (*compress)(struct FCI_Int *, const unsigned char *, cab_UWORD, unsigned char *);
+    BOOL          done;
+    cab_UWORD     uncompressed;
+    cab_UWORD     compressed;
+    cab_ULONG     csum;
+    unsigned char data_in[CAB_BLOCKMAX];
+    unsigned char data_out[2 * CAB_BLOCKMAX];
+};
+
+/* thread pool for pipelined compression; jobs are queued and retired in order */
+struct compress_pool
+{
+    CRITICAL_SECTION    cs;
+    CONDITION_VARIABLE  work_cv;       /* a job was queued, or shutdown */
+    CONDITION_VARIABLE  done_cv;       /* a job was compressed */
+    BOOL                shutdown;
+    unsigned int        queued;        /* jobs queued by the main thread */
+    unsigned int        taken;         /* jobs taken by the workers */
+    unsigned int        retired;       /* jobs retired by the main thread */
+    unsigned int        thread_count;
+    HANDLE              threads[CAB_MAX_THREADS];
+    unsigned int        job_count;
+    struct compress_job jobs[1];
+};
+
+/* limit for compressed data kept in memory instead of temp files */
+#define FCI_MAX_MEMORY_DATA (64 * 1024 * 1024)
+
 typedef struct FCI_Int
 {
   unsigned int       magic;
@@ -188,7 +224,9 @@ typedef struct FCI_Int
   cab_ULONG          pending_data_size;   /* size of data not yet assigned to a folder */
   cab_ULONG          folders_data_size;   /* total size of data contained in the current folders */
   TCOMP              compression;
-  cab_UWORD        (*compress)(struct FCI_Int *);
+  cab_UWORD        (*compress)(struct FCI_Int *, const unsigned char *, cab_UWORD, unsigned char *);
+  struct compress_pool *pool;             /* pipelined compression, NULL if disabled */
+  cab_ULONG          memory_data_size;    /* compressed data kept in memory */
 } FCI_Int;
 
 #define FCI_INT_MAGIC 0xfcfcfc05
@@ -309,33 +347,49 @@ static void free_file( FCI_Int *fci, struct file *file )
     fci->free( file );
 }
 
-/* create a new data block for the data in fci->data_in */
-static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+static cab_ULONG fci_get_checksum( const void *pv, UINT cb, cab_ULONG seed );
+
+/* store a compressed data block in the temp file, or in memory for pipelined compression */
+static BOOL store_data_block( FCI_Int *fci, cab_UWORD uncompressed, cab_UWORD compressed,
+                              const unsigned char *data, cab_ULONG csum, PFNFCISTATUS status_callback )
 {
     int err;
     struct data_block *block;
 
-    if (!fci->cdata_in) return TRUE;
-
-    if (fci->data.handle == -1 && !create_temp_file( fci, &fci->data )) return FALSE;
+    if (!fci->pool && fci->data.handle == -1 && !create_temp_file( fci, &fci->data )) return FALSE;
 
     if (!(block = fci->alloc( sizeof(*block) )))
     {
         set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
         return FALSE;
     }
-    block->uncompressed = fci->cdata_in;
-    block->compressed   = fci->compress( fci );
-
-    if (fci->write( fci->data.handle, fci->data_out,
-                    block->compressed, &err, fci->pv ) != block->compressed)
+    block->uncompressed = uncompressed;
+    block->compressed   = compressed;
+    block->csum         = csum;
+    block->csum_valid   = TRUE;
+    block->data         = NULL;
+
+    if (fci->pool && fci->memory_data_size + compressed <= FCI_MAX_MEMORY_DATA &&
+        (block->data = fci->alloc( compressed )))
     {
-        set_error( fci, FCIERR_TEMP_FILE, err );
-        fci->free( block );
-        return FALSE;
+        memcpy( block->data, data, compressed );
+        fci->memory_data_size += compressed;
+    }
+    else
+    {
+        if (fci->data.handle == -1 && !create_temp_file( fci, &fci->data ))
+        {
+            fci->free( block );
+            return FALSE;
+        }
+        if (fci->write( fci->data.handle, (void *)data, compressed, &err, fci->pv ) != compressed)
+        {
+            set_error( fci, FCIERR_TEMP_FILE, err );
+            fci->free( block );
+            return FALSE;
+        }
     }
 
-    fci->cdata_in = 0;
     fci->pending_data_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + block->compressed;
     fci->cCompressedBytesInFolder += block->compressed;
     fci->cDataBlocks++;
@@ -349,6 +403,148 @@ static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
     return TRUE;
 }
 
+/* wait for the oldest queued block to be compressed and store it */
+static BOOL retire_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    struct compress_pool *pool = fci->pool;
+    struct compress_job *job = &pool->jobs[pool->retired % pool->job_count];
+
+    EnterCriticalSection( &pool->cs );
+    while (!job->done) SleepConditionVariableCS( &pool->done_cv, &pool->cs, INFINITE );
+    LeaveCriticalSection( &pool->cs );
+    pool->retired++;
+
+    if (!job->compressed)
+    {
+        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+        return FALSE;
+    }
+    return store_data_block( fci, job->uncompressed, job->compressed, job->data_out,
+                             job->csum, status_callback );
+}
+
+/* store all the blocks still being compressed, in order */
+static BOOL retire_data_blocks( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    while (fci->pool->retired != fci->pool->queued)
+        if (!retire_data_block( fci, status_callback )) return FALSE;
+    return TRUE;
+}
+
+/* hand the data in fci->data_in over to the thread pool */
+static BOOL queue_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    struct compress_pool *pool = fci->pool;
+    struct compress_job *job;
+
+    if (!fci->cdata_in) return TRUE;
+
+    if (pool->queued - pool->retired == pool->job_count &&
+        !retire_data_block( fci, status_callback )) return FALSE;
+
+    job = &pool->jobs[pool->queued % pool->job_count];
+    job->compress     = fci->compress;
+    job->uncompressed = fci->cdata_in;
+    job->done         = FALSE;
+    memcpy( job->data_in, fci->data_in, fci->cdata_in );
+    fci->cdata_in = 0;
+
+    EnterCriticalSection( &pool->cs );
+    pool->queued++;
+    WakeConditionVariable( &pool->work_cv );
+    LeaveCriticalSection( &pool->cs );
+    return TRUE;
+}
+
+/* create a new data block for the data in fci->data_in */
+static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    cab_UWORD uncompressed = fci->cdata_in, compressed;
+
+    if (fci->pool)
+        return queue_data_block( fci, status_callback ) && retire_data_blocks( fci, status_callback );
+
+    if (!fci->cdata_in) return TRUE;
+
+    compressed = fci->compress( fci, fci->data_in, uncompressed, fci->data_out );
+    if (!store_data_block( fci, uncompressed, compressed, fci->data_out,
+                           fci_get_checksum( fci->data_out, compressed, 0 ), status_callback ))
+        return FALSE;
+    fci->cdata_in = 0;
+    return TRUE;
+}
+
+static DWORD WINAPI compress_thread( void *arg )
+{
+    struct compress_pool *pool = arg;
+    struct compress_job *job;
+
+    EnterCriticalSection( &pool->cs );
+    for (;;)
+    {
+        while (!pool->shutdown && pool->taken == pool->queued)
+            SleepConditionVariableCS( &pool->work_cv, &pool->cs, INFINITE );
+        if (pool->shutdown) break;
+        job = &pool->jobs[pool->taken++ % pool->job_count];
+        LeaveCriticalSection( &pool->cs );
+
+        job->compressed = job->compress( NULL, job->data_in, job->uncompressed, job->data_out );
+        job->csum = fci_get_checksum( job->data_out, job->compressed, 0 );
+
+        EnterCriticalSection( &pool->cs );
+        job->done = TRUE;
+        WakeAllConditionVariable( &pool->done_cv );
+    }
+    LeaveCriticalSection( &pool->cs );
+    return 0;
+}
+
+static struct compress_pool *create_compress_pool( FCI_Int *fci, unsigned int threads )
+{
+    unsigned int size = FIELD_OFFSET( struct compress_pool, jobs[2 * threads] );
+    struct compress_pool *pool = fci->alloc( size );
+
+    if (!pool) return NULL;
+    memset( pool, 0, size );
+    InitializeCriticalSection( &pool->cs );
+    pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": compress_pool.cs");
+    InitializeConditionVariable( &pool->work_cv );
+    InitializeConditionVariable( &pool->done_cv );
+    pool->job_count = 2 * threads;
+
+    while (pool->thread_count < threads)
+    {
+        HANDLE thread = CreateThread( NULL, 0, compress_thread, pool, 0, NULL );
+        if (!thread) break;
+        pool->threads[pool->thread_count++] = thread;
+    }
+    if (!pool->thread_count)
+    {
+        pool->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection( &pool->cs );
+        fci->free( pool );
+        return NULL;
+    }
+    TRACE( "compressing on %u threads\n", pool->thread_count );
+    return pool;
+}
+
+static void destroy_compress_pool( FCI_Int *fci, struct compress_pool *pool )
+{
+    unsigned int i;
+
+    EnterCriticalSection( &pool->cs );
+    pool->shutdown = TRUE;
+    WakeAllConditionVariable( &pool->work_cv );
+    LeaveCriticalSection( &pool->cs );
+
+    WaitForMultipleObjects( pool->thread_count, pool->threads, TRUE, INFINITE );
+    for (i = 0; i < pool->thread_count; i++) CloseHandle( pool->threads[i] );
+    pool->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &pool->cs );
+    fci->free( pool );
+}
+
 /* add compressed blocks for all the data that can be read from the file */
 static BOOL add_file_data( FCI_Int *fci, char *sourcefile, char *filename, BOOL execute,
                            PFNFCIGETOPENINFO get_open_info, PFNFCISTATUS status_callback )
@@ -381,15 +577,24 @@ static BOOL add_file_data( FCI_Int *fci, char *sourcefile, char *filename, BOOL
         }
         file->size += len;
         fci->cdata_in += len;
-        if (fci->cdata_in == CAB_BLOCKMAX && !add_data_block( fci, status_callback )) return FALSE;
+        if (fci->cdata_in == CAB_BLOCKMAX &&
+            !(fci->pool ? queue_data_block( fci, status_callback ) : add_data_block( fci, status_callback )))
+            return FALSE;
     }
     fci->close( handle, &err, fci->pv );
+    /* the folder and cabinet size checks need all the blocks */
+    if (fci->pool) return retire_data_blocks( fci, status_callback );
     return TRUE;
 }
 
 static void free_data_block( FCI_Int *fci, struct data_block *block )
 {
     list_remove( &block->entry );
+    if (block->data)
+    {
+        fci->memory_data_size -= block->compressed;
+        fci->free( block->data );
+    }
     fci->free( block );
 }
 
@@ -488,28 +693,34 @@ static BOOL copy_data_blocks( FCI_Int *fci, INT_PTR handle, cab_ULONG start_pos,
     struct data_block *block;
     int err;
 
-    if (fci->seek( handle, start_pos, SEEK_SET, &err, fci->pv ) != start_pos)
-    {
-        set_error( fci, FCIERR_TEMP_FILE, err );
-        return FALSE;
-    }
-    if (!create_temp_file( fci, temp )) return FALSE;
-
     LIST_FOR_EACH_ENTRY( block, &fci->blocks_list, struct data_block, entry )
     {
-        if (fci->read( handle, fci->data_out, block->compressed,
-                       &err, fci->pv ) != block->compressed)
+        /* blocks kept in memory stay where they are */
+        if (!block->data)
         {
-            close_temp_file( fci, temp );
-            set_error( fci, FCIERR_TEMP_FILE, err );
-            return FALSE;
-        }
-        if (fci->write( temp->handle, fci->data_out, block->compressed,
-                        &err, fci->pv ) != block->compressed)
-        {
-            close_temp_file( fci, temp );
-            set_error( fci, FCIERR_TEMP_FILE, err );
-            return FALSE;
+            if (temp->handle == -1)
+            {
+                if (fci->seek( handle, start_pos, SEEK_SET, &err, fci->pv ) != start_pos)
+                {
+                    set_error( fci, FCIERR_TEMP_FILE, err );
+                    return FALSE;
+                }
+                if (!create_temp_file( fci, temp )) return FALSE;
+            }
+            if (fci->read( handle, fci->data_out, block->compressed,
+                           &err, fci->pv ) != block->compressed)
+            {
+                close_temp_file( fci, temp );
+                set_error( fci, FCIERR_TEMP_FILE, err );
+                return FALSE;
+            }
+            if (fci->write( temp->handle, fci->data_out, block->compressed,
+                            &err, fci->pv ) != block->compressed)
+            {
+                close_temp_file( fci, temp );
+                set_error( fci, FCIERR_TEMP_FILE, err );
+                return FALSE;
+            }
         }
         fci->pending_data_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + block->compressed;
         fci->statusFolderCopied += block->compressed;
@@ -612,20 +823,30 @@ static BOOL write_data_blocks( FCI_Int *fci, INT_PTR handle, PFNFCISTATUS status
 
     LIST_FOR_EACH_ENTRY( folder, &fci->folders_list, struct folder, entry )
     {
-        if (fci->seek( folder->data.handle, 0, SEEK_SET, &err, fci->pv ) != 0)
+        if (folder->data.handle != -1 &&
+            fci->seek( folder->data.handle, 0, SEEK_SET, &err, fci->pv ) != 0)
         {
             set_error( fci, FCIERR_CAB_FILE, err );
             return FALSE;
         }
         LIST_FOR_EACH_ENTRY( block, &folder->blocks_list, struct data_block, entry )
         {
-            len = fci->read( folder->data.handle, data, block->compressed, &err, fci->pv );
-            if (len != block->compressed) return FALSE;
+            if (block->data)
+            {
+                len = block->compressed;
+                memcpy( data, block->data, len );
+            }
+            else
+            {
+                len = fci->read( folder->data.handle, data, block->compressed, &err, fci->pv );
+                if (len != block->compressed) return FALSE;
+            }
 
             cfdata->cbData = fci_endian_uword( block->compressed );
             cfdata->cbUncomp = fci_endian_uword( block->uncompressed );
             cfdata->csum = fci_endian_ulong( fci_get_checksum( &cfdata->cbData,
                                                                header_size - FIELD_OFFSET(CFDATA, cbData),
+                                                               block->csum_valid ? block->csum :
                                                                fci_get_checksum( data, len, 0 )));
 
             fci->statusFolderCopied += len;
@@ -801,6 +1022,19 @@ static BOOL add_data_to_folder( FCI_Int *fci, struct folder *folder, cab_ULONG *
             new->compressed = fci->ccab.cb - (sizeof(CFDATA) + fci->ccab.cbReserveCFData + current_size +
                                               sizeof(CFFOLDER) + fci->ccab.cbReserveCFFolder );
             new->uncompressed = 0; /* on split blocks of data this is zero */
+            new->csum_valid = block->csum_valid = FALSE;
+            new->data = NULL;
+            if (block->data)
+            {
+                if (!(new->data = fci->alloc( new->compressed )))
+                {
+                    fci->free( new );
+                    set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+                    return FALSE;
+                }
+                memcpy( new->data, block->data, new->compressed );
+                memmove( block->data, block->data + new->compressed, block->compressed - new->compressed );
+            }
             block->compressed -= new->compressed;
             split_block = TRUE;
         }
@@ -808,9 +1042,14 @@ static BOOL add_data_to_folder( FCI_Int *fci, struct folder *folder, cab_ULONG *
         {
             new->compressed   = block->compressed;
             new->uncompressed = block->uncompressed;
+            new->csum         = block->csum;
+            new->csum_valid   = block->csum_valid;
+            new->data         = block->data;
+            block->data       = NULL;
         }
 
-        start_pos += new->compressed;
+        /* offset of the remaining blocks in the temp file */
+        if (!new->data) start_pos += new->compressed;
         current_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + new->compressed;
         fci->folders_data_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + new->compressed;
         fci->statusFolderCopied += new->compressed;
@@ -903,10 +1142,11 @@ static BOOL add_files_to_folder( FCI_Int *fci, struct folder *folder, cab_ULONG
     return TRUE;
 }
 
-static cab_UWORD compress_NONE( FCI_Int *fci )
+/* the compression functions are called with a NULL fci on the pool threads */
+static cab_UWORD compress_NONE( FCI_Int *fci, const unsigned char *in, cab_UWORD size, unsigned char *out )
 {
-    memcpy( fci->data_out, fci->data_in, fci->cdata_in );
-    return fci->cdata_in;
+    memcpy( out, in, size );
+    return size;
 }
 
 #ifdef HAVE_ZLIB
@@ -914,16 +1154,18 @@ static cab_UWORD compress_NONE( FCI_Int *fci )
 static void *zalloc( void *opaque, unsigned int items, unsigned int size )
 {
     FCI_Int *fci = opaque;
+    if (!fci) return HeapAlloc( GetProcessHeap(), 0, items * size );
     return fci->alloc( items * size );
 }
 
 static void zfree( void *opaque, void *ptr )
 {
     FCI_Int *fci = opaque;
-    fci->free( ptr );
+    if (!fci) HeapFree( GetProcessHeap(), 0, ptr );
+    else fci->free( ptr );
 }
 
-static cab_UWORD compress_MSZIP( FCI_Int *fci )
+static cab_UWORD compress_MSZIP( FCI_Int *fci, const unsigned char *in, cab_UWORD size, unsigned char *out )
 {
     z_stream stream;
 
@@ -932,16 +1174,16 @@ static cab_UWORD compress_MSZIP( FCI_Int *fci )
     stream.opaque = fci;
     if (deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
     {
-        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+        if (fci) set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
         return 0;
     }
-    stream.next_in   = fci->data_in;
-    stream.avail_in  = fci->cdata_in;
-    stream.next_out  = fci->data_out + 2;
-    stream.avail_out = sizeof(fci->data_out) - 2;
+    stream.next_in   = (unsigned char *)in;
+    stream.avail_in  = size;
+    stream.next_out  = out + 2;
+    stream.avail_out = 2 * CAB_BLOCKMAX - 2;
     /* insert the signature */
-    fci->data_out[0] = 'C';
-    fci->data_out[1] = 'K';
+    out[0] = 'C';
+    out[1] = 'K';
     deflate( &stream, Z_FINISH );
     deflateEnd( &stream );
     return stream.total_out + 2;
@@ -1011,6 +1253,7 @@ HFCI __cdecl FCICreate(
 	void *pv)
 {
   FCI_Int *p_fci_internal;
+  unsigned int threads;
 
   if (!perf) {
     SetLastError(ERROR_BAD_ARGUMENTS);
@@ -1054,6 +1297,8 @@ HFCI __cdecl FCICreate(
   p_fci_internal->pv = pv;
   p_fci_internal->data.handle = -1;
   p_fci_internal->compress = compress_NONE;
+  if ((threads = cabinet_get_thread_count()))
+      p_fci_internal->pool = create_compress_pool( p_fci_internal, threads );
 
   list_init( &p_fci_internal->folders_list );
   list_init( &p_fci_internal->files_list );
@@ -1719,6 +1964,8 @@ BOOL __cdecl FCIDestroy(HFCI hfci)
     /* and deleted */
     p_fci_internal->magic = 0;
 
+    if (p_fci_internal->pool) destroy_compress_pool( p_fci_internal, p_fci_internal->pool );
+
     LIST_FOR_EACH_ENTRY_SAFE( folder, folder_next, &p_fci_internal->folders_list, struct folder, entry )
     {
         free_folder( p_fci_internal, folder );
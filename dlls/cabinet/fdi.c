@@ -149,6 +149,9 @@ typedef struct fdi_cds_fwd {
     struct QTMstate qtm;
     struct LZXstate lzx;
   } methods;
+  /* MSZIP fixed Huffman tables, built on first use */
+  struct Ziphuft *zip_fixed_tl, *zip_fixed_td;
+  cab_LONG zip_fixed_bl, zip_fixed_bd;
   /* some temp variables for use during decompression */
   cab_UBYTE q_length_base[27], q_length_extra[27], q_extra_bits[42];
   cab_ULONG q_position_base[42];
@@ -1124,10 +1127,19 @@ static cab_LONG fdi_Zipinflate_codes(const struct Ziphuft *tl, const struct Ziph
         e = ZIPWSIZE - max(d, w);
         e = min(e, n);
         n -= e;
-        do
+        if (d > w || w - d >= e)   /* source isn't being overwritten */
         {
-          CAB(outbuf)[w++] = CAB(outbuf)[d++];
-        } while (--e);
+          memmove(CAB(outbuf) + w, CAB(outbuf) + d, e);
+          w += e;
+          d += e;
+        }
+        else
+        {
+          do
+          {
+            CAB(outbuf)[w++] = CAB(outbuf)[d++];
+          } while (--e);
+        }
       } while (n);
     }
   }
@@ -1170,13 +1182,20 @@ static cab_LONG fdi_Zipinflate_stored(fdi_decomp_state *decomp_state)
     return 1;                   /* error in compressed data */
   ZIPDUMPBITS(16)
 
-  /* read and output the compressed data */
-  while(n--)
+  if (w + n > ZIPWSIZE)
+    return 1;
+
+  /* read and output the compressed data, first what is left in the bit
+   * buffer, then straight from the input */
+  while(n && k)
   {
-    ZIPNEEDBITS(8)
     CAB(outbuf)[w++] = (cab_UBYTE)b;
     ZIPDUMPBITS(8)
+    n--;
   }
+  memcpy(CAB(outbuf) + w, ZIP(inpos), n);
+  ZIP(inpos) += n;
+  w += n;
 
   /* restore the globals from the locals */
   ZIP(window_posn) = w;              /* restore global window pointer */
@@ -1196,6 +1215,11 @@ static cab_LONG fdi_Zipinflate_fixed(fdi_decomp_state *decomp_state)
   cab_LONG i;                /* temporary variable */
   cab_ULONG *l;
 
+  /* the fixed tables never change, so only build them once */
+  if (CAB(zip_fixed_tl))
+    return fdi_Zipinflate_codes(CAB(zip_fixed_tl), CAB(zip_fixed_td),
+                                CAB(zip_fixed_bl), CAB(zip_fixed_bd), decomp_state);
+
   l = ZIP(ll);
 
   /* literal table */
@@ -1221,12 +1245,13 @@ static cab_LONG fdi_Zipinflate_fixed(fdi_decomp_state *decomp_state)
     return i;
   }
 
-  /* decompress until an end-of-block code */
-  i = fdi_Zipinflate_codes(fixed_tl, fixed_td, fixed_bl, fixed_bd, decomp_state);
+  CAB(zip_fixed_tl) = fixed_tl;
+  CAB(zip_fixed_td) = fixed_td;
+  CAB(zip_fixed_bl) = fixed_bl;
+  CAB(zip_fixed_bd) = fixed_bd;
 
-  fdi_Ziphuft_free(CAB(fdi), fixed_td);
-  fdi_Ziphuft_free(CAB(fdi), fixed_tl);
-  return i;
+  /* decompress until an end-of-block code */
+  return fdi_Zipinflate_codes(fixed_tl, fixed_td, fixed_bl, fixed_bd, decomp_state);
 }
 
 /**************************************************************
@@ -1553,6 +1578,21 @@ static int QTMfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+/************************************************************
+ * fdi_lzx_copy (internal)
+ *
+ * Copies match data within the window. Overlapping matches repeat the
+ * bytes just written, so those have to be copied one at a time.
+ */
+static inline void fdi_lzx_copy(cab_UBYTE *dest, const cab_UBYTE *src, int len)
+{
+  if (len <= 0) return;
+  if (src + len <= dest || dest + len <= src)
+    memcpy(dest, src, len);
+  else
+    while (len-- > 0) *dest++ = *src++;
+}
+
 /************************************************************
  * fdi_lzx_read_lens (internal)
  */
@@ -1768,14 +1808,15 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
               if (copy_length < match_length) {
                 match_length -= copy_length;
                 window_posn += copy_length;
-                while (copy_length-- > 0) *rundest++ = *runsrc++;
+                fdi_lzx_copy(rundest, runsrc, copy_length);
+                rundest += copy_length;
                 runsrc = window;
               }
             }
             window_posn += match_length;
 
             /* copy match data - no worries about destination wraps */
-            while (match_length-- > 0) *rundest++ = *runsrc++;
+            fdi_lzx_copy(rundest, runsrc, match_length);
           }
         }
         break;
@@ -1857,14 +1898,15 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
               if (copy_length < match_length) {
                 match_length -= copy_length;
                 window_posn += copy_length;
-                while (copy_length-- > 0) *rundest++ = *runsrc++;
+                fdi_lzx_copy(rundest, runsrc, copy_length);
+                rundest += copy_length;
                 runsrc = window;
               }
             }
             window_posn += match_length;
 
             /* copy match data - no worries about destination wraps */
-            while (match_length-- > 0) *rundest++ = *runsrc++;
+            fdi_lzx_copy(rundest, runsrc, match_length);
           }
         }
         break;
@@ -1923,6 +1965,32 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+/**********************************************************
+ * fdi_init_decompressor (internal)
+ *
+ * Select and initialize the decompressor for a folder of the
+ * given compression type.
+ */
+static int fdi_init_decompressor(cab_UWORD comptype, fdi_decomp_state *decomp_state)
+{
+  switch (comptype & cffoldCOMPTYPE_MASK) {
+  case cffoldCOMPTYPE_NONE:
+    CAB(decompress) = NONEfdi_decomp;
+    return DECR_OK;
+  case cffoldCOMPTYPE_MSZIP:
+    CAB(decompress) = ZIPfdi_decomp;
+    return DECR_OK;
+  case cffoldCOMPTYPE_QUANTUM:
+    CAB(decompress) = QTMfdi_decomp;
+    return QTMfdi_init((comptype >> 8) & 0x1f, (comptype >> 4) & 0xF, decomp_state);
+  case cffoldCOMPTYPE_LZX:
+    CAB(decompress) = LZXfdi_decomp;
+    return LZXfdi_init((comptype >> 8) & 0x1f, decomp_state);
+  default:
+    return DECR_DATAFORMAT;
+  }
+}
+
 /**********************************************************
  * fdi_decomp (internal)
  *
@@ -2245,12 +2313,275 @@ static void free_decompression_mem(FDI_Int *fdi, fdi_decomp_state *decomp_state)
       CAB(firstfile) = CAB(firstfile)->next;
       fdi->free(file);
     }
+    if (CAB(zip_fixed_tl)) fdi_Ziphuft_free(fdi, CAB(zip_fixed_tl));
+    if (CAB(zip_fixed_td)) fdi_Ziphuft_free(fdi, CAB(zip_fixed_td));
     prev_fds = decomp_state;
     decomp_state = CAB(next);
     fdi->free(prev_fds);
   }
 }
 
+/*
+ * Optional parallel decoding of whole folders.
+ *
+ * Folders of a cabinet are compressed independently, so when
+ * WINE_CABINET_THREADS is set, FDICopy reads the data blocks of all but
+ * the first folder up front and hands them to worker threads, while the
+ * first folder is decoded as usual.  Files are still written in cabinet
+ * order with the same write calls as the serial path; any folder that
+ * fails to decode in the background is simply decoded serially again so
+ * errors are reported exactly as before.  The workers never call back
+ * into the application, they use the process heap for their buffers.
+ */
+#define FDI_MAX_PREDECODE (256 * 1024 * 1024)
+
+struct fdi_folder_job {
+  const struct fdi_folder *fol;
+  cab_UBYTE *input;                    /* data blocks, reserved area stripped */
+  cab_UBYTE *output;                   /* uncompressed folder                 */
+  cab_ULONG *block_end;                /* uncompressed end of each block      */
+  cab_ULONG output_size;
+  BOOL done;                           /* decoded without errors              */
+};
+
+struct fdi_parallel {
+  FDI_Int fdi;                         /* allocators used by the workers */
+  struct fdi_folder_job *jobs;
+  LONG job_count;
+  LONG next_job;
+  HANDLE threads[CAB_MAX_THREADS];
+  unsigned int thread_count;
+};
+
+static FNALLOC(fdi_heap_alloc)
+{
+  return HeapAlloc(GetProcessHeap(), 0, cb);
+}
+
+static FNFREE(fdi_heap_free)
+{
+  HeapFree(GetProcessHeap(), 0, pv);
+}
+
+/* decode all blocks of a folder; runs on a worker thread */
+static int fdi_decode_folder(struct fdi_parallel *parallel, struct fdi_folder_job *job)
+{
+  fdi_decomp_state *decomp_state;
+  const cab_UBYTE *pos = job->input;
+  cab_UWORD inlen, outlen;
+  cab_ULONG cksum, outpos = 0;
+  unsigned int i;
+  int err;
+
+  if (!(decomp_state = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(fdi_decomp_state))))
+    return DECR_NOMEMORY;
+  CAB(fdi) = &parallel->fdi;
+
+  err = fdi_init_decompressor(job->fol->comp_type, decomp_state);
+  for (i = 0; !err && i < job->fol->num_blocks; i++) {
+    inlen = EndGetI16(pos+cfdata_CompressedSize);
+    outlen = EndGetI16(pos+cfdata_UncompressedSize);
+
+    /* same input buffer layout as fdi_decomp */
+    memcpy(CAB(inbuf), pos + cfdata_SIZEOF, inlen);
+    CAB(inbuf)[inlen+1] = CAB(inbuf)[inlen+2] = 0;
+
+    cksum = EndGetI32(pos+cfdata_CheckSum);
+    if (cksum && cksum != checksum(pos+4, 4, checksum(CAB(inbuf), inlen, 0)))
+      err = DECR_CHECKSUM;
+    else if (!(err = CAB(decompress)(inlen, outlen, decomp_state))) {
+      memcpy(job->output + outpos, CAB(outbuf), outlen);
+      outpos += outlen;
+      job->block_end[i] = outpos;
+    }
+    pos += cfdata_SIZEOF + inlen;
+  }
+
+  free_decompression_temps(CAB(fdi), job->fol, decomp_state);
+  if (CAB(zip_fixed_tl)) fdi_Ziphuft_free(CAB(fdi), CAB(zip_fixed_tl));
+  if (CAB(zip_fixed_td)) fdi_Ziphuft_free(CAB(fdi), CAB(zip_fixed_td));
+  HeapFree(GetProcessHeap(), 0, decomp_state);
+  return err;
+}
+
+static DWORD WINAPI fdi_decode_thread(void *arg)
+{
+  struct fdi_parallel *parallel = arg;
+  LONG i;
+
+  while ((i = InterlockedIncrement(&parallel->next_job) - 1) < parallel->job_count)
+    parallel->jobs[i].done = (fdi_decode_folder(parallel, &parallel->jobs[i]) == DECR_OK);
+  return 0;
+}
+
+/* read the data blocks of a folder into memory; FALSE leaves it to the serial path */
+static BOOL fdi_read_folder(FDI_Int *fdi, fdi_decomp_state *decomp_state,
+  struct fdi_folder_job *job, cab_ULONG budget)
+{
+  cab_UBYTE buf[cfdata_SIZEOF], *pos;
+  cab_ULONG input_size = 0, output_size = 0;
+  cab_UWORD inlen, outlen;
+  unsigned int i;
+
+  if (!job->fol->num_blocks) return FALSE;
+
+  /* first pass: sizes from the block headers */
+  if (fdi->seek(CAB(cabhf), job->fol->offset, SEEK_SET) == -1) return FALSE;
+  for (i = 0; i < job->fol->num_blocks; i++) {
+    if (fdi->read(CAB(cabhf), buf, cfdata_SIZEOF) != cfdata_SIZEOF) return FALSE;
+    inlen = EndGetI16(buf+cfdata_CompressedSize);
+    outlen = EndGetI16(buf+cfdata_UncompressedSize);
+    if (inlen > CAB_INPUTMAX || !outlen || outlen > CAB_BLOCKMAX) return FALSE;
+    input_size += cfdata_SIZEOF + inlen;
+    output_size += outlen;
+    if (output_size > budget) return FALSE;
+    if (fdi->seek(CAB(cabhf), CAB(mii).block_resv + inlen, SEEK_CUR) == -1) return FALSE;
+  }
+
+  job->input = HeapAlloc(GetProcessHeap(), 0, input_size);
+  job->output = HeapAlloc(GetProcessHeap(), 0, output_size);
+  job->block_end = HeapAlloc(GetProcessHeap(), 0, job->fol->num_blocks * sizeof(cab_ULONG));
+  if (!job->input || !job->output || !job->block_end) return FALSE;
+  job->output_size = output_size;
+
+  /* second pass: the blocks themselves */
+  if (fdi->seek(CAB(cabhf), job->fol->offset, SEEK_SET) == -1) return FALSE;
+  for (i = 0, pos = job->input; i < job->fol->num_blocks; i++) {
+    if (fdi->read(CAB(cabhf), pos, cfdata_SIZEOF) != cfdata_SIZEOF) return FALSE;
+    if (fdi->seek(CAB(cabhf), CAB(mii).block_resv, SEEK_CUR) == -1) return FALSE;
+    inlen = EndGetI16(pos+cfdata_CompressedSize);
+    pos += cfdata_SIZEOF;
+    if (fdi->read(CAB(cabhf), pos, inlen) != inlen) return FALSE;
+    pos += inlen;
+  }
+  return TRUE;
+}
+
+static void fdi_free_folder_job(struct fdi_folder_job *job)
+{
+  HeapFree(GetProcessHeap(), 0, job->input);
+  HeapFree(GetProcessHeap(), 0, job->output);
+  HeapFree(GetProcessHeap(), 0, job->block_end);
+}
+
+static void fdi_wait_parallel_decode(struct fdi_parallel *parallel)
+{
+  unsigned int i;
+
+  if (!parallel->thread_count) return;
+  WaitForMultipleObjects(parallel->thread_count, parallel->threads, TRUE, INFINITE);
+  for (i = 0; i < parallel->thread_count; i++) CloseHandle(parallel->threads[i]);
+  parallel->thread_count = 0;
+}
+
+static void fdi_end_parallel_decode(FDI_Int *fdi, struct fdi_parallel *parallel)
+{
+  LONG i;
+
+  if (!parallel) return;
+  /* don't start any more folders */
+  InterlockedExchange(&parallel->next_job, parallel->job_count);
+  fdi_wait_parallel_decode(parallel);
+  for (i = 0; i < parallel->job_count; i++) fdi_free_folder_job(&parallel->jobs[i]);
+  fdi->free(parallel->jobs);
+  fdi->free(parallel);
+}
+
+static struct fdi_parallel *fdi_start_parallel_decode(FDI_Int *fdi, fdi_decomp_state *decomp_state)
+{
+  struct fdi_parallel *parallel;
+  struct fdi_folder *fol, *first = NULL;
+  struct fdi_file *file;
+  cab_ULONG budget = FDI_MAX_PREDECODE;
+  unsigned int threads, count = 0, index;
+
+  /* split cabinets chain decoder state across folders */
+  if (CAB(mii).hasnext || CAB(mii).prevname) return NULL;
+  if (!(threads = cabinet_get_thread_count())) return NULL;
+
+  for (file = CAB(firstfile); file; file = file->next)
+    if (file->index < cffileCONTINUED_FROM_PREV) break;
+  if (!file) return NULL;
+  for (fol = CAB(firstfol), index = 0; fol; fol = fol->next, index++) {
+    if (index == file->index) first = fol;
+    count++;
+  }
+  if (count < 2) return NULL;
+
+  if (!(parallel = fdi->alloc(sizeof(struct fdi_parallel)))) return NULL;
+  ZeroMemory(parallel, sizeof(struct fdi_parallel));
+  if (!(parallel->jobs = fdi->alloc(count * sizeof(struct fdi_folder_job)))) {
+    fdi->free(parallel);
+    return NULL;
+  }
+  parallel->fdi = *fdi;
+  parallel->fdi.alloc = fdi_heap_alloc;
+  parallel->fdi.free = fdi_heap_free;
+
+  for (fol = CAB(firstfol), index = 0; fol; fol = fol->next, index++) {
+    struct fdi_folder_job *job = &parallel->jobs[parallel->job_count];
+
+    if (fol == first) continue;
+    for (file = CAB(firstfile); file; file = file->next)
+      if (file->index == index) break;
+    if (!file) continue;
+
+    ZeroMemory(job, sizeof(*job));
+    job->fol = fol;
+    if (!fdi_read_folder(fdi, decomp_state, job, budget)) {
+      fdi_free_folder_job(job);
+      continue;
+    }
+    budget -= job->output_size;
+    parallel->job_count++;
+  }
+
+  threads = min(threads, parallel->job_count);
+  while (parallel->thread_count < threads) {
+    HANDLE thread = CreateThread(NULL, 0, fdi_decode_thread, parallel, 0, NULL);
+    if (!thread) break;
+    parallel->threads[parallel->thread_count++] = thread;
+  }
+  if (!parallel->thread_count) {
+    fdi_end_parallel_decode(fdi, parallel);
+    return NULL;
+  }
+  TRACE("decoding %d folders on %u threads\n", parallel->job_count, parallel->thread_count);
+  return parallel;
+}
+
+/* return the decoded folder if it covers the file, waiting for the workers if needed */
+static const struct fdi_folder_job *fdi_get_decoded_folder(struct fdi_parallel *parallel,
+  const struct fdi_folder *fol, const struct fdi_file *fi)
+{
+  LONG i;
+
+  for (i = 0; i < parallel->job_count; i++)
+    if (parallel->jobs[i].fol == fol) break;
+  if (i == parallel->job_count) return NULL;
+
+  fdi_wait_parallel_decode(parallel);
+  if (!parallel->jobs[i].done) return NULL;
+  if (fi->offset > parallel->jobs[i].output_size ||
+      fi->length > parallel->jobs[i].output_size - fi->offset) return NULL;
+  return &parallel->jobs[i];
+}
+
+/* write a file from a decoded folder, split at the same block boundaries as fdi_decomp */
+static void fdi_write_decoded(FDI_Int *fdi, const struct fdi_folder_job *job,
+  const struct fdi_file *fi, INT_PTR filehf)
+{
+  cab_ULONG pos = fi->offset, end = fi->offset + fi->length, cando;
+  unsigned int i = 0;
+
+  while (pos < end) {
+    while (job->block_end[i] <= pos) i++;
+    cando = min(job->block_end[i], end) - pos;
+    fdi->write(filehf, job->output + pos, cando);
+    pos += cando;
+  }
+}
+
 /***********************************************************************
  *		FDICopy (CABINET.22)
  *
@@ -2435,6 +2766,7 @@ BOOL __cdecl FDICopy(
   struct fdi_folder *fol = NULL, *linkfol = NULL; 
   struct fdi_file   *file = NULL, *linkfile = NULL;
   fdi_decomp_state *decomp_state;
+  struct fdi_parallel *parallel = NULL;
   FDI_Int *fdi = get_fdi_ptr( hfdi );
 
   TRACE("(hfdi == ^%p, pszCabinet == %s, pszCabPath == %s, flags == %x, "
@@ -2567,6 +2899,8 @@ BOOL __cdecl FDICopy(
     linkfile = file;
   }
 
+  parallel = fdi_start_parallel_decode(fdi, decomp_state);
+
   for (file = CAB(firstfile); (file); file = file->next) {
 
     /*
@@ -2667,6 +3001,7 @@ BOOL __cdecl FDICopy(
       cab_UWORD comptype = fol->comp_type;
       int ct1 = comptype & cffoldCOMPTYPE_MASK;
       int ct2 = CAB(current) ? (CAB(current)->comp_type & cffoldCOMPTYPE_MASK) : 0;
+      const struct fdi_folder_job *job;
       int err = 0;
 
       TRACE("Extracting file %s as requested by callee.\n", debugstr_a(file->filename));
@@ -2675,6 +3010,14 @@ BOOL __cdecl FDICopy(
       CAB(fdi) = fdi;
       CAB(filehf) = filehf;
 
+      /* Already decoded on a worker thread? */
+      if (parallel && (job = fdi_get_decoded_folder(parallel, fol, file))) {
+        fdi_write_decoded(fdi, job, file, filehf);
+        /* the serial decompressor is left alone */
+        fol = CAB(current);
+        goto close_file;
+      }
+
       /* Was there a change of folder?  Compression type?  Did we somehow go backwards? */
       if ((ct1 != ct2) || (CAB(current) != fol) || (file->offset < CAB(offset))) {
 
@@ -2702,24 +3045,7 @@ BOOL __cdecl FDICopy(
         CAB(outlen) = 0;
 
         /* initialize the new decompressor */
-        switch (ct1) {
-        case cffoldCOMPTYPE_NONE:
-          CAB(decompress) = NONEfdi_decomp;
-          break;
-        case cffoldCOMPTYPE_MSZIP:
-          CAB(decompress) = ZIPfdi_decomp;
-          break;
-        case cffoldCOMPTYPE_QUANTUM:
-          CAB(decompress) = QTMfdi_decomp;
-          err = QTMfdi_init((comptype >> 8) & 0x1f, (comptype >> 4) & 0xF, decomp_state);
-          break;
-        case cffoldCOMPTYPE_LZX:
-          CAB(decompress) = LZXfdi_decomp;
-          err = LZXfdi_init((comptype >> 8) & 0x1f, decomp_state);
-          break;
-        default:
-          err = DECR_DATAFORMAT;
-        }
+        err = fdi_init_decompressor(comptype, decomp_state);
       }
 
       CAB(current) = fol;
@@ -2757,6 +3083,7 @@ BOOL __cdecl FDICopy(
       err = fdi_decomp(file, 1, decomp_state, pszCabPath, pfnfdin, pvUser);
       if (err) CAB(current) = NULL; else CAB(offset) += file->length;
 
+      close_file:
       /* fdintCLOSE_FILE_INFO notification */
       ZeroMemory(&fdin, sizeof(FDINOTIFICATION));
       fdin.pv = pvUser;
@@ -2786,6 +3113,7 @@ BOOL __cdecl FDICopy(
     }
   }
 
+  fdi_end_parallel_decode(fdi, parallel);
   if (fol) free_decompression_temps(fdi, fol, decomp_state);
   free_decompression_mem(fdi, decomp_state);
  
@@ -2793,6 +3121,7 @@ BOOL __cdecl FDICopy(
 
   bail_and_fail: /* here we free ram before error returns */
 
+  fdi_end_parallel_decode(fdi, parallel);
   if (fol) free_decompression_temps(fdi, fol, decomp_state);
 
   if (filehf) fdi->close(filehf);
@@ -949,6 +949,265 @@ static void test_FDICopy(void)
     FDIDestroy(hfdi);
 }
 
+static void fill_folder_data(char *buffer, DWORD size, DWORD seed)
+{
+    DWORD i;
+
+    for (i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        /* mostly repetitive so that matches cross block boundaries */
+        buffer[i] = (i % 97 < 60) ? "cabinet"[i % 7] : (char)(seed >> 16);
+    }
+}
+
+struct folder_output
+{
+    char *data;
+    DWORD size;
+    DWORD pos;
+};
+
+static UINT CDECL fdi_folder_write(INT_PTR hf, void *pv, UINT cb)
+{
+    struct folder_output *out = (struct folder_output *)hf;
+
+    if (out->pos + cb > out->size) return -1;
+    memcpy(out->data + out->pos, pv, cb);
+    out->pos += cb;
+    return cb;
+}
+
+static struct folder_output folder_outputs[6];
+
+static int CDECL fdi_folder_close(INT_PTR hf)
+{
+    struct folder_output *out = (struct folder_output *)hf;
+
+    if (out >= folder_outputs && out < folder_outputs + ARRAY_SIZE(folder_outputs)) return 0;
+    return fdi_close(hf);
+}
+
+static INT_PTR CDECL fdi_folder_notify(FDINOTIFICATIONTYPE fdint, FDINOTIFICATION *info)
+{
+    if (fdint == fdintCOPY_FILE)
+    {
+        struct folder_output *out = &folder_outputs[info->psz1[1] - '0'];
+
+        ok(info->cb == out->size, "expected %u, got %d\n", out->size, info->cb);
+        out->pos = 0;
+        return (INT_PTR)out;
+    }
+    return 0;
+}
+
+static void test_FDICopy_folders(void)
+{
+    static const DWORD sizes[6] = { 70000, 100, 140000, 32768, 0, 90001 };
+    char name[] = "folders.cab", path[MAX_PATH + 1], file[3];
+    char *expected[6];
+    const char *threads[] = { NULL, "4" };
+    CCAB cabParams;
+    HFDI hfdi;
+    HFCI hfci;
+    ERF erf;
+    BOOL ret;
+    HANDLE handle;
+    DWORD written;
+    int i, j;
+
+    set_cab_parameters(&cabParams);
+    lstrcpyA(cabParams.szCab, name);
+
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek,
+                     fci_delete, get_temp_file, &cabParams, NULL);
+    ok(hfci != NULL, "Failed to create an FCI context\n");
+
+    for (i = 0; i < 6; i++)
+    {
+        sprintf(file, "f%d", i);
+        expected[i] = HeapAlloc(GetProcessHeap(), 0, sizes[i] + 1);
+        fill_folder_data(expected[i], sizes[i], i);
+        handle = CreateFileA(file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        ok(handle != INVALID_HANDLE_VALUE, "Failed to create %s\n", file);
+        WriteFile(handle, expected[i], sizes[i], &written, NULL);
+        CloseHandle(handle);
+
+        add_file(hfci, file);
+        /* one folder per file, except for the last two */
+        if (i < 4)
+        {
+            ret = FCIFlushFolder(hfci, get_next_cabinet, progress);
+            ok(ret, "Failed to flush the folder\n");
+        }
+        folder_outputs[i].data = HeapAlloc(GetProcessHeap(), 0, sizes[i] + 1);
+        folder_outputs[i].size = sizes[i];
+    }
+
+    ret = FCIFlushCabinet(hfci, FALSE, get_next_cabinet, progress);
+    ok(ret, "Failed to flush the cabinet\n");
+    FCIDestroy(hfci);
+
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+
+    /* folders are decoded on worker threads when requested, the result must not change */
+    for (j = 0; j < ARRAY_SIZE(threads); j++)
+    {
+        SetEnvironmentVariableA("WINE_CABINET_THREADS", threads[j]);
+
+        hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read,
+                         fdi_folder_write, fdi_folder_close, fdi_seek,
+                         cpuUNKNOWN, &erf);
+        ok(hfdi != NULL, "FDICreate error %d\n", erf.erfOper);
+
+        for (i = 0; i < 6; i++) folder_outputs[i].pos = ~0u;
+        ret = FDICopy(hfdi, name, path, 0, fdi_folder_notify, NULL, 0);
+        ok(ret, "FDICopy error %d\n", erf.erfOper);
+
+        for (i = 0; i < 6; i++)
+        {
+            ok(folder_outputs[i].pos == sizes[i], "%d: got %u bytes for file %d\n", j,
+               folder_outputs[i].pos, i);
+            ok(!memcmp(folder_outputs[i].data, expected[i], sizes[i]),
+               "%d: wrong data for file %d\n", j, i);
+        }
+
+        FDIDestroy(hfdi);
+    }
+    SetEnvironmentVariableA("WINE_CABINET_THREADS", NULL);
+
+    for (i = 0; i < 6; i++)
+    {
+        sprintf(file, "f%d", i);
+        DeleteFileA(file);
+        HeapFree(GetProcessHeap(), 0, expected[i]);
+        HeapFree(GetProcessHeap(), 0, folder_outputs[i].data);
+    }
+    DeleteFileA(name);
+}
+
+static BOOL CDECL get_next_span_cabinet(PCCAB pccab, ULONG cbPrevCab, void *pv)
+{
+    sprintf(pccab->szCab, "%s%d.cab", (const char *)pv, pccab->iCab);
+    return TRUE;
+}
+
+static char *read_cabinet(const char *name, DWORD *size)
+{
+    HANDLE handle;
+    DWORD read;
+    char *data;
+
+    handle = CreateFileA(name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return NULL;
+    *size = GetFileSize(handle, NULL);
+    data = HeapAlloc(GetProcessHeap(), 0, *size + 1);
+    ReadFile(handle, data, *size, &read, NULL);
+    ok(read == *size, "read %u of %u bytes from %s\n", read, *size, name);
+    CloseHandle(handle);
+    return data;
+}
+
+static void create_span_cabinets(const char *prefix, const DWORD *sizes, int count)
+{
+    char file[3];
+    CCAB cabParams;
+    HFCI hfci;
+    ERF erf;
+    BOOL ret;
+    int i;
+
+    set_cab_parameters(&cabParams);
+    cabParams.cb = 100000;
+    cabParams.cbFolderThresh = 150000;
+    cabParams.iCab = 1;
+    get_next_span_cabinet(&cabParams, 0, (void *)prefix);
+
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek,
+                     fci_delete, get_temp_file, &cabParams, (void *)prefix);
+    ok(hfci != NULL, "Failed to create an FCI context\n");
+
+    for (i = 0; i < count; i++)
+    {
+        sprintf(file, "f%d", i);
+        ret = FCIAddFile(hfci, file, file, FALSE, get_next_span_cabinet, progress,
+                         get_open_info, tcompTYPE_MSZIP);
+        ok(ret, "%s: Failed to add %s\n", prefix, file);
+        if (i == 1)
+        {
+            ret = FCIFlushFolder(hfci, get_next_span_cabinet, progress);
+            ok(ret, "%s: Failed to flush the folder\n", prefix);
+        }
+    }
+
+    ret = FCIFlushCabinet(hfci, FALSE, get_next_span_cabinet, progress);
+    ok(ret, "%s: Failed to flush the cabinet\n", prefix);
+    FCIDestroy(hfci);
+}
+
+static void test_FCI_threads(void)
+{
+    static const DWORD sizes[4] = { 300000, 70000, 250000, 180000 };
+    char file[3], serial_name[16], threaded_name[16];
+    char *serial, *threaded, *data;
+    DWORD serial_size, threaded_size;
+    HANDLE handle;
+    DWORD written;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        sprintf(file, "f%d", i);
+        data = HeapAlloc(GetProcessHeap(), 0, sizes[i]);
+        fill_folder_data(data, sizes[i], i);
+        handle = CreateFileA(file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        ok(handle != INVALID_HANDLE_VALUE, "Failed to create %s\n", file);
+        WriteFile(handle, data, sizes[i], &written, NULL);
+        CloseHandle(handle);
+        HeapFree(GetProcessHeap(), 0, data);
+    }
+
+    /* the cabinets span several folders and cabinets, so that the order in
+     * which compressed blocks are retired and the checksums of blocks split
+     * across cabinets are covered */
+    SetEnvironmentVariableA("WINE_CABINET_THREADS", NULL);
+    create_span_cabinets("serial", sizes, ARRAY_SIZE(sizes));
+    SetEnvironmentVariableA("WINE_CABINET_THREADS", "4");
+    create_span_cabinets("threaded", sizes, ARRAY_SIZE(sizes));
+    SetEnvironmentVariableA("WINE_CABINET_THREADS", NULL);
+
+    for (i = 1; ; i++)
+    {
+        sprintf(serial_name, "serial%d.cab", i);
+        sprintf(threaded_name, "threaded%d.cab", i);
+        serial = read_cabinet(serial_name, &serial_size);
+        threaded = read_cabinet(threaded_name, &threaded_size);
+        ok(!serial == !threaded, "%d: serial %p, threaded %p\n", i, serial, threaded);
+        if (serial && threaded)
+        {
+            ok(serial_size == threaded_size, "%d: serial size %u, threaded size %u\n", i,
+               serial_size, threaded_size);
+            ok(serial_size == threaded_size && !memcmp(serial, threaded, serial_size),
+               "%d: cabinets differ\n", i);
+        }
+        HeapFree(GetProcessHeap(), 0, serial);
+        HeapFree(GetProcessHeap(), 0, threaded);
+        if (!serial && !threaded) break;
+        DeleteFileA(serial_name);
+        DeleteFileA(threaded_name);
+    }
+    ok(i > 2, "expected the data to span several cabinets, got %d\n", i - 1);
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        sprintf(file, "f%d", i);
+        DeleteFileA(file);
+    }
+}
+
 
 START_TEST(fdi)
 {
@@ -956,4 +1215,6 @@ START_TEST(fdi)
     test_FDIDestroy();
     test_FDIIsCabinet();
     test_FDICopy();
+    test_FDICopy_folders();
+    test_FCI_threads();
 }
@@ -50,6 +50,34 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(dsound);
 
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <xmmintrin.h>
+#define HAVE_SSE_MIXER
+#define SSE_FUNC __attribute__((target("sse")))
+
+/* Setting WINE_DSOUND_SSE to 0 forces the scalar code, which gives the same
+ * results, so that the two can be compared. */
+static BOOL use_sse(void)
+{
+    static int enabled = -1;
+    char buffer[4];
+
+    if (enabled == -1)
+    {
+#ifdef __i386__
+        BOOL supported = IsProcessorFeaturePresent( PF_XMMI_INSTRUCTIONS_AVAILABLE );
+#else
+        BOOL supported = TRUE;
+#endif
+        if (GetEnvironmentVariableA( "WINE_DSOUND_SSE", buffer, sizeof(buffer) ) && buffer[0] == '0')
+            supported = FALSE;
+        enabled = supported;
+    }
+    return enabled;
+}
+#endif
+
 #ifdef WORDS_BIGENDIAN
 #define le16(x) RtlUshortByteSwap((x))
 #define le32(x) RtlUlongByteSwap((x))
@@ -153,14 +181,14 @@ static inline LONG f_to_32(float value)
 
 void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
 {
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
+    BYTE *buf = (BYTE *)dsb->tmp_buffer;
     float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
     *fbuf = value;
 }
 
 void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
 {
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
+    BYTE *buf = (BYTE *)dsb->tmp_buffer;
     float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
     *fbuf += value;
 }
@@ -280,13 +308,146 @@ void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel
     }
 }
 
+#ifdef HAVE_SSE_MIXER
+static unsigned SSE_FUNC mixieee32_sse(const float *src, float *dst, unsigned samples)
+{
+    unsigned i;
+
+    for (i = 0; i + 8 <= samples; i += 8)
+    {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_loadu_ps(src + i + 4)));
+    }
+    return i;
+}
+
+/* volumes holds the per channel factors repeated over 4 frames */
+static unsigned SSE_FUNC scaleieee32_sse(float *buf, const float *volumes, unsigned channels, unsigned frames)
+{
+    unsigned i, j, samples = (frames & ~3) * channels;
+
+    for (i = 0; i < samples; i += 4 * channels)
+        for (j = 0; j < 4 * channels; j += 4)
+            _mm_storeu_ps(buf + i + j, _mm_mul_ps(_mm_loadu_ps(buf + i + j), _mm_loadu_ps(volumes + j)));
+    return frames & ~3;
+}
+
+static unsigned SSE_FUNC fir_interpolate_sse(float *dst, const float *coefs, unsigned step, unsigned count, float rem)
+{
+    const __m128 r = _mm_set1_ps(rem), r1 = _mm_set1_ps(1.0f - rem);
+    __m128 a, b;
+    unsigned i;
+
+    for (i = 0; i + 4 <= count; i += 4, coefs += 4 * step)
+    {
+        a = _mm_setr_ps(coefs[0], coefs[step], coefs[2 * step], coefs[3 * step]);
+        b = _mm_setr_ps(coefs[1], coefs[step + 1], coefs[2 * step + 1], coefs[3 * step + 1]);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(a, r1), _mm_mul_ps(b, r)));
+    }
+    return i;
+}
+
+static float SSE_FUNC fir_dot_sse(const float *coefs, const float *samples, unsigned count)
+{
+    __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+    float ret[4];
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(coefs + i), _mm_loadu_ps(samples + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(coefs + i + 4), _mm_loadu_ps(samples + i + 4)));
+    }
+    if (i + 4 <= count)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(coefs + i), _mm_loadu_ps(samples + i)));
+        i += 4;
+    }
+    _mm_storeu_ps(ret, _mm_add_ps(sum0, sum1));
+    ret[0] += ret[1] + ret[2] + ret[3];
+    for (; i < count; i++) ret[0] += coefs[i] * samples[i];
+    return ret[0];
+}
+#endif
+
 void mixieee32(float *src, float *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
+#ifdef HAVE_SSE_MIXER
+    if (use_sse())
+    {
+        unsigned done = mixieee32_sse(src, dst, samples);
+        src += done;
+        dst += done;
+        samples -= done;
+    }
+#endif
     while (samples--)
         *(dst++) += *(src++);
 }
 
+/* Multiply each frame of an interleaved float buffer by the per channel
+ * volumes, channels must not be larger than DS_MAX_CHANNELS. */
+void scaleieee32(float *buf, const float *volumes, unsigned channels, unsigned frames)
+{
+    unsigned i, chan;
+
+#ifdef HAVE_SSE_MIXER
+    if (use_sse())
+    {
+        float pattern[4 * DS_MAX_CHANNELS];
+        unsigned done;
+
+        for (i = 0; i < 4 * channels; i++) pattern[i] = volumes[i % channels];
+        done = scaleieee32_sse(buf, pattern, channels, frames);
+        buf += done * channels;
+        frames -= done;
+    }
+#endif
+    for (i = 0; i < frames; i++)
+        for (chan = 0; chan < channels; chan++)
+            *(buf++) *= volumes[chan];
+}
+
+/* Interpolate count filter coefficients taken every step entries from
+ * coefs, between each coefficient and the next one. */
+void fir_interpolate(float *dst, const float *coefs, unsigned step, unsigned count, float rem)
+{
+    unsigned i = 0;
+
+#ifdef HAVE_SSE_MIXER
+    if (use_sse()) i = fir_interpolate_sse(dst, coefs, step, count, rem);
+#endif
+    for (coefs += i * step; i < count; i++, coefs += step)
+        dst[i] = coefs[0] * (1.0f - rem) + coefs[1] * rem;
+}
+
+/* The sums are done in the same order as in the SSE code. */
+float fir_dot(const float *coefs, const float *samples, unsigned count)
+{
+    float sum[8] = { 0 }, ret;
+    unsigned i, j;
+
+#ifdef HAVE_SSE_MIXER
+    if (use_sse()) return fir_dot_sse(coefs, samples, count);
+#endif
+    for (i = 0; i + 8 <= count; i += 8)
+        for (j = 0; j < 8; j++)
+            sum[j] += coefs[i + j] * samples[i + j];
+    if (i + 4 <= count)
+    {
+        for (j = 0; j < 4; j++)
+            sum[j] += coefs[i + j] * samples[i + j];
+        i += 4;
+    }
+    for (j = 0; j < 4; j++)
+        sum[j] += sum[j + 4];
+    ret = sum[0] + (sum[1] + sum[2] + sum[3]);
+    for (; i < count; i++)
+        ret += coefs[i] * samples[i];
+    return ret;
+}
+
 static void norm8(float *src, unsigned char *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
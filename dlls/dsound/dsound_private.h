@@ -50,6 +50,9 @@ extern const bitsgetfunc getbpp[5] DECLSPEC_HIDDEN;
 void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void mixieee32(float *src, float *dst, unsigned samples) DECLSPEC_HIDDEN;
+void scaleieee32(float *buf, const float *volumes, unsigned channels, unsigned frames) DECLSPEC_HIDDEN;
+void fir_interpolate(float *dst, const float *coefs, unsigned step, unsigned count, float rem) DECLSPEC_HIDDEN;
+float fir_dot(const float *coefs, const float *samples, unsigned count) DECLSPEC_HIDDEN;
 typedef void (*normfunc)(const void *, void *, unsigned);
 extern const normfunc normfunctions[4] DECLSPEC_HIDDEN;
 
@@ -66,6 +69,11 @@ typedef struct DSFilter {
     IMediaObjectInPlace* inplace;
 } DSFilter;
 
+typedef struct DSMixScratch {
+    float *buffer;
+    DWORD len;
+} DSMixScratch;
+
 /*****************************************************************************
  * IDirectSoundDevice implementation structure
  */
@@ -89,8 +97,7 @@ struct DirectSoundDevice
     int                         speaker_num[DS_MAX_CHANNELS];
     int                         num_speakers;
     int                         lfe_channel;
-    float *tmp_buffer, *cp_buffer;
-    DWORD                       tmp_buffer_len, cp_buffer_len;
+    DSMixScratch                tmp_scratch, cp_scratch;
 
     DSVOLUMEPAN                 volpan;
 
@@ -166,6 +173,7 @@ struct IDirectSoundBufferImpl
     int                         mix_channels;
     bitsgetfunc get, get_aux;
     bitsputfunc put, put_aux;
+    float                      *tmp_buffer; /* destination of put while mixing */
     int                         num_filters;
     DSFilter*                   filters;
 
@@ -25,6 +25,7 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <math.h>	/* Insomnia - pow() function */
+#include <stdlib.h>
 
 #define COBJMACROS
 
@@ -278,6 +279,25 @@ static inline float get_current_sample(const IDirectSoundBufferImpl *dsb,
     return dsb->get(dsb, mixpos % dsb->buflen, channel);
 }
 
+static float *get_mix_scratch(DSMixScratch *scratch, DWORD len)
+{
+    float *buffer;
+
+    if (scratch->buffer && len <= scratch->len)
+        return scratch->buffer;
+
+    if (scratch->buffer)
+        buffer = HeapReAlloc(GetProcessHeap(), 0, scratch->buffer, len);
+    else
+        buffer = HeapAlloc(GetProcessHeap(), 0, len);
+    if (!buffer)
+        return NULL;
+
+    scratch->buffer = buffer;
+    scratch->len = len;
+    return buffer;
+}
+
 static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
 {
     UINT istride = dsb->pwfx->nBlockAlign;
@@ -290,7 +310,8 @@ static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
     return count;
 }
 
-static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
+static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum,
+        DSMixScratch *cp_scratch)
 {
     UINT i, channel;
     UINT istride = dsb->pwfx->nBlockAlign;
@@ -310,15 +331,14 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
     len += fir_cachesize;
     len *= sizeof(float);
 
-    if (!dsb->device->cp_buffer) {
-        dsb->device->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
-        dsb->device->cp_buffer_len = len;
-    } else if (len > dsb->device->cp_buffer_len) {
-        dsb->device->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->cp_buffer, len);
-        dsb->device->cp_buffer_len = len;
+    if (!(fir_copy = get_mix_scratch(cp_scratch, len))) {
+        WARN("out of memory, skipping %u frames\n", count);
+        for (i = 0; i < count; ++i)
+            for (channel = 0; channel < channels; channel++)
+                dsb->put(dsb, i * ostride, channel, 0.0f);
+        *freqAccNum = freqAcc_end % dsb->freqAdjustDen;
+        return max_ipos;
     }
-
-    fir_copy = dsb->device->cp_buffer;
     intermediate = fir_copy + fir_cachesize;
 
 
@@ -333,28 +353,22 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
                     dsb->sec_mixpos + i * istride, channel);
 
     for(i = 0; i < count; ++i) {
-        UINT int_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / dsb->freqAdjustDen;
-        float total_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / (float)dsb->freqAdjustDen;
+        LONG64 fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep;
+        UINT int_fir_steps = fir_steps / dsb->freqAdjustDen;
         UINT ipos = int_fir_steps / dsbfirstep;
 
         UINT idx = (ipos + 1) * dsbfirstep - int_fir_steps - 1;
-        float rem = int_fir_steps + 1.0 - total_fir_steps;
+        /* taken from the remainder, so that it doesn't depend on where the mixes start */
+        float rem = 1.0f - (fir_steps % dsb->freqAdjustDen) / (float)dsb->freqAdjustDen;
 
-        int fir_used = 0;
-        while (idx < fir_len - 1) {
-            fir_copy[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
-            idx += dsb->firstep;
-        }
+        UINT fir_used = idx < fir_len - 1 ? (fir_len - 2 - idx) / dsbfirstep + 1 : 0;
+        fir_interpolate(fir_copy, fir + idx, dsbfirstep, fir_used, rem);
 
         assert(fir_used <= fir_cachesize);
         assert(ipos + fir_used <= required_input);
 
         for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
-            float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
+            float sum = fir_dot(fir_copy, &intermediate[channel * required_input + ipos], fir_used);
             dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
         }
     }
@@ -364,14 +378,14 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
     return max_ipos;
 }
 
-static void cp_fields(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
+static void cp_fields(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum, DSMixScratch *cp_scratch)
 {
     DWORD ipos, adv;
 
     if (dsb->freqAdjustNum == dsb->freqAdjustDen)
         adv = cp_fields_noresample(dsb, count); /* *freqAccNum is unmodified */
     else
-        adv = cp_fields_resample(dsb, count, freqAccNum);
+        adv = cp_fields_resample(dsb, count, freqAccNum, cp_scratch);
 
     ipos = dsb->sec_mixpos + adv * dsb->pwfx->nBlockAlign;
     if (ipos >= dsb->buflen) {
@@ -402,41 +416,38 @@ static inline DWORD DSOUND_BufPtrDiff(DWORD buflen, DWORD ptr1, DWORD ptr2)
 	}
 }
 /**
- * Mix at most the given amount of data into the allocated temporary buffer
- * of the given secondary buffer, starting from the dsb's first currently
- * unsampled frame (writepos), translating frequency (pitch), stereo/mono
- * and bits-per-sample so that it is ideal for the primary buffer.
+ * Mix at most the given amount of data into the given temporary buffer,
+ * starting from the dsb's first currently unsampled frame (writepos),
+ * translating frequency (pitch), stereo/mono and bits-per-sample so that
+ * it is ideal for the primary buffer.
  * Doesn't perform any mixing - this is a straight copy/convert operation.
  *
  * dsb = the secondary buffer
- * writepos = Starting position of changed buffer
- * len = number of bytes to resample from writepos
+ * tmp_buffer = the temporary buffer, large enough for frames
+ * cp_scratch = scratch space for the resampler
+ * frames = number of frames to resample from writepos
  *
  * NOTE: writepos + len <= buflen. When called by mixer, MixOne makes sure of this.
  */
-static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
+static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, float *tmp_buffer, DSMixScratch *cp_scratch, DWORD frames)
 {
-	UINT size_bytes = frames * sizeof(float) * dsb->device->pwfx->nChannels;
+	UINT channels = dsb->device->pwfx->nChannels;
+	UINT size_bytes = frames * sizeof(float) * channels;
 	HRESULT hr;
 	int i;
 
-	if (dsb->device->tmp_buffer_len < size_bytes || !dsb->device->tmp_buffer)
-	{
-		dsb->device->tmp_buffer_len = size_bytes;
-		if (dsb->device->tmp_buffer)
-			dsb->device->tmp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->tmp_buffer, size_bytes);
-		else
-			dsb->device->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
-	}
-	if(dsb->put_aux == putieee32_sum)
-		memset(dsb->device->tmp_buffer, 0, dsb->device->tmp_buffer_len);
+	dsb->tmp_buffer = tmp_buffer;
+
+	/* clear the buffer if put doesn't write every channel once */
+	if(dsb->put_aux == putieee32_sum || (dsb->put == putieee32 && dsb->mix_channels < channels))
+		memset(tmp_buffer, 0, size_bytes);
 
-	cp_fields(dsb, frames, &dsb->freqAccNum);
+	cp_fields(dsb, frames, &dsb->freqAccNum, cp_scratch);
 
 	if (size_bytes > 0) {
 		for (i = 0; i < dsb->num_filters; i++) {
 			if (dsb->filters[i].inplace) {
-				hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, size_bytes, (BYTE*)dsb->device->tmp_buffer, 0, DMO_INPLACE_NORMAL);
+				hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, size_bytes, (BYTE*)tmp_buffer, 0, DMO_INPLACE_NORMAL);
 
 				if (FAILED(hr))
 					WARN("IMediaObjectInPlace_Process failed for filter %u\n", i);
@@ -446,11 +457,11 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	}
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, float *tmp_buffer, INT frames)
 {
 	INT	i;
 	float vols[DS_MAX_CHANNELS];
-	UINT channels = dsb->device->pwfx->nChannels, chan;
+	UINT channels = dsb->device->pwfx->nChannels;
 
 	TRACE("(%p,%d)\n",dsb,frames);
 	TRACE("left = %x, right = %x\n", dsb->volpan.dwTotalAmpFactor[0],
@@ -470,42 +481,36 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
 
-	for(i = 0; i < frames; ++i){
-		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
-		}
-	}
+	scaleieee32(tmp_buffer, vols, channels, frames);
 }
 
 /**
- * Mix (at most) the given number of bytes into the given position of the
- * device buffer, from the secondary buffer "dsb" (starting at the current
- * mix position for that buffer).
+ * Convert (at most) the given number of frames from the secondary buffer
+ * "dsb" (starting at the current mix position for that buffer) into ibuf,
+ * in the device format with the volume applied.
  *
- * Returns the number of bytes actually mixed into the device buffer. This
- * will match fraglen unless the end of the secondary buffer is reached
+ * Returns the number of frames actually written to ibuf. This
+ * will match frames unless the end of the secondary buffer is reached
  * (and it is not looping).
  *
  * dsb  = the secondary buffer to mix from
- * fraglen = number of bytes to mix
+ * ibuf = the temporary buffer, large enough for frames
+ * cp_scratch = scratch space for the resampler
+ * frames = number of frames to mix
  */
-static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
+static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *ibuf, DSMixScratch *cp_scratch, DWORD frames)
 {
-	float *ibuf;
 	DWORD oldpos;
 
 	TRACE("sec_mixpos=%d/%d\n", dsb->sec_mixpos, dsb->buflen);
 	TRACE("(%p, frames=%d)\n",dsb,frames);
 
-	/* Resample buffer to temporary buffer specifically allocated for this purpose, if needed */
+	/* Resample buffer to the temporary buffer */
 	oldpos = dsb->sec_mixpos;
-	DSOUND_MixToTemporary(dsb, frames);
-	ibuf = dsb->device->tmp_buffer;
+	DSOUND_MixToTemporary(dsb, ibuf, cp_scratch, frames);
 
 	/* Apply volume if needed */
-	DSOUND_MixerVol(dsb, frames);
-
-	mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+	DSOUND_MixerVol(dsb, ibuf, frames);
 
 	/* check for notification positions */
 	if (dsb->dsbd.dwFlags & DSBCAPS_CTRLPOSITIONNOTIFY &&
@@ -518,17 +523,18 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 }
 
 /**
- * Mix some frames from the given secondary buffer "dsb" into the device
- * primary buffer.
+ * Convert some frames from the given secondary buffer "dsb" into ibuf, to be
+ * added to the device primary buffer.
  *
  * dsb = the secondary buffer
- * playpos = the current play position in the device buffer (primary buffer)
+ * ibuf = the temporary buffer, large enough for frames
+ * cp_scratch = scratch space for the resampler
  * frames = the maximum number of frames in the primary buffer to mix, from the
  *          current writepos.
  *
- * Returns: the number of frames beyond the writepos that were mixed.
+ * Returns: the number of frames written to ibuf, from the writepos.
  */
-static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
+static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *ibuf, DSMixScratch *cp_scratch, DWORD frames)
 {
 	DWORD primary_done = 0;
 
@@ -553,12 +559,283 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
 	/* First try to mix to the end of the buffer if possible
 	 * Theoretically it would allow for better optimization
 	*/
-	primary_done += DSOUND_MixInBuffer(dsb, mix_buffer, frames);
+	frames = DSOUND_MixInBuffer(dsb, ibuf, cp_scratch, frames);
+
+	TRACE("total mixed data=%d\n", primary_done + frames);
+
+	return frames;
+}
+
+/**
+ * Convert the next frames of the given secondary buffer into ibuf if it is
+ * playing, and update its state.
+ *
+ * Returns: the number of frames written to ibuf, 0 if the buffer is stopped.
+ */
+static DWORD DSOUND_MixBuffer(IDirectSoundBufferImpl *dsb, float *ibuf, DSMixScratch *cp_scratch, DWORD frames)
+{
+	DWORD mixed = 0;
+
+	TRACE("MixToPrimary for %p, state=%d\n", dsb, dsb->state);
+
+	if (dsb->buflen && dsb->state) {
+		TRACE("Checking %p, frames=%d\n", dsb, frames);
+		RtlAcquireResourceShared(&dsb->lock, TRUE);
+		/* if buffer is stopping it is stopped now */
+		if (dsb->state == STATE_STOPPING) {
+			dsb->state = STATE_STOPPED;
+			DSOUND_CheckEvent(dsb, 0, 0);
+		} else if (dsb->state != STATE_STOPPED) {
+
+			/* if the buffer was starting, it must be playing now */
+			if (dsb->state == STATE_STARTING)
+				dsb->state = STATE_PLAYING;
+
+			mixed = DSOUND_MixOne(dsb, ibuf, cp_scratch, frames);
+		}
+		RtlReleaseResource(&dsb->lock);
+	}
+	return mixed;
+}
+
+/*
+ * With many playing buffers, the buffers can be converted in parallel by a
+ * small pool of worker threads, the mixer thread taking its share.  Every
+ * buffer is converted into its own slot, and the slots are then added to
+ * the primary buffer in the order of the buffer list, split in ranges of
+ * samples.  Every sample is thus summed in the same order as when mixing on
+ * a single thread, and the result is identical.
+ *
+ * WINE_DSOUND_THREADS gives the total number of converting threads, the
+ * mixer thread included.  The workers are started on the first large mix
+ * and live as long as the process, dsound pins itself when it's attached.
+ */
+
+#define MAX_MIX_THREADS       16
+#define MIN_THREADED_BUFFERS  8     /* don't bother with fewer playing buffers */
+#define MIN_SUM_SAMPLES       1024  /* minimum number of samples summed by a thread */
+
+static CRITICAL_SECTION mix_cs;
+static CRITICAL_SECTION_DEBUG mix_cs_debug =
+{
+    0, 0, &mix_cs,
+    { &mix_cs_debug.ProcessLocksList, &mix_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": mix_cs") }
+};
+static CRITICAL_SECTION mix_cs = { &mix_cs_debug, -1, 0, 0, 0, 0 };
+
+static CONDITION_VARIABLE mix_work_cv = CONDITION_VARIABLE_INIT;
+static CONDITION_VARIABLE mix_done_cv = CONDITION_VARIABLE_INIT;
+
+static int mix_threads = -1;      /* number of worker threads, -1 if not initialized yet */
+static BOOL mix_busy;             /* the workers are owned by a mixer thread */
+static unsigned int mix_generation;
+static unsigned int mix_active;   /* workers that haven't finished the current items */
+static LONG mix_next;             /* next item to process */
+static int mix_count;
+static void (*mix_func)( void *ctx, int item, int thread );
+static void *mix_ctx;
+
+/* only used by the owner of the workers */
+struct mix_slot
+{
+    IDirectSoundBufferImpl *dsb;
+    DWORD                   frames;  /* frames converted into the slot */
+};
+
+static DSMixScratch mix_cp_scratch[MAX_MIX_THREADS];
+static DSMixScratch mix_slots_buffer;
+static struct mix_slot *mix_slots;
+static int mix_slots_size;
+
+static void process_mix_items( int thread )
+{
+    int item;
+
+    while ((item = InterlockedIncrement( &mix_next ) - 1) < mix_count) mix_func( mix_ctx, item, thread );
+}
+
+static DWORD CALLBACK mix_thread( void *arg )
+{
+    unsigned int generation = 0;
+    int thread = (INT_PTR)arg;
+
+    EnterCriticalSection( &mix_cs );
+    for (;;)
+    {
+        while (generation == mix_generation) SleepConditionVariableCS( &mix_work_cv, &mix_cs, INFINITE );
+        generation = mix_generation;
+        LeaveCriticalSection( &mix_cs );
+
+        process_mix_items( thread );
+
+        EnterCriticalSection( &mix_cs );
+        if (!--mix_active) WakeConditionVariable( &mix_done_cv );
+    }
+    return 0;
+}
+
+/* must be called with mix_cs held */
+static void init_mix_threads(void)
+{
+    SYSTEM_INFO si;
+    char buffer[16];
+    int i, count = 0;
+    HANDLE thread;
+
+    mix_threads = 0;
+    if (GetEnvironmentVariableA( "WINE_DSOUND_THREADS", buffer, sizeof(buffer) ))
+    {
+        count = atoi( buffer );
+        GetSystemInfo( &si );
+        if (count > (int)si.dwNumberOfProcessors) count = si.dwNumberOfProcessors;
+        if (count > MAX_MIX_THREADS) count = MAX_MIX_THREADS;
+    }
+
+    /* the mixer thread converts buffers too, and uses index 0 */
+    for (i = 1; i < count; i++)
+    {
+        if (!(thread = CreateThread( NULL, 0, mix_thread, (void *)(INT_PTR)i, 0, NULL ))) break;
+        CloseHandle( thread );
+        mix_threads++;
+    }
+    if (mix_threads) TRACE( "using %d worker threads\n", mix_threads );
+}
+
+/* take ownership of the worker threads, returns FALSE if there are none or they are busy */
+static BOOL begin_threaded_mix(void)
+{
+    BOOL ret = FALSE;
+
+    if (!mix_threads) return FALSE;
+    EnterCriticalSection( &mix_cs );
+    if (mix_threads == -1) init_mix_threads();
+    if (mix_threads > 0 && !mix_busy) ret = mix_busy = TRUE;
+    LeaveCriticalSection( &mix_cs );
+    return ret;
+}
+
+static void end_threaded_mix(void)
+{
+    EnterCriticalSection( &mix_cs );
+    mix_busy = FALSE;
+    LeaveCriticalSection( &mix_cs );
+}
 
-	TRACE("total mixed data=%d\n", primary_done);
+/* call func for every item from 0 to count - 1, must own the worker threads */
+static void run_mix_items( void (*func)( void *ctx, int item, int thread ), void *ctx, int count )
+{
+    EnterCriticalSection( &mix_cs );
+    mix_func = func;
+    mix_ctx = ctx;
+    mix_count = count;
+    mix_next = 0;
+    mix_active = mix_threads;
+    mix_generation++;
+    WakeAllConditionVariable( &mix_work_cv );
+    LeaveCriticalSection( &mix_cs );
+
+    process_mix_items( 0 );
+
+    EnterCriticalSection( &mix_cs );
+    while (mix_active) SleepConditionVariableCS( &mix_done_cv, &mix_cs, INFINITE );
+    LeaveCriticalSection( &mix_cs );
+}
 
-	/* Report back the total prebuffered amount for this buffer */
-	return primary_done;
+struct threaded_mix
+{
+    float *mix_buffer;
+    float *slots;
+    DWORD  frames, channels;
+    DWORD  samples;          /* samples in a slot */
+    int    count;            /* number of slots */
+    int    ranges;           /* number of ranges to sum */
+};
+
+static void mix_slot_item( void *ctx, int item, int thread )
+{
+    struct threaded_mix *mix = ctx;
+
+    mix_slots[item].frames = DSOUND_MixBuffer( mix_slots[item].dsb, mix->slots + (SIZE_T)item * mix->samples,
+                                               &mix_cp_scratch[thread], mix->frames );
+}
+
+static void sum_slots_item( void *ctx, int item, int thread )
+{
+    struct threaded_mix *mix = ctx;
+    DWORD start = (ULONGLONG)mix->samples * item / mix->ranges;
+    DWORD end = (ULONGLONG)mix->samples * (item + 1) / mix->ranges;
+    DWORD len;
+    int i;
+
+    for (i = 0; i < mix->count; i++)
+    {
+        len = min( end, mix_slots[i].frames * mix->channels );
+        if (len > start) mixieee32( mix->slots + (SIZE_T)i * mix->samples + start, mix->mix_buffer + start, len - start );
+    }
+}
+
+/**
+ * Mix the playing buffers of the device on the worker threads.
+ *
+ * Returns: FALSE if there are too few playing buffers, or no idle workers.
+ */
+static BOOL DSOUND_MixToPrimaryThreaded(DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
+{
+	struct threaded_mix mix;
+	IDirectSoundBufferImpl *dsb;
+	struct mix_slot *slots;
+	int i, count = 0;
+
+	if (!mix_threads || device->nrofbuffers < MIN_THREADED_BUFFERS)
+		return FALSE;
+
+	for (i = 0; i < device->nrofbuffers; i++)
+		if (device->buffers[i]->buflen && device->buffers[i]->state) count++;
+	if (count < MIN_THREADED_BUFFERS || !begin_threaded_mix())
+		return FALSE;
+
+	if (count > mix_slots_size) {
+		if (mix_slots)
+			slots = HeapReAlloc(GetProcessHeap(), 0, mix_slots, count * sizeof(*slots));
+		else
+			slots = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*slots));
+		if (!slots) {
+			end_threaded_mix();
+			return FALSE;
+		}
+		mix_slots = slots;
+		mix_slots_size = count;
+	}
+
+	mix.mix_buffer = mix_buffer;
+	mix.frames = frames;
+	mix.channels = device->pwfx->nChannels;
+	mix.samples = frames * mix.channels;
+	if (!(mix.slots = get_mix_scratch(&mix_slots_buffer, count * mix.samples * sizeof(float)))) {
+		end_threaded_mix();
+		return FALSE;
+	}
+	mix.ranges = max(1, min(mix_threads + 1, mix.samples / MIN_SUM_SAMPLES));
+
+	/* the buffer list can't change while the mixer holds buffer_list_lock */
+	for (i = mix.count = 0; i < device->nrofbuffers && mix.count < count; i++) {
+		dsb = device->buffers[i];
+		if (dsb->buflen && dsb->state) mix_slots[mix.count++].dsb = dsb;
+	}
+
+	TRACE("(frames %d), %d buffers on %d threads\n", frames, mix.count, mix_threads + 1);
+
+	run_mix_items(mix_slot_item, &mix, mix.count);
+
+	*all_stopped = TRUE;
+	for (i = 0; i < mix.count; i++)
+		if (mix_slots[i].frames) *all_stopped = FALSE;
+
+	run_mix_items(sum_slots_item, &mix, mix.ranges);
+
+	end_threaded_mix();
+	return TRUE;
 }
 
 /**
@@ -571,39 +848,25 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
  * Returns:  the length beyond the writepos that was mixed to.
  */
 
-static void DSOUND_MixToPrimary(const DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
+static void DSOUND_MixToPrimary(DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
 {
 	INT i;
-	IDirectSoundBufferImpl	*dsb;
+	DWORD channels = device->pwfx->nChannels, mixed;
+	float *ibuf;
+
+	if (DSOUND_MixToPrimaryThreaded(device, mix_buffer, frames, all_stopped))
+		return;
 
 	/* unless we find a running buffer, all have stopped */
 	*all_stopped = TRUE;
 
 	TRACE("(frames %d)\n", frames);
+	ibuf = get_mix_scratch(&device->tmp_scratch, frames * channels * sizeof(float));
 	for (i = 0; i < device->nrofbuffers; i++) {
-		dsb = device->buffers[i];
-
-		TRACE("MixToPrimary for %p, state=%d\n", dsb, dsb->state);
-
-		if (dsb->buflen && dsb->state) {
-			TRACE("Checking %p, frames=%d\n", dsb, frames);
-			RtlAcquireResourceShared(&dsb->lock, TRUE);
-			/* if buffer is stopping it is stopped now */
-			if (dsb->state == STATE_STOPPING) {
-				dsb->state = STATE_STOPPED;
-				DSOUND_CheckEvent(dsb, 0, 0);
-			} else if (dsb->state != STATE_STOPPED) {
-
-				/* if the buffer was starting, it must be playing now */
-				if (dsb->state == STATE_STARTING)
-					dsb->state = STATE_PLAYING;
-
-				/* mix next buffer into the main buffer */
-				DSOUND_MixOne(dsb, mix_buffer, frames);
-
-				*all_stopped = FALSE;
-			}
-			RtlReleaseResource(&dsb->lock);
+		/* mix next buffer into the main buffer */
+		if ((mixed = DSOUND_MixBuffer(device->buffers[i], ibuf, &device->cp_scratch, frames))) {
+			mixieee32(ibuf, mix_buffer, mixed * channels);
+			*all_stopped = FALSE;
 		}
 	}
 }
@@ -651,8 +914,8 @@ static void DSOUND_WaveQueue(DirectSoundDevice *device, LPBYTE pos, DWORD bytes)
  * The mixing procedure goes:
  *
  * secondary->buffer (secondary format)
- *   =[Resample]=> device->tmp_buffer (float format)
- *   =[Volume]=> device->tmp_buffer (float format)
+ *   =[Resample]=> device->tmp_scratch (float format)
+ *   =[Volume]=> device->tmp_scratch (float format)
  *   =[Reformat]=> device->buffer (device format, skipped on float)
  */
 static void DSOUND_PerformMix(DirectSoundDevice *device)
@@ -29,6 +29,7 @@
 #define NONAMELESSUNION
 #include <windows.h>
 #include <stdio.h>
+#include <math.h>
 
 #include "wine/test.h"
 #include "mmsystem.h"
@@ -1375,9 +1376,640 @@ static void test_effects(void)
     while (IDirectSound8_Release(dso));
 }
 
+/* A DMO that records the converted samples of a secondary buffer, so that
+ * the output of the mixer can be checked. */
+static const GUID CLSID_capture_dmo = {0x5b7a6d2e,0x4f1c,0x4b3a,{0x9d,0x52,0x31,0x6e,0x8a,0x0c,0x7f,0x14}};
+
+static struct
+{
+    BYTE *data;       /* the first bytes passed to Process */
+    DWORD size;
+    DWORD len;
+    DWORD calls;
+    DWORD stale;      /* samples that still hold the marker of the previous call */
+} capture;
+
+static IMediaObjectInPlace capture_dmo_inplace;
+
+static HRESULT WINAPI capture_dmo_QueryInterface(IMediaObject *iface, REFIID iid, void **out)
+{
+    if (IsEqualGUID(iid, &IID_IUnknown) || IsEqualGUID(iid, &IID_IMediaObject))
+        *out = iface;
+    else if (IsEqualGUID(iid, &IID_IMediaObjectInPlace))
+        *out = &capture_dmo_inplace;
+    else
+    {
+        *out = NULL;
+        return E_NOINTERFACE;
+    }
+    return S_OK;
+}
+
+static ULONG WINAPI capture_dmo_AddRef(IMediaObject *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI capture_dmo_Release(IMediaObject *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI capture_dmo_GetStreamCount(IMediaObject *iface, DWORD *inputs, DWORD *outputs)
+{
+    *inputs = *outputs = 1;
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_GetInputStreamInfo(IMediaObject *iface, DWORD index, DWORD *flags)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetOutputStreamInfo(IMediaObject *iface, DWORD index, DWORD *flags)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetInputType(IMediaObject *iface, DWORD index, DWORD type_index, DMO_MEDIA_TYPE *type)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetOutputType(IMediaObject *iface, DWORD index, DWORD type_index, DMO_MEDIA_TYPE *type)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_SetInputType(IMediaObject *iface, DWORD index, const DMO_MEDIA_TYPE *type, DWORD flags)
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_SetOutputType(IMediaObject *iface, DWORD index, const DMO_MEDIA_TYPE *type, DWORD flags)
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_GetInputCurrentType(IMediaObject *iface, DWORD index, DMO_MEDIA_TYPE *type)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetOutputCurrentType(IMediaObject *iface, DWORD index, DMO_MEDIA_TYPE *type)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetInputSizeInfo(IMediaObject *iface, DWORD index, DWORD *size,
+                                                   DWORD *lookahead, DWORD *alignment)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetOutputSizeInfo(IMediaObject *iface, DWORD index, DWORD *size, DWORD *alignment)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_GetInputMaxLatency(IMediaObject *iface, DWORD index, REFERENCE_TIME *latency)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_SetInputMaxLatency(IMediaObject *iface, DWORD index, REFERENCE_TIME latency)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_Flush(IMediaObject *iface)
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_Discontinuity(IMediaObject *iface, DWORD index)
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_AllocateStreamingResources(IMediaObject *iface)
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_FreeStreamingResources(IMediaObject *iface)
+{
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_GetInputStatus(IMediaObject *iface, DWORD index, DWORD *flags)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_ProcessInput(IMediaObject *iface, DWORD index, IMediaBuffer *buffer,
+                                               DWORD flags, REFERENCE_TIME timestamp, REFERENCE_TIME timelength)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_ProcessOutput(IMediaObject *iface, DWORD flags, DWORD count,
+                                                DMO_OUTPUT_DATA_BUFFER *buffers, DWORD *status)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_Lock(IMediaObject *iface, LONG lock)
+{
+    return S_OK;
+}
+
+static const IMediaObjectVtbl capture_dmo_vtbl =
+{
+    capture_dmo_QueryInterface,
+    capture_dmo_AddRef,
+    capture_dmo_Release,
+    capture_dmo_GetStreamCount,
+    capture_dmo_GetInputStreamInfo,
+    capture_dmo_GetOutputStreamInfo,
+    capture_dmo_GetInputType,
+    capture_dmo_GetOutputType,
+    capture_dmo_SetInputType,
+    capture_dmo_SetOutputType,
+    capture_dmo_GetInputCurrentType,
+    capture_dmo_GetOutputCurrentType,
+    capture_dmo_GetInputSizeInfo,
+    capture_dmo_GetOutputSizeInfo,
+    capture_dmo_GetInputMaxLatency,
+    capture_dmo_SetInputMaxLatency,
+    capture_dmo_Flush,
+    capture_dmo_Discontinuity,
+    capture_dmo_AllocateStreamingResources,
+    capture_dmo_FreeStreamingResources,
+    capture_dmo_GetInputStatus,
+    capture_dmo_ProcessInput,
+    capture_dmo_ProcessOutput,
+    capture_dmo_Lock,
+};
+
+static IMediaObject capture_dmo = { &capture_dmo_vtbl };
+
+static HRESULT WINAPI capture_dmo_inplace_QueryInterface(IMediaObjectInPlace *iface, REFIID iid, void **out)
+{
+    return capture_dmo_QueryInterface(&capture_dmo, iid, out);
+}
+
+static ULONG WINAPI capture_dmo_inplace_AddRef(IMediaObjectInPlace *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI capture_dmo_inplace_Release(IMediaObjectInPlace *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI capture_dmo_inplace_Process(IMediaObjectInPlace *iface, ULONG size, BYTE *data,
+                                                  REFERENCE_TIME start, DWORD flags)
+{
+    float *samples = (float *)data;
+    ULONG i;
+
+    if (capture.len < capture.size)
+    {
+        DWORD len = min(size, capture.size - capture.len);
+        memcpy(capture.data + capture.len, data, len);
+        capture.len += len;
+    }
+
+    /* The mixer must write or clear every sample before the next call. The
+     * samples of the test buffers are never exactly 1.0. */
+    for (i = 0; i < size / sizeof(float); i++)
+    {
+        if (capture.calls && samples[i] == 1.0f) capture.stale++;
+        samples[i] = 1.0f;
+    }
+    capture.calls++;
+    return S_OK;
+}
+
+static HRESULT WINAPI capture_dmo_inplace_Clone(IMediaObjectInPlace *iface, IMediaObjectInPlace **out)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI capture_dmo_inplace_GetLatency(IMediaObjectInPlace *iface, REFERENCE_TIME *latency)
+{
+    *latency = 0;
+    return S_OK;
+}
+
+static const IMediaObjectInPlaceVtbl capture_dmo_inplace_vtbl =
+{
+    capture_dmo_inplace_QueryInterface,
+    capture_dmo_inplace_AddRef,
+    capture_dmo_inplace_Release,
+    capture_dmo_inplace_Process,
+    capture_dmo_inplace_Clone,
+    capture_dmo_inplace_GetLatency,
+};
+
+static IMediaObjectInPlace capture_dmo_inplace = { &capture_dmo_inplace_vtbl };
+
+static HRESULT WINAPI capture_dmo_factory_QueryInterface(IClassFactory *iface, REFIID iid, void **out)
+{
+    if (IsEqualGUID(iid, &IID_IUnknown) || IsEqualGUID(iid, &IID_IClassFactory))
+    {
+        *out = iface;
+        return S_OK;
+    }
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI capture_dmo_factory_AddRef(IClassFactory *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI capture_dmo_factory_Release(IClassFactory *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI capture_dmo_factory_CreateInstance(IClassFactory *iface, IUnknown *outer,
+                                                         REFIID iid, void **out)
+{
+    if (outer) return CLASS_E_NOAGGREGATION;
+    return capture_dmo_QueryInterface(&capture_dmo, iid, out);
+}
+
+static HRESULT WINAPI capture_dmo_factory_LockServer(IClassFactory *iface, BOOL lock)
+{
+    return S_OK;
+}
+
+static const IClassFactoryVtbl capture_dmo_factory_vtbl =
+{
+    capture_dmo_factory_QueryInterface,
+    capture_dmo_factory_AddRef,
+    capture_dmo_factory_Release,
+    capture_dmo_factory_CreateInstance,
+    capture_dmo_factory_LockServer,
+};
+
+static IClassFactory capture_dmo_factory = { &capture_dmo_factory_vtbl };
+
+/* Plays a buffer filled with copies of samples through the capture DMO until
+ * size bytes of converted samples have been recorded, returns FALSE if the
+ * DMO can't be used. */
+static BOOL capture_buffer(IDirectSound8 *dso, WAVEFORMATEX *wfx, const BYTE *samples, DWORD samples_size,
+                           DWORD size)
+{
+    DSEFFECTDESC effect;
+    DSBUFFERDESC bufdesc;
+    IDirectSoundBuffer *secondary;
+    IDirectSoundBuffer8 *secondary8;
+    DWORD result, cookie, bytes, i;
+    void *ptr;
+    HRESULT rc;
+
+    capture.data = HeapAlloc(GetProcessHeap(), 0, size);
+    capture.size = size;
+    capture.len = 0;
+    capture.calls = 0;
+    capture.stale = 0;
+
+    rc = CoRegisterClassObject(&CLSID_capture_dmo, (IUnknown *)&capture_dmo_factory,
+                               CLSCTX_INPROC_SERVER, REGCLS_MULTIPLEUSE, &cookie);
+    ok(rc == S_OK, "CoRegisterClassObject() failed: %08x\n", rc);
+
+    ZeroMemory(&bufdesc, sizeof(bufdesc));
+    bufdesc.dwSize = sizeof(bufdesc);
+    bufdesc.dwFlags = DSBCAPS_CTRLFX | DSBCAPS_CTRLVOLUME | DSBCAPS_GETCURRENTPOSITION2;
+    bufdesc.dwBufferBytes = align(wfx->nAvgBytesPerSec / 2, wfx->nBlockAlign);
+    bufdesc.lpwfxFormat = wfx;
+    rc = IDirectSound8_CreateSoundBuffer(dso, &bufdesc, &secondary, NULL);
+    if (rc != DS_OK)
+    {
+        CoRevokeClassObject(cookie);
+        return FALSE;
+    }
+    IDirectSoundBuffer_QueryInterface(secondary, &IID_IDirectSoundBuffer8, (void **)&secondary8);
+
+    rc = IDirectSoundBuffer8_Lock(secondary8, 0, 0, &ptr, &bytes, NULL, NULL, DSBLOCK_ENTIREBUFFER);
+    ok(rc == DS_OK, "IDirectSoundBuffer8_Lock() failed: %08x\n", rc);
+    for (i = 0; i < bytes; i++)
+        ((BYTE *)ptr)[i] = samples[i % samples_size];
+    IDirectSoundBuffer8_Unlock(secondary8, ptr, bytes, NULL, 0);
+
+    /* the DMO marks the samples, the volume is applied after it */
+    IDirectSoundBuffer8_SetVolume(secondary8, DSBVOLUME_MIN);
+
+    ZeroMemory(&effect, sizeof(effect));
+    effect.dwSize = sizeof(effect);
+    effect.guidDSFXClass = CLSID_capture_dmo;
+    rc = IDirectSoundBuffer8_SetFX(secondary8, 1, &effect, &result);
+    if (rc == DS_OK)
+    {
+        rc = IDirectSoundBuffer8_Play(secondary8, 0, 0, DSBPLAY_LOOPING);
+        ok(rc == DS_OK, "IDirectSoundBuffer8_Play() failed: %08x\n", rc);
+        for (i = 0; i < 100 && (capture.len < capture.size || capture.calls < 4); i++) Sleep(20);
+        IDirectSoundBuffer8_Stop(secondary8);
+    }
+
+    /* releasing the buffer waits for the mixer */
+    IDirectSoundBuffer8_Release(secondary8);
+    IDirectSoundBuffer_Release(secondary);
+    CoRevokeClassObject(cookie);
+    return rc == DS_OK;
+}
+
+/* Buffers with more channels than mixed, like a 3 channel buffer on a quad
+ * or 5.1 device, must not leave samples of the previous mix in the other
+ * channels. On stereo devices every channel is written. */
+static void test_unused_channels(void)
+{
+    static const SHORT samples[3] = { 0x2000, 0x4000, 0x6000 };
+    IDirectSound8 *dso;
+    WAVEFORMATEX wfx;
+    HRESULT rc;
+
+    rc = pDirectSoundCreate8(NULL, &dso, NULL);
+    ok(rc == DS_OK || rc == DSERR_NODRIVER || rc == DSERR_ALLOCATED || rc == E_FAIL,
+       "DirectSoundCreate8() failed: %08x\n", rc);
+    if (rc != DS_OK)
+        return;
+
+    rc = IDirectSound8_SetCooperativeLevel(dso, get_hwnd(), DSSCL_PRIORITY);
+    ok(rc == DS_OK, "IDirectSound8_SetCooperativeLevel() failed: %08x\n", rc);
+
+    init_format(&wfx, WAVE_FORMAT_PCM, 44100, 16, 3);
+    if (!capture_buffer(dso, &wfx, (const BYTE *)samples, sizeof(samples), 0))
+        skip("Effects are not supported on 3 channel buffers\n");
+    else
+    {
+        ok(capture.calls >= 4, "got %u calls\n", capture.calls);
+        ok(!capture.stale, "got %u stale samples\n", capture.stale);
+    }
+    HeapFree(GetProcessHeap(), 0, capture.data);
+
+    IDirectSound8_Release(dso);
+}
+
+static BOOL capture_resampled(IDirectSound8 *dso)
+{
+    SHORT samples[2 * 1000];
+    WAVEFORMATEX wfx;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(samples); i++)
+        samples[i] = (i * 7919) % 0x4000 - 0x2000 + (i & 1) * 0x1000;
+
+    init_format(&wfx, WAVE_FORMAT_PCM, 22050, 16, 2);
+    return capture_buffer(dso, &wfx, (const BYTE *)samples, sizeof(samples), 0x8000);
+}
+
+static BOOL compare_samples(const float *a, const float *b, DWORD count)
+{
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+    {
+#ifdef __i386__
+        /* the scalar code uses the x87 unit here */
+        if (fabsf(a[i] - b[i]) > 1e-6f) return FALSE;
+#else
+        if (a[i] != b[i]) return FALSE;
+#endif
+    }
+    return TRUE;
+}
+
+/* The SSE and the scalar resampler must give the same results. The scalar
+ * code is forced by setting WINE_DSOUND_SSE to 0 in a child process, since
+ * it is only read once per process. */
+static void test_sse_mixer(void)
+{
+    char path[MAX_PATH], cmdline[MAX_PATH * 2];
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    IDirectSound8 *dso;
+    HANDLE file;
+    DWORD written;
+    char **argv;
+    HRESULT rc;
+    BOOL ret;
+
+    rc = pDirectSoundCreate8(NULL, &dso, NULL);
+    ok(rc == DS_OK || rc == DSERR_NODRIVER || rc == DSERR_ALLOCATED || rc == E_FAIL,
+       "DirectSoundCreate8() failed: %08x\n", rc);
+    if (rc != DS_OK)
+        return;
+
+    rc = IDirectSound8_SetCooperativeLevel(dso, get_hwnd(), DSSCL_PRIORITY);
+    ok(rc == DS_OK, "IDirectSound8_SetCooperativeLevel() failed: %08x\n", rc);
+
+    ret = capture_resampled(dso);
+    IDirectSound8_Release(dso);
+    if (!ret)
+    {
+        skip("Effects are not supported\n");
+        HeapFree(GetProcessHeap(), 0, capture.data);
+        return;
+    }
+    ok(capture.len == capture.size, "captured %u bytes\n", capture.len);
+
+    GetTempPathA(MAX_PATH, path);
+    GetTempFileNameA(path, "dsm", 0, path);
+    file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    WriteFile(file, capture.data, capture.len, &written, NULL);
+    CloseHandle(file);
+    HeapFree(GetProcessHeap(), 0, capture.data);
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" dsound8 scalar_mixer \"%s\"", argv[0], path);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    SetEnvironmentVariableA("WINE_DSOUND_SSE", "0");
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info);
+    SetEnvironmentVariableA("WINE_DSOUND_SSE", NULL);
+    ok(ret, "CreateProcess failed, error %u\n", GetLastError());
+    if (ret)
+    {
+        winetest_wait_child_process(info.hProcess);
+        CloseHandle(info.hProcess);
+        CloseHandle(info.hThread);
+    }
+    DeleteFileA(path);
+}
+
+static void test_scalar_mixer(const char *path)
+{
+    IDirectSound8 *dso;
+    float *expected;
+    HANDLE file;
+    DWORD size;
+    HRESULT rc;
+
+    rc = pDirectSoundCreate8(NULL, &dso, NULL);
+    ok(rc == DS_OK, "DirectSoundCreate8() failed: %08x\n", rc);
+    if (rc != DS_OK)
+        return;
+
+    rc = IDirectSound8_SetCooperativeLevel(dso, get_hwnd(), DSSCL_PRIORITY);
+    ok(rc == DS_OK, "IDirectSound8_SetCooperativeLevel() failed: %08x\n", rc);
+
+    ok(capture_resampled(dso), "capture failed\n");
+    IDirectSound8_Release(dso);
+
+    file = CreateFileA(path, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    expected = HeapAlloc(GetProcessHeap(), 0, capture.size);
+    ReadFile(file, expected, capture.size, &size, NULL);
+    CloseHandle(file);
+
+    ok(size == capture.len, "got %u bytes, expected %u\n", capture.len, size);
+    ok(compare_samples((const float *)capture.data, expected, min(size, capture.len) / sizeof(float)),
+       "scalar and SSE output differ\n");
+
+    HeapFree(GetProcessHeap(), 0, expected);
+    HeapFree(GetProcessHeap(), 0, capture.data);
+}
+
+/* plays enough one-shot buffers to use the threaded mixer if it is enabled */
+static void test_many_buffers(const char *mode)
+{
+    static const DWORD rates[] = { 8000, 11025, 22050, 44100, 48000 };
+    IDirectSound8 *dso;
+    IDirectSoundBuffer *primary, *secondaries[12];
+    IDirectSoundNotify *notify;
+    DSBPOSITIONNOTIFY pos;
+    DSBUFFERDESC bufdesc;
+    WAVEFORMATEX wfx;
+    HANDLE events[12];
+    DWORD size, status, ret, i, j;
+    UINT created = 0;
+    BYTE *data;
+    HRESULT rc;
+
+    rc = pDirectSoundCreate8(NULL, &dso, NULL);
+    ok(rc == DS_OK || rc == DSERR_NODRIVER || rc == DSERR_ALLOCATED || rc == E_FAIL,
+       "DirectSoundCreate8() failed: %08x\n", rc);
+    if (rc != DS_OK)
+        return;
+
+    rc = IDirectSound8_SetCooperativeLevel(dso, get_hwnd(), DSSCL_PRIORITY);
+    ok(rc == DS_OK, "IDirectSound8_SetCooperativeLevel() failed: %08x\n", rc);
+
+    ZeroMemory(&bufdesc, sizeof(bufdesc));
+    bufdesc.dwSize = sizeof(bufdesc);
+    bufdesc.dwFlags = DSBCAPS_PRIMARYBUFFER;
+    rc = IDirectSound8_CreateSoundBuffer(dso, &bufdesc, &primary, NULL);
+    ok(rc == DS_OK, "IDirectSound8_CreateSoundBuffer() failed: %08x\n", rc);
+    if (rc != DS_OK)
+    {
+        IDirectSound8_Release(dso);
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(secondaries); i++)
+    {
+        /* mix formats, channel counts and resampling */
+        init_format(&wfx, WAVE_FORMAT_PCM, rates[i % ARRAY_SIZE(rates)], (i & 1) ? 8 : 16, (i & 2) ? 1 : 2);
+        ZeroMemory(&bufdesc, sizeof(bufdesc));
+        bufdesc.dwSize = sizeof(bufdesc);
+        bufdesc.dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLPAN |
+                          DSBCAPS_CTRLFREQUENCY | DSBCAPS_CTRLPOSITIONNOTIFY | DSBCAPS_LOCSOFTWARE;
+        bufdesc.dwBufferBytes = align(wfx.nAvgBytesPerSec / 5, wfx.nBlockAlign);
+        bufdesc.lpwfxFormat = &wfx;
+        rc = IDirectSound8_CreateSoundBuffer(dso, &bufdesc, &secondaries[i], NULL);
+        ok(rc == DS_OK, "%s: IDirectSound8_CreateSoundBuffer() failed: %08x\n", mode, rc);
+        if (rc != DS_OK)
+            break;
+        events[i] = CreateEventW(NULL, FALSE, FALSE, NULL);
+        created++;
+
+        rc = IDirectSoundBuffer_Lock(secondaries[i], 0, 0, (void **)&data, &size, NULL, NULL,
+                                     DSBLOCK_ENTIREBUFFER);
+        ok(rc == DS_OK, "%s: IDirectSoundBuffer_Lock() failed: %08x\n", mode, rc);
+        if (rc == DS_OK)
+        {
+            for (j = 0; j < size; j++)
+                data[j] = j * (i + 1) * 37;
+            IDirectSoundBuffer_Unlock(secondaries[i], data, size, NULL, 0);
+        }
+        IDirectSoundBuffer_SetVolume(secondaries[i], -(LONG)(i * 100));
+        IDirectSoundBuffer_SetPan(secondaries[i], (LONG)(i * 300) - 1800);
+        if (i % 3 == 0)
+            IDirectSoundBuffer_SetFrequency(secondaries[i], wfx.nSamplesPerSec * 3 / 2);
+
+        rc = IDirectSoundBuffer_QueryInterface(secondaries[i], &IID_IDirectSoundNotify, (void **)&notify);
+        ok(rc == DS_OK, "%s: QueryInterface(IDirectSoundNotify) failed: %08x\n", mode, rc);
+        if (rc == DS_OK)
+        {
+            pos.dwOffset = DSBPN_OFFSETSTOP;
+            pos.hEventNotify = events[i];
+            rc = IDirectSoundNotify_SetNotificationPositions(notify, 1, &pos);
+            ok(rc == DS_OK, "%s: SetNotificationPositions() failed: %08x\n", mode, rc);
+            IDirectSoundNotify_Release(notify);
+        }
+    }
+
+    for (i = 0; i < created; i++)
+    {
+        rc = IDirectSoundBuffer_Play(secondaries[i], 0, 0, 0);
+        ok(rc == DS_OK, "%s: IDirectSoundBuffer_Play() failed: %08x\n", mode, rc);
+    }
+
+    /* every buffer must play to its end and stop */
+    if (created)
+    {
+        ret = WaitForMultipleObjects(created, events, TRUE, 5000);
+        ok(ret < WAIT_OBJECT_0 + created, "%s: buffers didn't stop, ret %u\n", mode, ret);
+    }
+
+    for (i = 0; i < created; i++)
+    {
+        rc = IDirectSoundBuffer_GetStatus(secondaries[i], &status);
+        ok(rc == DS_OK, "%s: IDirectSoundBuffer_GetStatus() failed: %08x\n", mode, rc);
+        ok(!(status & DSBSTATUS_PLAYING), "%s: buffer %u still playing\n", mode, i);
+        IDirectSoundBuffer_Release(secondaries[i]);
+        CloseHandle(events[i]);
+    }
+
+    IDirectSoundBuffer_Release(primary);
+    IDirectSound8_Release(dso);
+}
+
+/* the number of mixer threads is read once, so use a child process */
+static void test_threaded_mixer(void)
+{
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    char cmdline[MAX_PATH + 32], **argv;
+
+    test_many_buffers("serial");
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" dsound8 threaded_mixer", argv[0]);
+    SetEnvironmentVariableA("WINE_DSOUND_THREADS", "4");
+    ok(CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi),
+       "CreateProcess failed with error %u\n", GetLastError());
+    SetEnvironmentVariableA("WINE_DSOUND_THREADS", NULL);
+    winetest_wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
 START_TEST(dsound8)
 {
     HMODULE hDsound;
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
 
     CoInitialize(NULL);
 
@@ -1389,7 +2021,11 @@ START_TEST(dsound8)
             "DirectSoundEnumerateA");
         pDirectSoundCreate8 = (void*)GetProcAddress(hDsound,
             "DirectSoundCreate8");
-        if (pDirectSoundCreate8)
+        if (pDirectSoundCreate8 && argc > 2 && !strcmp(argv[2], "threaded_mixer"))
+            test_many_buffers("threaded");
+        else if (pDirectSoundCreate8 && argc > 3 && !strcmp(argv[2], "scalar_mixer"))
+            test_scalar_mixer(argv[3]);
+        else if (pDirectSoundCreate8)
         {
             test_COM();
             IDirectSound8_tests();
@@ -1397,6 +2033,9 @@ START_TEST(dsound8)
             test_hw_buffers();
             test_first_device();
             test_effects();
+            test_unused_channels();
+            test_sse_mixer();
+            test_threaded_mixer();
         }
         else
             skip("DirectSoundCreate8 missing - skipping all tests\n");
@@ -0,0 +1,361 @@
+/*
+ * DIB driver banded rendering
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Large primitive calls can be split into horizontal bands that are
+ * rendered by a small pool of worker threads, the calling thread taking its
+ * share of the bands.  Every band touches a disjoint set of destination
+ * rows, so the result is identical to rendering on a single thread.
+ *
+ * The workers compete with the application's own threads for the CPUs,
+ * so nothing is split unless WINE_DIB_THREADS says how many threads may
+ * render one call, counting the one that made it.
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "gdi_private.h"
+#include "dibdrv.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+#define MAX_BAND_THREADS  16
+#define MIN_BAND_PIXELS   (256 * 256)  /* don't bother with smaller operations */
+#define MIN_BAND_HEIGHT   16
+
+static CRITICAL_SECTION band_cs;
+static CRITICAL_SECTION_DEBUG band_cs_debug =
+{
+    0, 0, &band_cs,
+    { &band_cs_debug.ProcessLocksList, &band_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": band_cs") }
+};
+static CRITICAL_SECTION band_cs = { &band_cs_debug, -1, 0, 0, 0, 0 };
+
+static CONDITION_VARIABLE band_work_cv = CONDITION_VARIABLE_INIT;
+static CONDITION_VARIABLE band_done_cv = CONDITION_VARIABLE_INIT;
+
+static int band_threads = -1;     /* number of worker threads, -1 if not initialized yet */
+static BOOL band_busy;            /* the workers are processing a call */
+static unsigned int band_generation;
+static unsigned int band_active;  /* workers that haven't finished the current call */
+static LONG band_next;            /* next band to process */
+static int band_count;
+static void (*band_func)( void *ctx, int band );
+static void *band_ctx;
+
+static void process_bands( void (*func)( void *, int ), void *ctx, int count )
+{
+    int band;
+
+    while ((band = InterlockedIncrement( &band_next ) - 1) < count) func( ctx, band );
+}
+
+static DWORD CALLBACK band_thread( void *arg )
+{
+    unsigned int generation = 0;
+
+    EnterCriticalSection( &band_cs );
+    for (;;)
+    {
+        while (generation == band_generation) SleepConditionVariableCS( &band_work_cv, &band_cs, INFINITE );
+        generation = band_generation;
+        LeaveCriticalSection( &band_cs );
+
+        process_bands( band_func, band_ctx, band_count );
+
+        EnterCriticalSection( &band_cs );
+        if (!--band_active) WakeConditionVariable( &band_done_cv );
+    }
+    return 0;
+}
+
+/* must be called with band_cs held */
+static void init_band_threads(void)
+{
+    SYSTEM_INFO si;
+    char buffer[16];
+    int i, count = 0;
+    HANDLE thread;
+
+    band_threads = 0;
+    if (GetEnvironmentVariableA( "WINE_DIB_THREADS", buffer, sizeof(buffer) ))
+    {
+        count = atoi( buffer );
+        GetSystemInfo( &si );
+        if (count > (int)si.dwNumberOfProcessors) count = si.dwNumberOfProcessors;
+        if (count > MAX_BAND_THREADS) count = MAX_BAND_THREADS;
+    }
+
+    /* the calling thread renders bands too */
+    for (i = 1; i < count; i++)
+    {
+        if (!(thread = CreateThread( NULL, 0, band_thread, NULL, 0, NULL ))) break;
+        CloseHandle( thread );
+        band_threads++;
+    }
+    if (band_threads) TRACE( "using %d worker threads\n", band_threads );
+}
+
+/***********************************************************************
+ *           get_band_count
+ *
+ * Number of bands to split an operation on rows top to bottom into,
+ * 1 if it should be done in one go.
+ */
+int get_band_count( int top, int bottom, int width )
+{
+    int height = bottom - top, count;
+
+    if (!band_threads) return 1;
+    if (band_threads == -1)
+    {
+        EnterCriticalSection( &band_cs );
+        if (band_threads == -1) init_band_threads();
+        LeaveCriticalSection( &band_cs );
+        if (!band_threads) return 1;
+    }
+    if (height < 2 * MIN_BAND_HEIGHT || height * width < MIN_BAND_PIXELS) return 1;
+
+    count = min( band_threads + 1, height / MIN_BAND_HEIGHT );
+    return max( count, 1 );
+}
+
+/***********************************************************************
+ *           run_bands
+ *
+ * Call func for every band from 0 to count - 1.  The bands are processed
+ * by the worker threads if they are idle, else on the calling thread.
+ */
+void run_bands( void (*func)( void *ctx, int band ), void *ctx, int count )
+{
+    int band;
+
+    if (count > 1 && band_threads > 0)
+    {
+        EnterCriticalSection( &band_cs );
+        if (!band_busy)
+        {
+            band_busy = TRUE;
+            band_func = func;
+            band_ctx = ctx;
+            band_count = count;
+            band_next = 0;
+            band_active = band_threads;
+            band_generation++;
+            WakeAllConditionVariable( &band_work_cv );
+            LeaveCriticalSection( &band_cs );
+
+            process_bands( func, ctx, count );
+
+            EnterCriticalSection( &band_cs );
+            while (band_active) SleepConditionVariableCS( &band_done_cv, &band_cs, INFINITE );
+            band_busy = FALSE;
+            LeaveCriticalSection( &band_cs );
+            return;
+        }
+        LeaveCriticalSection( &band_cs );
+    }
+
+    for (band = 0; band < count; band++) func( ctx, band );
+}
+
+/* rows covered by a band, bands are of roughly equal height */
+static void get_band_rows( int top, int bottom, int band, int count, int *band_top, int *band_bottom )
+{
+    *band_top = top + (int)((LONGLONG)(bottom - top) * band / count);
+    *band_bottom = top + (int)((LONGLONG)(bottom - top) * (band + 1) / count);
+}
+
+/* returns FALSE if the rectangles don't cover any row */
+static BOOL get_rects_extent( int num, const RECT *rects, int *top, int *bottom, int *area )
+{
+    int i;
+
+    *top = INT_MAX;
+    *bottom = INT_MIN;
+    *area = 0;
+    for (i = 0; i < num; i++)
+    {
+        *top = min( *top, rects[i].top );
+        *bottom = max( *bottom, rects[i].bottom );
+        *area += (rects[i].right - rects[i].left) * (rects[i].bottom - rects[i].top);
+    }
+    return *bottom > *top;
+}
+
+struct solid_rects_bands
+{
+    const dib_info *dib;
+    int             num;
+    const RECT     *rects;
+    DWORD           and, xor;
+    int             top, bottom, count;
+};
+
+static void solid_rects_band( void *ctx, int band )
+{
+    struct solid_rects_bands *params = ctx;
+    RECT rect;
+    int i, top, bottom;
+
+    get_band_rows( params->top, params->bottom, band, params->count, &top, &bottom );
+    for (i = 0; i < params->num; i++)
+    {
+        rect = params->rects[i];
+        rect.top = max( rect.top, top );
+        rect.bottom = min( rect.bottom, bottom );
+        if (rect.top >= rect.bottom) continue;
+        params->dib->funcs->solid_rects( params->dib, 1, &rect, params->and, params->xor );
+    }
+}
+
+/***********************************************************************
+ *           solid_rects_banded
+ */
+void solid_rects_banded( const dib_info *dib, int num, const RECT *rects, DWORD and, DWORD xor )
+{
+    struct solid_rects_bands params;
+    int area;
+
+    if (band_threads && num > 0 && get_rects_extent( num, rects, &params.top, &params.bottom, &area ))
+    {
+        params.count = get_band_count( params.top, params.bottom, area / (params.bottom - params.top) );
+        if (params.count > 1)
+        {
+            params.dib = dib;
+            params.num = num;
+            params.rects = rects;
+            params.and = and;
+            params.xor = xor;
+            run_bands( solid_rects_band, &params, params.count );
+            return;
+        }
+    }
+    dib->funcs->solid_rects( dib, num, rects, and, xor );
+}
+
+struct rects_bands
+{
+    const dib_info *dst;
+    const dib_info *src;
+    const RECT     *dst_rect;
+    const RECT     *src_rect;
+    int             num;
+    const RECT     *rects;
+    int             rop2;
+    BLENDFUNCTION   blend;
+    int             top, bottom, count;
+};
+
+static BOOL get_band_rect( const struct rects_bands *params, int band, int i, RECT *rect, POINT *origin )
+{
+    int top, bottom;
+
+    get_band_rows( params->top, params->bottom, band, params->count, &top, &bottom );
+    *rect = params->rects[i];
+    rect->top = max( rect->top, top );
+    rect->bottom = min( rect->bottom, bottom );
+    if (rect->top >= rect->bottom) return FALSE;
+    origin->x = params->src_rect->left + rect->left - params->dst_rect->left;
+    origin->y = params->src_rect->top  + rect->top  - params->dst_rect->top;
+    return TRUE;
+}
+
+static void copy_rect_band( void *ctx, int band )
+{
+    struct rects_bands *params = ctx;
+    RECT rect;
+    POINT origin;
+    int i;
+
+    for (i = 0; i < params->num; i++)
+        if (get_band_rect( params, band, i, &rect, &origin ))
+            params->dst->funcs->copy_rect( params->dst, &rect, params->src, &origin, params->rop2, 0 );
+}
+
+/***********************************************************************
+ *           copy_rect_banded
+ *
+ * Copy non-overlapping rectangles, returns FALSE if the operation is too
+ * small to be split.
+ */
+BOOL copy_rect_banded( const dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                       int num, const RECT *rects, int rop2 )
+{
+    struct rects_bands params;
+    int area;
+
+    if (!band_threads || num <= 0) return FALSE;
+    if (!get_rects_extent( num, rects, &params.top, &params.bottom, &area )) return FALSE;
+    params.count = get_band_count( params.top, params.bottom, area / (params.bottom - params.top) );
+    if (params.count <= 1) return FALSE;
+
+    params.dst = dst;
+    params.src = src;
+    params.dst_rect = dst_rect;
+    params.src_rect = src_rect;
+    params.num = num;
+    params.rects = rects;
+    params.rop2 = rop2;
+    run_bands( copy_rect_band, &params, params.count );
+    return TRUE;
+}
+
+static void blend_rect_band( void *ctx, int band )
+{
+    struct rects_bands *params = ctx;
+    RECT rect;
+    POINT origin;
+    int i;
+
+    for (i = 0; i < params->num; i++)
+        if (get_band_rect( params, band, i, &rect, &origin ))
+            params->dst->funcs->blend_rect( params->dst, &rect, params->src, &origin, params->blend );
+}
+
+/***********************************************************************
+ *           blend_rect_banded
+ *
+ * Blend rectangles from a different dib, returns FALSE if the operation
+ * is too small to be split.
+ */
+BOOL blend_rect_banded( const dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                        int num, const RECT *rects, BLENDFUNCTION blend )
+{
+    struct rects_bands params;
+    int area;
+
+    if (!band_threads || num <= 0) return FALSE;
+    if (!get_rects_extent( num, rects, &params.top, &params.bottom, &area )) return FALSE;
+    params.count = get_band_count( params.top, params.bottom, area / (params.bottom - params.top) );
+    if (params.count <= 1) return FALSE;
+
+    params.dst = dst;
+    params.src = src;
+    params.dst_rect = dst_rect;
+    params.src_rect = src_rect;
+    params.num = num;
+    params.rects = rects;
+    params.blend = blend;
+    run_bands( blend_rect_band, &params, params.count );
+    return TRUE;
+}
@@ -492,7 +492,7 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     case R2_WHITE: xor = ~0u;
         /* fall through */
     case R2_BLACK:
-        dst->funcs->solid_rects( dst, count, rects, and, xor );
+        solid_rects_banded( dst, count, rects, and, xor );
         /* fall through */
     case R2_NOP:
         return;
@@ -541,6 +541,8 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
             }
         }
     }
+    else if (!overlap && copy_rect_banded( dst, dst_rect, src, src_rect, count, rects, rop2 ))
+        return;
     else  /* left to right, top to bottom */
     {
         for (i = 0; i < count; i++)
@@ -589,11 +591,15 @@ static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *sr
     int i;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
-    for (i = 0; i < clipped_rects.count; i++)
+    if (src->bits.ptr == dst->bits.ptr ||
+        !blend_rect_banded( dst, dst_rect, src, src_rect, clipped_rects.count, clipped_rects.rects, blend ))
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        for (i = 0; i < clipped_rects.count; i++)
+        {
+            origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
+            origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
+            dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        }
     }
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -1196,111 +1202,208 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
-DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+#define MAX_STRETCH_BANDS 17
+
+struct stretch_band
 {
-    dib_info src_dib, dst_dib;
-    POINT dst_start, src_start, dst_end, src_end;
-    RECT rect;
-    BOOL hstretch, vstretch;
+    POINT        dst_start, src_start;
+    int          err;
+    unsigned int start, length;  /* range of iterations of the vertical loop */
+};
+
+struct stretch_rows
+{
+    dib_info              src_dib, dst_dib;
     struct stretch_params v_params, h_params;
-    int err;
-    DWORD ret;
+    BOOL                  vstretch;
+    int                   mode, width;
     void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
                     const dib_info *src_dib, const POINT *src_start,
                     const struct stretch_params *params, int mode, BOOL keep_dst);
+    struct stretch_band   bands[MAX_STRETCH_BANDS];
+};
 
-    TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
-          dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
-          src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
-
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
-
-    /* v */
-    ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
-                                  src->y, src->height, src->visrect.top, src->visrect.bottom,
-                                  &dst_start.y, &src_start.y, &dst_end.y, &src_end.y,
-                                  &v_params, &vstretch );
-    if (ret) return ret;
-
-    /* h */
-    ret = calc_1d_stretch_params( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
-                                  src->x, src->width, src->visrect.left, src->visrect.right,
-                                  &dst_start.x, &src_start.x, &dst_end.x, &src_end.x,
-                                  &h_params, &hstretch );
-    if (ret) return ret;
-
-    TRACE("got dst start %d, %d inc %d, %d. src start %d, %d inc %d, %d len %d x %d\n",
-          dst_start.x, dst_start.y, h_params.dst_inc, v_params.dst_inc,
-          src_start.x, src_start.y, h_params.src_inc, v_params.src_inc,
-          h_params.length, v_params.length);
-
-    get_bounding_rect( &rect, dst_start.x, dst_start.y, dst_end.x - dst_start.x, dst_end.y - dst_start.y );
-    intersect_rect( &dst->visrect, &dst->visrect, &rect );
-
-    dst_start.x -= dst->visrect.left;
-    dst_start.y -= dst->visrect.top;
-
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+static void stretch_rows( const struct stretch_rows *rows, POINT dst_start, POINT src_start,
+                          int err, unsigned int length )
+{
+    dib_info *dst_dib = (dib_info *)&rows->dst_dib;
+    const struct stretch_params *v_params = &rows->v_params;
 
-    if (vstretch)
+    if (rows->vstretch)
     {
         BOOL need_row = TRUE;
         RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
         last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
+        last_row.right = rows->width;
 
-        while (v_params.length--)
+        while (length--)
         {
             if (need_row)
             {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
+                rows->row_fn( dst_dib, &dst_start, &rows->src_dib, &src_start, &rows->h_params, rows->mode, FALSE );
                 need_row = FALSE;
             }
             else
             {
-                last_row.top = dst_start.y - v_params.dst_inc;
+                last_row.top = dst_start.y - v_params->dst_inc;
                 last_row.bottom = last_row.top + 1;
                 this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
+                offset_rect( &this_row, 0, v_params->dst_inc );
+                copy_rect( dst_dib, &this_row, dst_dib, &last_row, NULL, R2_COPYPEN );
             }
 
             if (err > 0)
             {
-                src_start.y += v_params.src_inc;
+                src_start.y += v_params->src_inc;
                 need_row = TRUE;
-                err += v_params.err_add_1;
+                err += v_params->err_add_1;
             }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
         }
     }
     else
     {
         int merged_rows = 0;
 
-        while (v_params.length--)
+        while (length--)
         {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
+            if (rows->mode != STRETCH_DELETESCANS || !merged_rows)
+                rows->row_fn( dst_dib, &dst_start, &rows->src_dib, &src_start, &rows->h_params, rows->mode,
+                              merged_rows != 0 );
             merged_rows++;
 
             if (err > 0)
             {
-                dst_start.y += v_params.dst_inc;
+                dst_start.y += v_params->dst_inc;
                 merged_rows = 0;
-                err += v_params.err_add_1;
+                err += v_params->err_add_1;
             }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
         }
     }
+}
+
+/* Split the vertical loop into bands that each start on a new destination
+ * row, so that no destination row is written by more than one band.  A
+ * stretched row that would have been copied from the previous band is
+ * rendered again instead, which gives the same pixels. */
+static int split_stretch_rows( struct stretch_rows *rows, POINT dst_start, POINT src_start, int err, int count )
+{
+    const struct stretch_params *v_params = &rows->v_params;
+    unsigned int i, next = v_params->length / count;
+    BOOL new_row = TRUE;
+    int band = 0;
+
+    rows->bands[0].dst_start = dst_start;
+    rows->bands[0].src_start = src_start;
+    rows->bands[0].err = err;
+    rows->bands[0].start = 0;
+
+    for (i = 0; i < v_params->length; i++)
+    {
+        if (i >= next && new_row && band + 1 < count)
+        {
+            band++;
+            rows->bands[band].dst_start = dst_start;
+            rows->bands[band].src_start = src_start;
+            rows->bands[band].err = err;
+            rows->bands[band].start = i;
+            next = (ULONGLONG)v_params->length * (band + 1) / count;
+        }
+
+        if (rows->vstretch)
+        {
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+        else
+        {
+            new_row = err > 0;
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+
+    for (i = 0; i < band; i++) rows->bands[i].length = rows->bands[i + 1].start - rows->bands[i].start;
+    rows->bands[band].length = v_params->length - rows->bands[band].start;
+    return band + 1;
+}
+
+static void stretch_rows_band( void *ctx, int band )
+{
+    const struct stretch_rows *rows = ctx;
+    const struct stretch_band *params = &rows->bands[band];
+
+    stretch_rows( rows, params->dst_start, params->src_start, params->err, params->length );
+}
+
+DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
+                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
+                          INT mode )
+{
+    struct stretch_rows rows;
+    POINT dst_start, src_start, dst_end, src_end;
+    RECT rect;
+    BOOL hstretch;
+    int count;
+    DWORD ret;
+
+    TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
+          dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
+          src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
+
+    init_dib_info_from_bitmapinfo( &rows.src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &rows.dst_dib, dst_info, dst_bits );
+
+    /* v */
+    ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
+                                  src->y, src->height, src->visrect.top, src->visrect.bottom,
+                                  &dst_start.y, &src_start.y, &dst_end.y, &src_end.y,
+                                  &rows.v_params, &rows.vstretch );
+    if (ret) return ret;
+
+    /* h */
+    ret = calc_1d_stretch_params( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
+                                  src->x, src->width, src->visrect.left, src->visrect.right,
+                                  &dst_start.x, &src_start.x, &dst_end.x, &src_end.x,
+                                  &rows.h_params, &hstretch );
+    if (ret) return ret;
+
+    TRACE("got dst start %d, %d inc %d, %d. src start %d, %d inc %d, %d len %d x %d\n",
+          dst_start.x, dst_start.y, rows.h_params.dst_inc, rows.v_params.dst_inc,
+          src_start.x, src_start.y, rows.h_params.src_inc, rows.v_params.src_inc,
+          rows.h_params.length, rows.v_params.length);
+
+    get_bounding_rect( &rect, dst_start.x, dst_start.y, dst_end.x - dst_start.x, dst_end.y - dst_start.y );
+    intersect_rect( &dst->visrect, &dst->visrect, &rect );
+
+    dst_start.x -= dst->visrect.left;
+    dst_start.y -= dst->visrect.top;
+
+    rows.row_fn = hstretch ? rows.dst_dib.funcs->stretch_row : rows.dst_dib.funcs->shrink_row;
+    rows.mode = (rows.vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    rows.width = dst->visrect.right - dst->visrect.left;
+
+    count = get_band_count( dst->visrect.top, dst->visrect.bottom, rows.width );
+    if (count > 1 && src_bits != dst_bits)
+    {
+        count = split_stretch_rows( &rows, dst_start, src_start, rows.v_params.err_start,
+                                    min( count, MAX_STRETCH_BANDS ));
+        run_bands( stretch_rows_band, &rows, count );
+    }
+    else stretch_rows( &rows, dst_start, src_start, rows.v_params.err_start, rows.v_params.length );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
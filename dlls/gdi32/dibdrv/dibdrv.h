@@ -265,6 +265,13 @@ extern int clip_line(const POINT *start, const POINT *end, const RECT *clip,
                      const bres_params *params, POINT *pt1, POINT *pt2) DECLSPEC_HIDDEN;
 extern void release_cached_font( struct cached_font *font ) DECLSPEC_HIDDEN;
 extern BOOL fill_with_pixel( DC *dc, dib_info *dib, DWORD pixel, int num, const RECT *rects, INT rop ) DECLSPEC_HIDDEN;
+extern int get_band_count( int top, int bottom, int width ) DECLSPEC_HIDDEN;
+extern void run_bands( void (*func)( void *ctx, int band ), void *ctx, int count ) DECLSPEC_HIDDEN;
+extern void solid_rects_banded( const dib_info *dib, int num, const RECT *rects, DWORD and, DWORD xor ) DECLSPEC_HIDDEN;
+extern BOOL copy_rect_banded( const dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                              int num, const RECT *rects, int rop2 ) DECLSPEC_HIDDEN;
+extern BOOL blend_rect_banded( const dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
+                               int num, const RECT *rects, BLENDFUNCTION blend ) DECLSPEC_HIDDEN;
 
 static inline void init_clipped_rects( struct clipped_rects *clip_rects )
 {
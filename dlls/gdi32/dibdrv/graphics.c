@@ -45,8 +45,10 @@ enum glyph_type
 
 struct cached_font
 {
-    struct list           entry;
+    struct list           entry;      /* entry in the unused fonts list */
+    struct cached_font   *next;       /* next font in the same hash bucket */
     LONG                  ref;
+    LONG                  size;       /* bytes used by the font and its glyphs */
     DWORD                 hash;
     LOGFONTW              lf;
     XFORM                 xform;
@@ -54,7 +56,16 @@ struct cached_font
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
-static struct list font_cache = LIST_INIT( font_cache );
+#define FONT_CACHE_BUCKETS     256
+#define FONT_CACHE_MAX_SIZE    (4 * 1024 * 1024)
+#define FONT_CACHE_MIN_UNUSED  5
+
+static struct list unused_fonts = LIST_INIT( unused_fonts );  /* most recently released first */
+static UINT unused_font_count;
+static struct cached_font *font_cache_table[FONT_CACHE_BUCKETS];
+static LONG font_cache_size;
+static LONG font_cache_hits, font_cache_misses;
+static LONG glyph_cache_hits, glyph_cache_misses;
 
 static CRITICAL_SECTION font_cache_cs;
 static CRITICAL_SECTION_DEBUG critsect_debug =
@@ -554,10 +565,46 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_font( struct cached_font *font )
+{
+    struct cached_font **prev = &font_cache_table[font->hash % FONT_CACHE_BUCKETS];
+    UINT i, j, k;
+
+    while (*prev != font) prev = &(*prev)->next;
+    *prev = font->next;
+    list_remove( &font->entry );
+    unused_font_count--;
+    InterlockedExchangeAdd( &font_cache_size, -font->size );
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+    HeapFree( GetProcessHeap(), 0, font );
+}
+
+/* evict the least recently released fonts until the cache is back under budget */
+static void trim_font_cache(void)
+{
+    struct cached_font *font;
+
+    while (font_cache_size > FONT_CACHE_MAX_SIZE && unused_font_count > FONT_CACHE_MIN_UNUSED)
+    {
+        font = LIST_ENTRY( list_tail( &unused_fonts ), struct cached_font, entry );
+        TRACE( "evicting %p, %d bytes\n", font, font->size );
+        free_cached_font( font );
+    }
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -573,37 +620,26 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.hash = font_cache_hash( &font );
 
     EnterCriticalSection( &font_cache_cs );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    for (ptr = font_cache_table[font.hash % FONT_CACHE_BUCKETS]; ptr; ptr = ptr->next)
     {
         if (!font_cache_cmp( &font, ptr ))
         {
-            InterlockedIncrement( &ptr->ref );
-            list_remove( &ptr->entry );
-            goto done;
-        }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
-    }
-
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
-    {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+            if (!ptr->ref++)
             {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
+                list_remove( &ptr->entry );
+                unused_font_count--;
             }
+            font_cache_hits++;
+            goto done;
         }
-        list_remove( &ptr->entry );
     }
-    else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
+
+    font_cache_misses++;
+    TRACE( "fonts %d hits %d misses, glyphs %d hits %d misses, %d bytes\n",
+           font_cache_hits, font_cache_misses, glyph_cache_hits, glyph_cache_misses, font_cache_size );
+    trim_font_cache();
+
+    if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
     {
         LeaveCriticalSection( &font_cache_cs );
         return NULL;
@@ -611,9 +647,12 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = sizeof(*ptr);
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
+    ptr->next = font_cache_table[font.hash % FONT_CACHE_BUCKETS];
+    font_cache_table[font.hash % FONT_CACHE_BUCKETS] = ptr;
+    InterlockedExchangeAdd( &font_cache_size, ptr->size );
 done:
-    list_add_head( &font_cache, &ptr->entry );
     LeaveCriticalSection( &font_cache_cs );
     TRACE( "%d %s -> %p\n", ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
     return ptr;
@@ -621,11 +660,26 @@ done:
 
 void release_cached_font( struct cached_font *font )
 {
-    if (font) InterlockedDecrement( &font->ref );
+    if (!font) return;
+    EnterCriticalSection( &font_cache_cs );
+    if (!--font->ref)
+    {
+        list_add_head( &unused_fonts, &font->entry );
+        unused_font_count++;
+        trim_font_cache();
+    }
+    LeaveCriticalSection( &font_cache_cs );
+}
+
+/* the font is referenced by the caller, so it can't be evicted while its size changes */
+static inline void add_cached_font_size( struct cached_font *font, LONG size )
+{
+    InterlockedExchangeAdd( &font->size, size );
+    InterlockedExchangeAdd( &font_cache_size, size );
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, DWORD size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -644,9 +698,15 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         }
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             HeapFree( GetProcessHeap(), 0, ptr );
+        else
+            add_cached_font_size( font, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        ret = glyph;
+        add_cached_font_size( font, size );
+    }
     else HeapFree( GetProcessHeap(), 0, glyph );
     return ret;
 }
@@ -805,14 +865,14 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
                            UINT flags, const WCHAR *str, UINT count, const INT *dx,
                            const struct clipped_rects *clipped_rects, RECT *bounds )
 {
-    UINT i;
+    UINT i, misses = 0;
     struct cached_glyph *glyph;
     dib_info glyph_dib;
     DWORD text_color;
@@ -833,8 +893,11 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
 
     for (i = 0; i < count; i++)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        if (!(glyph = get_cached_glyph( font, str[i], flags )))
+        {
+            misses++;
+            if (!(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        }
 
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
@@ -861,6 +924,9 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+
+    if (count - misses) InterlockedExchangeAdd( &glyph_cache_hits, count - misses );
+    if (misses) InterlockedExchangeAdd( &glyph_cache_misses, misses );
 }
 
 BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
@@ -1198,7 +1264,7 @@ BOOL dibdrv_PatBlt( PHYSDEV dev, struct bitblt_coords *dst, DWORD rop )
     case R2_WHITE: xor = ~0u;
         /* fall through */
     case R2_BLACK:
-        pdev->dib.funcs->solid_rects( &pdev->dib, clipped_rects.count, clipped_rects.rects, and, xor );
+        solid_rects_banded( &pdev->dib, clipped_rects.count, clipped_rects.rects, and, xor );
         /* fall through */
     case R2_NOP:
         break;
@@ -27,6 +27,36 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
 
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <emmintrin.h>
+#define HAVE_SSE2_PRIMITIVES
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+static BOOL use_sse2(void)
+{
+#ifdef __i386__
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        unsigned int regs[4];
+
+        __asm__("pushl %%ebx\n\t"
+                "cpuid\n\t"
+                "movl %%ebx, %%esi\n\t"
+                "popl %%ebx"
+                : "=a" (regs[0]), "=S" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+                : "0" (1));
+        supported = (regs[3] >> 26) & 1;
+    }
+    return supported;
+#else
+    return TRUE;
+#endif
+}
+#endif
+
 /* Bayer matrices for dithering */
 
 static const BYTE bayer_4x4[4][4] =
@@ -2215,6 +2245,53 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+#ifdef HAVE_SSE2_PRIMITIVES
+/* convert a multiple of 8 pixels */
+static void SSE2_FUNC convert_555_to_8888_sse2( DWORD *dst, const WORD *src, int len )
+{
+    const __m128i mask = _mm_set1_epi16( 0x1f );
+    __m128i val, r, g, b, lo, hi;
+    int x;
+
+    for (x = 0; x < len; x += 8)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        r = _mm_and_si128( _mm_srli_epi16( val, 10 ), mask );
+        g = _mm_and_si128( _mm_srli_epi16( val, 5 ), mask );
+        b = _mm_and_si128( val, mask );
+        r = _mm_or_si128( _mm_slli_epi16( r, 3 ), _mm_srli_epi16( r, 2 ));
+        g = _mm_or_si128( _mm_slli_epi16( g, 3 ), _mm_srli_epi16( g, 2 ));
+        b = _mm_or_si128( _mm_slli_epi16( b, 3 ), _mm_srli_epi16( b, 2 ));
+        lo = _mm_or_si128( b, _mm_slli_epi16( g, 8 ));
+        hi = r;
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_unpacklo_epi16( lo, hi ));
+        _mm_storeu_si128( (__m128i *)(dst + x + 4), _mm_unpackhi_epi16( lo, hi ));
+    }
+}
+
+/* convert a multiple of 8 pixels */
+static void SSE2_FUNC convert_8888_to_555_sse2( WORD *dst, const DWORD *src, int len )
+{
+    const __m128i r_mask = _mm_set1_epi32( 0x7c00 ), g_mask = _mm_set1_epi32( 0x03e0 );
+    const __m128i b_mask = _mm_set1_epi32( 0x001f );
+    __m128i val, lo, hi;
+    int x;
+
+    for (x = 0; x < len; x += 8)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(src + x) );
+        lo = _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_srli_epi32( val, 9 ), r_mask ),
+                                         _mm_and_si128( _mm_srli_epi32( val, 6 ), g_mask )),
+                           _mm_and_si128( _mm_srli_epi32( val, 3 ), b_mask ));
+        val = _mm_loadu_si128( (const __m128i *)(src + x + 4) );
+        hi = _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_srli_epi32( val, 9 ), r_mask ),
+                                         _mm_and_si128( _mm_srli_epi32( val, 6 ), g_mask )),
+                           _mm_and_si128( _mm_srli_epi32( val, 3 ), b_mask ));
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packs_epi32( lo, hi ));
+    }
+}
+#endif
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -2312,7 +2389,17 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef HAVE_SSE2_PRIMITIVES
+                if (use_sse2())
+                {
+                    convert_555_to_8888_sse2( dst_pixel, src_pixel, (src_rect->right - x) & ~7 );
+                    dst_pixel += (src_rect->right - x) & ~7;
+                    src_pixel += (src_rect->right - x) & ~7;
+                    x += (src_rect->right - x) & ~7;
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
@@ -2992,7 +3079,17 @@ static void convert_to_555(dib_info *dst, const dib_info *src, const RECT *src_r
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef HAVE_SSE2_PRIMITIVES
+                if (use_sse2())
+                {
+                    convert_8888_to_555_sse2( dst_pixel, src_pixel, (src_rect->right - x) & ~7 );
+                    dst_pixel += (src_rect->right - x) & ~7;
+                    src_pixel += (src_rect->right - x) & ~7;
+                    x += (src_rect->right - x) & ~7;
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = ((src_val >> 9) & 0x7c00) |
@@ -4651,6 +4748,66 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef HAVE_SSE2_PRIMITIVES
+/* (val + 127) / 255 for 16-bit lanes holding at most 255 * 255 */
+static inline __m128i SSE2_FUNC div255_epu16( __m128i val )
+{
+    val = _mm_add_epi16( val, _mm_set1_epi16( 127 ));
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( val, _mm_set1_epi16( 1 )), _mm_srli_epi16( val, 8 )), 8 );
+}
+
+/* add premultiplied source channels to the destination scaled by the source alpha,
+ * carrying overflows into the next channel like blend_argb() does */
+static inline __m128i SSE2_FUNC blend_argb_epu16( __m128i dst, __m128i src )
+{
+    __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+    __m128i val = _mm_add_epi16( src, div255_epu16( _mm_mullo_epi16( dst,
+                                 _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha ))));
+
+    return _mm_or_si128( _mm_and_si128( val, _mm_set1_epi16( 0xff )),
+                         _mm_slli_epi64( _mm_srli_epi16( val, 8 ), 16 ));
+}
+
+/* blend a multiple of 4 pixels, src_or is or'ed to the source pixels when they have no alpha */
+static void SSE2_FUNC blend_row_8888_sse2( DWORD *dst, const DWORD *src, int len, BLENDFUNCTION blend,
+                                           DWORD src_or )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi16( blend.SourceConstantAlpha );
+    const __m128i inv_alpha = _mm_set1_epi16( 255 - blend.SourceConstantAlpha );
+    const __m128i or_mask = _mm_set1_epi32( src_or );
+    __m128i d, s, d_lo, d_hi, s_lo, s_hi;
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), or_mask );
+        d_lo = _mm_unpacklo_epi8( d, zero );
+        d_hi = _mm_unpackhi_epi8( d, zero );
+        s_lo = _mm_unpacklo_epi8( s, zero );
+        s_hi = _mm_unpackhi_epi8( s, zero );
+
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+        {
+            if (blend.SourceConstantAlpha != 255)
+            {
+                s_lo = div255_epu16( _mm_mullo_epi16( s_lo, alpha ));
+                s_hi = div255_epu16( _mm_mullo_epi16( s_hi, alpha ));
+            }
+            d_lo = blend_argb_epu16( d_lo, s_lo );
+            d_hi = blend_argb_epu16( d_hi, s_hi );
+        }
+        else
+        {
+            d_lo = div255_epu16( _mm_add_epi16( _mm_mullo_epi16( s_lo, alpha ), _mm_mullo_epi16( d_lo, inv_alpha )));
+            d_hi = div255_epu16( _mm_add_epi16( _mm_mullo_epi16( s_hi, alpha ), _mm_mullo_epi16( d_hi, inv_alpha )));
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( d_lo, d_hi ));
+    }
+}
+#endif
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
@@ -4658,6 +4815,29 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
     int x, y;
 
+#ifdef HAVE_SSE2_PRIMITIVES
+    if (use_sse2())
+    {
+        int width = rc->right - rc->left, simd_width = width & ~3;
+        /* blending a pixel without alpha is the same as blending it with an opaque alpha */
+        DWORD src_or = (!(blend.AlphaFormat & AC_SRC_ALPHA) && src->compression != BI_RGB) ? 0xff000000 : 0;
+
+        for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+        {
+            blend_row_8888_sse2( dst_ptr, src_ptr, simd_width, blend, src_or );
+            for (x = simd_width; x < width; x++)
+            {
+                if (blend.AlphaFormat & AC_SRC_ALPHA)
+                    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                else
+                    dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x] | src_or,
+                                                            blend.SourceConstantAlpha );
+            }
+        }
+        return;
+    }
+#endif
+
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
@@ -6066,21 +6246,63 @@ static inline DWORD aa_rgb( BYTE r_dst, BYTE g_dst, BYTE b_dst, DWORD text, cons
             aa_color( r_dst, text >> 16, range->r_min, range->r_max ) << 16);
 }
 
+static inline void draw_glyph_span_8888( DWORD *dst_ptr, const BYTE *glyph_ptr, int start, int end,
+                                         DWORD text_pixel, const struct intensity_range *ranges )
+{
+    int x;
+
+    for (x = start; x < end; x++)
+    {
+        if (glyph_ptr[x] <= 1) continue;
+        if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
+        dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
+    }
+}
+
+#ifdef HAVE_SSE2_PRIMITIVES
+/* Skip fully transparent and fill fully opaque runs of 16 pixels at a time,
+ * only the antialiased edges go through aa_rgb(). */
+static void SSE2_FUNC draw_glyph_row_8888_sse2( DWORD *dst_ptr, const BYTE *glyph_ptr, int len,
+                                                DWORD text_pixel, const struct intensity_range *ranges )
+{
+    const __m128i one = _mm_set1_epi8( 1 ), full = _mm_set1_epi8( 16 );
+    const __m128i text = _mm_set1_epi32( text_pixel );
+    __m128i val;
+    int x;
+
+    for (x = 0; x + 16 <= len; x += 16)
+    {
+        val = _mm_loadu_si128( (const __m128i *)(glyph_ptr + x) );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_min_epu8( val, one ), val )) == 0xffff) continue;
+        if (_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_max_epu8( val, full ), val )) == 0xffff)
+        {
+            _mm_storeu_si128( (__m128i *)(dst_ptr + x), text );
+            _mm_storeu_si128( (__m128i *)(dst_ptr + x + 4), text );
+            _mm_storeu_si128( (__m128i *)(dst_ptr + x + 8), text );
+            _mm_storeu_si128( (__m128i *)(dst_ptr + x + 12), text );
+            continue;
+        }
+        draw_glyph_span_8888( dst_ptr, glyph_ptr, x, x + 16, text_pixel, ranges );
+    }
+    draw_glyph_span_8888( dst_ptr, glyph_ptr, x, len, text_pixel, ranges );
+}
+#endif
+
 static void draw_glyph_8888( const dib_info *dib, const RECT *rect, const dib_info *glyph,
                              const POINT *origin, DWORD text_pixel, const struct intensity_range *ranges )
 {
     DWORD *dst_ptr = get_pixel_ptr_32( dib, rect->left, rect->top );
     const BYTE *glyph_ptr = get_pixel_ptr_8( glyph, origin->x, origin->y );
-    int x, y;
+    int y;
 
     for (y = rect->top; y < rect->bottom; y++)
     {
-        for (x = 0; x < rect->right - rect->left; x++)
-        {
-            if (glyph_ptr[x] <= 1) continue;
-            if (glyph_ptr[x] >= 16) { dst_ptr[x] = text_pixel; continue; }
-            dst_ptr[x] = aa_rgb( dst_ptr[x] >> 16, dst_ptr[x] >> 8, dst_ptr[x], text_pixel, ranges + glyph_ptr[x] );
-        }
+#ifdef HAVE_SSE2_PRIMITIVES
+        if (use_sse2())
+            draw_glyph_row_8888_sse2( dst_ptr, glyph_ptr, rect->right - rect->left, text_pixel, ranges );
+        else
+#endif
+        draw_glyph_span_8888( dst_ptr, glyph_ptr, 0, rect->right - rect->left, text_pixel, ranges );
         dst_ptr += dib->stride / 4;
         glyph_ptr += glyph->stride;
     }
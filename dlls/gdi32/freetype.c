@@ -1927,14 +1927,13 @@ static void get_family_names( FT_Face ft_face, WCHAR **name, WCHAR **english, BO
     }
 }
 
-static Family *get_family( FT_Face ft_face, BOOL vertical )
+/****************************************************************
+ * NB This function stores the ptrs to the strings to save copying.
+ * Don't free them after calling.
+ */
+static Family *get_family( WCHAR *name, WCHAR *english_name )
 {
-    Family *family;
-    WCHAR *name, *english_name;
-
-    get_family_names( ft_face, &name, &english_name, vertical );
-
-    family = find_family_from_name( name );
+    Family *family = find_family_from_name( name );
 
     if (!family)
     {
@@ -2142,15 +2141,8 @@ static Face *create_face( FT_Face ft_face, FT_Long face_index, const char *file,
     return face;
 }
 
-static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
-                          FT_Long face_index, DWORD flags )
+static void add_face_to_family( Face *face, Family *family, DWORD flags )
 {
-    Face *face;
-    Family *family;
-
-    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
-    family = get_family( ft_face, flags & ADDFONT_VERTICAL_FONT );
-
     if (insert_face_in_family_list( face, family ))
     {
         if (flags & ADDFONT_ADD_TO_CACHE)
@@ -2163,6 +2155,572 @@ static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr
     release_family( family );
 }
 
+/*
+ * Persistent font index
+ *
+ * Opening every font file with FreeType is what makes init_font_list slow
+ * on systems with a lot of fonts.  The face information found in each file
+ * is saved to a binary index in the prefix directory; later sessions map it
+ * read-only and only open the files whose modification time or size
+ * changed.  The index is rewritten whenever the set of font files changes.
+ */
+
+#define FONT_INDEX_MAGIC    0x58494657  /* "WFIX" */
+#define FONT_INDEX_VERSION  1
+#define FONT_INDEX_NONE     (~0u)       /* string offset of a missing name */
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD ft_version;     /* FreeType version used to build the index */
+    DWORD langid;         /* face names depend on the system language */
+    DWORD lcid;
+    DWORD file_count;
+    DWORD face_count;
+    DWORD table_size;     /* size of the hash table, a power of 2 */
+    DWORD strings_size;
+    DWORD reserved;
+};
+
+struct font_index_file
+{
+    ULONGLONG mtime;
+    ULONGLONG size;
+    DWORD     path;       /* offset of the unix file name in the string table */
+    DWORD     flags;      /* ADDFONT_ALLOW_BITMAP if bitmap fonts were allowed */
+    DWORD     first_face;
+    DWORD     face_count;
+    INT       ret;        /* value returned by AddFontToList */
+    DWORD     reserved;
+};
+
+struct font_index_face
+{
+    DWORD         family; /* string table offsets of the names */
+    DWORD         english;
+    DWORD         style;
+    DWORD         full;
+    DWORD         vertical;
+    DWORD         scalable;
+    LONG          face_index;
+    LONG          font_version;
+    DWORD         ntm_flags;
+    FONTSIGNATURE fs;
+    LONG          size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+    SHORT         height;
+    SHORT         width;
+    SHORT         internal_leading;
+    SHORT         reserved;
+};
+
+/* the file layout is the header followed by these arrays in this order */
+struct font_index
+{
+    struct font_index_file *files;
+    struct font_index_face *faces;
+    DWORD                  *table;   /* file index + 1 for used hash slots, 0 for free ones */
+    char                   *strings;
+    DWORD                   file_count;
+    DWORD                   face_count;
+    DWORD                   table_size;
+    DWORD                   strings_size;
+};
+
+static struct font_index font_index;  /* index written by a previous session */
+static void *font_index_data;
+static size_t font_index_data_size;
+static DWORD font_index_hits;
+
+static struct
+{
+    struct font_index index;
+    DWORD             files_alloc;
+    DWORD             faces_alloc;
+    DWORD             strings_alloc;
+    DWORD             current;       /* file being loaded */
+    BOOL              active;
+    BOOL              failed;
+} font_index_builder;
+
+static DWORD hash_font_path( const char *path )
+{
+    DWORD hash = 0x811c9dc5;
+
+    while (*path) hash = (hash ^ (unsigned char)*path++) * 0x01000193;
+    return hash;
+}
+
+static const WCHAR *get_font_index_string( const struct font_index *index, DWORD offset )
+{
+    if (offset == FONT_INDEX_NONE) return NULL;
+    return (const WCHAR *)(index->strings + offset);
+}
+
+static WCHAR *dup_font_index_string( const struct font_index *index, DWORD offset )
+{
+    if (offset == FONT_INDEX_NONE) return NULL;
+    return strdupW( get_font_index_string( index, offset ));
+}
+
+static const struct font_index_file *find_font_index_file( const struct font_index *index, const char *path,
+                                                           const struct stat *st, DWORD flags )
+{
+    const struct font_index_file *file;
+    DWORD i, slot, mask = index->table_size - 1;
+
+    if (!index->table_size) return NULL;
+    flags &= ADDFONT_ALLOW_BITMAP;
+    slot = hash_font_path( path ) & mask;
+    for (i = 0; i < index->table_size && index->table[slot]; i++, slot = (slot + 1) & mask)
+    {
+        file = &index->files[index->table[slot] - 1];
+        if (file->mtime == st->st_mtime && file->size == st->st_size && file->flags == flags &&
+            !strcmp( index->strings + file->path, path ))
+            return file;
+    }
+    return NULL;
+}
+
+static BOOL is_valid_font_index_string( const struct font_index *index, DWORD offset, BOOL optional )
+{
+    if (offset == FONT_INDEX_NONE) return optional;
+    return offset < index->strings_size && !(offset & 1);
+}
+
+static BOOL is_valid_font_index( const struct font_index *index )
+{
+    DWORD i;
+
+    if (index->table_size & (index->table_size - 1)) return FALSE;
+    if (index->file_count && index->file_count * 2 > index->table_size) return FALSE;
+    if (index->strings_size)
+    {
+        /* make sure that all strings are terminated */
+        if ((index->strings_size & 1) || *(const WCHAR *)(index->strings + index->strings_size - 2))
+            return FALSE;
+    }
+    for (i = 0; i < index->table_size; i++)
+        if (index->table[i] > index->file_count) return FALSE;
+    for (i = 0; i < index->file_count; i++)
+    {
+        const struct font_index_file *file = &index->files[i];
+
+        if (file->path >= index->strings_size) return FALSE;
+        if (file->first_face > index->face_count) return FALSE;
+        if (file->face_count > index->face_count - file->first_face) return FALSE;
+    }
+    for (i = 0; i < index->face_count; i++)
+    {
+        const struct font_index_face *face = &index->faces[i];
+
+        if (!is_valid_font_index_string( index, face->family, FALSE ) ||
+            !is_valid_font_index_string( index, face->english, TRUE ) ||
+            !is_valid_font_index_string( index, face->style, FALSE ) ||
+            !is_valid_font_index_string( index, face->full, TRUE ))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static char *get_font_index_path(void)
+{
+    static const char nameA[] = "/fontindex";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+
+    if (!config_dir) return NULL;
+    if (!(path = HeapAlloc( GetProcessHeap(), 0, strlen(config_dir) + sizeof(nameA) ))) return NULL;
+    strcpy( path, config_dir );
+    strcat( path, nameA );
+    return path;
+}
+
+static void map_font_index(void)
+{
+    const struct font_index_header *header;
+    struct stat st;
+    ULONGLONG size;
+    char *path;
+    void *data;
+    int fd;
+
+    if (!(path = get_font_index_path())) return;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header))
+    {
+        close( fd );
+        return;
+    }
+    data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (data == MAP_FAILED) return;
+
+    header = data;
+    if (header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ||
+        header->ft_version != FT_SimpleVersion || header->langid != GetSystemDefaultLangID() ||
+        header->lcid != GetSystemDefaultLCID())
+        goto invalid;
+
+    size = sizeof(*header) + (ULONGLONG)header->file_count * sizeof(struct font_index_file) +
+           (ULONGLONG)header->face_count * sizeof(struct font_index_face) +
+           (ULONGLONG)header->table_size * sizeof(DWORD) + header->strings_size;
+    if (size != st.st_size) goto invalid;
+
+    font_index.files        = (struct font_index_file *)(header + 1);
+    font_index.faces        = (struct font_index_face *)(font_index.files + header->file_count);
+    font_index.table        = (DWORD *)(font_index.faces + header->face_count);
+    font_index.strings      = (char *)(font_index.table + header->table_size);
+    font_index.file_count   = header->file_count;
+    font_index.face_count   = header->face_count;
+    font_index.table_size   = header->table_size;
+    font_index.strings_size = header->strings_size;
+    if (!is_valid_font_index( &font_index )) goto invalid;
+
+    TRACE( "mapped font index with %u files and %u faces\n", font_index.file_count, font_index.face_count );
+    font_index_data = data;
+    font_index_data_size = st.st_size;
+    return;
+
+invalid:
+    TRACE( "ignoring outdated or invalid font index\n" );
+    memset( &font_index, 0, sizeof(font_index) );
+    munmap( data, st.st_size );
+}
+
+static BOOL grow_font_index_array( void **array, DWORD *alloc, DWORD count, DWORD size )
+{
+    DWORD new_alloc;
+    void *new_array;
+
+    if (count <= *alloc) return TRUE;
+    new_alloc = max( count, max( *alloc * 2, 64 ));
+    if (*array) new_array = HeapReAlloc( GetProcessHeap(), 0, *array, (SIZE_T)new_alloc * size );
+    else new_array = HeapAlloc( GetProcessHeap(), 0, (SIZE_T)new_alloc * size );
+    if (!new_array)
+    {
+        font_index_builder.failed = TRUE;
+        return FALSE;
+    }
+    *array = new_array;
+    *alloc = new_alloc;
+    return TRUE;
+}
+
+static DWORD add_font_index_string( const void *str, DWORD size )
+{
+    struct font_index *index = &font_index_builder.index;
+    DWORD offset = index->strings_size;
+
+    if (!str) return FONT_INDEX_NONE;
+    /* keep the strings WCHAR aligned */
+    if (!grow_font_index_array( (void **)&index->strings, &font_index_builder.strings_alloc,
+                                offset + size + 1, 1 ))
+        return FONT_INDEX_NONE;
+    memcpy( index->strings + offset, str, size );
+    index->strings_size += size;
+    if (index->strings_size & 1) index->strings[index->strings_size++] = 0;
+    return offset;
+}
+
+static DWORD add_font_index_stringW( const WCHAR *str )
+{
+    if (!str) return FONT_INDEX_NONE;
+    return add_font_index_string( str, (strlenW( str ) + 1) * sizeof(WCHAR) );
+}
+
+static void insert_font_index_file( struct font_index *index, DWORD file )
+{
+    DWORD slot, mask = index->table_size - 1;
+
+    slot = hash_font_path( index->strings + index->files[file].path ) & mask;
+    while (index->table[slot]) slot = (slot + 1) & mask;
+    index->table[slot] = file + 1;
+}
+
+static BOOL grow_font_index_table(void)
+{
+    struct font_index *index = &font_index_builder.index;
+    DWORD i, *table, size;
+
+    if ((index->file_count + 1) * 2 <= index->table_size) return TRUE;
+    size = max( index->table_size * 2, 256 );
+    if (!(table = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*table) )))
+    {
+        font_index_builder.failed = TRUE;
+        return FALSE;
+    }
+    HeapFree( GetProcessHeap(), 0, index->table );
+    index->table = table;
+    index->table_size = size;
+    for (i = 0; i < index->file_count; i++) insert_font_index_file( index, i );
+    return TRUE;
+}
+
+/* start recording the faces found in a font file */
+static void begin_font_index_file( const char *path, const struct stat *st, DWORD flags )
+{
+    struct font_index *index = &font_index_builder.index;
+    struct font_index_file *file;
+    DWORD path_offset;
+
+    font_index_builder.current = FONT_INDEX_NONE;
+    if (!font_index_builder.active || font_index_builder.failed) return;
+    if (!grow_font_index_table()) return;
+    if (!grow_font_index_array( (void **)&index->files, &font_index_builder.files_alloc,
+                                index->file_count + 1, sizeof(*index->files) ))
+        return;
+    path_offset = add_font_index_string( path, strlen( path ) + 1 );
+    if (font_index_builder.failed) return;
+
+    file = &index->files[index->file_count];
+    file->mtime      = st->st_mtime;
+    file->size       = st->st_size;
+    file->path       = path_offset;
+    file->flags      = flags & ADDFONT_ALLOW_BITMAP;
+    file->first_face = index->face_count;
+    file->face_count = 0;
+    file->ret        = 0;
+    file->reserved   = 0;
+    insert_font_index_file( index, index->file_count );
+    font_index_builder.current = index->file_count++;
+}
+
+static void end_font_index_file( INT ret )
+{
+    if (font_index_builder.current == FONT_INDEX_NONE) return;
+    if (!font_index_builder.failed) font_index_builder.index.files[font_index_builder.current].ret = ret;
+    font_index_builder.current = FONT_INDEX_NONE;
+}
+
+static void add_font_index_face( const Face *face, const WCHAR *family, const WCHAR *english )
+{
+    struct font_index *index = &font_index_builder.index;
+    struct font_index_face *entry;
+    DWORD family_offset, english_offset, style_offset, full_offset;
+
+    if (font_index_builder.current == FONT_INDEX_NONE || font_index_builder.failed) return;
+
+    family_offset  = add_font_index_stringW( family );
+    english_offset = add_font_index_stringW( english );
+    style_offset   = add_font_index_stringW( face->StyleName );
+    full_offset    = add_font_index_stringW( face->FullName );
+    if (!grow_font_index_array( (void **)&index->faces, &font_index_builder.faces_alloc,
+                                index->face_count + 1, sizeof(*index->faces) ))
+        return;
+    if (font_index_builder.failed) return;
+
+    entry = &index->faces[index->face_count++];
+    memset( entry, 0, sizeof(*entry) );
+    entry->family           = family_offset;
+    entry->english          = english_offset;
+    entry->style            = style_offset;
+    entry->full             = full_offset;
+    entry->vertical         = (face->flags & ADDFONT_VERTICAL_FONT) != 0;
+    entry->scalable         = face->scalable;
+    entry->face_index       = face->face_index;
+    entry->font_version     = face->font_version;
+    entry->ntm_flags        = face->ntmFlags;
+    entry->fs               = face->fs;
+    entry->size             = face->size.size;
+    entry->x_ppem           = face->size.x_ppem;
+    entry->y_ppem           = face->size.y_ppem;
+    entry->height           = face->size.height;
+    entry->width            = face->size.width;
+    entry->internal_leading = face->size.internal_leading;
+    index->files[font_index_builder.current].face_count++;
+}
+
+static Face *create_face_from_index( const struct font_index *index, const struct font_index_face *entry,
+                                     const char *file, const struct stat *st, DWORD flags )
+{
+    Face *face;
+
+    if (!(face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) ))) return NULL;
+    face->refcount = 1;
+    face->StyleName = dup_font_index_string( index, entry->style );
+    face->FullName = dup_font_index_string( index, entry->full );
+    face->file = towstr( CP_UNIXCP, file );
+    face->dev = st->st_dev;
+    face->ino = st->st_ino;
+    face->font_data_ptr = NULL;
+    face->font_data_size = 0;
+    face->face_index = entry->face_index;
+    face->fs = entry->fs;
+    face->ntmFlags = entry->ntm_flags;
+    face->font_version = entry->font_version;
+    face->scalable = entry->scalable;
+    face->size.height = entry->height;
+    face->size.width = entry->width;
+    face->size.size = entry->size;
+    face->size.x_ppem = entry->x_ppem;
+    face->size.y_ppem = entry->y_ppem;
+    face->size.internal_leading = entry->internal_leading;
+
+    if (!HIWORD( flags )) flags |= ADDFONT_AA_FLAGS( default_aa_flags );
+    face->flags  = flags;
+    face->family = NULL;
+    face->cached_enum_data = NULL;
+    return face;
+}
+
+static INT add_faces_from_index( const struct font_index *index, const struct font_index_file *file,
+                                 const char *path, const struct stat *st, DWORD flags )
+{
+    const struct font_index_face *entry;
+    DWORD i, face_flags;
+    Face *face;
+
+    for (i = 0; i < file->face_count; i++)
+    {
+        entry = &index->faces[file->first_face + i];
+        face_flags = entry->vertical ? flags | ADDFONT_VERTICAL_FONT : flags;
+        if (!(face = create_face_from_index( index, entry, path, st, face_flags ))) return i;
+        if (index != &font_index_builder.index)
+            add_font_index_face( face, get_font_index_string( index, entry->family ),
+                                 get_font_index_string( index, entry->english ));
+        add_face_to_family( face, get_family( dup_font_index_string( index, entry->family ),
+                                              dup_font_index_string( index, entry->english )), face_flags );
+    }
+    return file->ret;
+}
+
+/*************************************************************
+ *    load_font_from_index
+ *
+ * Add the faces of a font file from the font index without opening it.
+ * Returns the number of faces added, or -1 if the file has to be loaded.
+ */
+static INT load_font_from_index( const char *path, const struct stat *st, DWORD flags )
+{
+    const struct font_index_file *file;
+    INT ret;
+
+    if (!font_index_builder.active) return -1;
+
+    /* already seen in this session */
+    if (!font_index_builder.failed &&
+        (file = find_font_index_file( &font_index_builder.index, path, st, flags )))
+        return add_faces_from_index( &font_index_builder.index, file, path, st, flags );
+
+    if (!(file = find_font_index_file( &font_index, path, st, flags ))) return -1;
+
+    TRACE( "using font index for %s\n", debugstr_a(path) );
+    font_index_hits++;
+    begin_font_index_file( path, st, flags );
+    ret = add_faces_from_index( &font_index, file, path, st, flags );
+    end_font_index_file( ret );
+    return ret;
+}
+
+static BOOL write_font_index_data( int fd, const void *data, size_t size )
+{
+    const char *ptr = data;
+    ssize_t ret;
+
+    while (size)
+    {
+        if ((ret = write( fd, ptr, size )) <= 0) return FALSE;
+        ptr += ret;
+        size -= ret;
+    }
+    return TRUE;
+}
+
+static void write_font_index(void)
+{
+    const struct font_index *index = &font_index_builder.index;
+    struct font_index_header header;
+    char *path, *tmp_path;
+    BOOL ret;
+    int fd;
+
+    if (font_index_builder.failed) return;
+    if (index->file_count == font_index_hits && font_index_hits == font_index.file_count)
+    {
+        TRACE( "font index is up to date\n" );
+        return;
+    }
+
+    if (!(path = get_font_index_path())) return;
+    if ((tmp_path = HeapAlloc( GetProcessHeap(), 0, strlen(path) + 16 )))
+    {
+        /* write a new file and rename it, other sessions may still have the old one mapped */
+        sprintf( tmp_path, "%s.%x", path, GetCurrentProcessId() );
+        if ((fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) != -1)
+        {
+            header.magic        = FONT_INDEX_MAGIC;
+            header.version      = FONT_INDEX_VERSION;
+            header.ft_version   = FT_SimpleVersion;
+            header.langid       = GetSystemDefaultLangID();
+            header.lcid         = GetSystemDefaultLCID();
+            header.file_count   = index->file_count;
+            header.face_count   = index->face_count;
+            header.table_size   = index->table_size;
+            header.strings_size = index->strings_size;
+            header.reserved     = 0;
+
+            ret = write_font_index_data( fd, &header, sizeof(header) ) &&
+                  write_font_index_data( fd, index->files, index->file_count * sizeof(*index->files) ) &&
+                  write_font_index_data( fd, index->faces, index->face_count * sizeof(*index->faces) ) &&
+                  write_font_index_data( fd, index->table, index->table_size * sizeof(*index->table) ) &&
+                  write_font_index_data( fd, index->strings, index->strings_size );
+            if (close( fd )) ret = FALSE;
+
+            if (ret && !rename( tmp_path, path ))
+                TRACE( "wrote font index with %u files, %u reused\n", index->file_count, font_index_hits );
+            else
+            {
+                WARN( "failed to write font index %s\n", debugstr_a(path) );
+                unlink( tmp_path );
+            }
+        }
+        HeapFree( GetProcessHeap(), 0, tmp_path );
+    }
+    HeapFree( GetProcessHeap(), 0, path );
+}
+
+static void open_font_index(void)
+{
+    map_font_index();
+    font_index_builder.current = FONT_INDEX_NONE;
+    font_index_builder.active = TRUE;
+}
+
+static void close_font_index(void)
+{
+    write_font_index();
+
+    HeapFree( GetProcessHeap(), 0, font_index_builder.index.files );
+    HeapFree( GetProcessHeap(), 0, font_index_builder.index.faces );
+    HeapFree( GetProcessHeap(), 0, font_index_builder.index.table );
+    HeapFree( GetProcessHeap(), 0, font_index_builder.index.strings );
+    memset( &font_index_builder, 0, sizeof(font_index_builder) );
+    font_index_builder.current = FONT_INDEX_NONE;
+
+    if (font_index_data) munmap( font_index_data, font_index_data_size );
+    font_index_data = NULL;
+    memset( &font_index, 0, sizeof(font_index) );
+    font_index_hits = 0;
+}
+
+static void AddFaceToList(FT_Face ft_face, const char *file, void *font_data_ptr, DWORD font_data_size,
+                          FT_Long face_index, DWORD flags )
+{
+    Face *face;
+    WCHAR *name, *english_name;
+
+    face = create_face( ft_face, face_index, file, font_data_ptr, font_data_size, flags );
+    get_family_names( ft_face, &name, &english_name, flags & ADDFONT_VERTICAL_FONT );
+    add_font_index_face( face, name, english_name );
+    add_face_to_family( face, get_family( name, english_name ), flags );
+}
+
 static FT_Face new_ft_face( const char *file, void *font_data_ptr, DWORD font_data_size,
                             FT_Long face_index, BOOL allow_bitmap )
 {
@@ -2243,6 +2801,7 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
 {
     FT_Face ft_face;
     FT_Long face_index = 0, num_faces;
+    struct stat st;
     INT ret = 0;
 
     /* we always load external fonts from files - otherwise we would get a crash in update_reg_entries */
@@ -2269,18 +2828,30 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
     }
 #endif /* HAVE_CARBON_CARBON_H */
 
+    if (file && font_index_builder.active && !stat( file, &st ))
+    {
+        if ((ret = load_font_from_index( file, &st, flags )) >= 0) return ret;
+        ret = 0;
+        begin_font_index_file( file, &st, flags );
+    }
+
     do {
         const DWORD FS_DBCS_MASK = FS_JISJAPAN|FS_CHINESESIMP|FS_WANSUNG|FS_CHINESETRAD|FS_JOHAB;
         FONTSIGNATURE fs;
 
         ft_face = new_ft_face( file, font_data_ptr, font_data_size, face_index, flags & ADDFONT_ALLOW_BITMAP );
-        if (!ft_face) return 0;
+        if (!ft_face)
+        {
+            ret = 0;
+            break;
+        }
 
         if(ft_face->family_name[0] == '.') /* Ignore fonts with names beginning with a dot */
         {
             TRACE("Ignoring %s since its family name begins with a dot\n", debugstr_a(file));
             pFT_Done_Face(ft_face);
-            return 0;
+            ret = 0;
+            break;
         }
 
         AddFaceToList(ft_face, file, font_data_ptr, font_data_size, face_index, flags);
@@ -2297,6 +2868,8 @@ static INT AddFontToList(const char *file, void *font_data_ptr, DWORD font_data_
 	num_faces = ft_face->num_faces;
 	pFT_Done_Face(ft_face);
     } while(num_faces > ++face_index);
+
+    end_font_index_file( ret );
     return ret;
 }
 
@@ -4199,6 +4772,7 @@ static void init_font_list(void)
     char *unixname;
 
     delete_external_font_keys();
+    open_font_index();
 
     /* load the system bitmap fonts */
     load_system_fonts();
@@ -4324,6 +4898,8 @@ static void init_font_list(void)
         }
         RegCloseKey(hkey);
     }
+
+    close_font_index();
 }
 
 static BOOL move_to_front(const WCHAR *name)
@@ -3516,11 +3516,192 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+static void time_dib_operations( HDC hdc, HDC src_dc, const char *format )
+{
+    static const WCHAR text[] = {'T','h','e',' ','q','u','i','c','k',' ','b','r','o','w','n',' ',
+                                 'f','o','x',' ','j','u','m','p','s',' ','o','v','e','r',' ',
+                                 't','h','e',' ','l','a','z','y',' ','d','o','g',0};
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    TRIVERTEX vrect[] = { { 0, 0, 0xff00, 0x8000, 0x0000, 0x8000 },
+                          { 512, 512, 0x0000, 0x4000, 0xff00, 0xff00 } };
+    GRADIENT_RECT rect = { 0, 1 };
+    TRIVERTEX vtri[] = { { 0, 0, 0xff00, 0x0000, 0x0000, 0xff00 },
+                         { 512, 0, 0x0000, 0xff00, 0x0000, 0x8000 },
+                         { 256, 512, 0x0000, 0x0000, 0xff00, 0x0000 } };
+    GRADIENT_TRIANGLE tri = { 0, 1, 2 };
+    LOGFONTA lf;
+    HFONT font, old_font;
+    DWORD start, times[8];
+    int i, j;
+
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) GdiAlphaBlend( hdc, 0, 0, 512, 512, src_dc, 0, 0, 512, 512, blend );
+    times[0] = GetTickCount() - start;
+
+    blend.SourceConstantAlpha = 128;
+    blend.AlphaFormat = 0;
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) GdiAlphaBlend( hdc, 0, 0, 512, 512, src_dc, 0, 0, 512, 512, blend );
+    times[1] = GetTickCount() - start;
+
+    SetStretchBltMode( hdc, COLORONCOLOR );
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) StretchBlt( hdc, 0, 0, 512, 512, src_dc, 0, 0, 173, 211, SRCCOPY );
+    times[2] = GetTickCount() - start;
+
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) StretchBlt( hdc, 0, 0, 173, 211, src_dc, 0, 0, 512, 512, SRCCOPY );
+    times[3] = GetTickCount() - start;
+
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) GdiGradientFill( hdc, vrect, 2, &rect, 1, GRADIENT_FILL_RECT_H );
+    times[4] = GetTickCount() - start;
+
+    start = GetTickCount();
+    for (i = 0; i < 20; i++) GdiGradientFill( hdc, vtri, 3, &tri, 1, GRADIENT_FILL_TRIANGLE );
+    times[5] = GetTickCount() - start;
+
+    memset( &lf, 0, sizeof(lf) );
+    strcpy( lf.lfFaceName, "Tahoma" );
+    lf.lfHeight = -20;
+    lf.lfQuality = ANTIALIASED_QUALITY;
+    font = CreateFontIndirectA( &lf );
+    old_font = SelectObject( hdc, font );
+    SetBkMode( hdc, TRANSPARENT );
+    start = GetTickCount();
+    for (i = 0; i < 20; i++)
+        for (j = 0; j < 20; j++)
+            ExtTextOutW( hdc, 0, j * 24, 0, NULL, text, lstrlenW(text), NULL );
+    times[6] = GetTickCount() - start;
+
+    lf.lfHeight = -72;
+    DeleteObject( SelectObject( hdc, CreateFontIndirectA( &lf )));
+    start = GetTickCount();
+    for (i = 0; i < 20; i++)
+        for (j = 0; j < 6; j++)
+            ExtTextOutW( hdc, 0, j * 80, 0, NULL, text, lstrlenW(text), NULL );
+    times[7] = GetTickCount() - start;
+    DeleteObject( SelectObject( hdc, old_font ));
+
+    trace( "%s: alpha blend %u ms, constant alpha blend %u ms, stretch %u ms, shrink %u ms, "
+           "gradient rect %u ms, gradient triangle %u ms, small text %u ms, large text %u ms\n",
+           format, times[0], times[1], times[2], times[3], times[4], times[5], times[6], times[7] );
+}
+
+/* Times the common DIB engine operations, so that regressions in the
+ * primitives show up in the test logs. The results are not checked. */
+static void test_performance(void)
+{
+    char bmibuf[sizeof(BITMAPINFO) + 256 * sizeof(RGBQUAD)];
+    BITMAPINFO *bmi = (BITMAPINFO *)bmibuf;
+    DWORD *bit_fields = (DWORD *)(bmibuf + sizeof(BITMAPINFOHEADER));
+    HBITMAP dib, src_dib, orig_bm, orig_src_bm;
+    HDC hdc, src_dc;
+    DWORD *src_bits;
+    BYTE *bits;
+    int i;
+
+    memset( bmi, 0, sizeof(bmibuf) );
+    bmi->bmiHeader.biSize = sizeof(bmi->bmiHeader);
+    bmi->bmiHeader.biWidth = 512;
+    bmi->bmiHeader.biHeight = 512;
+    bmi->bmiHeader.biPlanes = 1;
+    bmi->bmiHeader.biBitCount = 32;
+    bmi->bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC( 0 );
+    src_dc = CreateCompatibleDC( 0 );
+
+    src_dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    ok( src_dib != NULL, "ret NULL\n" );
+    for (i = 0; i < 512 * 512; i++)
+    {
+        BYTE alpha = (i * 7) & 0xff;
+        src_bits[i] = alpha << 24 | ((i * 3) % (alpha + 1)) << 16 | ((i >> 9) % (alpha + 1)) << 8 | (i % (alpha + 1));
+    }
+    orig_src_bm = SelectObject( src_dc, src_dib );
+
+    dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    ok( dib != NULL, "ret NULL\n" );
+    memset( bits, 0x55, 512 * 512 * 4 );
+    orig_bm = SelectObject( hdc, dib );
+    time_dib_operations( hdc, src_dc, "8888" );
+    SelectObject( hdc, orig_bm );
+    DeleteObject( dib );
+
+    bmi->bmiHeader.biBitCount = 16;
+    dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    ok( dib != NULL, "ret NULL\n" );
+    memset( bits, 0x55, 512 * 512 * 2 );
+    orig_bm = SelectObject( hdc, dib );
+    time_dib_operations( hdc, src_dc, "555" );
+    SelectObject( hdc, orig_bm );
+    DeleteObject( dib );
+
+    bmi->bmiHeader.biCompression = BI_BITFIELDS;
+    bit_fields[0] = 0xf800;
+    bit_fields[1] = 0x07e0;
+    bit_fields[2] = 0x001f;
+    dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    ok( dib != NULL, "ret NULL\n" );
+    memset( bits, 0x55, 512 * 512 * 2 );
+    orig_bm = SelectObject( hdc, dib );
+    time_dib_operations( hdc, src_dc, "565" );
+    SelectObject( hdc, orig_bm );
+    DeleteObject( dib );
+
+    SelectObject( src_dc, orig_src_bm );
+    DeleteObject( src_dib );
+    DeleteDC( src_dc );
+    DeleteDC( hdc );
+}
+
+/* Runs the graphics tests again in a child process with WINE_DIB_THREADS
+ * set, so that large operations are rendered in bands. The thread count is
+ * only read once per process, and the output must match the same hashes. */
+static void test_banded_graphics(void)
+{
+    char cmdline[MAX_PATH + 32];
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char **argv;
+    BOOL ret;
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "\"%s\" dib banded", argv[0] );
+
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    SetEnvironmentVariableA( "WINE_DIB_THREADS", "4" );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info );
+    SetEnvironmentVariableA( "WINE_DIB_THREADS", NULL );
+    ok( ret, "CreateProcess failed, error %u\n", GetLastError() );
+    if (!ret) return;
+
+    winetest_wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+}
+
 START_TEST(dib)
 {
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs( &argv );
+
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
+    if (argc >= 3 && !strcmp( argv[2], "banded" ))
+    {
+        test_simple_graphics();
+        CryptReleaseContext(crypt_prov, 0);
+        return;
+    }
+
     test_simple_graphics();
+    test_banded_graphics();
+    test_performance();
 
     CryptReleaseContext(crypt_prov, 0);
 }
@@ -28,6 +28,7 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winnls.h"
+#include "winreg.h"
 
 #include "wine/heap.h"
 #include "wine/test.h"
@@ -7004,6 +7005,245 @@ static void test_long_names(void)
     ReleaseDC(NULL, dc);
 }
 
+static INT CALLBACK count_fonts_proc(const LOGFONTA *lf, const TEXTMETRICA *tm, DWORD type, LPARAM lparam)
+{
+    (*(int *)lparam)++;
+    return 1;
+}
+
+static int count_fonts(void)
+{
+    LOGFONTA lf;
+    int count = 0;
+    HDC hdc;
+
+    memset(&lf, 0, sizeof(lf));
+    lf.lfCharSet = DEFAULT_CHARSET;
+    hdc = GetDC(NULL);
+    EnumFontFamiliesExA(hdc, &lf, count_fonts_proc, (LPARAM)&count, 0);
+    ReleaseDC(NULL, hdc);
+    return count;
+}
+
+/* wine keeps an index of the font files in the prefix directory */
+static BOOL get_font_index_path(WCHAR *path)
+{
+    static const WCHAR driveW[] = {'C',':','\\',0};
+    char *(CDECL *pwine_get_unix_file_name)(LPCWSTR);
+    WCHAR *(CDECL *pwine_get_dos_file_name)(LPCSTR);
+    HMODULE kernel32 = GetModuleHandleA("kernel32.dll");
+    char *unix_name, *p, buffer[MAX_PATH];
+    WCHAR *dos_name;
+
+    pwine_get_unix_file_name = (void *)GetProcAddress(kernel32, "wine_get_unix_file_name");
+    pwine_get_dos_file_name = (void *)GetProcAddress(kernel32, "wine_get_dos_file_name");
+    if (!pwine_get_unix_file_name || !pwine_get_dos_file_name) return FALSE;
+
+    /* C: is a link in the dosdevices directory of the prefix */
+    if (!(unix_name = pwine_get_unix_file_name(driveW))) return FALSE;
+    p = strstr(unix_name, "/dosdevices/");
+    if (p && p - unix_name + sizeof("/fontindex") <= sizeof(buffer))
+    {
+        memcpy(buffer, unix_name, p - unix_name);
+        strcpy(buffer + (p - unix_name), "/fontindex");
+    }
+    HeapFree(GetProcessHeap(), 0, unix_name);
+    if (!p || !(dos_name = pwine_get_dos_file_name(buffer))) return FALSE;
+    lstrcpynW(path, dos_name, MAX_PATH);
+    HeapFree(GetProcessHeap(), 0, dos_name);
+    return TRUE;
+}
+
+/* starts a process that builds the font list again, with the index left in path */
+static void check_fonts_from_index(const WCHAR *path, int count, int line)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmd[MAX_PATH + 32];
+    char **argv;
+    LONG ret;
+
+    /* the font list is only built from the files and the index when there's no cache */
+    ret = RegDeleteTreeA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts\\Cache");
+    ok_(__FILE__, line)(!ret || ret == ERROR_FILE_NOT_FOUND, "RegDeleteTree failed, error %d\n", ret);
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmd, "%s font font_index %d", argv[0], count);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    ret = CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info);
+    ok_(__FILE__, line)(ret, "CreateProcess failed, error %u\n", GetLastError());
+    if (!ret) return;
+    winetest_wait_child_process(info.hProcess);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+
+    ok_(__FILE__, line)(GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES, "font index not written again\n");
+}
+
+static void test_font_index(void)
+{
+    WCHAR path[MAX_PATH];
+    DWORD size, written;
+    HANDLE file;
+    HKEY key;
+    BYTE *data;
+    int count;
+
+    if (!get_font_index_path(path) || GetFileAttributesW(path) == INVALID_FILE_ATTRIBUTES)
+    {
+        skip("font index not found\n");
+        return;
+    }
+    if (RegOpenKeyExA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts\\Cache", 0, KEY_READ, &key))
+    {
+        skip("font cache not found\n");
+        return;
+    }
+    RegCloseKey(key);
+
+    count = count_fonts();
+    ok(count > 0, "no fonts found\n");
+
+    file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        skip("can't open the font index, error %u\n", GetLastError());
+        return;
+    }
+    size = GetFileSize(file, NULL);
+    data = HeapAlloc(GetProcessHeap(), 0, size);
+    memset(data, 0xa5, size);
+
+    /* garbage after the header, the size still matches */
+    SetFilePointer(file, min(size, 64), NULL, FILE_BEGIN);
+    WriteFile(file, data, size - min(size, 64), &written, NULL);
+    CloseHandle(file);
+    HeapFree(GetProcessHeap(), 0, data);
+    check_fonts_from_index(path, count, __LINE__);
+
+    /* truncated */
+    file = CreateFileW(path, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "can't open the font index, error %u\n", GetLastError());
+    SetFilePointer(file, GetFileSize(file, NULL) / 2, NULL, FILE_BEGIN);
+    SetEndOfFile(file);
+    CloseHandle(file);
+    check_fonts_from_index(path, count, __LINE__);
+
+    /* the index written by the last process is used as is */
+    check_fonts_from_index(path, count, __LINE__);
+}
+
+static HFONT create_cache_test_font(int height)
+{
+    LOGFONTA lf;
+
+    memset(&lf, 0, sizeof(lf));
+    lf.lfHeight = height;
+    lf.lfQuality = NONANTIALIASED_QUALITY;
+    strcpy(lf.lfFaceName, "Tahoma");
+    return CreateFontIndirectA(&lf);
+}
+
+static void draw_cache_test_text(HDC hdc, const char *str, SIZE *size)
+{
+    BOOL ret;
+
+    PatBlt(hdc, 0, 0, 2048, 128, WHITENESS);
+    ret = ExtTextOutA(hdc, 0, 0, 0, NULL, str, strlen(str), NULL);
+    ok(ret, "ExtTextOutA failed\n");
+    ret = GetTextExtentPoint32A(hdc, str, strlen(str), size);
+    ok(ret, "GetTextExtentPoint32A failed\n");
+}
+
+static void test_dib_font_cache(void)
+{
+    static const char str[] = "The quick brown fox jumps over the lazy dog 0123456789 {}[]()@#$%&*";
+    char all_chars[96];
+    BITMAPINFO bmi;
+    HDC hdc, hdc_held;
+    HBITMAP bmp, bmp_held;
+    HFONT font, font_held, old_font, old_font_held;
+    void *bits, *bits_held;
+    BYTE *expect, *expect_held;
+    DWORD bits_size;
+    SIZE size, size_held, size2;
+    int i;
+
+    if (!is_truetype_font_installed("Tahoma"))
+    {
+        skip("Tahoma is not installed\n");
+        return;
+    }
+
+    for (i = 0; i < 95; i++) all_chars[i] = ' ' + i;
+    all_chars[95] = 0;
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = 2048;
+    bmi.bmiHeader.biHeight = -128;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bits_size = 2048 * 128 * 4;
+
+    hdc = CreateCompatibleDC(0);
+    hdc_held = CreateCompatibleDC(0);
+    bmp = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    bmp_held = CreateDIBSection(hdc_held, &bmi, DIB_RGB_COLORS, &bits_held, NULL, 0);
+    ok(bmp && bmp_held, "CreateDIBSection failed\n");
+    SelectObject(hdc, bmp);
+    SelectObject(hdc_held, bmp_held);
+    expect = HeapAlloc(GetProcessHeap(), 0, bits_size);
+    expect_held = HeapAlloc(GetProcessHeap(), 0, bits_size);
+
+    /* one font is released and should get evicted, the other one stays selected */
+    font = create_cache_test_font(-40);
+    old_font = SelectObject(hdc, font);
+    draw_cache_test_text(hdc, str, &size);
+    memcpy(expect, bits, bits_size);
+    SelectObject(hdc, old_font);
+
+    font_held = create_cache_test_font(-30);
+    old_font_held = SelectObject(hdc_held, font_held);
+    draw_cache_test_text(hdc_held, str, &size_held);
+    memcpy(expect_held, bits_held, bits_size);
+
+    /* fill the cache with large glyphs, well beyond its memory budget */
+    for (i = 0; i < 32; i++)
+    {
+        HFONT big_font = create_cache_test_font(-(100 + i * 10));
+
+        old_font = SelectObject(hdc, big_font);
+        ExtTextOutA(hdc, 0, 0, 0, NULL, all_chars, strlen(all_chars), NULL);
+        SelectObject(hdc, old_font);
+        DeleteObject(big_font);
+    }
+
+    old_font = SelectObject(hdc, font);
+    draw_cache_test_text(hdc, str, &size2);
+    ok(size2.cx == size.cx && size2.cy == size.cy, "got %dx%d, expected %dx%d\n",
+       size2.cx, size2.cy, size.cx, size.cy);
+    ok(!memcmp(bits, expect, bits_size), "text differs after the cache was trimmed\n");
+    SelectObject(hdc, old_font);
+
+    draw_cache_test_text(hdc_held, str, &size2);
+    ok(size2.cx == size_held.cx && size2.cy == size_held.cy, "got %dx%d, expected %dx%d\n",
+       size2.cx, size2.cy, size_held.cx, size_held.cy);
+    ok(!memcmp(bits_held, expect_held, bits_size), "text of the selected font differs\n");
+    SelectObject(hdc_held, old_font_held);
+
+    HeapFree(GetProcessHeap(), 0, expect);
+    HeapFree(GetProcessHeap(), 0, expect_held);
+    DeleteObject(font);
+    DeleteObject(font_held);
+    DeleteDC(hdc);
+    DeleteDC(hdc_held);
+    DeleteObject(bmp);
+    DeleteObject(bmp_held);
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
@@ -7022,6 +7262,11 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (argc >= 4 && !strcmp(argv[2], "font_index"))
+        {
+            int count = count_fonts();
+            ok(count == atoi(argv[3]), "got %d fonts, expected %s\n", count, argv[3]);
+        }
         return;
     }
 
@@ -7085,6 +7330,8 @@ START_TEST(font)
     test_bitmap_font_glyph_index();
     test_GetCharWidthI();
     test_long_names();
+    test_font_index();
+    test_dib_font_cache();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
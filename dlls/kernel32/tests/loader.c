@@ -29,6 +29,9 @@
 #include "windef.h"
 #include "winbase.h"
 #include "winternl.h"
+#include "winnls.h"
+#include "winuser.h"
+#include "tlhelp32.h"
 #include "wine/test.h"
 #include "delayloadhandler.h"
 
@@ -3659,6 +3662,224 @@ static void test_InMemoryOrderModuleList(void)
     ok(entry2 == mark2, "expected entry2 == mark2, got %p and %p\n", entry2, mark2);
 }
 
+/* writes the names of the loaded modules to a file */
+static void load_profile_child(const char *output)
+{
+    MODULEENTRY32 entry;
+    HANDLE snapshot, file;
+    DWORD written;
+    BOOL ret;
+
+    file = CreateFileA(output, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "CreateFile failed, error %u\n", GetLastError());
+    snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, 0);
+    ok(snapshot != INVALID_HANDLE_VALUE, "CreateToolhelp32Snapshot failed, error %u\n", GetLastError());
+
+    entry.dwSize = sizeof(entry);
+    for (ret = Module32First(snapshot, &entry); ret; ret = Module32Next(snapshot, &entry))
+    {
+        WriteFile(file, entry.szExePath, strlen(entry.szExePath), &written, NULL);
+        WriteFile(file, "\n", 1, &written, NULL);
+    }
+    CloseHandle(snapshot);
+    CloseHandle(file);
+}
+
+/* the profiles are kept in the loadprofile directory of the prefix, named after the exe path */
+static BOOL get_load_profile_path(WCHAR *path)
+{
+    static const WCHAR driveW[] = {'C',':','\\',0};
+    char *(CDECL *pwine_get_unix_file_name)(LPCWSTR);
+    WCHAR *(CDECL *pwine_get_dos_file_name)(LPCSTR);
+    HMODULE kernel32 = GetModuleHandleA("kernel32.dll");
+    char *unix_name, *p, buffer[MAX_PATH];
+    WCHAR exe[MAX_PATH], *dos_name;
+    ULONG hash = 0;
+    int i;
+
+    pwine_get_unix_file_name = (void *)GetProcAddress(kernel32, "wine_get_unix_file_name");
+    pwine_get_dos_file_name = (void *)GetProcAddress(kernel32, "wine_get_dos_file_name");
+    if (!pwine_get_unix_file_name || !pwine_get_dos_file_name) return FALSE;
+
+    GetModuleFileNameW(NULL, exe, MAX_PATH);
+    CharUpperW(exe);
+    for (i = 0; exe[i]; i++) hash = hash * 31 + exe[i];
+
+    /* C: is a link in the dosdevices directory of the prefix */
+    if (!(unix_name = pwine_get_unix_file_name(driveW))) return FALSE;
+    p = strstr(unix_name, "/dosdevices/");
+    if (p && p - unix_name + sizeof("/loadprofile/12345678") <= sizeof(buffer))
+        sprintf(buffer, "%.*s/loadprofile/%08x", (int)(p - unix_name), unix_name, hash);
+    HeapFree(GetProcessHeap(), 0, unix_name);
+    if (!p || !(dos_name = pwine_get_dos_file_name(buffer))) return FALSE;
+    lstrcpynW(path, dos_name, MAX_PATH);
+    HeapFree(GetProcessHeap(), 0, dos_name);
+    return TRUE;
+}
+
+static char *read_file(const WCHAR *path)
+{
+    HANDLE file;
+    DWORD size;
+    char *data;
+
+    file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    size = GetFileSize(file, NULL);
+    data = HeapAlloc(GetProcessHeap(), 0, size + 1);
+    ReadFile(file, data, size, &size, NULL);
+    data[size] = 0;
+    CloseHandle(file);
+    return data;
+}
+
+/* runs a child with load profiles enabled, returns the modules it loaded */
+static char *run_load_profile_child(const char *dir)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmdline[MAX_PATH * 3], output[MAX_PATH];
+    WCHAR outputW[MAX_PATH];
+    char **argv;
+    char *ret;
+    BOOL res;
+
+    /* not in the load path directory, that would change its write time */
+    winetest_get_mainargs(&argv);
+    GetTempPathA(MAX_PATH, output);
+    strcat(output, "wine_load_profile.txt");
+    sprintf(cmdline, "\"%s\" loader load_profile \"%s\"", argv[0], output);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    SetEnvironmentVariableA("WINE_LOAD_PROFILE", "1");
+    res = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, dir, &startup, &info);
+    SetEnvironmentVariableA("WINE_LOAD_PROFILE", NULL);
+    ok(res, "CreateProcess failed, error %u\n", GetLastError());
+    if (!res) return NULL;
+    winetest_wait_child_process(info.hProcess);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+
+    MultiByteToWideChar(CP_ACP, 0, output, -1, outputW, MAX_PATH);
+    ret = read_file(outputW);
+    ok(ret != NULL, "no module list\n");
+    DeleteFileA(output);
+    return ret;
+}
+
+static BOOL set_write_time(const WCHAR *name, DWORD flags)
+{
+    FILETIME time;
+    HANDLE file;
+    BOOL ret;
+
+    file = CreateFileW(name, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL, OPEN_EXISTING, flags, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+    GetSystemTimeAsFileTime(&time);
+    time.dwHighDateTime -= 0x100;  /* about 3 days ago */
+    ret = SetFileTime(file, NULL, NULL, &time);
+    CloseHandle(file);
+    return ret;
+}
+
+/* returns the DOS file name of the first dll recorded in the profile */
+static BOOL get_profiled_dll(const char *profile, WCHAR *name)
+{
+    const char *line, *end;
+    int i, len;
+
+    if (!(line = strstr(profile, "\ndll|"))) return FALSE;
+    /* dll|hash|dev|ino|size|mtime|name|filename|unix name */
+    for (i = 0; i < 7; i++) if (!(line = strchr(line + 1, '|'))) return FALSE;
+    if (!(end = strchr(++line, '|'))) return FALSE;
+    if (!(len = MultiByteToWideChar(CP_ACP, 0, line, end - line, name, MAX_PATH - 1))) return FALSE;
+    name[len] = 0;
+    return TRUE;
+}
+
+static void test_load_profile(void)
+{
+    char dir[MAX_PATH], *modules, *modules2, *profile, *profile2;
+    WCHAR path[MAX_PATH], dirW[MAX_PATH], dll[MAX_PATH];
+    FILETIME dll_time;
+    HANDLE file;
+
+    if (!get_load_profile_path(path))
+    {
+        win_skip("load profiles are specific to Wine\n");
+        return;
+    }
+    DeleteFileW(path);
+
+    GetTempPathA(MAX_PATH, dir);
+    strcat(dir, "wine_load_profile");
+    CreateDirectoryA(dir, NULL);
+    MultiByteToWideChar(CP_ACP, 0, dir, -1, dirW, MAX_PATH);
+
+    /* the first run records the profile */
+    modules = run_load_profile_child(dir);
+    profile = read_file(path);
+    if (!modules || !profile)
+    {
+        skip("no load profile was written\n");
+        goto done;
+    }
+    ok(strstr(profile, "\ndir|") != NULL, "no directory recorded:\n%s\n", profile);
+    ok(strstr(profile, "\ndll|") != NULL, "no dll recorded:\n%s\n", profile);
+
+    /* the second one uses it as is */
+    modules2 = run_load_profile_child(dir);
+    ok(modules2 && !strcmp(modules, modules2), "different modules:\n%s\n%s\n", modules, modules2);
+    HeapFree(GetProcessHeap(), 0, modules2);
+    profile2 = read_file(path);
+    ok(profile2 && !strcmp(profile, profile2), "profile changed:\n%s\n%s\n", profile, profile2);
+    HeapFree(GetProcessHeap(), 0, profile2);
+
+    /* a change to a load path directory drops the search results */
+    ok(set_write_time(dirW, FILE_FLAG_BACKUP_SEMANTICS), "can't touch the directory, error %u\n", GetLastError());
+    modules2 = run_load_profile_child(dir);
+    ok(modules2 && !strcmp(modules, modules2), "different modules:\n%s\n%s\n", modules, modules2);
+    HeapFree(GetProcessHeap(), 0, modules2);
+    profile2 = read_file(path);
+    ok(profile2 && strcmp(profile, profile2), "profile not updated\n");
+    HeapFree(GetProcessHeap(), 0, profile);
+    profile = profile2;
+
+    /* so does a change to a dll */
+    if (!profile || !get_profiled_dll(profile, dll))
+    {
+        ok(0, "no dll found in the profile\n");
+        goto done;
+    }
+    file = CreateFileW(dll, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       NULL, OPEN_EXISTING, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "can't open %s, error %u\n", wine_dbgstr_w(dll), GetLastError());
+    GetFileTime(file, NULL, NULL, &dll_time);
+    CloseHandle(file);
+    if (set_write_time(dll, 0))
+    {
+        modules2 = run_load_profile_child(dir);
+        ok(modules2 && !strcmp(modules, modules2), "different modules:\n%s\n%s\n", modules, modules2);
+        HeapFree(GetProcessHeap(), 0, modules2);
+        profile2 = read_file(path);
+        ok(profile2 && strcmp(profile, profile2), "profile not updated for %s\n", wine_dbgstr_w(dll));
+        HeapFree(GetProcessHeap(), 0, profile2);
+
+        file = CreateFileW(dll, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, 0, NULL);
+        SetFileTime(file, NULL, NULL, &dll_time);
+        CloseHandle(file);
+    }
+    else skip("can't touch %s, error %u\n", wine_dbgstr_w(dll), GetLastError());
+
+done:
+    HeapFree(GetProcessHeap(), 0, modules);
+    HeapFree(GetProcessHeap(), 0, profile);
+    DeleteFileW(path);
+    RemoveDirectoryA(dir);
+}
+
 START_TEST(loader)
 {
     int argc;
@@ -3708,6 +3929,11 @@ START_TEST(loader)
         *child_failures = -1;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc == 4 && !strcmp(argv[2], "load_profile"))
+    {
+        load_profile_child(argv[3]);
+        return;
+    }
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -3723,4 +3949,5 @@ START_TEST(loader)
     test_import_resolution();
     test_ExitProcess();
     test_InMemoryOrderModuleList();
+    test_load_profile();
 }
@@ -4053,6 +4053,59 @@ static void test_join(void)
     MsiViewClose(hview);
     MsiCloseHandle(hview);
 
+    /* join with parameters on both sides of the join */
+    query = "SELECT `Component`.`ComponentId`, `FeatureComponents`.`Feature_` "
+            "FROM `Component`, `FeatureComponents` "
+            "WHERE `FeatureComponents`.`Feature_` = ? "
+            "AND `Component`.`Component` = `FeatureComponents`.`Component_` "
+            "AND `Component`.`Attributes` = ?";
+    r = MsiDatabaseOpenViewA(hdb, query, &hview);
+    ok( r == ERROR_SUCCESS, "failed to open view: %d\n", r );
+
+    hrec = MsiCreateRecord(2);
+    MsiRecordSetStringA(hrec, 1, "nasalis");
+    MsiRecordSetInteger(hrec, 2, 0);
+    r = MsiViewExecute(hview, hrec);
+    ok( r == ERROR_SUCCESS, "failed to execute view: %d\n", r );
+    MsiCloseHandle(hrec);
+
+    i = 0;
+    data_correct = TRUE;
+    while ((r = MsiViewFetch(hview, &hrec)) == ERROR_SUCCESS)
+    {
+        size = MAX_PATH;
+        r = MsiRecordGetStringA( hrec, 1, buf, &size );
+        ok( r == ERROR_SUCCESS, "failed to get record string: %d\n", r );
+        if (lstrcmpA( buf, "septum" ) && lstrcmpA( buf, "ramus" ))
+            data_correct = FALSE;
+
+        size = MAX_PATH;
+        r = MsiRecordGetStringA( hrec, 2, buf, &size );
+        ok( r == ERROR_SUCCESS, "failed to get record string: %d\n", r );
+        if (lstrcmpA( buf, "nasalis" ))
+            data_correct = FALSE;
+
+        i++;
+        MsiCloseHandle(hrec);
+    }
+    ok( data_correct, "wrong data returned\n" );
+    ok( i == 2, "Expected 2 rows, got %d\n", i );
+    ok( r == ERROR_NO_MORE_ITEMS, "expected no more items: %d\n", r );
+    MsiViewClose(hview);
+
+    hrec = MsiCreateRecord(2);
+    MsiRecordSetStringA(hrec, 1, "nasalis");
+    MsiRecordSetInteger(hrec, 2, 1);
+    r = MsiViewExecute(hview, hrec);
+    ok( r == ERROR_SUCCESS, "failed to execute view: %d\n", r );
+    MsiCloseHandle(hrec);
+
+    r = MsiViewFetch(hview, &hrec);
+    ok( r == ERROR_NO_MORE_ITEMS, "expected no more items: %d\n", r );
+
+    MsiViewClose(hview);
+    MsiCloseHandle(hview);
+
     MsiCloseHandle(hdb);
     DeleteFileA(msifile);
 }
@@ -37,6 +37,7 @@
 #include "query.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(msidb);
+WINE_DECLARE_DEBUG_CHANNEL(msiplan);
 
 /* below is the query interface to a table */
 typedef struct tagMSIROWENTRY
@@ -54,6 +55,46 @@ typedef struct tagJOINTABLE
     UINT table_index;
 } JOINTABLE;
 
+/* a term of the top level AND chain of the condition */
+typedef struct tagJOINCOND
+{
+    struct expr *expr;
+    UINT         rec_index; /* wildcards used by the preceding terms */
+    UINT         table_count;
+    UINT         level;     /* last join level referencing the term */
+} JOINCOND;
+
+typedef struct tagJOINHASHENTRY
+{
+    UINT value;
+    UINT row;
+    UINT next;
+} JOINHASHENTRY;
+
+/* how the rows of one table are produced, in join order */
+typedef struct tagJOINLEVEL
+{
+    JOINTABLE     *table;
+    UINT          *rows;        /* rows matching the single table terms, NULL for all */
+    UINT           row_count;
+    JOINCOND     **conds;       /* multi table terms referencing this table */
+    UINT           cond_count;
+    const union ext_column *inner; /* hash join column of this table */
+    const union ext_column *outer; /* column of a table joined earlier */
+    BOOL           string;
+    UINT          *buckets;     /* index + 1 of the first entry, 0 if empty */
+    UINT           hash_mask;
+    JOINHASHENTRY *entries;
+} JOINLEVEL;
+
+typedef struct tagJOINPLAN
+{
+    JOINCOND  *conds;
+    UINT       cond_count;
+    JOINLEVEL *levels;
+    BOOL       empty;           /* the result is known to be empty */
+} JOINPLAN;
+
 typedef struct tagMSIORDERINFO
 {
     UINT col_count;
@@ -521,15 +562,14 @@ static UINT STRCMP_Evaluate( MSIWHEREVIEW *wv, const UINT rows[], const struct c
 {
     int sr;
     const WCHAR *l_str, *r_str;
-    UINT r;
+    UINT rl, rr;
 
     *val = TRUE;
-    r = STRING_evaluate(wv, rows, expr->left, record, &l_str);
-    if (r == ERROR_CONTINUE)
-        return r;
-    r = STRING_evaluate(wv, rows, expr->right, record, &r_str);
-    if (r == ERROR_CONTINUE)
-        return r;
+    /* evaluate both sides so that wildcards are consumed in order */
+    rl = STRING_evaluate(wv, rows, expr->left, record, &l_str);
+    rr = STRING_evaluate(wv, rows, expr->right, record, &r_str);
+    if (rl == ERROR_CONTINUE || rr == ERROR_CONTINUE)
+        return ERROR_CONTINUE;
 
     if( l_str == r_str ||
         ((!l_str || !*l_str) && (!r_str || !*r_str)) )
@@ -599,41 +639,6 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
-static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
-                             UINT table_rows[] )
-{
-    UINT r = ERROR_FUNCTION_FAILED;
-    INT val;
-
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
-    {
-        val = 0;
-        wv->rec_index = 0;
-        r = WHERE_evaluate( wv, table_rows, wv->cond, &val, record );
-        if (r != ERROR_SUCCESS && r != ERROR_CONTINUE)
-            break;
-        if (val)
-        {
-            if (*(tables + 1))
-            {
-                r = check_condition(wv, record, tables + 1, table_rows);
-                if (r != ERROR_SUCCESS)
-                    break;
-            }
-            else
-            {
-                if (r != ERROR_SUCCESS)
-                    break;
-                add_row (wv, table_rows);
-            }
-        }
-    }
-    table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
-    return r;
-}
-
 static int compare_entry( const void *left, const void *right )
 {
     const MSIROWENTRY *le = *(const MSIROWENTRY**)left;
@@ -763,6 +768,456 @@ static JOINTABLE **ordertables( MSIWHEREVIEW *wv )
     return tables;
 }
 
+static UINT count_terms( const struct expr *expr )
+{
+    if (expr->type == EXPR_COMPLEX && expr->u.expr.op == OP_AND)
+        return count_terms( expr->u.expr.left ) + count_terms( expr->u.expr.right );
+    return 1;
+}
+
+static UINT count_wildcards( const struct expr *expr )
+{
+    switch (expr->type)
+    {
+    case EXPR_WILDCARD:
+        return 1;
+    case EXPR_COMPLEX:
+    case EXPR_STRCMP:
+        return count_wildcards( expr->u.expr.left ) + count_wildcards( expr->u.expr.right );
+    default:
+        return 0;
+    }
+}
+
+static BOOL expr_uses_table( const struct expr *expr, const JOINTABLE *table )
+{
+    switch (expr->type)
+    {
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+    case EXPR_COL_NUMBER_STRING:
+        return expr->u.column.parsed.table == table;
+    case EXPR_COMPLEX:
+    case EXPR_STRCMP:
+        if (expr_uses_table( expr->u.expr.right, table ))
+            return TRUE;
+        /* fall through */
+    case EXPR_UNARY:
+        return expr_uses_table( expr->u.expr.left, table );
+    default:
+        return FALSE;
+    }
+}
+
+/* splits the condition into its AND terms, keeping track of the wildcard
+ * record fields each of them consumes */
+static UINT split_condition( struct expr *expr, JOINPLAN *plan, UINT rec_index )
+{
+    JOINCOND *cond;
+
+    if (expr->type == EXPR_COMPLEX && expr->u.expr.op == OP_AND)
+    {
+        rec_index = split_condition( expr->u.expr.left, plan, rec_index );
+        return split_condition( expr->u.expr.right, plan, rec_index );
+    }
+
+    cond = &plan->conds[plan->cond_count++];
+    cond->expr = expr;
+    cond->rec_index = rec_index;
+    cond->table_count = 0;
+    cond->level = 0;
+    return rec_index + count_wildcards( expr );
+}
+
+static UINT evaluate_cond( MSIWHEREVIEW *wv, const UINT rows[], const JOINCOND *cond,
+                           INT *val, MSIRECORD *record )
+{
+    *val = 0;
+    wv->rec_index = cond->rec_index;
+    return WHERE_evaluate( wv, rows, cond->expr, val, record );
+}
+
+/* column = column comparison between two different tables */
+static BOOL is_equi_join( const struct expr *expr )
+{
+    const struct expr *left = expr->u.expr.left, *right = expr->u.expr.right;
+
+    if (expr->type != EXPR_STRCMP && expr->type != EXPR_COMPLEX)
+        return FALSE;
+    if (expr->u.expr.op != OP_EQ || left->type != right->type)
+        return FALSE;
+    if (left->type != EXPR_COL_NUMBER_STRING && left->type != EXPR_COL_NUMBER &&
+        left->type != EXPR_COL_NUMBER32)
+        return FALSE;
+    return left->u.column.parsed.table != right->u.column.parsed.table;
+}
+
+static inline UINT join_hash( UINT value )
+{
+    return value ^ (value >> 16);
+}
+
+/* string comparisons treat empty and null strings alike */
+static UINT join_key( MSIWHEREVIEW *wv, const JOINLEVEL *level, UINT value )
+{
+    const WCHAR *str;
+
+    if (!level->string || !value)
+        return value;
+    str = msi_string_lookup( wv->db->strings, value, NULL );
+    return (str && *str) ? value : 0;
+}
+
+static BOOL is_key_column( const union ext_column *column )
+{
+    JOINTABLE *table = column->parsed.table;
+    UINT type;
+
+    if (table->view->ops->get_column_info( table->view, column->parsed.column, NULL, &type,
+                                           NULL, NULL ) != ERROR_SUCCESS)
+        return FALSE;
+    return (type & MSITYPE_KEY) != 0;
+}
+
+static void choose_hash_join( JOINPLAN *plan, UINT index )
+{
+    JOINLEVEL *level = &plan->levels[index];
+    UINT i, best = ~0u;
+    BOOL best_key = FALSE;
+
+    for (i = 0; i < level->cond_count; i++)
+    {
+        const struct expr *expr = level->conds[i]->expr;
+        const union ext_column *inner, *outer;
+        BOOL key;
+
+        if (level->conds[i]->table_count != 2 || !is_equi_join( expr ))
+            continue;
+
+        inner = &expr->u.expr.left->u.column;
+        outer = &expr->u.expr.right->u.column;
+        if (outer->parsed.table == level->table)
+        {
+            inner = &expr->u.expr.right->u.column;
+            outer = &expr->u.expr.left->u.column;
+        }
+        if (inner->parsed.table != level->table || level->conds[i]->level != index)
+            continue;
+
+        key = is_key_column( inner );
+        if (best != ~0u && (best_key || !key))
+            continue;
+
+        best = i;
+        best_key = key;
+        level->inner = inner;
+        level->outer = outer;
+        level->string = expr->type == EXPR_STRCMP;
+    }
+
+    if (best == ~0u)
+        return;
+
+    /* the hash lookup makes the term redundant at this level */
+    level->conds[best] = level->conds[--level->cond_count];
+}
+
+static UINT filter_rows( MSIWHEREVIEW *wv, MSIRECORD *record, JOINPLAN *plan, UINT index,
+                         UINT table_rows[] )
+{
+    JOINLEVEL *level = &plan->levels[index];
+    UINT table_index = level->table->table_index;
+    UINT i, j, r = ERROR_SUCCESS;
+    INT val;
+
+    for (i = 0; i < plan->cond_count; i++)
+        if (plan->conds[i].table_count == 1 && plan->conds[i].level == index)
+            break;
+    if (i == plan->cond_count)
+    {
+        level->row_count = level->table->row_count;
+        return ERROR_SUCCESS;
+    }
+
+    level->rows = msi_alloc( level->table->row_count * sizeof(*level->rows) );
+    if (!level->rows)
+        return ERROR_OUTOFMEMORY;
+
+    for (table_rows[table_index] = 0;
+         table_rows[table_index] < level->table->row_count;
+         table_rows[table_index]++)
+    {
+        for (j = i; j < plan->cond_count; j++)
+        {
+            if (plan->conds[j].table_count != 1 || plan->conds[j].level != index)
+                continue;
+            r = evaluate_cond( wv, table_rows, &plan->conds[j], &val, record );
+            if (r != ERROR_SUCCESS || !val)
+                break;
+        }
+        if (r != ERROR_SUCCESS)
+            break;
+        if (j == plan->cond_count)
+            level->rows[level->row_count++] = table_rows[table_index];
+    }
+    table_rows[table_index] = INVALID_ROW_INDEX;
+    return r;
+}
+
+static UINT build_hash( MSIWHEREVIEW *wv, JOINLEVEL *level )
+{
+    JOINTABLE *table = level->table;
+    UINT i, row, value, size = 16, count = 0;
+
+    while (size < level->row_count)
+        size <<= 1;
+
+    level->buckets = msi_alloc_zero( size * sizeof(*level->buckets) );
+    level->entries = msi_alloc( max( level->row_count, 1 ) * sizeof(*level->entries) );
+    if (!level->buckets || !level->entries)
+        return ERROR_OUTOFMEMORY;
+    level->hash_mask = size - 1;
+
+    /* insert backwards so that each chain lists its rows in ascending order */
+    for (i = level->row_count; i > 0; i--)
+    {
+        JOINHASHENTRY *entry = &level->entries[count];
+        UINT *bucket;
+
+        row = level->rows ? level->rows[i - 1] : i - 1;
+        if (table->view->ops->fetch_int( table->view, row, level->inner->parsed.column,
+                                         &value ) != ERROR_SUCCESS)
+            continue;
+
+        entry->value = join_key( wv, level, value );
+        entry->row = row;
+        bucket = &level->buckets[join_hash( entry->value ) & level->hash_mask];
+        entry->next = *bucket;
+        *bucket = ++count;
+    }
+    return ERROR_SUCCESS;
+}
+
+static void trace_plan( const MSIWHEREVIEW *wv, const JOINPLAN *plan )
+{
+    UINT i;
+
+    TRACE_(msiplan)("%p: %u tables, %u terms%s\n", wv, wv->table_count, plan->cond_count,
+                    plan->empty ? ", empty result" : "");
+
+    for (i = 0; i < wv->table_count; i++)
+    {
+        const JOINLEVEL *level = &plan->levels[i];
+        LPCWSTR table_name = NULL, inner_name = NULL, outer_name = NULL, outer_table = NULL;
+
+        level->table->view->ops->get_column_info( level->table->view, 1, NULL, NULL, NULL,
+                                                  &table_name );
+        if (!level->inner)
+        {
+            TRACE_(msiplan)("  %u: scan %s, %u of %u rows, %u residual terms\n", i,
+                            debugstr_w(table_name), level->row_count, level->table->row_count,
+                            level->cond_count);
+            continue;
+        }
+
+        level->table->view->ops->get_column_info( level->table->view, level->inner->parsed.column,
+                                                  &inner_name, NULL, NULL, NULL );
+        level->outer->parsed.table->view->ops->get_column_info( level->outer->parsed.table->view,
+                                                  level->outer->parsed.column, &outer_name,
+                                                  NULL, NULL, &outer_table );
+        TRACE_(msiplan)("  %u: hash join %s.%s = %s.%s%s, %u of %u rows, %u residual terms\n", i,
+                        debugstr_w(table_name), debugstr_w(inner_name), debugstr_w(outer_table),
+                        debugstr_w(outer_name), is_key_column( level->inner ) ? " (key)" : "",
+                        level->row_count, level->table->row_count, level->cond_count);
+    }
+}
+
+static void free_plan( MSIWHEREVIEW *wv, JOINPLAN *plan )
+{
+    UINT i;
+
+    if (plan->levels)
+    {
+        for (i = 0; i < wv->table_count; i++)
+        {
+            msi_free( plan->levels[i].rows );
+            msi_free( plan->levels[i].conds );
+            msi_free( plan->levels[i].buckets );
+            msi_free( plan->levels[i].entries );
+        }
+        msi_free( plan->levels );
+    }
+    msi_free( plan->conds );
+}
+
+/* Splits the condition into terms and decides how each table is iterated.
+ * Terms referencing a single table are evaluated once per row of that
+ * table, equality terms between two tables are turned into hash lookups,
+ * and everything else is checked as soon as the tables it references are
+ * bound. */
+static UINT build_plan( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **ordered_tables,
+                        JOINPLAN *plan, UINT table_rows[] )
+{
+    UINT i, j, r;
+    INT val;
+
+    memset( plan, 0, sizeof(*plan) );
+
+    plan->levels = msi_alloc_zero( wv->table_count * sizeof(*plan->levels) );
+    if (!plan->levels)
+        return ERROR_OUTOFMEMORY;
+
+    if (wv->cond)
+    {
+        plan->conds = msi_alloc( count_terms( wv->cond ) * sizeof(*plan->conds) );
+        if (!plan->conds)
+            return ERROR_OUTOFMEMORY;
+        split_condition( wv->cond, plan, 0 );
+    }
+
+    for (i = 0; i < wv->table_count; i++)
+    {
+        plan->levels[i].table = ordered_tables[i];
+        if (plan->cond_count)
+        {
+            plan->levels[i].conds = msi_alloc( plan->cond_count * sizeof(*plan->levels[i].conds) );
+            if (!plan->levels[i].conds)
+                return ERROR_OUTOFMEMORY;
+        }
+    }
+
+    for (i = 0; i < plan->cond_count; i++)
+    {
+        JOINCOND *cond = &plan->conds[i];
+
+        for (j = 0; j < wv->table_count; j++)
+        {
+            if (!expr_uses_table( cond->expr, plan->levels[j].table ))
+                continue;
+            cond->table_count++;
+            cond->level = j;
+        }
+
+        if (cond->table_count == 0)
+        {
+            /* constant term, evaluate it once */
+            r = evaluate_cond( wv, table_rows, cond, &val, record );
+            if (r != ERROR_SUCCESS && r != ERROR_CONTINUE)
+                return r;
+            if (!val)
+                plan->empty = TRUE;
+        }
+        else if (cond->table_count > 1)
+        {
+            /* only an OR term can be decided before all its tables are bound */
+            BOOL partial = cond->expr->type == EXPR_COMPLEX && cond->expr->u.expr.op == OP_OR;
+
+            for (j = 0; j <= cond->level; j++)
+            {
+                if (j < cond->level && !partial)
+                    continue;
+                if (expr_uses_table( cond->expr, plan->levels[j].table ))
+                    plan->levels[j].conds[plan->levels[j].cond_count++] = cond;
+            }
+        }
+    }
+
+    for (i = 0; i < wv->table_count && !plan->empty; i++)
+    {
+        r = filter_rows( wv, record, plan, i, table_rows );
+        if (r != ERROR_SUCCESS)
+            return r;
+        if (!plan->levels[i].row_count)
+            plan->empty = TRUE;
+    }
+
+    for (i = 1; i < wv->table_count && !plan->empty; i++)
+    {
+        choose_hash_join( plan, i );
+        if (!plan->levels[i].inner)
+            continue;
+        r = build_hash( wv, &plan->levels[i] );
+        if (r != ERROR_SUCCESS)
+            return r;
+    }
+
+    if (TRACE_ON(msiplan))
+        trace_plan( wv, plan );
+
+    return ERROR_SUCCESS;
+}
+
+static UINT join_tables( MSIWHEREVIEW *wv, MSIRECORD *record, const JOINPLAN *plan, UINT index,
+                         UINT table_rows[] )
+{
+    const JOINLEVEL *level = &plan->levels[index];
+    UINT table_index = level->table->table_index;
+    UINT i = 0, j, entry = 0, value = 0, r = ERROR_SUCCESS;
+    INT val;
+
+    if (level->inner)
+    {
+        JOINTABLE *outer = level->outer->parsed.table;
+
+        r = outer->view->ops->fetch_int( outer->view, table_rows[outer->table_index],
+                                         level->outer->parsed.column, &value );
+        if (r != ERROR_SUCCESS)
+            return r;
+        value = join_key( wv, level, value );
+        entry = level->buckets[join_hash( value ) & level->hash_mask];
+    }
+
+    for (;;)
+    {
+        if (level->inner)
+        {
+            const JOINHASHENTRY *hash_entry;
+
+            if (!entry)
+                break;
+            hash_entry = &level->entries[entry - 1];
+            entry = hash_entry->next;
+            if (hash_entry->value != value)
+                continue;
+            table_rows[table_index] = hash_entry->row;
+        }
+        else
+        {
+            if (i >= level->row_count)
+                break;
+            table_rows[table_index] = level->rows ? level->rows[i] : i;
+            i++;
+        }
+
+        for (j = 0; j < level->cond_count; j++)
+        {
+            r = evaluate_cond( wv, table_rows, level->conds[j], &val, record );
+            if (r == ERROR_CONTINUE)
+            {
+                /* depends on tables that are not bound yet */
+                r = ERROR_SUCCESS;
+                continue;
+            }
+            if (r != ERROR_SUCCESS || !val)
+                break;
+        }
+        if (r != ERROR_SUCCESS)
+            break;
+        if (j < level->cond_count)
+            continue;
+
+        if (index + 1 < wv->table_count)
+            r = join_tables( wv, record, plan, index + 1, table_rows );
+        else
+            r = add_row( wv, table_rows );
+        if (r != ERROR_SUCCESS)
+            break;
+    }
+
+    table_rows[table_index] = INVALID_ROW_INDEX;
+    return r;
+}
+
 static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 {
     MSIWHEREVIEW *wv = (MSIWHEREVIEW*)view;
@@ -770,6 +1225,7 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
     JOINTABLE *table = wv->tables;
     UINT *rows;
     JOINTABLE **ordered_tables;
+    JOINPLAN plan;
     UINT i = 0;
 
     TRACE("%p %p\n", wv, record);
@@ -799,12 +1255,21 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
     while ((table = table->next));
 
     ordered_tables = ordertables( wv );
-
     rows = msi_alloc( wv->table_count * sizeof(*rows) );
+    if (!ordered_tables || !rows)
+    {
+        msi_free( ordered_tables );
+        msi_free( rows );
+        return ERROR_OUTOFMEMORY;
+    }
+
     for (i = 0; i < wv->table_count; i++)
         rows[i] = INVALID_ROW_INDEX;
 
-    r =  check_condition(wv, record, ordered_tables, rows);
+    r = build_plan( wv, record, ordered_tables, &plan, rows );
+    if (r == ERROR_SUCCESS && !plan.empty)
+        r = join_tables( wv, record, &plan, 0, rows );
+    free_plan( wv, &plan );
 
     if (wv->order_info)
         wv->order_info->error = ERROR_SUCCESS;
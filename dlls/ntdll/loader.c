@@ -23,7 +23,9 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
@@ -605,15 +607,13 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 
 
 /*************************************************************************
- *		find_named_export
+ *		find_export_name_index
  *
- * Find an exported function by name.
- * The loader_section must be locked while calling this function.
+ * Find the index of a name in the export name table, -1 if not found.
  */
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
-                                  DWORD exp_size, const char *name, int hint, LPCWSTR load_path )
+static int find_export_name_index( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+                                   const char *name, int hint )
 {
-    const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int min = 0, max = exports->NumberOfNames - 1;
 
@@ -621,8 +621,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     if (hint >= 0 && hint <= max)
     {
         char *ename = get_rva( module, names[hint] );
-        if (!strcmp( ename, name ))
-            return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
+        if (!strcmp( ename, name )) return hint;
     }
 
     /* then do a binary search */
@@ -630,13 +629,28 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     {
         int res, pos = (min + max) / 2;
         char *ename = get_rva( module, names[pos] );
-        if (!(res = strcmp( ename, name )))
-            return find_ordinal_export( module, exports, exp_size, ordinals[pos], load_path );
+        if (!(res = strcmp( ename, name ))) return pos;
         if (res > 0) max = pos - 1;
         else min = pos + 1;
     }
-    return NULL;
+    return -1;
+}
+
 
+/*************************************************************************
+ *		find_named_export
+ *
+ * Find an exported function by name.
+ * The loader_section must be locked while calling this function.
+ */
+static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+                                  DWORD exp_size, const char *name, int hint, LPCWSTR load_path )
+{
+    const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
+    int pos = find_export_name_index( module, exports, name, hint );
+
+    if (pos == -1) return NULL;
+    return find_ordinal_export( module, exports, exp_size, ordinals[pos], load_path );
 }
 
 
@@ -661,6 +675,9 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     PVOID protect_base;
     SIZE_T protect_size = 0;
     DWORD protect_old;
+    const WORD *ordinals;
+    const int *indexes;
+    UINT i, count = 0;
 
     thunk_list = get_rva( module, (DWORD)descr->FirstThunk );
     if (descr->u.OriginalFirstThunk)
@@ -706,9 +723,9 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
 
     /* unprotect the import address table since it can be located in
      * readonly section */
-    while (import_list[protect_size].u1.Ordinal) protect_size++;
+    while (import_list[count].u1.Ordinal) count++;
     protect_base = thunk_list;
-    protect_size *= sizeof(*thunk_list);
+    protect_size = count * sizeof(*thunk_list);
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base,
                             &protect_size, PAGE_READWRITE, &protect_old );
 
@@ -741,7 +758,11 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         goto done;
     }
 
-    while (import_list->u1.Ordinal)
+    /* export name indexes that didn't match the hints on a previous run */
+    ordinals = get_rva( imp_mod, exports->AddressOfNameOrdinals );
+    indexes = load_profile_get_import_indexes( current_modref->ldr.BaseDllName.Buffer, name, count );
+
+    for (i = 0; import_list->u1.Ordinal; i++)
     {
         if (IMAGE_SNAP_BY_ORDINAL(import_list->u1.Ordinal))
         {
@@ -761,10 +782,20 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         else  /* import by name */
         {
             IMAGE_IMPORT_BY_NAME *pe_name;
+            int pos, hint;
+
             pe_name = get_rva( module, (DWORD)import_list->u1.AddressOfData );
-            thunk_list->u1.Function = (ULONG_PTR)find_named_export( imp_mod, exports, exp_size,
-                                                                    (const char*)pe_name->Name,
-                                                                    pe_name->Hint, load_path );
+            hint = indexes && indexes[i] != -1 ? indexes[i] : pe_name->Hint;
+            pos = find_export_name_index( imp_mod, exports, (const char *)pe_name->Name, hint );
+            if (pos != -1)
+            {
+                thunk_list->u1.Function = (ULONG_PTR)find_ordinal_export( imp_mod, exports, exp_size,
+                                                                          ordinals[pos], load_path );
+                if (pos != hint)
+                    load_profile_set_import_index( current_modref->ldr.BaseDllName.Buffer, name, count,
+                                                   i, pos == pe_name->Hint ? -1 : pos );
+            }
+            else thunk_list->u1.Function = 0;
             if (!thunk_list->u1.Function)
             {
                 thunk_list->u1.Function = allocate_stub( name, (const char*)pe_name->Name );
@@ -1843,6 +1874,172 @@ static void set_security_cookie( void *module, SIZE_T len )
     }
 }
 
+/*
+ * Relocating a large image that couldn't be mapped at its preferred base
+ * touches most of its pages, so the relocation blocks are split across a few
+ * threads. Linkers emit one block per 4k page in increasing order; images
+ * that are laid out that way, with every fixup inside its own page and the
+ * image, can have their blocks applied in any order without two threads
+ * writing to the same place. Anything else is relocated on the calling
+ * thread. The helpers are plain pthreads that don't have a TEB, they are
+ * started for one image and joined before returning, and they only run
+ * LdrProcessRelocationBlock on the validated blocks.
+ *
+ * WINE_LOADER_THREADS gives the number of threads to use, the calling thread
+ * included; images are relocated on the calling thread only if it's unset.
+ */
+
+#define MAX_RELOC_THREADS   16
+#define MIN_RELOC_SIZE      0x10000  /* size of the relocation directory worth splitting */
+#define RELOC_CHUNK_BLOCKS  16       /* blocks processed at a time by a thread */
+#define RELOC_PAGE_SIZE     0x1000   /* size of the page covered by a block */
+
+static int reloc_threads = -1;       /* number of threads to use, -1 if not initialized yet */
+static LONG reloc_next;              /* next chunk to process */
+static IMAGE_BASE_RELOCATION **reloc_blocks;
+static UINT reloc_count;
+static char *reloc_module;
+static INT_PTR reloc_delta;
+
+static void process_relocation_chunks(void)
+{
+    UINT i, start;
+
+    while ((start = (InterlockedIncrement( &reloc_next ) - 1) * RELOC_CHUNK_BLOCKS) < reloc_count)
+    {
+        for (i = start; i < reloc_count && i < start + RELOC_CHUNK_BLOCKS; i++)
+        {
+            IMAGE_BASE_RELOCATION *rel = reloc_blocks[i];
+            LdrProcessRelocationBlock( reloc_module + rel->VirtualAddress,
+                                       (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT),
+                                       (USHORT *)(rel + 1), reloc_delta );
+        }
+    }
+}
+
+static void *reloc_thread( void *arg )
+{
+    sigset_t set;
+
+    /* we don't have a TEB, so the signal handlers can't run on this thread */
+    sigfillset( &set );
+    pthread_sigmask( SIG_BLOCK, &set, NULL );
+
+    process_relocation_chunks();
+    return NULL;
+}
+
+static void init_reloc_threads(void)
+{
+    const char *env = getenv( "WINE_LOADER_THREADS" );
+    int count = env ? atoi( env ) : 0;
+
+    if (count > (int)NtCurrentTeb()->Peb->NumberOfProcessors) count = NtCurrentTeb()->Peb->NumberOfProcessors;
+    if (count > MAX_RELOC_THREADS) count = MAX_RELOC_THREADS;
+    reloc_threads = count > 1 ? count : 0;
+    if (reloc_threads) TRACE( "using %d relocation threads\n", reloc_threads );
+}
+
+static IMAGE_BASE_RELOCATION *next_relocation_block( IMAGE_BASE_RELOCATION *rel )
+{
+    return (IMAGE_BASE_RELOCATION *)((USHORT *)(rel + 1) + (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT));
+}
+
+/* check that a relocation block can be processed without any error, and that
+ * it only writes inside its page of the image */
+static BOOL is_valid_relocation_block( const IMAGE_BASE_RELOCATION *rel, const IMAGE_BASE_RELOCATION *end,
+                                       SIZE_T len )
+{
+    const USHORT *relocs = (const USHORT *)(rel + 1);
+    UINT i, count, offset, size;
+
+    if (rel->VirtualAddress >= len || rel->SizeOfBlock < sizeof(*rel)) return FALSE;
+    count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+    if ((const char *)(relocs + count) > (const char *)end) return FALSE;
+
+    for (i = 0; i < count; i++)
+    {
+        offset = relocs[i] & 0xfff;
+        switch (relocs[i] >> 12)
+        {
+        case IMAGE_REL_BASED_ABSOLUTE:
+            continue;
+        case IMAGE_REL_BASED_HIGH:
+        case IMAGE_REL_BASED_LOW:
+            size = sizeof(short);
+            break;
+        case IMAGE_REL_BASED_HIGHLOW:
+            size = sizeof(int);
+            break;
+#ifdef _WIN64
+        case IMAGE_REL_BASED_DIR64:
+            size = sizeof(INT_PTR);
+            break;
+#endif
+        default:
+            return FALSE;
+        }
+        if (offset + size > RELOC_PAGE_SIZE) return FALSE;
+        if (offset + size > len - rel->VirtualAddress) return FALSE;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           relocate_in_parallel
+ *
+ * Apply the relocation blocks from rel to end using several threads.
+ * Returns FALSE if the image should be relocated on the calling thread.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL relocate_in_parallel( void *module, SIZE_T len, IMAGE_BASE_RELOCATION *rel,
+                                  IMAGE_BASE_RELOCATION *end, INT_PTR delta )
+{
+    IMAGE_BASE_RELOCATION *block;
+    pthread_t threads[MAX_RELOC_THREADS];
+    pthread_attr_t attr;
+    UINT count = 0, prev = 0;
+    int i, started;
+
+    if (reloc_threads == -1) init_reloc_threads();
+    if (!reloc_threads) return FALSE;
+    if ((char *)end - (char *)rel < MIN_RELOC_SIZE) return FALSE;
+
+    for (block = rel; block < end - 1 && block->SizeOfBlock; block = next_relocation_block( block ))
+    {
+        if (!is_valid_relocation_block( block, end, len )) return FALSE;
+        /* one block per page, in increasing order */
+        if (count && block->VirtualAddress < prev + RELOC_PAGE_SIZE) return FALSE;
+        prev = block->VirtualAddress;
+        count++;
+    }
+    if (!(reloc_blocks = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(*reloc_blocks) ))) return FALSE;
+    for (block = rel, count = 0; block < end - 1 && block->SizeOfBlock; block = next_relocation_block( block ))
+        reloc_blocks[count++] = block;
+
+    TRACE( "relocating %u blocks on %d threads\n", count, reloc_threads );
+
+    reloc_module = module;
+    reloc_delta = delta;
+    reloc_count = count;
+    reloc_next = 0;
+
+    pthread_attr_init( &attr );
+    pthread_attr_setstacksize( &attr, 0x10000 );
+    /* the calling thread relocates blocks too */
+    for (started = 0; started < reloc_threads - 1; started++)
+        if (pthread_create( &threads[started], &attr, reloc_thread, NULL )) break;
+    pthread_attr_destroy( &attr );
+
+    process_relocation_chunks();
+
+    for (i = 0; i < started; i++) pthread_join( threads[i], NULL );
+
+    RtlFreeHeap( GetProcessHeap(), 0, reloc_blocks );
+    reloc_blocks = NULL;
+    return TRUE;
+}
+
 static NTSTATUS perform_relocations( void *module, SIZE_T len )
 {
     IMAGE_NT_HEADERS *nt;
@@ -1897,6 +2094,8 @@ static NTSTATUS perform_relocations( void *module, SIZE_T len )
     end = get_rva( module, relocs->VirtualAddress + relocs->Size );
     delta = (char *)module - base;
 
+    if (relocate_in_parallel( module, len, rel, end, delta )) rel = end;
+
     while (rel < end - 1 && rel->SizeOfBlock)
     {
         if (rel->VirtualAddress >= len)
@@ -2365,6 +2564,35 @@ static HANDLE open_dll_file( UNICODE_STRING *nt_name, WINE_MODREF **pwm, struct
 }
 
 
+/***********************************************************************
+ *	find_profiled_dll
+ *
+ * Open a dll using the load path search result recorded in the load
+ * profile. Helper for find_dll_file.
+ */
+static BOOL find_profiled_dll( const WCHAR *load_path, const WCHAR *libname, WCHAR *filename,
+                               ULONG size, WINE_MODREF **pwm, HANDLE *handle, struct stat *st )
+{
+    UNICODE_STRING nt_name;
+    const WCHAR *profiled;
+
+    if (!(profiled = load_profile_get_dll( load_path, libname ))) return FALSE;
+    if ((strlenW( profiled ) + 1) * sizeof(WCHAR) > size) return FALSE;
+
+    strcpyW( filename, profiled );
+    if ((*pwm = find_fullname_module( filename ))) return TRUE;
+    if (!RtlDosPathNameToNtPathName_U( filename, &nt_name, NULL, NULL )) return FALSE;
+    *handle = open_dll_file( &nt_name, pwm, st );
+    RtlFreeUnicodeString( &nt_name );
+
+    if (load_profile_check_dll( load_path, libname, (*handle || *pwm) ? st : NULL )) return TRUE;
+    if (*handle) NtClose( *handle );
+    *handle = 0;
+    *pwm = NULL;
+    return FALSE;
+}
+
+
 /***********************************************************************
  *	find_dll_file
  *
@@ -2418,6 +2646,7 @@ static NTSTATUS find_dll_file( const WCHAR *load_path, const WCHAR *libname,
     if (RtlDetermineDosPathNameType_U( libname ) == RELATIVE_PATH)
     {
         /* we need to search for it */
+        if (find_profiled_dll( load_path, libname, filename, *size, pwm, handle, st )) goto found;
         len = RtlDosSearchPath_U( load_path, libname, NULL, *size, filename, &file_part );
         if (len)
         {
@@ -2430,6 +2659,7 @@ static NTSTATUS find_dll_file( const WCHAR *load_path, const WCHAR *libname,
                 return STATUS_NO_MEMORY;
             }
             *handle = open_dll_file( &nt_name, pwm, st );
+            if (*handle) load_profile_add_dll( load_path, libname, filename, st );
             goto found;
         }
 
@@ -3269,6 +3499,7 @@ NTSTATUS attach_dlls( CONTEXT *context, void **entry )
     if (!imports_fixup_done)
     {
         actctx_init();
+        load_profile_init( wm->ldr.FullDllName.Buffer );
         if (wm->ldr.Flags & LDR_COR_ILONLY)
             status = fixup_imports_ilonly( wm, load_path, entry );
         else
@@ -3305,6 +3536,7 @@ NTSTATUS attach_dlls( CONTEXT *context, void **entry )
             NtTerminateProcess( GetCurrentProcess(), status );
         }
         attach_implicitly_loaded_dlls( context );
+        load_profile_save();
         virtual_release_address_space();
     }
     else
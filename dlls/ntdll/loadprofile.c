@@ -0,0 +1,708 @@
+/*
+ * Dll load profiles
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * A load profile records, for a given executable, where the dlls loaded
+ * at process start were found on the load path, and which export name
+ * table entry each of their imports resolved to.  On the next start the
+ * recorded search results are used instead of searching the load path
+ * again, as long as none of the load path directories has changed and the
+ * dll files still have the same identity, and the dll files are
+ * prefetched.  Export name indexes are used as hints, so they don't need
+ * any validation.
+ *
+ * Profiles are only used when WINE_LOAD_PROFILE is set to a non-zero
+ * value.  Each one is a text file in the loadprofile subdirectory of the
+ * Wine config directory, named after the hash of the executable path.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+#include "ntdll_misc.h"
+
+#include "wine/library.h"
+#include "wine/list.h"
+#include "wine/unicode.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(module);
+
+static const char profile_magic[] = "wine load profile 1";
+
+/* a directory of a searched load path */
+struct profile_dir
+{
+    struct list entry;
+    time_t      mtime;      /* modification time, 0 if the directory doesn't exist */
+    char        unix_name[1];
+};
+
+/* the result of a load path search */
+struct profile_dll
+{
+    struct list entry;
+    ULONG       path_hash;  /* hash of the load path and current directory */
+    ULONGLONG   dev;        /* identity of the file that was found */
+    ULONGLONG   ino;
+    ULONGLONG   size;
+    time_t      mtime;
+    WCHAR      *name;       /* name that was searched for */
+    WCHAR      *filename;   /* DOS name of the file that was found */
+    char       *unix_name;  /* Unix name of the file, for prefetching */
+};
+
+/* the export name table indexes of an import descriptor */
+struct profile_import
+{
+    struct list entry;
+    WCHAR      *importer;   /* base name of the importing module */
+    char       *dll;        /* dll name in the import descriptor */
+    UINT        count;      /* number of imported functions */
+    int         index[1];   /* export name index for each function, -1 if unknown */
+};
+
+static BOOL profile_active;
+static BOOL profile_dirty;
+static char *profile_file;
+static struct list profile_dirs = LIST_INIT( profile_dirs );
+static struct list profile_dlls = LIST_INIT( profile_dlls );
+static struct list profile_imports = LIST_INIT( profile_imports );
+
+static ULONG recorded_paths[8];  /* load paths whose directories are in profile_dirs */
+static unsigned int nb_recorded_paths;
+
+
+static ULONG hash_string( ULONG hash, const WCHAR *str )
+{
+    while (*str) hash = hash * 31 + toupperW( *str++ );
+    return hash;
+}
+
+/* the result of a search with a relative load path entry depends on the current directory */
+static ULONG hash_load_path( const WCHAR *load_path )
+{
+    ULONG hash = hash_string( 0, load_path );
+
+    RtlAcquirePebLock();
+    hash = hash_string( hash, NtCurrentTeb()->Peb->ProcessParameters->CurrentDirectory.DosPath.Buffer );
+    RtlReleasePebLock();
+    return hash;
+}
+
+static WCHAR *strdupW( const WCHAR *str )
+{
+    WCHAR *ret;
+
+    if ((ret = RtlAllocateHeap( GetProcessHeap(), 0, (strlenW( str ) + 1) * sizeof(WCHAR) )))
+        strcpyW( ret, str );
+    return ret;
+}
+
+static char *strdupA( const char *str, size_t len )
+{
+    char *ret;
+
+    if ((ret = RtlAllocateHeap( GetProcessHeap(), 0, len + 1 )))
+    {
+        memcpy( ret, str, len );
+        ret[len] = 0;
+    }
+    return ret;
+}
+
+static WCHAR *unix_to_wide( const char *str, size_t len )
+{
+    WCHAR *ret;
+    int count;
+
+    if (!(ret = RtlAllocateHeap( GetProcessHeap(), 0, (len + 1) * sizeof(WCHAR) ))) return NULL;
+    count = ntdll_umbstowcs( 0, str, len, ret, len );
+    ret[count] = 0;
+    return ret;
+}
+
+static char *wide_to_unix( const WCHAR *str )
+{
+    int len = strlenW( str ), count;
+    char *ret;
+
+    if (!(ret = RtlAllocateHeap( GetProcessHeap(), 0, len * 3 + 1 ))) return NULL;
+    count = ntdll_wcstoumbs( 0, str, len, ret, len * 3, NULL, NULL );
+    ret[count] = 0;
+    return ret;
+}
+
+/* returns the Unix name of a DOS path, the file itself doesn't need to exist */
+static char *get_unix_name( const WCHAR *dos_name )
+{
+    UNICODE_STRING nt_name;
+    ANSI_STRING unix_name;
+    NTSTATUS status;
+
+    if (!RtlDosPathNameToNtPathName_U( dos_name, &nt_name, NULL, NULL )) return NULL;
+    status = wine_nt_to_unix_file_name( &nt_name, &unix_name, FILE_OPEN_IF, FALSE );
+    RtlFreeUnicodeString( &nt_name );
+    if (status && status != STATUS_NO_SUCH_FILE) return NULL;
+    return unix_name.Buffer;
+}
+
+static time_t get_dir_mtime( const char *unix_name )
+{
+    struct stat st;
+
+    if (stat( unix_name, &st ) == -1 || !S_ISDIR( st.st_mode )) return 0;
+    return st.st_mtime;
+}
+
+static void free_dll( struct profile_dll *dll )
+{
+    list_remove( &dll->entry );
+    RtlFreeHeap( GetProcessHeap(), 0, dll->name );
+    RtlFreeHeap( GetProcessHeap(), 0, dll->filename );
+    RtlFreeHeap( GetProcessHeap(), 0, dll->unix_name );
+    RtlFreeHeap( GetProcessHeap(), 0, dll );
+}
+
+static void free_import( struct profile_import *import )
+{
+    list_remove( &import->entry );
+    RtlFreeHeap( GetProcessHeap(), 0, import->importer );
+    RtlFreeHeap( GetProcessHeap(), 0, import->dll );
+    RtlFreeHeap( GetProcessHeap(), 0, import );
+}
+
+static void free_profile(void)
+{
+    struct profile_dir *dir, *next_dir;
+    struct profile_dll *dll, *next_dll;
+    struct profile_import *import, *next_import;
+
+    LIST_FOR_EACH_ENTRY_SAFE( dir, next_dir, &profile_dirs, struct profile_dir, entry )
+    {
+        list_remove( &dir->entry );
+        RtlFreeHeap( GetProcessHeap(), 0, dir );
+    }
+    LIST_FOR_EACH_ENTRY_SAFE( dll, next_dll, &profile_dlls, struct profile_dll, entry )
+        free_dll( dll );
+    LIST_FOR_EACH_ENTRY_SAFE( import, next_import, &profile_imports, struct profile_import, entry )
+        free_import( import );
+    RtlFreeHeap( GetProcessHeap(), 0, profile_file );
+    profile_file = NULL;
+    nb_recorded_paths = 0;
+}
+
+static struct profile_dir *add_dir( const char *unix_name, time_t mtime )
+{
+    struct profile_dir *dir;
+
+    LIST_FOR_EACH_ENTRY( dir, &profile_dirs, struct profile_dir, entry )
+        if (!strcmp( dir->unix_name, unix_name )) return dir;
+
+    if (!(dir = RtlAllocateHeap( GetProcessHeap(), 0,
+                                 offsetof( struct profile_dir, unix_name[strlen( unix_name ) + 1] ))))
+        return NULL;
+    dir->mtime = mtime;
+    strcpy( dir->unix_name, unix_name );
+    list_add_tail( &profile_dirs, &dir->entry );
+    return dir;
+}
+
+/***********************************************************************
+ *           add_load_path
+ *
+ * Record the directories of a load path, so that the search results can be
+ * validated. Fails if one of the directories can't be resolved.
+ */
+static BOOL add_load_path( const WCHAR *load_path, ULONG hash )
+{
+    const WCHAR *p, *end;
+    WCHAR *name;
+    char *unix_name;
+    unsigned int i;
+    BOOL ret = TRUE;
+
+    for (i = 0; i < nb_recorded_paths; i++) if (recorded_paths[i] == hash) return TRUE;
+
+    for (p = load_path; *p && ret; p = *end ? end + 1 : end)
+    {
+        if (!(end = strchrW( p, ';' ))) end = p + strlenW( p );
+        if (end == p) continue;
+        if (!(name = RtlAllocateHeap( GetProcessHeap(), 0, (end - p + 1) * sizeof(WCHAR) ))) return FALSE;
+        memcpy( name, p, (end - p) * sizeof(WCHAR) );
+        name[end - p] = 0;
+        if ((unix_name = get_unix_name( name )))
+        {
+            if (!add_dir( unix_name, get_dir_mtime( unix_name ) )) ret = FALSE;
+            RtlFreeHeap( GetProcessHeap(), 0, unix_name );
+        }
+        else ret = FALSE;
+        RtlFreeHeap( GetProcessHeap(), 0, name );
+    }
+
+    if (ret && nb_recorded_paths < ARRAY_SIZE(recorded_paths)) recorded_paths[nb_recorded_paths++] = hash;
+    return ret;
+}
+
+static struct profile_dll *find_dll( ULONG path_hash, const WCHAR *name )
+{
+    struct profile_dll *dll;
+
+    LIST_FOR_EACH_ENTRY( dll, &profile_dlls, struct profile_dll, entry )
+        if (dll->path_hash == path_hash && !strcmpiW( dll->name, name )) return dll;
+    return NULL;
+}
+
+static struct profile_import *find_import( const WCHAR *importer, const char *name )
+{
+    struct profile_import *import;
+
+    LIST_FOR_EACH_ENTRY( import, &profile_imports, struct profile_import, entry )
+        if (!strcasecmp( import->dll, name ) && !strcmpiW( import->importer, importer )) return import;
+    return NULL;
+}
+
+static struct profile_import *add_import( WCHAR *importer, char *name, UINT count )
+{
+    struct profile_import *import;
+    UINT i;
+
+    if (!(import = RtlAllocateHeap( GetProcessHeap(), 0, offsetof( struct profile_import, index[count] ) )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, importer );
+        RtlFreeHeap( GetProcessHeap(), 0, name );
+        return NULL;
+    }
+    import->importer = importer;
+    import->dll = name;
+    import->count = count;
+    for (i = 0; i < count; i++) import->index[i] = -1;
+    list_add_tail( &profile_imports, &import->entry );
+    return import;
+}
+
+
+/***********************************************************************
+ * Profile file parsing. Every line is a record made of fields separated
+ * by '|', the last field extends to the end of the line:
+ *
+ * dir|mtime|unix name
+ * dll|path hash|dev|ino|size|mtime|name|DOS name|unix name
+ * imp|importer|dll name|count|index,index,...
+ */
+
+static char *get_field( char **pos )
+{
+    char *ret = *pos, *p;
+
+    if (!ret) return NULL;
+    if ((p = strchr( ret, '|' )))
+    {
+        *p = 0;
+        *pos = p + 1;
+    }
+    else *pos = NULL;
+    return ret;
+}
+
+static BOOL get_number_field( char **pos, ULONGLONG *val )
+{
+    char *str = get_field( pos );
+
+    if (!str || !*str) return FALSE;
+    for (*val = 0; *str; str++)
+    {
+        if (*str < '0' || *str > '9') return FALSE;
+        *val = *val * 10 + *str - '0';
+    }
+    return TRUE;
+}
+
+static BOOL parse_dir( char *pos )
+{
+    ULONGLONG mtime;
+
+    if (!get_number_field( &pos, &mtime ) || !pos) return FALSE;
+    if (get_dir_mtime( pos ) != (time_t)mtime)
+    {
+        TRACE( "%s changed, ignoring the load path search results\n", debugstr_a(pos) );
+        return FALSE;
+    }
+    return add_dir( pos, mtime ) != NULL;
+}
+
+static void parse_dll( char *pos )
+{
+    struct profile_dll *dll;
+    ULONGLONG hash, dev, ino, size, mtime;
+    char *name, *filename;
+
+    if (!get_number_field( &pos, &hash ) || !get_number_field( &pos, &dev ) ||
+        !get_number_field( &pos, &ino ) || !get_number_field( &pos, &size ) ||
+        !get_number_field( &pos, &mtime )) return;
+    if (!(name = get_field( &pos )) || !(filename = get_field( &pos )) || !pos) return;
+
+    if (!(dll = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*dll) ))) return;
+    dll->path_hash = hash;
+    dll->dev = dev;
+    dll->ino = ino;
+    dll->size = size;
+    dll->mtime = mtime;
+    list_add_tail( &profile_dlls, &dll->entry );
+    if (!(dll->name = unix_to_wide( name, strlen( name ) )) ||
+        !(dll->filename = unix_to_wide( filename, strlen( filename ) )) ||
+        !(dll->unix_name = strdupA( pos, strlen( pos ) )))
+        free_dll( dll );
+}
+
+static void parse_import( char *pos )
+{
+    struct profile_import *import;
+    ULONGLONG count, index;
+    char *importer, *name, *p;
+    UINT i;
+
+    if (!(importer = get_field( &pos )) || !(name = get_field( &pos ))) return;
+    if (!get_number_field( &pos, &count ) || !count || count > 0x10000 || !pos) return;
+
+    if (!(import = add_import( unix_to_wide( importer, strlen( importer ) ),
+                               strdupA( name, strlen( name ) ), count ))) return;
+    if (!import->importer || !import->dll)
+    {
+        free_import( import );
+        return;
+    }
+
+    for (i = 0; i < count && pos; i++)
+    {
+        if ((p = strchr( pos, ',' ))) *p++ = 0;
+        if (*pos && get_number_field( &pos, &index ) && index < 0x10000) import->index[i] = index;
+        pos = p;
+    }
+}
+
+/* tell the kernel that the dll files are about to be mapped */
+static void prefetch_dlls(void)
+{
+#ifdef HAVE_POSIX_FADVISE
+    struct profile_dll *dll;
+    int fd;
+
+    LIST_FOR_EACH_ENTRY( dll, &profile_dlls, struct profile_dll, entry )
+    {
+        if ((fd = open( dll->unix_name, O_RDONLY )) == -1) continue;
+        posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );
+        close( fd );
+    }
+#endif
+}
+
+static void read_profile(void)
+{
+    struct stat st;
+    char *buffer, *line, *next, *type;
+    BOOL dirs_valid = TRUE;
+    ssize_t size;
+    int fd;
+
+    if ((fd = open( profile_file, O_RDONLY )) == -1) return;
+    if (fstat( fd, &st ) == -1 || !st.st_size || st.st_size > 0x4000000 ||
+        !(buffer = RtlAllocateHeap( GetProcessHeap(), 0, st.st_size + 1 )))
+    {
+        close( fd );
+        return;
+    }
+    size = read( fd, buffer, st.st_size );
+    close( fd );
+    if (size != st.st_size) goto done;
+    buffer[size] = 0;
+
+    for (line = buffer; line; line = next)
+    {
+        if ((next = strchr( line, '\n' ))) *next++ = 0;
+        if (line == buffer)
+        {
+            if (strcmp( line, profile_magic )) break;
+            continue;
+        }
+        if (!(type = get_field( &line )) || !line) continue;
+
+        if (!strcmp( type, "dir" ))
+        {
+            /* the search results are only valid if no load path directory changed */
+            if (dirs_valid && !parse_dir( line ))
+            {
+                dirs_valid = FALSE;
+                profile_dirty = TRUE;
+            }
+        }
+        else if (!strcmp( type, "dll" ))
+        {
+            if (dirs_valid) parse_dll( line );
+        }
+        else if (!strcmp( type, "imp" )) parse_import( line );
+    }
+
+    if (!dirs_valid)
+    {
+        struct profile_dir *dir, *next_dir;
+        struct profile_dll *dll, *next_dll;
+
+        LIST_FOR_EACH_ENTRY_SAFE( dir, next_dir, &profile_dirs, struct profile_dir, entry )
+        {
+            list_remove( &dir->entry );
+            RtlFreeHeap( GetProcessHeap(), 0, dir );
+        }
+        LIST_FOR_EACH_ENTRY_SAFE( dll, next_dll, &profile_dlls, struct profile_dll, entry )
+            free_dll( dll );
+    }
+    TRACE( "loaded %s, %u dlls\n", debugstr_a(profile_file), list_count( &profile_dlls ) );
+
+done:
+    RtlFreeHeap( GetProcessHeap(), 0, buffer );
+}
+
+static void write_profile(void)
+{
+    struct profile_dir *dir;
+    struct profile_dll *dll;
+    struct profile_import *import;
+    char *tmp, *p, *name, *filename;
+    FILE *f;
+    UINT i;
+
+    if (!(tmp = RtlAllocateHeap( GetProcessHeap(), 0, strlen( profile_file ) + sizeof(".tmp") ))) return;
+    strcpy( tmp, profile_file );
+    p = strrchr( tmp, '/' );
+    *p = 0;
+    mkdir( tmp, 0777 );
+    *p = '/';
+    strcat( tmp, ".tmp" );
+
+    if (!(f = fopen( tmp, "w" )))
+    {
+        WARN( "cannot create %s: %s\n", debugstr_a(tmp), strerror( errno ));
+        RtlFreeHeap( GetProcessHeap(), 0, tmp );
+        return;
+    }
+
+    fprintf( f, "%s\n", profile_magic );
+    LIST_FOR_EACH_ENTRY( dir, &profile_dirs, struct profile_dir, entry )
+        fprintf( f, "dir|%lu|%s\n", (unsigned long)dir->mtime, dir->unix_name );
+    LIST_FOR_EACH_ENTRY( dll, &profile_dlls, struct profile_dll, entry )
+    {
+        name = wide_to_unix( dll->name );
+        filename = wide_to_unix( dll->filename );
+        if (name && filename)
+            fprintf( f, "dll|%u|%llu|%llu|%llu|%lu|%s|%s|%s\n", dll->path_hash,
+                     (unsigned long long)dll->dev, (unsigned long long)dll->ino,
+                     (unsigned long long)dll->size, (unsigned long)dll->mtime,
+                     name, filename, dll->unix_name );
+        RtlFreeHeap( GetProcessHeap(), 0, name );
+        RtlFreeHeap( GetProcessHeap(), 0, filename );
+    }
+    LIST_FOR_EACH_ENTRY( import, &profile_imports, struct profile_import, entry )
+    {
+        if (!(name = wide_to_unix( import->importer ))) continue;
+        fprintf( f, "imp|%s|%s|%u|", name, import->dll, import->count );
+        for (i = 0; i < import->count; i++)
+        {
+            if (i) fputc( ',', f );
+            if (import->index[i] != -1) fprintf( f, "%d", import->index[i] );
+        }
+        fputc( '\n', f );
+        RtlFreeHeap( GetProcessHeap(), 0, name );
+    }
+
+    if (fclose( f ) || rename( tmp, profile_file ) == -1)
+    {
+        WARN( "cannot write %s: %s\n", debugstr_a(profile_file), strerror( errno ));
+        unlink( tmp );
+    }
+    else TRACE( "saved %s\n", debugstr_a(profile_file) );
+    RtlFreeHeap( GetProcessHeap(), 0, tmp );
+}
+
+
+/***********************************************************************
+ *           load_profile_init
+ *
+ * Load the profile of the main executable, if profiles are enabled.
+ * The loader_section must be locked while calling this function.
+ */
+void load_profile_init( const WCHAR *exe_name )
+{
+    static const char subdir[] = "/loadprofile/";
+    const char *env = getenv( "WINE_LOAD_PROFILE" );
+    const char *config_dir;
+
+    if (!env || !atoi( env )) return;
+    if (!(config_dir = wine_get_config_dir())) return;
+
+    if (!(profile_file = RtlAllocateHeap( GetProcessHeap(), 0, strlen( config_dir ) + sizeof(subdir) + 8 )))
+        return;
+    sprintf( profile_file, "%s%s%08x", config_dir, subdir, hash_string( 0, exe_name ) );
+
+    profile_active = TRUE;
+    read_profile();
+    prefetch_dlls();
+}
+
+/***********************************************************************
+ *           load_profile_save
+ *
+ * Write the profile back if anything changed and stop recording. The
+ * profile only covers the dlls loaded at process start.
+ * The loader_section must be locked while calling this function.
+ */
+void load_profile_save(void)
+{
+    if (!profile_active) return;
+    if (profile_dirty) write_profile();
+    profile_active = FALSE;
+    free_profile();
+}
+
+/***********************************************************************
+ *           load_profile_get_dll
+ *
+ * Get the recorded result of a load path search.
+ */
+const WCHAR *load_profile_get_dll( const WCHAR *load_path, const WCHAR *name )
+{
+    struct profile_dll *dll;
+
+    if (!profile_active || !(dll = find_dll( hash_load_path( load_path ), name ))) return NULL;
+    return dll->filename;
+}
+
+/***********************************************************************
+ *           load_profile_check_dll
+ *
+ * Check that the file found with a recorded search result is still the
+ * same, and drop the result if it isn't. st is NULL if the file couldn't
+ * be opened.
+ */
+BOOL load_profile_check_dll( const WCHAR *load_path, const WCHAR *name, const struct stat *st )
+{
+    struct profile_dll *dll;
+
+    if (!profile_active || !(dll = find_dll( hash_load_path( load_path ), name ))) return FALSE;
+    if (st && dll->dev == st->st_dev && dll->ino == st->st_ino &&
+        dll->size == st->st_size && dll->mtime == st->st_mtime)
+        return TRUE;
+
+    TRACE( "%s changed\n", debugstr_w(dll->filename) );
+    free_dll( dll );
+    profile_dirty = TRUE;
+    return FALSE;
+}
+
+/***********************************************************************
+ *           load_profile_add_dll
+ *
+ * Record the result of a load path search.
+ */
+void load_profile_add_dll( const WCHAR *load_path, const WCHAR *name, const WCHAR *filename,
+                           const struct stat *st )
+{
+    struct profile_dll *dll;
+    ULONG hash;
+
+    if (!profile_active) return;
+
+    hash = hash_load_path( load_path );
+    if (!add_load_path( load_path, hash )) return;
+    if ((dll = find_dll( hash, name ))) free_dll( dll );
+
+    if (!(dll = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*dll) ))) return;
+    dll->path_hash = hash;
+    dll->dev = st->st_dev;
+    dll->ino = st->st_ino;
+    dll->size = st->st_size;
+    dll->mtime = st->st_mtime;
+    list_add_tail( &profile_dlls, &dll->entry );
+    if (!(dll->name = strdupW( name )) || !(dll->filename = strdupW( filename )) ||
+        !(dll->unix_name = get_unix_name( filename )))
+    {
+        free_dll( dll );
+        return;
+    }
+    profile_dirty = TRUE;
+}
+
+/***********************************************************************
+ *           load_profile_get_import_indexes
+ *
+ * Get the recorded export name indexes for the functions imported from a dll.
+ */
+const int *load_profile_get_import_indexes( const WCHAR *importer, const char *name, UINT count )
+{
+    struct profile_import *import;
+
+    if (!profile_active || !(import = find_import( importer, name )) || import->count != count)
+        return NULL;
+    return import->index;
+}
+
+/***********************************************************************
+ *           load_profile_set_import_index
+ *
+ * Record the export name index of an imported function.
+ */
+void load_profile_set_import_index( const WCHAR *importer, const char *name, UINT count,
+                                    UINT func, int index )
+{
+    struct profile_import *import;
+
+    if (!profile_active) return;
+
+    if ((import = find_import( importer, name )) && import->count != count)
+    {
+        free_import( import );
+        import = NULL;
+    }
+    if (!import && !(import = add_import( strdupW( importer ), strdupA( name, strlen( name ) ), count )))
+        return;
+    if (!import->importer || !import->dll)
+    {
+        free_import( import );
+        return;
+    }
+    if (import->index[func] == index) return;
+    import->index[func] = index;
+    profile_dirty = TRUE;
+}
@@ -218,6 +218,20 @@ enum loadorder
 
 extern enum loadorder get_load_order( const WCHAR *app_name, const WCHAR *path ) DECLSPEC_HIDDEN;
 
+/* load profile */
+
+extern void load_profile_init( const WCHAR *exe_name ) DECLSPEC_HIDDEN;
+extern void load_profile_save(void) DECLSPEC_HIDDEN;
+extern const WCHAR *load_profile_get_dll( const WCHAR *load_path, const WCHAR *name ) DECLSPEC_HIDDEN;
+extern BOOL load_profile_check_dll( const WCHAR *load_path, const WCHAR *name,
+                                    const struct stat *st ) DECLSPEC_HIDDEN;
+extern void load_profile_add_dll( const WCHAR *load_path, const WCHAR *name, const WCHAR *filename,
+                                  const struct stat *st ) DECLSPEC_HIDDEN;
+extern const int *load_profile_get_import_indexes( const WCHAR *importer, const char *name,
+                                                   UINT count ) DECLSPEC_HIDDEN;
+extern void load_profile_set_import_index( const WCHAR *importer, const char *name, UINT count,
+                                           UINT func, int index ) DECLSPEC_HIDDEN;
+
 struct debug_info
 {
     char *str_pos;       /* current position in strings buffer */
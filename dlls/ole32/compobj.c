@@ -74,18 +74,15 @@ WINE_DEFAULT_DEBUG_CHANNEL(ole);
  * This section defines variables internal to the COM module.
  */
 
-static APARTMENT *MTA; /* protected by csApartment */
-static APARTMENT *MainApartment; /* the first STA apartment */
-static struct list apts = LIST_INIT( apts ); /* protected by csApartment */
+#define APT_HASH_SIZE 32
 
-static CRITICAL_SECTION csApartment;
-static CRITICAL_SECTION_DEBUG critsect_debug =
-{
-    0, 0, &csApartment,
-    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
-      0, 0, { (DWORD_PTR)(__FILE__ ": csApartment") }
-};
-static CRITICAL_SECTION csApartment = { &critsect_debug, -1, 0, 0, 0, 0 };
+/* Apartments are looked up on every incoming call and unmarshal, so they are
+ * kept in hash tables protected by an SRW lock, lookups only take it shared. */
+static SRWLOCK apt_lock = SRWLOCK_INIT;
+static APARTMENT *MTA; /* protected by apt_lock */
+static APARTMENT *MainApartment; /* the first STA apartment, protected by apt_lock */
+static struct list apt_oxids[APT_HASH_SIZE]; /* apartments by oxid, protected by apt_lock */
+static struct list apt_tids[APT_HASH_SIZE]; /* apartments by creator thread id, protected by apt_lock */
 
 enum comclass_threadingmodel
 {
@@ -620,11 +617,51 @@ static DWORD apartment_addref(struct apartment *apt)
     return refs;
 }
 
+/* adds a reference to an apartment found in the global tables, fails if the
+ * apartment is about to be destroyed. must be called with apt_lock held */
+static BOOL apartment_addref_if_alive(struct apartment *apt)
+{
+    LONG refs = apt->refs, prev;
+
+    while (refs)
+    {
+        if ((prev = InterlockedCompareExchange(&apt->refs, refs + 1, refs)) == refs)
+        {
+            TRACE("%s: before = %d\n", wine_dbgstr_longlong(apt->oxid), refs);
+            return TRUE;
+        }
+        refs = prev;
+    }
+    return FALSE;
+}
+
+static inline struct list *apartment_oxid_bucket(OXID oxid)
+{
+    return &apt_oxids[(ULONG)(oxid ^ (oxid >> 32)) % APT_HASH_SIZE];
+}
+
+static inline struct list *apartment_tid_bucket(DWORD tid)
+{
+    return &apt_tids[tid % APT_HASH_SIZE];
+}
+
+static void apartment_init_tables(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < APT_HASH_SIZE; i++)
+    {
+        list_init(&apt_oxids[i]);
+        list_init(&apt_tids[i]);
+    }
+}
+
 /* allocates memory and fills in the necessary fields for a new apartment
- * object. must be called inside apartment cs */
+ * object. must be called with apt_lock held exclusively */
 static APARTMENT *apartment_construct(DWORD model)
 {
     APARTMENT *apt;
+    unsigned int i;
 
     TRACE("creating new apartment, model=%d\n", model);
 
@@ -633,6 +670,13 @@ static APARTMENT *apartment_construct(DWORD model)
 
     list_init(&apt->proxies);
     list_init(&apt->stubmgrs);
+    for (i = 0; i < STUBMGR_HASH_SIZE; i++)
+    {
+        list_init(&apt->stubmgr_oids[i]);
+        list_init(&apt->stubmgr_objects[i]);
+        list_init(&apt->ifstub_ipids[i]);
+    }
+    InitializeSRWLock(&apt->stubmgr_lock);
     list_init(&apt->loaded_dlls);
     apt->ipidc = 0;
     apt->refs = 1;
@@ -656,7 +700,8 @@ static APARTMENT *apartment_construct(DWORD model)
 
     TRACE("Created apartment on OXID %s\n", wine_dbgstr_longlong(apt->oxid));
 
-    list_add_head(&apts, &apt->entry);
+    list_add_head(apartment_oxid_bucket(apt->oxid), &apt->entry);
+    list_add_head(apartment_tid_bucket(apt->tid), &apt->tid_entry);
 
     return apt;
 }
@@ -672,39 +717,36 @@ static APARTMENT *apartment_get_or_create(DWORD model)
     {
         if (model & COINIT_APARTMENTTHREADED)
         {
-            EnterCriticalSection(&csApartment);
+            AcquireSRWLockExclusive(&apt_lock);
 
             apt = apartment_construct(model);
-            if (!MainApartment)
+            if (!MainApartment || !MainApartment->refs)
             {
                 MainApartment = apt;
                 apt->main = TRUE;
                 TRACE("Created main-threaded apartment with OXID %s\n", wine_dbgstr_longlong(apt->oxid));
             }
 
-            LeaveCriticalSection(&csApartment);
+            ReleaseSRWLockExclusive(&apt_lock);
 
             if (apt->main)
                 apartment_createwindowifneeded(apt);
         }
         else
         {
-            EnterCriticalSection(&csApartment);
+            AcquireSRWLockExclusive(&apt_lock);
 
             /* The multi-threaded apartment (MTA) contains zero or more threads interacting
              * with free threaded (ie thread safe) COM objects. There is only ever one MTA
              * in a process */
-            if (MTA)
-            {
+            if (MTA && apartment_addref_if_alive(MTA))
                 TRACE("entering the multithreaded apartment %s\n", wine_dbgstr_longlong(MTA->oxid));
-                apartment_addref(MTA);
-            }
             else
                 MTA = apartment_construct(model);
 
             apt = MTA;
 
-            LeaveCriticalSection(&csApartment);
+            ReleaseSRWLockExclusive(&apt_lock);
         }
         COM_CurrentInfo()->apt = apt;
     }
@@ -724,12 +766,12 @@ static APARTMENT *apartment_find_mta(void)
 {
     APARTMENT *apt;
 
-    EnterCriticalSection(&csApartment);
+    AcquireSRWLockShared(&apt_lock);
 
-    if ((apt = MTA))
-        apartment_addref(apt);
+    if ((apt = MTA) && !apartment_addref_if_alive(apt))
+        apt = NULL;
 
-    LeaveCriticalSection(&csApartment);
+    ReleaseSRWLockShared(&apt_lock);
 
     return apt;
 }
@@ -1170,27 +1212,29 @@ DWORD apartment_release(struct apartment *apt)
 {
     DWORD ret;
 
-    EnterCriticalSection(&csApartment);
-
+    /* lookups don't resurrect an apartment once its refcount dropped to
+     * zero, so only the final release needs the lock */
     ret = InterlockedDecrement(&apt->refs);
     TRACE("%s: after = %d\n", wine_dbgstr_longlong(apt->oxid), ret);
 
+    if (ret) return ret;
+
+    AcquireSRWLockExclusive(&apt_lock);
+
     if (apt->being_destroyed)
     {
-        LeaveCriticalSection(&csApartment);
+        ReleaseSRWLockExclusive(&apt_lock);
         return ret;
     }
 
-    /* destruction stuff that needs to happen under csApartment CS */
-    if (ret == 0)
-    {
-        apt->being_destroyed = TRUE;
-        if (apt == MTA) MTA = NULL;
-        else if (apt == MainApartment) MainApartment = NULL;
-        list_remove(&apt->entry);
-    }
+    /* destruction stuff that needs to happen under apt_lock */
+    apt->being_destroyed = TRUE;
+    if (apt == MTA) MTA = NULL;
+    else if (apt == MainApartment) MainApartment = NULL;
+    list_remove(&apt->entry);
+    list_remove(&apt->tid_entry);
 
-    LeaveCriticalSection(&csApartment);
+    ReleaseSRWLockExclusive(&apt_lock);
 
     if (ret == 0)
     {
@@ -1273,20 +1317,18 @@ DWORD apartment_release(struct apartment *apt)
 APARTMENT *apartment_findfromoxid(OXID oxid, BOOL ref)
 {
     APARTMENT *result = NULL;
-    struct list *cursor;
+    struct apartment *apt;
 
-    EnterCriticalSection(&csApartment);
-    LIST_FOR_EACH( cursor, &apts )
+    AcquireSRWLockShared(&apt_lock);
+    LIST_FOR_EACH_ENTRY( apt, apartment_oxid_bucket(oxid), struct apartment, entry )
     {
-        struct apartment *apt = LIST_ENTRY( cursor, struct apartment, entry );
-        if (apt->oxid == oxid)
+        if (apt->oxid == oxid && (ref ? apartment_addref_if_alive(apt) : apt->refs != 0))
         {
             result = apt;
-            if (ref) apartment_addref(result);
             break;
         }
     }
-    LeaveCriticalSection(&csApartment);
+    ReleaseSRWLockShared(&apt_lock);
 
     return result;
 }
@@ -1297,20 +1339,18 @@ APARTMENT *apartment_findfromoxid(OXID oxid, BOOL ref)
 APARTMENT *apartment_findfromtid(DWORD tid)
 {
     APARTMENT *result = NULL;
-    struct list *cursor;
+    struct apartment *apt;
 
-    EnterCriticalSection(&csApartment);
-    LIST_FOR_EACH( cursor, &apts )
+    AcquireSRWLockShared(&apt_lock);
+    LIST_FOR_EACH_ENTRY( apt, apartment_tid_bucket(tid), struct apartment, tid_entry )
     {
-        struct apartment *apt = LIST_ENTRY( cursor, struct apartment, entry );
-        if (apt->tid == tid)
+        if (apt->tid == tid && apartment_addref_if_alive(apt))
         {
             result = apt;
-            apartment_addref(result);
             break;
         }
     }
-    LeaveCriticalSection(&csApartment);
+    ReleaseSRWLockShared(&apt_lock);
 
     return result;
 }
@@ -1322,12 +1362,12 @@ static APARTMENT *apartment_findmain(void)
 {
     APARTMENT *result;
 
-    EnterCriticalSection(&csApartment);
+    AcquireSRWLockShared(&apt_lock);
 
     result = MainApartment;
-    if (result) apartment_addref(result);
+    if (result && !apartment_addref_if_alive(result)) result = NULL;
 
-    LeaveCriticalSection(&csApartment);
+    ReleaseSRWLockShared(&apt_lock);
 
     return result;
 }
@@ -2926,42 +2966,265 @@ static enum comclass_threadingmodel get_threading_model(const struct class_reg_d
         return data->u.actctx.data->model;
 }
 
-static HRESULT get_inproc_class_object(APARTMENT *apt, const struct class_reg_data *regdata,
-                                       REFCLSID rclsid, REFIID riid,
-                                       BOOL hostifnecessary, void **ppv)
+/*****************************************************************************
+ * This section contains the class activation cache
+ *
+ * Finding the in-process server of a class takes several registry lookups,
+ * each of them a server round trip.  The results are cached per process and
+ * the cache is flushed whenever something changes under HKCR\CLSID.  The
+ * change notification event is checked before every lookup, the server sets
+ * it before the change returns, so that a lookup following a registry change
+ * never uses stale data.  Only
+ * registered servers are cached, so that classes registered by the process
+ * itself are found immediately; TreatAs lookups are also cached when there
+ * is no TreatAs key, CoTreatAsClass flushes the cache explicitly.
+ *
+ * The loaded dlls are not referenced from the cache, apartment_getclassobject
+ * finds them in the apartment list so that CoFreeUnusedLibraries still works.
+ */
+
+#define CLASS_CACHE_HASH_SIZE  64
+#define CLASS_CACHE_MAX_COUNT  4096
+
+enum class_cache_type
 {
+    CLASS_CACHE_INPROC_SERVER,
+    CLASS_CACHE_INPROC_HANDLER,
+    CLASS_CACHE_TREAT_AS
+};
+
+struct class_cache_entry
+{
+    struct list entry;
+    CLSID clsid;
+    enum class_cache_type type;
+    enum comclass_threadingmodel model;
+    CLSID treat_as;                 /* CLASS_CACHE_TREAT_AS: new class */
+    HRESULT hr;                     /* CLASS_CACHE_TREAT_AS: S_OK or S_FALSE */
     WCHAR dllpath[MAX_PATH+1];
-    BOOL apartment_threaded;
+};
 
-    if (hostifnecessary)
-    {
-        enum comclass_threadingmodel model = get_threading_model(regdata);
+static CRITICAL_SECTION cs_class_cache;
+static CRITICAL_SECTION_DEBUG class_cache_cs_debug =
+{
+    0, 0, &cs_class_cache,
+    { &class_cache_cs_debug.ProcessLocksList, &class_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": cs_class_cache") }
+};
+static CRITICAL_SECTION cs_class_cache = { &class_cache_cs_debug, -1, 0, 0, 0, 0 };
+
+static struct list class_cache[CLASS_CACHE_HASH_SIZE];
+static unsigned int class_cache_count;
+static unsigned int class_cache_generation;  /* incremented on every flush */
+static int class_cache_state = -1;           /* 1 if enabled, 0 if disabled, -1 if not initialized yet */
+static HKEY class_cache_hkey;
+static HANDLE class_cache_event;
 
-        if (model == ThreadingModel_Apartment)
+static inline struct list *class_cache_bucket(REFCLSID clsid)
+{
+    return &class_cache[clsid->Data1 % CLASS_CACHE_HASH_SIZE];
+}
+
+/* must be called with cs_class_cache held */
+static void class_cache_clear(void)
+{
+    struct class_cache_entry *cached, *next;
+    unsigned int i;
+
+    for (i = 0; i < CLASS_CACHE_HASH_SIZE; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE(cached, next, &class_cache[i], struct class_cache_entry, entry)
         {
-            apartment_threaded = TRUE;
-            if (apt->multi_threaded)
-                return apartment_hostobject_in_hostapt(apt, FALSE, FALSE, regdata, rclsid, riid, ppv);
+            list_remove(&cached->entry);
+            HeapFree(GetProcessHeap(), 0, cached);
         }
-        else if (model == ThreadingModel_Free)
+    }
+    class_cache_count = 0;
+    class_cache_generation++;
+}
+
+/* must be called with cs_class_cache held */
+static BOOL class_cache_watch(void)
+{
+    return !RegNotifyChangeKeyValue(class_cache_hkey, TRUE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                                    class_cache_event, TRUE);
+}
+
+/* must be called with cs_class_cache held */
+static void class_cache_check(void)
+{
+    if (class_cache_state != 1 || WaitForSingleObject(class_cache_event, 0)) return;
+
+    /* rearm the notification before flushing so that no change is missed */
+    if (!class_cache_watch())
+    {
+        WARN("failed to watch the classes key, disabling the class cache\n");
+        class_cache_state = 0;
+    }
+    class_cache_clear();
+}
+
+/* must be called with cs_class_cache held */
+static void class_cache_init(void)
+{
+    static const WCHAR clsidW[] = {'C','L','S','I','D',0};
+    unsigned int i;
+
+    class_cache_state = 0;
+    for (i = 0; i < CLASS_CACHE_HASH_SIZE; i++) list_init(&class_cache[i]);
+
+    if (open_classes_key(HKEY_CLASSES_ROOT, clsidW, KEY_NOTIFY, &class_cache_hkey)) return;
+    if (!(class_cache_event = CreateEventW(NULL, FALSE, FALSE, NULL))) goto failed;
+    if (!class_cache_watch()) goto failed;
+    class_cache_state = 1;
+    return;
+
+failed:
+    WARN("failed to watch the classes key, not using the class cache\n");
+    if (class_cache_event) CloseHandle(class_cache_event);
+    RegCloseKey(class_cache_hkey);
+    class_cache_event = NULL;
+    class_cache_hkey = NULL;
+}
+
+/* returns the generation to pass to class_cache_add, 0 if the cache is disabled */
+static unsigned int class_cache_get_generation(void)
+{
+    unsigned int ret;
+
+    EnterCriticalSection(&cs_class_cache);
+    if (class_cache_state == -1) class_cache_init();
+    class_cache_check();
+    ret = class_cache_state == 1 ? class_cache_generation + 1 : 0;
+    LeaveCriticalSection(&cs_class_cache);
+    return ret;
+}
+
+static BOOL class_cache_lookup(REFCLSID clsid, enum class_cache_type type, struct class_cache_entry *ret)
+{
+    struct class_cache_entry *cached;
+    BOOL found = FALSE;
+
+    if (class_cache_state != 1) return FALSE;
+
+    EnterCriticalSection(&cs_class_cache);
+    class_cache_check();
+    LIST_FOR_EACH_ENTRY(cached, class_cache_bucket(clsid), struct class_cache_entry, entry)
+    {
+        if (cached->type == type && IsEqualCLSID(&cached->clsid, clsid))
         {
-            apartment_threaded = FALSE;
-            if (!apt->multi_threaded)
-                return apartment_hostobject_in_hostapt(apt, TRUE, FALSE, regdata, rclsid, riid, ppv);
+            *ret = *cached;
+            found = TRUE;
+            break;
         }
-        /* everything except "Apartment", "Free" and "Both" */
-        else if (model != ThreadingModel_Both)
-        {
-            apartment_threaded = TRUE;
-            /* everything else is main-threaded */
-            if (model != ThreadingModel_No)
-                FIXME("unrecognised threading model %d for object %s, should be main-threaded?\n", model, debugstr_guid(rclsid));
+    }
+    LeaveCriticalSection(&cs_class_cache);
+    return found;
+}
+
+/* adds an entry unless the cache has been flushed since the registry was read */
+static void class_cache_add(const struct class_cache_entry *entry, unsigned int generation)
+{
+    struct class_cache_entry *cached;
+
+    if (!generation) return;
 
-            if (apt->multi_threaded || !apt->main)
-                return apartment_hostobject_in_hostapt(apt, FALSE, TRUE, regdata, rclsid, riid, ppv);
+    EnterCriticalSection(&cs_class_cache);
+    class_cache_check();
+    if (class_cache_state == 1 && generation == class_cache_generation + 1 &&
+        class_cache_count < CLASS_CACHE_MAX_COUNT)
+    {
+        LIST_FOR_EACH_ENTRY(cached, class_cache_bucket(&entry->clsid), struct class_cache_entry, entry)
+            if (cached->type == entry->type && IsEqualCLSID(&cached->clsid, &entry->clsid)) goto done;
+
+        if ((cached = HeapAlloc(GetProcessHeap(), 0, sizeof(*cached))))
+        {
+            *cached = *entry;
+            list_add_head(class_cache_bucket(&entry->clsid), &cached->entry);
+            class_cache_count++;
         }
-        else
-            apartment_threaded = FALSE;
+    }
+done:
+    LeaveCriticalSection(&cs_class_cache);
+}
+
+static void class_cache_flush(void)
+{
+    EnterCriticalSection(&cs_class_cache);
+    if (class_cache_state != -1) class_cache_clear();
+    LeaveCriticalSection(&cs_class_cache);
+}
+
+static void class_cache_free(void)
+{
+    if (class_cache_state == 1)
+    {
+        CloseHandle(class_cache_event);
+        RegCloseKey(class_cache_hkey);
+        class_cache_state = 0;
+    }
+    if (class_cache_state != -1) class_cache_clear();
+    DeleteCriticalSection(&cs_class_cache);
+}
+
+/* caches the server registered in the InprocServer32 or InprocHandler32 key */
+static void class_cache_add_server(REFCLSID rclsid, enum class_cache_type type,
+                                   const struct class_reg_data *regdata, unsigned int generation)
+{
+    struct class_cache_entry entry;
+
+    if (!generation) return;
+    if (!get_object_dll_path(regdata, entry.dllpath, ARRAY_SIZE(entry.dllpath))) return;
+    entry.clsid = *rclsid;
+    entry.type = type;
+    entry.model = get_threading_model(regdata);
+    class_cache_add(&entry, generation);
+}
+
+/* returns TRUE if an object with the given threading model has to be created
+ * in a host apartment, else whether it is apartment-threaded */
+static BOOL need_host_apartment(APARTMENT *apt, enum comclass_threadingmodel model, REFCLSID rclsid,
+                                BOOL *apartment_threaded, BOOL *host_multi, BOOL *host_main)
+{
+    *host_multi = *host_main = FALSE;
+
+    if (model == ThreadingModel_Apartment)
+    {
+        *apartment_threaded = TRUE;
+        return apt->multi_threaded;
+    }
+    if (model == ThreadingModel_Free)
+    {
+        *apartment_threaded = FALSE;
+        *host_multi = TRUE;
+        return !apt->multi_threaded;
+    }
+    /* everything except "Apartment", "Free" and "Both" */
+    if (model != ThreadingModel_Both)
+    {
+        *apartment_threaded = TRUE;
+        /* everything else is main-threaded */
+        if (model != ThreadingModel_No)
+            FIXME("unrecognised threading model %d for object %s, should be main-threaded?\n", model, debugstr_guid(rclsid));
+        *host_main = TRUE;
+        return apt->multi_threaded || !apt->main;
+    }
+    *apartment_threaded = FALSE;
+    return FALSE;
+}
+
+static HRESULT get_inproc_class_object(APARTMENT *apt, const struct class_reg_data *regdata,
+                                       REFCLSID rclsid, REFIID riid,
+                                       BOOL hostifnecessary, void **ppv)
+{
+    WCHAR dllpath[MAX_PATH+1];
+    BOOL apartment_threaded, host_multi, host_main;
+
+    if (hostifnecessary)
+    {
+        if (need_host_apartment(apt, get_threading_model(regdata), rclsid,
+                                &apartment_threaded, &host_multi, &host_main))
+            return apartment_hostobject_in_hostapt(apt, host_multi, host_main, regdata, rclsid, riid, ppv);
     }
     else
         apartment_threaded = !apt->multi_threaded;
@@ -2977,6 +3240,26 @@ static HRESULT get_inproc_class_object(APARTMENT *apt, const struct class_reg_da
                                     rclsid, riid, ppv);
 }
 
+/* gets the class object of a server found in the class cache, returns FALSE
+ * if the class isn't cached or has to be created in a host apartment */
+static BOOL get_cached_class_object(APARTMENT *apt, REFCLSID rclsid, enum class_cache_type type,
+                                    REFIID riid, BOOL hostifnecessary, void **ppv, HRESULT *hr)
+{
+    struct class_cache_entry cached;
+    BOOL apartment_threaded, host_multi, host_main;
+
+    if (!class_cache_lookup(rclsid, type, &cached)) return FALSE;
+
+    if (!hostifnecessary)
+        apartment_threaded = !apt->multi_threaded;
+    else if (need_host_apartment(apt, cached.model, rclsid, &apartment_threaded, &host_multi, &host_main))
+        return FALSE;
+
+    TRACE("using cached server %s for %s\n", debugstr_w(cached.dllpath), debugstr_guid(rclsid));
+    *hr = apartment_getclassobject(apt, cached.dllpath, apartment_threaded, rclsid, riid, ppv);
+    return TRUE;
+}
+
 /***********************************************************************
  *           CoGetClassObject [OLE32.@]
  *
@@ -3089,27 +3372,35 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
     if (CLSCTX_INPROC_SERVER & dwClsContext)
     {
         static const WCHAR wszInprocServer32[] = {'I','n','p','r','o','c','S','e','r','v','e','r','3','2',0};
+        unsigned int generation;
         HKEY hkey;
 
-        hres = COM_OpenKeyForCLSID(rclsid, wszInprocServer32, KEY_READ, &hkey);
-        if (FAILED(hres))
+        if (!get_cached_class_object(apt, rclsid, CLASS_CACHE_INPROC_SERVER, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv, &hres))
         {
-            if (hres == REGDB_E_CLASSNOTREG)
-                ERR("class %s not registered\n", debugstr_guid(rclsid));
-            else if (hres == REGDB_E_KEYMISSING)
+            generation = class_cache_get_generation();
+
+            hres = COM_OpenKeyForCLSID(rclsid, wszInprocServer32, KEY_READ, &hkey);
+            if (FAILED(hres))
             {
-                WARN("class %s not registered as in-proc server\n", debugstr_guid(rclsid));
-                hres = REGDB_E_CLASSNOTREG;
+                if (hres == REGDB_E_CLASSNOTREG)
+                    ERR("class %s not registered\n", debugstr_guid(rclsid));
+                else if (hres == REGDB_E_KEYMISSING)
+                {
+                    WARN("class %s not registered as in-proc server\n", debugstr_guid(rclsid));
+                    hres = REGDB_E_CLASSNOTREG;
+                }
             }
-        }
 
-        if (SUCCEEDED(hres))
-        {
-            clsreg.u.hkey = hkey;
-            clsreg.hkey = TRUE;
+            if (SUCCEEDED(hres))
+            {
+                clsreg.u.hkey = hkey;
+                clsreg.hkey = TRUE;
+
+                class_cache_add_server(rclsid, CLASS_CACHE_INPROC_SERVER, &clsreg, generation);
 
-            hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
-            RegCloseKey(hkey);
+                hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
+                RegCloseKey(hkey);
+            }
         }
 
         /* return if we got a class, otherwise fall through to one of the
@@ -3125,27 +3416,35 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
     if (CLSCTX_INPROC_HANDLER & dwClsContext)
     {
         static const WCHAR wszInprocHandler32[] = {'I','n','p','r','o','c','H','a','n','d','l','e','r','3','2',0};
+        unsigned int generation;
         HKEY hkey;
 
-        hres = COM_OpenKeyForCLSID(rclsid, wszInprocHandler32, KEY_READ, &hkey);
-        if (FAILED(hres))
+        if (!get_cached_class_object(apt, rclsid, CLASS_CACHE_INPROC_HANDLER, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv, &hres))
         {
-            if (hres == REGDB_E_CLASSNOTREG)
-                ERR("class %s not registered\n", debugstr_guid(rclsid));
-            else if (hres == REGDB_E_KEYMISSING)
+            generation = class_cache_get_generation();
+
+            hres = COM_OpenKeyForCLSID(rclsid, wszInprocHandler32, KEY_READ, &hkey);
+            if (FAILED(hres))
             {
-                WARN("class %s not registered in-proc handler\n", debugstr_guid(rclsid));
-                hres = REGDB_E_CLASSNOTREG;
+                if (hres == REGDB_E_CLASSNOTREG)
+                    ERR("class %s not registered\n", debugstr_guid(rclsid));
+                else if (hres == REGDB_E_KEYMISSING)
+                {
+                    WARN("class %s not registered in-proc handler\n", debugstr_guid(rclsid));
+                    hres = REGDB_E_CLASSNOTREG;
+                }
             }
-        }
 
-        if (SUCCEEDED(hres))
-        {
-            clsreg.u.hkey = hkey;
-            clsreg.hkey = TRUE;
+            if (SUCCEEDED(hres))
+            {
+                clsreg.u.hkey = hkey;
+                clsreg.hkey = TRUE;
+
+                class_cache_add_server(rclsid, CLASS_CACHE_INPROC_HANDLER, &clsreg, generation);
 
-            hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
-            RegCloseKey(hkey);
+                hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
+                RegCloseKey(hkey);
+            }
         }
 
         /* return if we got a class, otherwise fall through to one of the
@@ -3840,6 +4139,7 @@ HRESULT WINAPI CoTreatAsClass(REFCLSID clsidOld, REFCLSID clsidNew)
 
 done:
     if (hkey) RegCloseKey(hkey);
+    class_cache_flush();
     return res;
 }
 
@@ -3866,6 +4166,8 @@ HRESULT WINAPI CoGetTreatAsClass(REFCLSID clsidOld, LPCLSID clsidNew)
     WCHAR szClsidNew[CHARS_IN_GUID];
     HRESULT res = S_OK;
     LONG len = sizeof(szClsidNew);
+    struct class_cache_entry cached;
+    unsigned int generation;
 
     TRACE("(%s,%p)\n", debugstr_guid(clsidOld), clsidNew);
 
@@ -3874,6 +4176,13 @@ HRESULT WINAPI CoGetTreatAsClass(REFCLSID clsidOld, LPCLSID clsidNew)
 
     *clsidNew = *clsidOld; /* copy over old value */
 
+    if (class_cache_lookup(clsidOld, CLASS_CACHE_TREAT_AS, &cached))
+    {
+        *clsidNew = cached.treat_as;
+        return cached.hr;
+    }
+    generation = class_cache_get_generation();
+
     res = COM_OpenKeyForCLSID(clsidOld, wszTreatAs, KEY_READ, &hkey);
     if (FAILED(res))
     {
@@ -3890,6 +4199,14 @@ HRESULT WINAPI CoGetTreatAsClass(REFCLSID clsidOld, LPCLSID clsidNew)
         ERR("Failed CLSIDFromStringA(%s), hres 0x%08x\n", debugstr_w(szClsidNew), res);
 done:
     if (hkey) RegCloseKey(hkey);
+    if (res == S_OK || res == S_FALSE)
+    {
+        cached.clsid = *clsidOld;
+        cached.type = CLASS_CACHE_TREAT_AS;
+        cached.treat_as = *clsidNew;
+        cached.hr = res;
+        class_cache_add(&cached, generation);
+    }
     return res;
 }
 
@@ -5262,6 +5579,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID reserved)
     switch(fdwReason) {
     case DLL_PROCESS_ATTACH:
         hProxyDll = hinstDLL;
+        apartment_init_tables();
 	break;
 
     case DLL_PROCESS_DETACH:
@@ -5271,8 +5589,8 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID reserved)
             UnregisterClassW( (const WCHAR*)MAKEINTATOM(apt_win_class), hProxyDll );
         RPC_UnregisterAllChannelHooks();
         COMPOBJ_DllList_Free();
+        class_cache_free();
         DeleteCriticalSection(&csRegisteredClassList);
-        DeleteCriticalSection(&csApartment);
 	break;
 
     case DLL_THREAD_DETACH:
@@ -59,6 +59,9 @@ DEFINE_OLEGUID( CLSID_DfMarshal, 0x0000030b, 0, 0 );
  * MUTEX - The value is read or written to with a mutex held.
  *         The identifier following "MUTEX" is the specific mutex that
  *         must be used.
+ * SRW   - The value is read with the SRW lock held in shared mode and
+ *         written to with it held in exclusive mode. The identifier
+ *         following "SRW" is the specific lock that must be used.
  */
 
 typedef enum ifstub_state
@@ -74,6 +77,8 @@ typedef enum ifstub_state
 struct ifstub   
 {
     struct list       entry;      /* entry in stub_manager->ifstubs list (CS stub_manager->lock) */
+    struct list       ipid_entry; /* entry in apartment ipid hash table (SRW apt->stubmgr_lock) */
+    struct stub_manager *manager; /* owning stub manager (RO) */
     IRpcStubBuffer   *stubbuffer; /* RO */
     IID               iid;        /* RO */
     IPID              ipid;       /* RO */
@@ -86,13 +91,15 @@ struct ifstub
 /* stub managers hold refs on the object and each interface stub */
 struct stub_manager
 {
-    struct list       entry;      /* entry in apartment stubmgr list (CS apt->cs) */
+    struct list       entry;      /* entry in apartment stubmgr list (SRW apt->stubmgr_lock) */
+    struct list       oid_entry;  /* entry in apartment oid hash table (SRW apt->stubmgr_lock) */
+    struct list       object_entry; /* entry in apartment object hash table (SRW apt->stubmgr_lock) */
     struct list       ifstubs;    /* list of active ifstubs for the object (CS lock) */
     CRITICAL_SECTION  lock;
     APARTMENT        *apt;        /* owning apt (RO) */
 
     ULONG             extrefs;    /* number of 'external' references (CS lock) */
-    ULONG             refs;       /* internal reference count (CS apt->cs) */
+    LONG              refs;       /* internal reference count (LOCK) */
     ULONG             weakrefs;   /* number of weak references (CS lock) */
     OID               oid;        /* apartment-scoped unique identifier (RO) */
     IUnknown         *object;     /* the object we are managing the stub for (RO) */
@@ -124,9 +131,12 @@ struct ifproxy
   IRpcChannelBuffer *chan; /* channel to object (CS parent->cs) */
 };
 
+#define STUBMGR_HASH_SIZE 64
+
 struct apartment
 {
-  struct list entry;
+  struct list entry;       /* entry in oxid hash table (SRW apt_lock) */
+  struct list tid_entry;   /* entry in creator thread id hash table (SRW apt_lock) */
 
   LONG  refs;              /* refcount of the apartment (LOCK) */
   BOOL multi_threaded;     /* multi-threaded or single-threaded apartment? (RO) */
@@ -135,7 +145,11 @@ struct apartment
   LONG ipidc;              /* interface pointer ID counter, starts at 1 (LOCK) */
   CRITICAL_SECTION cs;     /* thread safety */
   struct list proxies;     /* imported objects (CS cs) */
-  struct list stubmgrs;    /* stub managers for exported objects (CS cs) */
+  SRWLOCK stubmgr_lock;    /* protects the stub manager tables */
+  struct list stubmgrs;    /* stub managers for exported objects (SRW stubmgr_lock) */
+  struct list stubmgr_oids[STUBMGR_HASH_SIZE];    /* stub managers by oid (SRW stubmgr_lock) */
+  struct list stubmgr_objects[STUBMGR_HASH_SIZE]; /* stub managers by object (SRW stubmgr_lock) */
+  struct list ifstub_ipids[STUBMGR_HASH_SIZE];    /* interface stubs by ipid (SRW stubmgr_lock) */
   BOOL remunk_exported;    /* has the IRemUnknown interface for this apartment been created yet? (CS cs) */
   LONG remoting_started;   /* has the RPC system been started for this apartment? (LOCK) */
   struct list loaded_dlls; /* list of dlls loaded by this apartment (CS cs) */
@@ -145,7 +159,7 @@ struct apartment
   BOOL being_destroyed;    /* is currently being destroyed */
 
   /* FIXME: OIDs should be given out by RPCSS */
-  OID oidc;                /* object ID counter, starts at 1, zero is invalid OID (CS cs) */
+  OID oidc;                /* object ID counter, starts at 1, zero is invalid OID (SRW stubmgr_lock) */
 
   /* STA-only fields */
   HWND win;                /* message window (LOCK) */
@@ -211,6 +211,7 @@ struct BlockChainStream
   ULONG        blockToEvict;
   ULONG        tailIndex;
   ULONG        numBlocks;
+  ULONG        nextReadIndex;
 };
 
 /* Returns the number of blocks that comprises this chain.
@@ -2868,6 +2869,152 @@ static HRESULT StorageBaseImpl_DeleteStorageTree(StorageBaseImpl *This, DirRef e
  * StorageImpl implementation
  ***********************************************************************/
 
+/******************************************************************************
+ *      StorageImpl sector cache
+ *
+ * Keeps copies of recently read big blocks as they are stored in the file.
+ * All writes to the file go through StorageImpl_WriteAt, which updates the
+ * cached copies, so the cache never holds data that differs from the file.
+ */
+static ULONG StorageImpl_GetSectorCacheSize(DWORD openFlags)
+{
+  /* Another writer could change the file behind our back. */
+  if (STGM_SHARE_MODE(openFlags) != STGM_SHARE_DENY_WRITE &&
+      STGM_SHARE_MODE(openFlags) != STGM_SHARE_EXCLUSIVE)
+    return 0;
+
+  return SECTOR_CACHE_SIZE;
+}
+
+static BOOL StorageImpl_AllocSectorCache(StorageImpl* This)
+{
+  ULONG i;
+
+  if (This->sectorCache)
+    return TRUE;
+
+  if (!This->sectorCacheSize)
+    return FALSE;
+
+  This->sectorCache = HeapAlloc(GetProcessHeap(), 0,
+    sizeof(SectorCacheEntry) * This->sectorCacheSize);
+  This->sectorCacheData = HeapAlloc(GetProcessHeap(), 0,
+    This->bigBlockSize * This->sectorCacheSize);
+
+  if (!This->sectorCache || !This->sectorCacheData)
+  {
+    HeapFree(GetProcessHeap(), 0, This->sectorCache);
+    HeapFree(GetProcessHeap(), 0, This->sectorCacheData);
+    This->sectorCache = NULL;
+    This->sectorCacheData = NULL;
+    This->sectorCacheSize = 0;
+    return FALSE;
+  }
+
+  for (i=0; i<This->sectorCacheSize; i++)
+  {
+    This->sectorCache[i].sector = BLOCK_UNUSED;
+    This->sectorCache[i].lastUse = 0;
+  }
+  This->sectorCacheTick = 0;
+
+  return TRUE;
+}
+
+static void StorageImpl_FreeSectorCache(StorageImpl* This)
+{
+  HeapFree(GetProcessHeap(), 0, This->sectorCache);
+  HeapFree(GetProcessHeap(), 0, This->sectorCacheData);
+  This->sectorCache = NULL;
+  This->sectorCacheData = NULL;
+}
+
+static void StorageImpl_InvalidateSmallBlockIndex(StorageImpl* This)
+{
+  int i;
+
+  for (i=0; i<SMALLBLOCKINDEX_CACHE_SIZE; i++)
+    This->smallBlockIndexCache[i].head = BLOCK_END_OF_CHAIN;
+}
+
+static BYTE* StorageImpl_LookupSectorCache(StorageImpl* This, ULONG sector)
+{
+  ULONG i;
+
+  if (!This->sectorCache)
+    return NULL;
+
+  for (i=0; i<This->sectorCacheSize; i++)
+  {
+    if (This->sectorCache[i].sector == sector)
+    {
+      This->sectorCache[i].lastUse = ++This->sectorCacheTick;
+      return This->sectorCacheData + i * This->bigBlockSize;
+    }
+  }
+
+  return NULL;
+}
+
+static void StorageImpl_InsertSectorCache(StorageImpl* This, ULONG sector,
+  const void* data)
+{
+  ULONG i, victim = 0;
+
+  if (!StorageImpl_AllocSectorCache(This))
+    return;
+
+  /* Replace the least recently used entry, unused entries come first. */
+  for (i=0; i<This->sectorCacheSize; i++)
+  {
+    if (This->sectorCache[i].sector == sector)
+    {
+      victim = i;
+      break;
+    }
+    if (This->sectorCache[i].lastUse < This->sectorCache[victim].lastUse)
+      victim = i;
+  }
+
+  This->sectorCache[victim].sector = sector;
+  This->sectorCache[victim].lastUse = ++This->sectorCacheTick;
+  memcpy(This->sectorCacheData + victim * This->bigBlockSize, data, This->bigBlockSize);
+}
+
+static void StorageImpl_UpdateSectorCache(StorageImpl* This,
+  ULARGE_INTEGER offset, const void* buffer, ULONG size, BOOL written)
+{
+  ULONGLONG start, end;
+  ULONG i;
+
+  for (i=0; i<This->sectorCacheSize; i++)
+  {
+    if (This->sectorCache[i].sector == BLOCK_UNUSED)
+      continue;
+
+    start = (ULONGLONG)(This->sectorCache[i].sector+1) * This->bigBlockSize;
+    end = start + This->bigBlockSize;
+
+    if (offset.QuadPart >= end || offset.QuadPart + size <= start)
+      continue;
+
+    if (written)
+    {
+      ULONGLONG from = max(start, offset.QuadPart);
+      ULONGLONG to = min(end, offset.QuadPart + size);
+
+      memcpy(This->sectorCacheData + i * This->bigBlockSize + (from - start),
+             (const BYTE*)buffer + (from - offset.QuadPart), to - from);
+    }
+    else
+    {
+      /* We don't know what ended up in the file. */
+      This->sectorCache[i].sector = BLOCK_UNUSED;
+      This->sectorCache[i].lastUse = 0;
+    }
+  }
+}
+
 static HRESULT StorageImpl_ReadAt(StorageImpl* This,
   ULARGE_INTEGER offset,
   void*          buffer,
@@ -2883,7 +3030,18 @@ static HRESULT StorageImpl_WriteAt(StorageImpl* This,
   const ULONG    size,
   ULONG*         bytesWritten)
 {
-    return ILockBytes_WriteAt(This->lockBytes,offset,buffer,size,bytesWritten);
+    HRESULT hr;
+    ULONG written = 0;
+
+    hr = ILockBytes_WriteAt(This->lockBytes,offset,buffer,size,&written);
+
+    if (This->sectorCache)
+      StorageImpl_UpdateSectorCache(This, offset, buffer, size,
+        SUCCEEDED(hr) && written == size);
+
+    if (bytesWritten) *bytesWritten = written;
+
+    return hr;
 }
 
 /******************************************************************************
@@ -3554,6 +3712,16 @@ static HRESULT StorageImpl_ReadBigBlock(
   DWORD  read=0;
   HRESULT hr;
 
+  BYTE*  cached;
+
+  cached = StorageImpl_LookupSectorCache(This, blockIndex);
+  if (cached)
+  {
+    memcpy(buffer, cached, This->bigBlockSize);
+    if (out_read) *out_read = This->bigBlockSize;
+    return S_OK;
+  }
+
   ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This, blockIndex);
 
   hr = StorageImpl_ReadAt(This, ulOffset, buffer, This->bigBlockSize, &read);
@@ -3563,6 +3731,8 @@ static HRESULT StorageImpl_ReadBigBlock(
     /* File ends during this block; fill the rest with 0's. */
     memset((LPBYTE)buffer+read, 0, This->bigBlockSize-read);
   }
+  else if (SUCCEEDED(hr))
+    StorageImpl_InsertSectorCache(This, blockIndex, buffer);
 
   if (out_read) *out_read = read;
 
@@ -3578,6 +3748,14 @@ static BOOL StorageImpl_ReadDWordFromBigBlock(
   ULARGE_INTEGER ulOffset;
   DWORD  read;
   DWORD  tmp;
+  BYTE*  cached;
+
+  cached = StorageImpl_LookupSectorCache(This, blockIndex);
+  if (cached)
+  {
+    StorageUtl_ReadDWord(cached, offset, value);
+    return TRUE;
+  }
 
   ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This, blockIndex);
   ulOffset.QuadPart += offset;
@@ -3587,6 +3765,43 @@ static BOOL StorageImpl_ReadDWordFromBigBlock(
   return (read == sizeof(DWORD));
 }
 
+/******************************************************************************
+ *      StorageImpl_ReadAheadBigBlocks
+ *
+ * Reads 'count' big blocks stored in consecutive sectors with a single call
+ * to the ILockBytes and puts them in the sector cache.
+ */
+static void StorageImpl_ReadAheadBigBlocks(
+  StorageImpl* This,
+  ULONG        blockIndex,
+  ULONG        count)
+{
+  ULARGE_INTEGER ulOffset;
+  BYTE*  buffer;
+  DWORD  read=0;
+  ULONG  i;
+
+  count = min(count, This->sectorCacheSize / 2);
+  if (count < 2 || !StorageImpl_AllocSectorCache(This))
+    return;
+
+  buffer = HeapAlloc(GetProcessHeap(), 0, count * This->bigBlockSize);
+  if (!buffer)
+    return;
+
+  ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This, blockIndex);
+
+  if (SUCCEEDED(StorageImpl_ReadAt(This, ulOffset, buffer, count * This->bigBlockSize, &read)))
+  {
+    TRACE("read %u blocks ahead at %u\n", read / This->bigBlockSize, blockIndex);
+
+    for (i=0; i < read / This->bigBlockSize; i++)
+      StorageImpl_InsertSectorCache(This, blockIndex + i, buffer + i * This->bigBlockSize);
+  }
+
+  HeapFree(GetProcessHeap(), 0, buffer);
+}
+
 static BOOL StorageImpl_WriteBigBlock(
   StorageImpl*  This,
   ULONG         blockIndex,
@@ -4628,6 +4843,10 @@ static HRESULT StorageImpl_Refresh(StorageImpl *This, BOOL new_object, BOOL crea
   DirRef      currentEntryRef;
   BlockChainStream *blockChainStream;
 
+  /* The file may have been changed by someone else. */
+  StorageImpl_FreeSectorCache(This);
+  StorageImpl_InvalidateSmallBlockIndex(This);
+
   if (create)
   {
     ULARGE_INTEGER size;
@@ -5203,6 +5422,8 @@ static void StorageImpl_Destroy(StorageBaseImpl* iface)
   for (i = 0; i < BLOCKCHAIN_CACHE_SIZE; i++)
     BlockChainStream_Destroy(This->blockChainCache[i]);
 
+  StorageImpl_FreeSectorCache(This);
+
   for (i = 0; i < ARRAY_SIZE(This->locked_bytes); i++)
   {
     ULARGE_INTEGER offset, cb;
@@ -5310,6 +5531,9 @@ static HRESULT StorageImpl_Construct(
 
   This->base.reverted = FALSE;
 
+  This->sectorCacheSize = StorageImpl_GetSectorCacheSize(openFlags);
+  StorageImpl_InvalidateSmallBlockIndex(This);
+
   /*
    * Initialize the big block cache.
    */
@@ -7212,6 +7436,25 @@ static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG of
   return This->indexCache[min_run].firstSector + offset - This->indexCache[min_run].firstOffset;
 }
 
+/* Returns the number of blocks starting at the nth block that are stored in
+ * consecutive sectors, up to max. */
+static ULONG BlockChainStream_GetContiguousCount(BlockChainStream *This,
+    ULONG offset, ULONG sector, ULONG max)
+{
+  ULONG count = 1;
+
+  while (count < max &&
+         BlockChainStream_GetSectorOfOffset(This, offset + count) == sector + count)
+    count++;
+
+  return count;
+}
+
+static BOOL BlockChainStream_IsBlockCached(BlockChainStream *This, ULONG index)
+{
+  return This->cachedBlocks[0].index == index || This->cachedBlocks[1].index == index;
+}
+
 static HRESULT BlockChainStream_GetBlockAtOffset(BlockChainStream *This,
     ULONG index, BlockChainBlock **block, ULONG *sector, BOOL create)
 {
@@ -7281,6 +7524,7 @@ BlockChainStream* BlockChainStream_Construct(
   newStream->cachedBlocks[1].index = 0xffffffff;
   newStream->cachedBlocks[1].dirty = FALSE;
   newStream->blockToEvict          = 0;
+  newStream->nextReadIndex         = 0xffffffff;
 
   if (FAILED(BlockChainStream_UpdateIndexCache(newStream)))
   {
@@ -7656,7 +7900,19 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
 
     if (!cachedBlock)
     {
-      /* Not in cache, and we're going to read past the end of the block. */
+      ULONG blocks = 1;
+
+      /* Not in cache, and we're going to read past the end of the block.
+       * Read the following full blocks along with it as long as they are
+       * stored in consecutive sectors. */
+      while (size - bytesToReadInBuffer > This->parentStorage->bigBlockSize &&
+             !BlockChainStream_IsBlockCached(This, blockNoInSequence + blocks) &&
+             BlockChainStream_GetSectorOfOffset(This, blockNoInSequence + blocks) == blockIndex + blocks)
+      {
+        bytesToReadInBuffer += This->parentStorage->bigBlockSize;
+        blocks++;
+      }
+
       ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This->parentStorage, blockIndex) +
                                offsetInBlock;
 
@@ -7665,12 +7921,23 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
            bufferWalker,
            bytesToReadInBuffer,
            &bytesReadAt);
+
+      blockNoInSequence += blocks - 1;
     }
     else
     {
       if (!cachedBlock->read)
       {
         ULONG read;
+
+        /* Fetch the next sectors too if the stream is read sequentially. */
+        if (blockNoInSequence == This->nextReadIndex &&
+            This->parentStorage->sectorCacheSize &&
+            !StorageImpl_LookupSectorCache(This->parentStorage, cachedBlock->sector))
+          StorageImpl_ReadAheadBigBlocks(This->parentStorage, cachedBlock->sector,
+            BlockChainStream_GetContiguousCount(This, blockNoInSequence,
+              cachedBlock->sector, SECTOR_READAHEAD));
+
         if (FAILED(StorageImpl_ReadBigBlock(This->parentStorage, cachedBlock->sector, cachedBlock->data, &read)) && !read)
           return STG_E_READFAULT;
 
@@ -7691,6 +7958,8 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
         break;
   }
 
+  This->nextReadIndex = blockNoInSequence;
+
   return S_OK;
 }
 
@@ -7878,6 +8147,103 @@ static HRESULT SmallBlockChainStream_GetNextBlockInChain(
   return res;
 }
 
+/******************************************************************************
+ *      SmallBlockChainStream_GetIndex
+ *
+ * Returns the list of small blocks in the chain starting at 'head', reading
+ * it from the small block depot if it isn't cached yet.
+ */
+static HRESULT SmallBlockChainStream_GetIndex(
+  SmallBlockChainStream* This,
+  ULONG                  head,
+  SmallBlockChainIndex** result)
+{
+  StorageImpl* storage = This->parentStorage;
+  SmallBlockChainIndex* index;
+  ULONG blockIndex;
+  HRESULT hr;
+  int i;
+
+  for (i=0; i<SMALLBLOCKINDEX_CACHE_SIZE; i++)
+  {
+    if (storage->smallBlockIndexCache[i].head == head)
+    {
+      *result = &storage->smallBlockIndexCache[i];
+      return S_OK;
+    }
+  }
+
+  index = &storage->smallBlockIndexCache[storage->smallBlockIndexToEvict++];
+  if (storage->smallBlockIndexToEvict == SMALLBLOCKINDEX_CACHE_SIZE)
+    storage->smallBlockIndexToEvict = 0;
+
+  index->head = BLOCK_END_OF_CHAIN;
+  index->count = 0;
+
+  blockIndex = head;
+  while (blockIndex != BLOCK_END_OF_CHAIN && index->count < SMALLBLOCKINDEX_MAX_BLOCKS)
+  {
+    index->sectors[index->count++] = blockIndex;
+
+    hr = SmallBlockChainStream_GetNextBlockInChain(This, blockIndex, &blockIndex);
+    if (FAILED(hr))
+      return hr;
+  }
+
+  index->complete = (blockIndex == BLOCK_END_OF_CHAIN);
+  index->head = head;
+
+  *result = index;
+  return S_OK;
+}
+
+/******************************************************************************
+ *      SmallBlockChainStream_GetBlockOfOffset
+ *
+ * Locates the nth small block of the chain starting at 'head'.
+ */
+static HRESULT SmallBlockChainStream_GetBlockOfOffset(
+  SmallBlockChainStream* This,
+  ULONG                  head,
+  ULONG                  offset,
+  ULONG*                 blockIndex)
+{
+  SmallBlockChainIndex* index;
+  HRESULT hr;
+
+  *blockIndex = BLOCK_END_OF_CHAIN;
+
+  if (head == BLOCK_END_OF_CHAIN)
+    return S_OK;
+
+  hr = SmallBlockChainStream_GetIndex(This, head, &index);
+  if (FAILED(hr))
+    return hr;
+
+  if (offset < index->count)
+  {
+    *blockIndex = index->sectors[offset];
+    return S_OK;
+  }
+
+  if (index->complete)
+    return S_OK;
+
+  /* The chain is longer than what we cache, walk the rest of it. */
+  *blockIndex = index->sectors[index->count-1];
+  offset -= index->count-1;
+
+  while (offset > 0 && *blockIndex != BLOCK_END_OF_CHAIN)
+  {
+    hr = SmallBlockChainStream_GetNextBlockInChain(This, *blockIndex, blockIndex);
+    if (FAILED(hr))
+      return hr;
+    offset--;
+  }
+
+  return S_OK;
+}
+
 /******************************************************************************
  *       SmallBlockChainStream_SetNextBlockInChain
  *
@@ -7899,6 +8265,8 @@ static void SmallBlockChainStream_SetNextBlockInChain(
 
   StorageUtl_WriteDWord((BYTE *)&buffer, 0, nextBlock);
 
+  StorageImpl_InvalidateSmallBlockIndex(This->parentStorage);
+
   /*
    * Read those bytes in the buffer from the small block file.
    */
@@ -8050,7 +8418,7 @@ HRESULT SmallBlockChainStream_ReadAt(
 
   ULONG offsetInBlock = offset.u.LowPart % This->parentStorage->smallBlockSize;
   ULONG bytesToReadInBuffer;
-  ULONG blockIndex;
+  ULONG blockIndex, nextBlock, headOfChain;
   ULONG bytesReadFromBigBlockFile;
   BYTE* bufferWalker;
   ULARGE_INTEGER stream_size;
@@ -8071,15 +8439,11 @@ HRESULT SmallBlockChainStream_ReadAt(
   /*
    * Find the first block in the stream that contains part of the buffer.
    */
-  blockIndex = SmallBlockChainStream_GetHeadOfChain(This);
+  headOfChain = SmallBlockChainStream_GetHeadOfChain(This);
 
-  while ( (blockNoInSequence > 0) &&  (blockIndex != BLOCK_END_OF_CHAIN))
-  {
-    rc = SmallBlockChainStream_GetNextBlockInChain(This, blockIndex, &blockIndex);
-    if(FAILED(rc))
-      return rc;
-    blockNoInSequence--;
-  }
+  rc = SmallBlockChainStream_GetBlockOfOffset(This, headOfChain, blockNoInSequence, &blockIndex);
+  if(FAILED(rc))
+    return rc;
 
   /*
    * Start reading the buffer.
@@ -8088,12 +8452,31 @@ HRESULT SmallBlockChainStream_ReadAt(
 
   while ( (size > 0) && (blockIndex != BLOCK_END_OF_CHAIN) )
   {
+    ULONG blocks = 1;
+
     /*
      * Calculate how many bytes we can copy from this small block.
      */
     bytesToReadInBuffer =
       min(This->parentStorage->smallBlockSize - offsetInBlock, size);
 
+    /*
+     * Small blocks stored next to each other can be read at once.
+     */
+    while (bytesToReadInBuffer < size)
+    {
+      rc = SmallBlockChainStream_GetBlockOfOffset(This, headOfChain,
+        blockNoInSequence + blocks, &nextBlock);
+      if(FAILED(rc))
+        return STG_E_DOCFILECORRUPT;
+
+      if (nextBlock != blockIndex + blocks)
+        break;
+
+      bytesToReadInBuffer += min(This->parentStorage->smallBlockSize, size - bytesToReadInBuffer);
+      blocks++;
+    }
+
     /*
      * Calculate the offset of the small block in the small block file.
      */
@@ -8119,17 +8502,22 @@ HRESULT SmallBlockChainStream_ReadAt(
     if (!bytesReadFromBigBlockFile)
       return STG_E_DOCFILECORRUPT;
 
-    /*
-     * Step to the next big block.
-     */
-    rc = SmallBlockChainStream_GetNextBlockInChain(This, blockIndex, &blockIndex);
-    if(FAILED(rc))
-      return STG_E_DOCFILECORRUPT;
-
     bufferWalker += bytesReadFromBigBlockFile;
     size         -= bytesReadFromBigBlockFile;
     *bytesRead   += bytesReadFromBigBlockFile;
+
+    blockNoInSequence += (offsetInBlock + bytesReadFromBigBlockFile) / This->parentStorage->smallBlockSize;
     offsetInBlock = (offsetInBlock + bytesReadFromBigBlockFile) % This->parentStorage->smallBlockSize;
+
+    /*
+     * Step to the next small block.
+     */
+    if (size > 0)
+    {
+      rc = SmallBlockChainStream_GetBlockOfOffset(This, headOfChain, blockNoInSequence, &blockIndex);
+      if(FAILED(rc))
+        return STG_E_DOCFILECORRUPT;
+    }
   }
 
   return S_OK;
@@ -8154,7 +8542,7 @@ HRESULT SmallBlockChainStream_WriteAt(
 
   ULONG offsetInBlock = offset.u.LowPart % This->parentStorage->smallBlockSize;
   ULONG bytesToWriteInBuffer;
-  ULONG blockIndex;
+  ULONG blockIndex, headOfChain;
   ULONG bytesWrittenToBigBlockFile;
   const BYTE* bufferWalker;
   HRESULT res;
@@ -8167,14 +8555,10 @@ HRESULT SmallBlockChainStream_WriteAt(
   /*
    * Find the first block in the stream that contains part of the buffer.
    */
-  blockIndex = SmallBlockChainStream_GetHeadOfChain(This);
+  headOfChain = SmallBlockChainStream_GetHeadOfChain(This);
 
-  while ( (blockNoInSequence > 0) &&  (blockIndex != BLOCK_END_OF_CHAIN))
-  {
-    if(FAILED(SmallBlockChainStream_GetNextBlockInChain(This, blockIndex, &blockIndex)))
-      return STG_E_DOCFILECORRUPT;
-    blockNoInSequence--;
-  }
+  if(FAILED(SmallBlockChainStream_GetBlockOfOffset(This, headOfChain, blockNoInSequence, &blockIndex)))
+    return STG_E_DOCFILECORRUPT;
 
   /*
    * Start writing the buffer.
@@ -8210,9 +8594,9 @@ HRESULT SmallBlockChainStream_WriteAt(
       return res;
 
     /*
-     * Step to the next big block.
+     * Step to the next small block.
      */
-    res = SmallBlockChainStream_GetNextBlockInChain(This, blockIndex, &blockIndex);
+    res = SmallBlockChainStream_GetBlockOfOffset(This, headOfChain, ++blockNoInSequence, &blockIndex);
     if (FAILED(res))
       return res;
     bufferWalker  += bytesWrittenToBigBlockFile;
@@ -362,6 +362,32 @@ void StorageBaseImpl_RemoveStream(StorageBaseImpl * stg, StgStreamImpl * strm) D
 /* Number of BlockChainStream objects to cache in a StorageImpl */
 #define BLOCKCHAIN_CACHE_SIZE 4
 
+/* Default number of big blocks kept in the sector cache of a StorageImpl */
+#define SECTOR_CACHE_SIZE 32
+
+/* Maximum number of consecutive sectors read ahead on sequential access */
+#define SECTOR_READAHEAD 8
+
+/* Number of small block chains whose sector list is cached in a StorageImpl */
+#define SMALLBLOCKINDEX_CACHE_SIZE 4
+
+/* Enough sectors for a small block stream using the default small block size */
+#define SMALLBLOCKINDEX_MAX_BLOCKS (LIMIT_TO_USE_SMALL_BLOCK / 0x40)
+
+typedef struct SectorCacheEntry
+{
+  ULONG sector;
+  ULONG lastUse;
+} SectorCacheEntry;
+
+typedef struct SmallBlockChainIndex
+{
+  ULONG head;
+  ULONG count;
+  BOOL  complete;
+  ULONG sectors[SMALLBLOCKINDEX_MAX_BLOCKS];
+} SmallBlockChainIndex;
+
 /****************************************************************************
  * StorageImpl definitions.
  *
@@ -411,6 +437,19 @@ struct StorageImpl
   BlockChainStream* blockChainCache[BLOCKCHAIN_CACHE_SIZE];
   UINT blockChainToEvict;
 
+  /*
+   * LRU cache of big blocks as they are stored in the file. The size is
+   * chosen per storage when it is opened, 0 disables the cache.
+   */
+  ULONG sectorCacheSize;
+  ULONG sectorCacheTick;
+  SectorCacheEntry* sectorCache;
+  BYTE* sectorCacheData;
+
+  /* Cache of the sectors used by recently accessed small block chains */
+  SmallBlockChainIndex smallBlockIndexCache[SMALLBLOCKINDEX_CACHE_SIZE];
+  UINT smallBlockIndexToEvict;
+
   ULONG locks_supported;
 
   ILockBytes* lockBytes;
@@ -43,6 +43,25 @@
 WINE_DEFAULT_DEBUG_CHANNEL(ole);
 
 
+/* Stub managers and their interface stubs are looked up on every incoming
+ * call, so the apartment keeps them in hash tables protected by an SRW lock.
+ * Lookups only take the lock shared and never resurrect a stub manager whose
+ * refcount already dropped to zero. */
+static inline struct list *stub_manager_oid_bucket(APARTMENT *apt, OID oid)
+{
+    return &apt->stubmgr_oids[(ULONG)(oid ^ (oid >> 32)) % STUBMGR_HASH_SIZE];
+}
+
+static inline struct list *stub_manager_object_bucket(APARTMENT *apt, IUnknown *object)
+{
+    return &apt->stubmgr_objects[((ULONG_PTR)object >> 4) % STUBMGR_HASH_SIZE];
+}
+
+static inline struct list *ifstub_ipid_bucket(APARTMENT *apt, const IPID *ipid)
+{
+    return &apt->ifstub_ipids[ipid->Data1 % STUBMGR_HASH_SIZE];
+}
+
 /* generates an ipid in the following format (similar to native version):
  * Data1 = apartment-local ipid counter
  * Data2 = apartment creator thread ID
@@ -99,6 +118,7 @@ struct ifstub *stub_manager_new_ifstub(struct stub_manager *m, IRpcStubBuffer *s
 
     stub->flags = flags;
     stub->iid = *iid;
+    stub->manager = m;
 
     /* FIXME: find a cleaner way of identifying that we are creating an ifstub
      * for the remunknown interface */
@@ -113,6 +133,10 @@ struct ifstub *stub_manager_new_ifstub(struct stub_manager *m, IRpcStubBuffer *s
     if (flags & MSHLFLAGS_NORMAL) m->norm_refs++;
     LeaveCriticalSection(&m->lock);
 
+    AcquireSRWLockExclusive(&m->apt->stubmgr_lock);
+    list_add_head(ifstub_ipid_bucket(m->apt, &stub->ipid), &stub->ipid_entry);
+    ReleaseSRWLockExclusive(&m->apt->stubmgr_lock);
+
     TRACE("ifstub %p created with ipid %s\n", stub, debugstr_guid(&stub->ipid));
 
     return stub;
@@ -231,10 +255,12 @@ static struct stub_manager *new_stub_manager(APARTMENT *apt, IUnknown *object)
     if(FAILED(hres))
         sm->extern_conn = NULL;
 
-    EnterCriticalSection(&apt->cs);
+    AcquireSRWLockExclusive(&apt->stubmgr_lock);
     sm->oid = apt->oidc++;
     list_add_head(&apt->stubmgrs, &sm->entry);
-    LeaveCriticalSection(&apt->cs);
+    list_add_head(stub_manager_oid_bucket(apt, sm->oid), &sm->oid_entry);
+    list_add_head(stub_manager_object_bucket(apt, object), &sm->object_entry);
+    ReleaseSRWLockExclusive(&apt->stubmgr_lock);
 
     TRACE("Created new stub manager (oid=%s) at %p for object with IUnknown %p\n", wine_dbgstr_longlong(sm->oid), sm, object);
     
@@ -293,40 +319,49 @@ static void stub_manager_delete(struct stub_manager *m)
     HeapFree(GetProcessHeap(), 0, m);
 }
 
-/* increments the internal refcount */
-static ULONG stub_manager_int_addref(struct stub_manager *This)
+/* increments the internal refcount of a stub manager found in the apartment
+ * tables, fails if it is being destroyed. must be called with
+ * apt->stubmgr_lock held */
+static BOOL stub_manager_int_addref(struct stub_manager *This)
 {
-    ULONG refs;
-
-    EnterCriticalSection(&This->apt->cs);
-    refs = ++This->refs;
-    LeaveCriticalSection(&This->apt->cs);
+    LONG refs = This->refs, prev;
 
-    TRACE("before %d\n", refs - 1);
-
-    return refs;
+    while (refs)
+    {
+        if ((prev = InterlockedCompareExchange(&This->refs, refs + 1, refs)) == refs)
+        {
+            TRACE("before %d\n", refs);
+            return TRUE;
+        }
+        refs = prev;
+    }
+    return FALSE;
 }
 
 /* decrements the internal refcount */
 ULONG stub_manager_int_release(struct stub_manager *This)
 {
-    ULONG refs;
     APARTMENT *apt = This->apt;
+    struct ifstub *ifstub;
+    ULONG refs;
 
-    EnterCriticalSection(&apt->cs);
-    refs = --This->refs;
+    refs = InterlockedDecrement(&This->refs);
 
     TRACE("after %d\n", refs);
 
-    /* remove from apartment so no other thread can access it... */
-    if (!refs)
-        list_remove(&This->entry);
+    if (refs) return refs;
 
-    LeaveCriticalSection(&apt->cs);
+    /* remove from apartment so no other thread can access it... */
+    AcquireSRWLockExclusive(&apt->stubmgr_lock);
+    list_remove(&This->entry);
+    list_remove(&This->oid_entry);
+    list_remove(&This->object_entry);
+    LIST_FOR_EACH_ENTRY(ifstub, &This->ifstubs, struct ifstub, entry)
+        list_remove(&ifstub->ipid_entry);
+    ReleaseSRWLockExclusive(&apt->stubmgr_lock);
 
-    /* ... so now we can delete it without being inside the apartment critsec */
-    if (!refs)
-        stub_manager_delete(This);
+    /* ... so now we can delete it without holding the apartment lock */
+    stub_manager_delete(This);
 
     return refs;
 }
@@ -336,8 +371,7 @@ ULONG stub_manager_int_release(struct stub_manager *This)
  * it must also call release on the stub manager when it is no longer needed */
 struct stub_manager *get_stub_manager_from_object(APARTMENT *apt, IUnknown *obj, BOOL alloc)
 {
-    struct stub_manager *result = NULL;
-    struct list         *cursor;
+    struct stub_manager *result = NULL, *m;
     IUnknown *object;
     HRESULT hres;
 
@@ -347,19 +381,16 @@ struct stub_manager *get_stub_manager_from_object(APARTMENT *apt, IUnknown *obj,
         return NULL;
     }
 
-    EnterCriticalSection(&apt->cs);
-    LIST_FOR_EACH( cursor, &apt->stubmgrs )
+    AcquireSRWLockShared(&apt->stubmgr_lock);
+    LIST_FOR_EACH_ENTRY( m, stub_manager_object_bucket(apt, object), struct stub_manager, object_entry )
     {
-        struct stub_manager *m = LIST_ENTRY( cursor, struct stub_manager, entry );
-
-        if (m->object == object)
+        if (m->object == object && stub_manager_int_addref(m))
         {
             result = m;
-            stub_manager_int_addref(result);
             break;
         }
     }
-    LeaveCriticalSection(&apt->cs);
+    ReleaseSRWLockShared(&apt->stubmgr_lock);
 
     if (result) {
         TRACE("found %p for object %p\n", result, object);
@@ -379,22 +410,18 @@ struct stub_manager *get_stub_manager_from_object(APARTMENT *apt, IUnknown *obj,
  * it must also call release on the stub manager when it is no longer needed */
 struct stub_manager *get_stub_manager(APARTMENT *apt, OID oid)
 {
-    struct stub_manager *result = NULL;
-    struct list         *cursor;
+    struct stub_manager *result = NULL, *m;
 
-    EnterCriticalSection(&apt->cs);
-    LIST_FOR_EACH( cursor, &apt->stubmgrs )
+    AcquireSRWLockShared(&apt->stubmgr_lock);
+    LIST_FOR_EACH_ENTRY( m, stub_manager_oid_bucket(apt, oid), struct stub_manager, oid_entry )
     {
-        struct stub_manager *m = LIST_ENTRY( cursor, struct stub_manager, entry );
-
-        if (m->oid == oid)
+        if (m->oid == oid && stub_manager_int_addref(m))
         {
             result = m;
-            stub_manager_int_addref(result);
             break;
         }
     }
-    LeaveCriticalSection(&apt->cs);
+    ReleaseSRWLockShared(&apt->stubmgr_lock);
 
     if (result)
         TRACE("found %p for oid %s\n", result, wine_dbgstr_longlong(oid));
@@ -474,21 +501,21 @@ ULONG stub_manager_ext_release(struct stub_manager *m, ULONG refs, BOOL tablewea
 static struct stub_manager *get_stub_manager_from_ipid(APARTMENT *apt, const IPID *ipid, struct ifstub **ifstub)
 {
     struct stub_manager *result = NULL;
-    struct list         *cursor;
+    struct ifstub       *stub;
 
-    EnterCriticalSection(&apt->cs);
-    LIST_FOR_EACH( cursor, &apt->stubmgrs )
-    {
-        struct stub_manager *m = LIST_ENTRY( cursor, struct stub_manager, entry );
+    *ifstub = NULL;
 
-        if ((*ifstub = stub_manager_ipid_to_ifstub(m, ipid)))
+    AcquireSRWLockShared(&apt->stubmgr_lock);
+    LIST_FOR_EACH_ENTRY( stub, ifstub_ipid_bucket(apt, ipid), struct ifstub, ipid_entry )
+    {
+        if (IsEqualGUID(ipid, &stub->ipid) && stub_manager_int_addref(stub->manager))
         {
-            result = m;
-            stub_manager_int_addref(result);
+            result = stub->manager;
+            *ifstub = stub;
             break;
         }
     }
-    LeaveCriticalSection(&apt->cs);
+    ReleaseSRWLockShared(&apt->stubmgr_lock);
 
     if (result)
         TRACE("found %p for ipid %s\n", result, debugstr_guid(ipid));
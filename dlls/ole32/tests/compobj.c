@@ -658,6 +658,71 @@ static void test_CoCreateInstance(void)
     test_apt_type(APTTYPE_CURRENT, APTTYPEQUALIFIER_NONE);
 }
 
+static void test_CoCreateInstance_cache(void)
+{
+    static GUID deadbeef = {0xdeadbeef,0xdead,0xbeef,{0xde,0xad,0xbe,0xef,0xde,0xad,0xbe,0xef}};
+    static const char deadbeefA[] = "CLSID\\{DEADBEEF-DEAD-BEEF-DEAD-BEEFDEADBEEF}";
+    static const char treatasA[] = "{12345678-1234-1234-1234-56789ABCDEF0}";
+    DWORD start, ticks, i;
+    IUnknown *pUnk;
+    HKEY hkey;
+    CLSID out;
+    HRESULT hr;
+    LONG res;
+
+    CoInitialize(NULL);
+
+    hr = CoCreateInstance(&CLSID_InternetZoneManager, NULL, CLSCTX_INPROC_SERVER, &IID_IUnknown, (void **)&pUnk);
+    if (hr == REGDB_E_CLASSNOTREG)
+    {
+        skip("IE not installed so can't test CoCreateInstance\n");
+        CoUninitialize();
+        return;
+    }
+    ok_ole_success(hr, "CoCreateInstance");
+    IUnknown_Release(pUnk);
+
+    start = GetTickCount();
+    for (i = 0; i < 10000; i++)
+    {
+        hr = CoCreateInstance(&CLSID_InternetZoneManager, NULL, CLSCTX_INPROC_SERVER, &IID_IUnknown, (void **)&pUnk);
+        if (FAILED(hr)) break;
+        IUnknown_Release(pUnk);
+    }
+    ticks = GetTickCount() - start;
+    ok_ole_success(hr, "CoCreateInstance");
+    trace("%u CoCreateInstance calls took %u ms\n", i, ticks);
+
+    /* registry changes made behind ole32's back are picked up */
+    hr = CoGetTreatAsClass(&deadbeef, &out);
+    ok(hr == S_FALSE, "expected S_FALSE got %08x\n", hr);
+
+    res = RegCreateKeyExA(HKEY_CLASSES_ROOT, deadbeefA, 0, NULL, 0, KEY_ALL_ACCESS, NULL, &hkey, NULL);
+    if (res)
+    {
+        skip("failed to create a test key, error %d\n", res);
+        CoUninitialize();
+        return;
+    }
+    res = RegSetValueA(hkey, "TreatAs", REG_SZ, treatasA, strlen(treatasA) + 1);
+    ok(!res, "RegSetValue returned %d\n", res);
+
+    hr = CoGetTreatAsClass(&deadbeef, &out);
+    ok(hr == S_OK, "CoGetTreatAsClass returned %08x\n", hr);
+    ok(IsEqualGUID(&out, &CLSID_non_existent), "got wrong class %s\n", wine_dbgstr_guid(&out));
+
+    res = RegDeleteKeyA(hkey, "TreatAs");
+    ok(!res, "RegDeleteKey returned %d\n", res);
+    RegCloseKey(hkey);
+    res = RegDeleteKeyA(HKEY_CLASSES_ROOT, deadbeefA);
+    ok(!res, "RegDeleteKey returned %d\n", res);
+
+    hr = CoGetTreatAsClass(&deadbeef, &out);
+    ok(hr == S_FALSE, "expected S_FALSE got %08x\n", hr);
+
+    CoUninitialize();
+}
+
 static void test_CoGetClassObject(void)
 {
     HRESULT hr;
@@ -3797,6 +3862,7 @@ START_TEST(compobj)
     test_IIDFromString();
     test_StringFromGUID2();
     test_CoCreateInstance();
+    test_CoCreateInstance_cache();
     test_ole_menu();
     test_CoGetClassObject();
     test_CoCreateInstanceEx();
@@ -2558,6 +2558,79 @@ static void test_proxy_used_in_wrong_thread(void)
     end_host_object(tid, host_thread);
 }
 
+static DWORD CALLBACK mta_call_thread_proc(void *p)
+{
+    IStream *stream = p;
+    IClassFactory *cf;
+    IUnknown *unk;
+    HRESULT hr;
+    int i;
+
+    pCoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+
+    IStream_Seek(stream, ullZero, STREAM_SEEK_SET, NULL);
+    hr = CoUnmarshalInterface(stream, &IID_IClassFactory, (void **)&cf);
+    ok_ole_success(hr, CoUnmarshalInterface);
+    if (hr == S_OK)
+    {
+        for (i = 0; i < 1000 && hr == S_OK; i++)
+        {
+            hr = IClassFactory_CreateInstance(cf, NULL, &IID_IUnknown, (void **)&unk);
+            if (hr == S_OK) IUnknown_Release(unk);
+        }
+        ok(hr == S_OK, "CreateInstance failed with error 0x%08x\n", hr);
+        IClassFactory_Release(cf);
+    }
+
+    CoUninitialize();
+    return 0;
+}
+
+/* calls from several apartments into an object living in the MTA, every
+ * incoming call looks up the apartment and stub manager of the object */
+static void test_mta_call_throughput(void)
+{
+    IStream *streams[4];
+    HANDLE threads[4];
+    unsigned int i, count;
+    DWORD start;
+    HRESULT hr;
+
+    CoUninitialize();
+    pCoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    cLocks = 0;
+    external_connections = 0;
+
+    for (count = 1; count <= ARRAY_SIZE(threads); count *= 2)
+    {
+        for (i = 0; i < count; i++)
+        {
+            hr = CreateStreamOnHGlobal(NULL, TRUE, &streams[i]);
+            ok_ole_success(hr, CreateStreamOnHGlobal);
+            hr = CoMarshalInterface(streams[i], &IID_IClassFactory, (IUnknown *)&Test_ClassFactory,
+                                    MSHCTX_INPROC, NULL, MSHLFLAGS_NORMAL);
+            ok_ole_success(hr, CoMarshalInterface);
+        }
+
+        start = GetTickCount();
+        for (i = 0; i < count; i++)
+            threads[i] = CreateThread(NULL, 0, mta_call_thread_proc, streams[i], 0, NULL);
+        for (i = 0; i < count; i++)
+        {
+            ok(!WaitForSingleObject(threads[i], 30000), "wait timed out\n");
+            CloseHandle(threads[i]);
+            IStream_Release(streams[i]);
+        }
+        trace("%u threads making 1000 calls each into the MTA took %u ms\n", count, GetTickCount() - start);
+    }
+
+    ok_no_locks();
+
+    CoUninitialize();
+    pCoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+}
+
 static HRESULT WINAPI MessageFilter_QueryInterface(IMessageFilter *iface, REFIID riid, void ** ppvObj)
 {
     if (ppvObj == NULL) return E_POINTER;
@@ -4663,6 +4736,7 @@ START_TEST(marshal)
     test_CoGetStandardMarshal();
     test_hresult_marshaling();
     test_proxy_used_in_wrong_thread();
+    test_mta_call_throughput();
     test_message_filter();
     test_bad_marshal_stream();
     test_proxy_interfaces();
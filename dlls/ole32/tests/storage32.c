@@ -3871,6 +3871,166 @@ static void test_overwrite(void)
     DeleteFileA(filenameA);
 }
 
+static BYTE read_pattern_byte(ULONG stream, ULONG offset)
+{
+    return (offset * 7 + offset / 251 + stream * 13) & 0xff;
+}
+
+static void check_stream_reads(IStorage *stg, const WCHAR *name, ULONG id, ULONG size, ULONG chunk)
+{
+    IStream *stm;
+    BYTE buffer[5000];
+    ULONG offset, read, i;
+    HRESULT r;
+
+    r = IStorage_OpenStream(stg, name, NULL, STGM_SHARE_EXCLUSIVE | STGM_READ, 0, &stm);
+    ok(r == S_OK, "IStorage->OpenStream failed %x\n", r);
+    if (FAILED(r)) return;
+
+    for (offset = 0; offset < size; offset += read)
+    {
+        r = IStream_Read(stm, buffer, chunk, &read);
+        ok(r == S_OK, "IStream->Read failed %x\n", r);
+        ok(read == min(chunk, size - offset), "stream %u: read %u bytes at %u\n", id, read, offset);
+        if (!read) break;
+
+        for (i = 0; i < read; i++)
+            if (buffer[i] != read_pattern_byte(id, offset + i))
+                break;
+        ok(i == read, "stream %u, chunk %u: unexpected data at byte %u\n", id, chunk, offset + i);
+        if (i != read) break;
+    }
+
+    IStream_Release(stm);
+}
+
+static void test_read_patterns(void)
+{
+    static const WCHAR smallname[] = {'S','m','a','l','l',0};
+    static const WCHAR bigname[] = {'B','i','g',0};
+    static const WCHAR othername[] = {'O','t','h','e','r',0};
+    static const ULONG chunks[] = {1, 7, 64, 100, 515, 4096, 5000};
+    static const ULONG small_size = 3000, big_size = 70000;
+    IStorage *stg = NULL;
+    IStream *stm[3];
+    LARGE_INTEGER pos;
+    ULARGE_INTEGER size;
+    BYTE buffer[1000];
+    ULONG written, offset, i, j;
+    HRESULT r;
+
+    DeleteFileA(filenameA);
+
+    r = StgCreateDocfile(filename, STGM_CREATE | STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, &stg);
+    ok(r == S_OK, "StgCreateDocfile failed %x\n", r);
+    if (FAILED(r)) return;
+
+    r = IStorage_CreateStream(stg, smallname, STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, 0, &stm[0]);
+    ok(r == S_OK, "IStorage->CreateStream failed %x\n", r);
+    r = IStorage_CreateStream(stg, bigname, STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, 0, &stm[1]);
+    ok(r == S_OK, "IStorage->CreateStream failed %x\n", r);
+    r = IStorage_CreateStream(stg, othername, STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, 0, &stm[2]);
+    ok(r == S_OK, "IStorage->CreateStream failed %x\n", r);
+
+    /* Interleave the writes so the chains of the streams are fragmented. */
+    for (offset = 0; offset < big_size; offset += sizeof(buffer))
+    {
+        for (i = 0; i < 3; i++)
+        {
+            ULONG size = (i == 1) ? big_size : small_size;
+            ULONG len = (i == 1) ? sizeof(buffer) : 150;
+            ULONG start = (i == 1) ? offset : offset / sizeof(buffer) * len;
+
+            if (start >= size) continue;
+            len = min(len, size - start);
+
+            for (j = 0; j < len; j++)
+                buffer[j] = read_pattern_byte(i, start + j);
+
+            r = IStream_Write(stm[i], buffer, len, &written);
+            ok(r == S_OK, "IStream->Write failed %x\n", r);
+        }
+    }
+
+    for (i = 0; i < 3; i++)
+        IStream_Release(stm[i]);
+    IStorage_Release(stg);
+
+    r = StgOpenStorage(filename, NULL, STGM_DIRECT | STGM_READ | STGM_SHARE_DENY_WRITE, NULL, 0, &stg);
+    ok(r == S_OK, "StgOpenStorage failed %x\n", r);
+    if (FAILED(r)) return;
+
+    for (i = 0; i < ARRAY_SIZE(chunks); i++)
+    {
+        check_stream_reads(stg, smallname, 0, small_size, chunks[i]);
+        check_stream_reads(stg, bigname, 1, big_size, chunks[i]);
+        check_stream_reads(stg, othername, 2, small_size, chunks[i]);
+    }
+
+    IStorage_Release(stg);
+
+    /* Data read earlier must not hide later writes. */
+    r = StgOpenStorage(filename, NULL, STGM_DIRECT | STGM_READWRITE | STGM_SHARE_EXCLUSIVE, NULL, 0, &stg);
+    ok(r == S_OK, "StgOpenStorage failed %x\n", r);
+    if (FAILED(r)) return;
+
+    check_stream_reads(stg, bigname, 1, big_size, 100);
+    check_stream_reads(stg, smallname, 0, small_size, 100);
+
+    r = IStorage_OpenStream(stg, bigname, NULL, STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, &stm[1]);
+    ok(r == S_OK, "IStorage->OpenStream failed %x\n", r);
+
+    memset(buffer, 0xcc, sizeof(buffer));
+    pos.QuadPart = 20000;
+    r = IStream_Seek(stm[1], pos, STREAM_SEEK_SET, NULL);
+    ok(r == S_OK, "IStream->Seek failed %x\n", r);
+    r = IStream_Write(stm[1], buffer, sizeof(buffer), &written);
+    ok(r == S_OK, "IStream->Write failed %x\n", r);
+
+    pos.QuadPart = 19990;
+    r = IStream_Seek(stm[1], pos, STREAM_SEEK_SET, NULL);
+    ok(r == S_OK, "IStream->Seek failed %x\n", r);
+    r = IStream_Read(stm[1], buffer, sizeof(buffer), &written);
+    ok(r == S_OK, "IStream->Read failed %x\n", r);
+    ok(buffer[9] == read_pattern_byte(1, 19999), "unexpected data at byte 19999\n");
+    ok(buffer[10] == 0xcc && buffer[sizeof(buffer)-1] == 0xcc, "unexpected data after write\n");
+
+    IStream_Release(stm[1]);
+
+    /* Change the layout of a small block chain after it was read. */
+    r = IStorage_OpenStream(stg, smallname, NULL, STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, &stm[0]);
+    ok(r == S_OK, "IStorage->OpenStream failed %x\n", r);
+
+    size.QuadPart = 1000;
+    r = IStream_SetSize(stm[0], size);
+    ok(r == S_OK, "IStream->SetSize failed %x\n", r);
+    size.QuadPart = small_size;
+    r = IStream_SetSize(stm[0], size);
+    ok(r == S_OK, "IStream->SetSize failed %x\n", r);
+
+    pos.QuadPart = 1000;
+    r = IStream_Seek(stm[0], pos, STREAM_SEEK_SET, NULL);
+    ok(r == S_OK, "IStream->Seek failed %x\n", r);
+    for (offset = 1000; offset < small_size; offset += written)
+    {
+        ULONG len = min(sizeof(buffer), small_size - offset);
+
+        for (j = 0; j < len; j++)
+            buffer[j] = read_pattern_byte(0, offset + j);
+        r = IStream_Write(stm[0], buffer, len, &written);
+        ok(r == S_OK, "IStream->Write failed %x\n", r);
+    }
+
+    IStream_Release(stm[0]);
+
+    check_stream_reads(stg, smallname, 0, small_size, 64);
+    check_stream_reads(stg, othername, 2, small_size, 515);
+
+    IStorage_Release(stg);
+
+    DeleteFileA(filenameA);
+}
+
 static void test_custom_lockbytes(void)
 {
     static const WCHAR stmname[] = { 'C','O','N','T','E','N','T','S',0 };
@@ -3968,4 +4128,5 @@ START_TEST(storage32)
     test_transacted_shared();
     test_overwrite();
     test_custom_lockbytes();
+    test_read_patterns();
 }
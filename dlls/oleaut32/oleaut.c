@@ -32,6 +32,7 @@
 #include "wingdi.h"
 #include "winuser.h"
 #include "winerror.h"
+#include "winternl.h"
 
 #include "ole2.h"
 #include "olectl.h"
@@ -111,6 +112,26 @@ typedef struct {
 
 static bstr_cache_entry_t bstr_cache[0x10000/BUCKET_SIZE];
 
+/* Small strings are first cached per thread, so that the common alloc/free
+ * patterns don't need to take cs_bstr_cache.  The shared cache is used when
+ * the thread buckets are empty or full. */
+#define THREAD_BUCKET_COUNT 32
+
+typedef struct {
+    LONG hits;         /* allocations served by a thread cache */
+    LONG shared_hits;  /* allocations served by the shared cache */
+    LONG misses;       /* allocations from the heap */
+    LONG frees;        /* strings returned to the heap */
+} bstr_cache_stats_t;
+
+typedef struct {
+    bstr_cache_entry_t entries[THREAD_BUCKET_COUNT];
+    bstr_cache_stats_t stats;
+} bstr_thread_cache_t;
+
+static DWORD bstr_tls = TLS_OUT_OF_INDEXES;
+static bstr_cache_stats_t bstr_cache_stats;
+
 static inline size_t bstr_alloc_size(size_t size)
 {
     return (FIELD_OFFSET(bstr_t, u.ptr[size]) + sizeof(WCHAR) + BUCKET_SIZE-1) & ~(BUCKET_SIZE-1);
@@ -121,6 +142,17 @@ static inline bstr_t *bstr_from_str(BSTR str)
     return CONTAINING_RECORD(str, bstr_t, u.str);
 }
 
+static inline unsigned get_cache_idx(size_t size)
+{
+    return FIELD_OFFSET(bstr_t, u.ptr[size+sizeof(WCHAR)-1])/BUCKET_SIZE;
+}
+
+static inline unsigned get_cache_idx_from_alloc_size(SIZE_T alloc_size)
+{
+    if (alloc_size < BUCKET_SIZE) return ~0u;
+    return (alloc_size - BUCKET_SIZE) / BUCKET_SIZE;
+}
+
 static inline bstr_cache_entry_t *get_cache_entry_from_idx(unsigned cache_idx)
 {
     return bstr_cache_enabled && cache_idx < ARRAY_SIZE(bstr_cache) ? bstr_cache + cache_idx : NULL;
@@ -128,51 +160,136 @@ static inline bstr_cache_entry_t *get_cache_entry_from_idx(unsigned cache_idx)
 
 static inline bstr_cache_entry_t *get_cache_entry(size_t size)
 {
-    unsigned cache_idx = FIELD_OFFSET(bstr_t, u.ptr[size+sizeof(WCHAR)-1])/BUCKET_SIZE;
-    return get_cache_entry_from_idx(cache_idx);
+    return get_cache_entry_from_idx(get_cache_idx(size));
 }
 
-static inline bstr_cache_entry_t *get_cache_entry_from_alloc_size(SIZE_T alloc_size)
+static inline bstr_cache_entry_t *get_thread_cache_entry(bstr_thread_cache_t *cache, unsigned cache_idx)
 {
-    unsigned cache_idx;
-    if (alloc_size < BUCKET_SIZE) return NULL;
-    cache_idx = (alloc_size - BUCKET_SIZE) / BUCKET_SIZE;
-    return get_cache_entry_from_idx(cache_idx);
+    return cache && cache_idx < ARRAY_SIZE(cache->entries) ? cache->entries + cache_idx : NULL;
+}
+
+static bstr_thread_cache_t *get_thread_cache(void)
+{
+    bstr_thread_cache_t *cache;
+
+    if (!bstr_cache_enabled || bstr_tls == TLS_OUT_OF_INDEXES)
+        return NULL;
+
+    /* Access the slot directly, TlsGetValue() would reset the last error. */
+    if (!(cache = NtCurrentTeb()->TlsSlots[bstr_tls]))
+    {
+        if (!(cache = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache))))
+            return NULL;
+        NtCurrentTeb()->TlsSlots[bstr_tls] = cache;
+    }
+    return cache;
+}
+
+/* Frees the strings cached by the current thread and adds its counters to the totals. */
+static void release_thread_cache(void)
+{
+    bstr_thread_cache_t *cache;
+    unsigned i, j;
+
+    if (bstr_tls == TLS_OUT_OF_INDEXES || !(cache = NtCurrentTeb()->TlsSlots[bstr_tls]))
+        return;
+    NtCurrentTeb()->TlsSlots[bstr_tls] = NULL;
+
+    for (i = 0; i < ARRAY_SIZE(cache->entries); i++)
+    {
+        bstr_cache_entry_t *entry = cache->entries + i;
+        for (j = 0; j < entry->cnt; j++)
+            CoTaskMemFree(entry->buf[(entry->head+j) % BUCKET_BUFFER_SIZE]);
+    }
+
+    InterlockedExchangeAdd(&bstr_cache_stats.hits, cache->stats.hits);
+    InterlockedExchangeAdd(&bstr_cache_stats.shared_hits, cache->stats.shared_hits);
+    InterlockedExchangeAdd(&bstr_cache_stats.misses, cache->stats.misses);
+    InterlockedExchangeAdd(&bstr_cache_stats.frees, cache->stats.frees);
+    HeapFree(GetProcessHeap(), 0, cache);
+}
+
+static bstr_t *cache_entry_pop(bstr_cache_entry_t *cache_entry)
+{
+    bstr_t *ret = cache_entry->buf[cache_entry->head++];
+    cache_entry->head %= BUCKET_BUFFER_SIZE;
+    cache_entry->cnt--;
+    return ret;
+}
+
+/* Returns FALSE if the entry is full.  According to tests, freeing a string
+ * that's already in cache doesn't corrupt anything, for that to work we need
+ * to search the cache. */
+static BOOL cache_entry_push(bstr_cache_entry_t *cache_entry, bstr_t *bstr, SIZE_T alloc_size)
+{
+    unsigned i;
+
+    for(i=0; i < cache_entry->cnt; i++) {
+        if(cache_entry->buf[(cache_entry->head+i) % BUCKET_BUFFER_SIZE] == bstr) {
+            WARN_(heap)("String already is in cache!\n");
+            return TRUE;
+        }
+    }
+
+    if(cache_entry->cnt == ARRAY_SIZE(cache_entry->buf))
+        return FALSE;
+
+    cache_entry->buf[(cache_entry->head+cache_entry->cnt) % BUCKET_BUFFER_SIZE] = bstr;
+    cache_entry->cnt++;
+
+    if(WARN_ON(heap)) {
+        unsigned n = (alloc_size-FIELD_OFFSET(bstr_t, u.ptr))/sizeof(DWORD);
+        for(i=0; i<n; i++)
+            bstr->u.dwptr[i] = ARENA_FREE_FILLER;
+    }
+    return TRUE;
 }
 
 static bstr_t *alloc_bstr(size_t size)
 {
-    bstr_cache_entry_t *cache_entry = get_cache_entry(size);
-    bstr_t *ret;
+    bstr_thread_cache_t *thread_cache = get_thread_cache();
+    unsigned cache_idx = get_cache_idx(size);
+    bstr_cache_entry_t *cache_entry;
+    bstr_t *ret = NULL;
+
+    cache_entry = get_thread_cache_entry(thread_cache, cache_idx);
+    if(cache_entry && !cache_entry->cnt)
+        cache_entry = get_thread_cache_entry(thread_cache, cache_idx+1);
+    if(cache_entry && cache_entry->cnt) {
+        ret = cache_entry_pop(cache_entry);
+        thread_cache->stats.hits++;
+    }
 
-    if(cache_entry) {
+    if(!ret && (cache_entry = get_cache_entry_from_idx(cache_idx))) {
         EnterCriticalSection(&cs_bstr_cache);
 
         if(!cache_entry->cnt) {
-            cache_entry = get_cache_entry(size+BUCKET_SIZE);
+            cache_entry = get_cache_entry_from_idx(cache_idx+1);
             if(cache_entry && !cache_entry->cnt)
                 cache_entry = NULL;
         }
 
-        if(cache_entry) {
-            ret = cache_entry->buf[cache_entry->head++];
-            cache_entry->head %= BUCKET_BUFFER_SIZE;
-            cache_entry->cnt--;
-        }
+        if(cache_entry)
+            ret = cache_entry_pop(cache_entry);
 
         LeaveCriticalSection(&cs_bstr_cache);
 
-        if(cache_entry) {
-            if(WARN_ON(heap)) {
-                size_t fill_size = (FIELD_OFFSET(bstr_t, u.ptr[size])+2*sizeof(WCHAR)-1) & ~(sizeof(WCHAR)-1);
-                memset(ret, ARENA_INUSE_FILLER, fill_size);
-                memset((char *)ret+fill_size, ARENA_TAIL_FILLER, bstr_alloc_size(size)-fill_size);
-            }
-            ret->size = size;
-            return ret;
+        if(ret && thread_cache)
+            thread_cache->stats.shared_hits++;
+    }
+
+    if(ret) {
+        if(WARN_ON(heap)) {
+            size_t fill_size = (FIELD_OFFSET(bstr_t, u.ptr[size])+2*sizeof(WCHAR)-1) & ~(sizeof(WCHAR)-1);
+            memset(ret, ARENA_INUSE_FILLER, fill_size);
+            memset((char *)ret+fill_size, ARENA_TAIL_FILLER, bstr_alloc_size(size)-fill_size);
         }
+        ret->size = size;
+        return ret;
     }
 
+    if(thread_cache)
+        thread_cache->stats.misses++;
     ret = CoTaskMemAlloc(bstr_alloc_size(size));
     if(ret)
         ret->size = size;
@@ -273,10 +390,13 @@ static inline IMalloc *get_malloc(void)
  */
 void WINAPI DECLSPEC_HOTPATCH SysFreeString(BSTR str)
 {
+    bstr_thread_cache_t *thread_cache;
     bstr_cache_entry_t *cache_entry;
     bstr_t *bstr;
     IMalloc *malloc = get_malloc();
     SIZE_T alloc_size;
+    unsigned cache_idx;
+    BOOL cached;
 
     if(!str)
         return;
@@ -287,39 +407,24 @@ void WINAPI DECLSPEC_HOTPATCH SysFreeString(BSTR str)
     if (alloc_size == ~0UL)
         return;
 
-    cache_entry = get_cache_entry_from_alloc_size(alloc_size);
-    if(cache_entry) {
-        unsigned i;
-
-        EnterCriticalSection(&cs_bstr_cache);
-
-        /* According to tests, freeing a string that's already in cache doesn't corrupt anything.
-         * For that to work we need to search the cache. */
-        for(i=0; i < cache_entry->cnt; i++) {
-            if(cache_entry->buf[(cache_entry->head+i) % BUCKET_BUFFER_SIZE] == bstr) {
-                WARN_(heap)("String already is in cache!\n");
-                LeaveCriticalSection(&cs_bstr_cache);
-                return;
-            }
-        }
-
-        if(cache_entry->cnt < ARRAY_SIZE(cache_entry->buf)) {
-            cache_entry->buf[(cache_entry->head+cache_entry->cnt) % BUCKET_BUFFER_SIZE] = bstr;
-            cache_entry->cnt++;
+    thread_cache = get_thread_cache();
+    cache_idx = get_cache_idx_from_alloc_size(alloc_size);
 
-            if(WARN_ON(heap)) {
-                unsigned n = (alloc_size-FIELD_OFFSET(bstr_t, u.ptr))/sizeof(DWORD);
-                for(i=0; i<n; i++)
-                    bstr->u.dwptr[i] = ARENA_FREE_FILLER;
-            }
-
-            LeaveCriticalSection(&cs_bstr_cache);
-            return;
-        }
+    cache_entry = get_thread_cache_entry(thread_cache, cache_idx);
+    if(cache_entry && cache_entry_push(cache_entry, bstr, alloc_size))
+        return;
 
+    cache_entry = get_cache_entry_from_idx(cache_idx);
+    if(cache_entry) {
+        EnterCriticalSection(&cs_bstr_cache);
+        cached = cache_entry_push(cache_entry, bstr, alloc_size);
         LeaveCriticalSection(&cs_bstr_cache);
+        if(cached)
+            return;
     }
 
+    if(thread_cache)
+        thread_cache->stats.frees++;
     CoTaskMemFree(bstr);
 }
 
@@ -506,6 +611,7 @@ void WINAPI SetOaNoCache(void)
 {
     TRACE("\n");
     bstr_cache_enabled = FALSE;
+    release_thread_cache();
 }
 
 static const WCHAR	_delimiter[] = {'!',0}; /* default delimiter apparently */
@@ -764,6 +870,7 @@ HRESULT WINAPI OleTranslateColor(
 
 extern HRESULT WINAPI OLEAUTPS_DllGetClassObject(REFCLSID, REFIID, LPVOID *) DECLSPEC_HIDDEN;
 extern BOOL WINAPI OLEAUTPS_DllMain(HINSTANCE, DWORD, LPVOID) DECLSPEC_HIDDEN;
+extern HINSTANCE hProxyDll DECLSPEC_HIDDEN;
 extern HRESULT WINAPI OLEAUTPS_DllRegisterServer(void) DECLSPEC_HIDDEN;
 extern HRESULT WINAPI OLEAUTPS_DllUnregisterServer(void) DECLSPEC_HIDDEN;
 
@@ -1128,9 +1235,38 @@ BOOL WINAPI DllMain(HINSTANCE hInstDll, DWORD fdwReason, LPVOID lpvReserved)
 {
     static const WCHAR oanocacheW[] = {'o','a','n','o','c','a','c','h','e',0};
 
-    if(fdwReason == DLL_PROCESS_ATTACH)
+    switch(fdwReason)
+    {
+    case DLL_PROCESS_ATTACH:
         bstr_cache_enabled = !GetEnvironmentVariableW(oanocacheW, NULL, 0);
 
+        /* The thread caches access the TEB slot directly. */
+        bstr_tls = TlsAlloc();
+        if (bstr_tls != TLS_OUT_OF_INDEXES && bstr_tls >= TLS_MINIMUM_AVAILABLE)
+        {
+            TlsFree(bstr_tls);
+            bstr_tls = TLS_OUT_OF_INDEXES;
+        }
+
+        /* Don't let the proxy DllMain disable thread notifications,
+         * they are needed to release the thread caches. */
+        hProxyDll = hInstDll;
+        return TRUE;
+
+    case DLL_THREAD_DETACH:
+        release_thread_cache();
+        break;
+
+    case DLL_PROCESS_DETACH:
+        TRACE_(heap)("BSTR cache: %d thread hits, %d shared hits, %d misses, %d frees\n",
+                     bstr_cache_stats.hits, bstr_cache_stats.shared_hits,
+                     bstr_cache_stats.misses, bstr_cache_stats.frees);
+        if (lpvReserved) break;
+        release_thread_cache();
+        if (bstr_tls != TLS_OUT_OF_INDEXES) TlsFree(bstr_tls);
+        break;
+    }
+
     return OLEAUTPS_DllMain( hInstDll, fdwReason, lpvReserved );
 }
 
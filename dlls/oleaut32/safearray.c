@@ -372,9 +372,15 @@ static HRESULT SAFEARRAY_CopyData(SAFEARRAY *psa, SAFEARRAY *dest)
       {
         HRESULT hRet;
 
-        /* destination is cleared automatically */
-        hRet = VariantCopy(dest_var, src_var);
-        if (FAILED(hRet)) FIXME("VariantCopy failed with 0x%08x, element %u\n", hRet, ulCellCount);
+        /* plain values don't need a deep copy or a destination to clear */
+        if (VARIANT_IsScalar(V_VT(src_var)) && VARIANT_IsScalar(V_VT(dest_var)))
+          *dest_var = *src_var;
+        else
+        {
+          /* destination is cleared automatically */
+          hRet = VariantCopy(dest_var, src_var);
+          if (FAILED(hRet)) FIXME("VariantCopy failed with 0x%08x, element %u\n", hRet, ulCellCount);
+        }
         src_var++;
         dest_var++;
       }
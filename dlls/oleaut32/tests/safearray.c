@@ -1645,6 +1645,71 @@ static void test_SafeArrayCreateEx(void)
   IRecordInfo_Release(&iRec->IRecordInfo_iface);
 }
 
+static void test_SafeArrayCopy_VARIANT(void)
+{
+  static const WCHAR testW[] = {'t','e','s','t',0};
+  static const LONG count = 100000;
+  SAFEARRAY *sa, *sa2;
+  VARIANT *src, *dst;
+  HRESULT hres;
+  LONG i;
+
+  sa = SafeArrayCreateVector(VT_VARIANT, 0, count);
+  ok(sa != NULL, "SafeArrayCreateVector failed\n");
+  if (!sa) return;
+
+  src = sa->pvData;
+  for (i = 0; i < count; i++)
+  {
+    if (i % 1000)
+    {
+      V_VT(&src[i]) = VT_R8;
+      V_R8(&src[i]) = i;
+    }
+    else
+    {
+      V_VT(&src[i]) = VT_BSTR;
+      V_BSTR(&src[i]) = SysAllocString(testW);
+    }
+  }
+
+  hres = SafeArrayCopy(sa, &sa2);
+  ok(hres == S_OK, "SafeArrayCopy failed with %08x\n", hres);
+
+  dst = sa2->pvData;
+  for (i = 0; i < count; i++)
+  {
+    if (i % 1000)
+      ok(V_VT(&dst[i]) == VT_R8 && V_R8(&dst[i]) == i, "%d: got type %d\n", i, V_VT(&dst[i]));
+    else
+    {
+      ok(V_VT(&dst[i]) == VT_BSTR, "%d: got type %d\n", i, V_VT(&dst[i]));
+      ok(V_BSTR(&dst[i]) != V_BSTR(&src[i]), "%d: string not copied\n", i);
+      ok(!lstrcmpW(V_BSTR(&dst[i]), testW), "%d: got %s\n", i, wine_dbgstr_w(V_BSTR(&dst[i])));
+    }
+  }
+
+  /* the destination values are cleared, strings or not */
+  for (i = 0; i < count; i += 500)
+  {
+    VariantClear(&dst[i]);
+    V_VT(&dst[i]) = VT_BSTR;
+    V_BSTR(&dst[i]) = SysAllocString(testW);
+  }
+  hres = SafeArrayCopyData(sa, sa2);
+  ok(hres == S_OK, "SafeArrayCopyData failed with %08x\n", hres);
+  for (i = 0; i < count; i += 250)
+  {
+    if (i % 1000)
+      ok(V_VT(&dst[i]) == VT_R8 && V_R8(&dst[i]) == i, "%d: got type %d\n", i, V_VT(&dst[i]));
+    else
+      ok(V_VT(&dst[i]) == VT_BSTR && V_BSTR(&dst[i]) != V_BSTR(&src[i]), "%d: got type %d\n", i, V_VT(&dst[i]));
+  }
+
+  SafeArrayDestroy(sa2);
+  SafeArrayDestroy(sa);
+}
+
 static void test_SafeArrayClear(void)
 {
   SAFEARRAYBOUND sab;
@@ -2104,6 +2169,7 @@ START_TEST(safearray)
     test_LockUnlock();
     test_SafeArrayChangeTypeEx();
     test_SafeArrayCopy();
+    test_SafeArrayCopy_VARIANT();
     test_SafeArrayClear();
     test_SafeArrayCreateEx();
     test_SafeArrayCopyData();
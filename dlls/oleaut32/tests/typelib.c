@@ -5152,6 +5152,82 @@ static void test_LoadTypeLib(void)
     ok(tl == (void *)0xdeadbeef, "Got %p.\n", tl);
 }
 
+static void walk_typelib(ITypeLib *tl)
+{
+    UINT i, j, count = ITypeLib_GetTypeInfoCount(tl);
+    ITypeInfo *ti;
+    TYPEATTR *attr;
+    FUNCDESC *funcdesc;
+    VARDESC *vardesc;
+    HRESULT hr;
+
+    for (i = 0; i < count; i++)
+    {
+        hr = ITypeLib_GetTypeInfo(tl, i, &ti);
+        ok(hr == S_OK, "got %08x\n", hr);
+        hr = ITypeInfo_GetTypeAttr(ti, &attr);
+        ok(hr == S_OK, "got %08x\n", hr);
+        for (j = 0; j < attr->cFuncs; j++)
+        {
+            hr = ITypeInfo_GetFuncDesc(ti, j, &funcdesc);
+            ok(hr == S_OK, "got %08x\n", hr);
+            ITypeInfo_ReleaseFuncDesc(ti, funcdesc);
+        }
+        for (j = 0; j < attr->cVars; j++)
+        {
+            hr = ITypeInfo_GetVarDesc(ti, j, &vardesc);
+            ok(hr == S_OK, "got %08x\n", hr);
+            ITypeInfo_ReleaseVarDesc(ti, vardesc);
+        }
+        ITypeInfo_ReleaseTypeAttr(ti, attr);
+        ITypeInfo_Release(ti);
+    }
+}
+
+static DWORD WINAPI load_typelib_thread(void *arg)
+{
+    ITypeLib *tl, *expect = arg;
+    HRESULT hr;
+    int i;
+
+    for (i = 0; i < 20; i++)
+    {
+        hr = LoadTypeLib(wszStdOle2, &tl);
+        ok(hr == S_OK, "got %08x\n", hr);
+        if (hr != S_OK) break;
+        if (expect) ok(tl == expect, "got different typelib %p/%p\n", tl, expect);
+        walk_typelib(tl);
+        ITypeLib_Release(tl);
+    }
+    return 0;
+}
+
+static void test_LoadTypeLib_threads(void)
+{
+    HANDLE threads[4];
+    ITypeLib *tl;
+    HRESULT hr;
+    int i, pass;
+
+    hr = LoadTypeLib(wszStdOle2, &tl);
+    ok(hr == S_OK, "got %08x\n", hr);
+    if (hr != S_OK) return;
+
+    /* types are decoded concurrently, the first time with the typelib
+     * held and then while it is being loaded and released */
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (i = 0; i < ARRAY_SIZE(threads); i++)
+            threads[i] = CreateThread(NULL, 0, load_typelib_thread, pass ? NULL : tl, 0, NULL);
+        for (i = 0; i < ARRAY_SIZE(threads); i++)
+        {
+            ok(!WaitForSingleObject(threads[i], 10000), "thread didn't finish\n");
+            CloseHandle(threads[i]);
+        }
+        if (!pass) ITypeLib_Release(tl);
+    }
+}
+
 static void test_SetVarHelpContext(void)
 {
     static OLECHAR nameW[] = {'n','a','m','e',0};
@@ -5371,6 +5447,254 @@ static void test_SetFuncAndParamNames(void)
     DeleteFileA(filenameA);
 }
 
+static void test_name_lookup(void)
+{
+    static OLECHAR nameW[] = {'n','a','m','e',0};
+    static OLECHAR name2W[] = {'n','a','m','e','2',0};
+    static OLECHAR firstW[] = {'f','i','r','s','t',0};
+    static OLECHAR secondW[] = {'S','e','c','o','n','d',0};
+    static OLECHAR accentW[] = {'f',0xe9,'t',0xe9,0};
+    static OLECHAR accent_upperW[] = {'F',0xc9,'T',0xc9,0};
+    static OLECHAR unknownW[] = {'u','n','k','n','o','w','n',0};
+    static OLECHAR addedW[] = {'A','d','d','e','d',0};
+    static OLECHAR renamedW[] = {'R','e','n','a','m','e','d',0};
+    static OLECHAR method0W[] = {'m','e','t','h','o','d','0',0};
+    static OLECHAR propW[] = {'P','r','o','p',0};
+    static OLECHAR prop2W[] = {'P','r','o','p','2',0};
+    const unsigned int count = 1000;
+    CHAR filenameA[MAX_PATH];
+    WCHAR filenameW[MAX_PATH], buffer[32];
+    OLECHAR *names[3];
+    ICreateTypeLib2 *ctl;
+    ICreateTypeInfo *cti;
+    ITypeInfo *ti, *bound_ti;
+    ITypeComp *tcomp;
+    ITypeLib *tl;
+    FUNCDESC funcdesc;
+    VARDESC vardesc;
+    ELEMDESC edesc[2];
+    MEMBERID memids[3];
+    DESCKIND desckind;
+    BINDPTR bindptr;
+    unsigned int i, j;
+    HRESULT hr;
+
+    GetTempFileNameA(".", "tlb", 0, filenameA);
+    MultiByteToWideChar(CP_ACP, 0, filenameA, -1, filenameW, MAX_PATH);
+
+    hr = CreateTypeLib2(SYS_WIN32, filenameW, &ctl);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    hr = ICreateTypeLib2_CreateTypeInfo(ctl, nameW, TKIND_DISPATCH, &cti);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    memset(&funcdesc, 0, sizeof(funcdesc));
+    memset(edesc, 0, sizeof(edesc));
+    edesc[0].tdesc.vt = VT_I4;
+    edesc[1].tdesc.vt = VT_BSTR;
+    funcdesc.funckind = FUNC_DISPATCH;
+    funcdesc.invkind = INVOKE_FUNC;
+    funcdesc.callconv = CC_STDCALL;
+    funcdesc.elemdescFunc.tdesc.vt = VT_VOID;
+    funcdesc.lprgelemdescParam = edesc;
+    funcdesc.cParams = 2;
+
+    names[0] = buffer;
+    names[1] = firstW;
+    names[2] = secondW;
+    for (i = 0; i < count; i++)
+    {
+        static const WCHAR fmtW[] = {'M','e','t','h','o','d','%','u',0};
+
+        funcdesc.memid = i + 1;
+        hr = ICreateTypeInfo_AddFuncDesc(cti, i, &funcdesc);
+        ok(hr == S_OK, "got %08x\n", hr);
+        wsprintfW(buffer, fmtW, i);
+        hr = ICreateTypeInfo_SetFuncAndParamNames(cti, i, names, 3);
+        ok(hr == S_OK, "got %08x\n", hr);
+    }
+
+    hr = ICreateTypeInfo_QueryInterface(cti, &IID_ITypeInfo, (void **)&ti);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    for (i = 0; i < count; i += 97)
+    {
+        static const WCHAR fmtW[] = {'m','E','T','H','O','D','%','u',0};
+
+        wsprintfW(buffer, fmtW, i);
+        hr = ITypeInfo_GetIDsOfNames(ti, names, 3, memids);
+        ok(hr == S_OK, "got %08x\n", hr);
+        ok(memids[0] == i + 1, "got memid %d for %s\n", memids[0], wine_dbgstr_w(buffer));
+        ok(memids[1] == 0, "got %d\n", memids[1]);
+        ok(memids[2] == 1, "got %d\n", memids[2]);
+    }
+
+    names[0] = unknownW;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == DISP_E_UNKNOWNNAME, "got %08x\n", hr);
+    ok(memids[0] == MEMBERID_NIL, "got %d\n", memids[0]);
+
+    names[0] = buffer;
+    names[1] = unknownW;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 2, memids);
+    ok(hr == DISP_E_UNKNOWNNAME, "got %08x\n", hr);
+    ok(memids[0] != MEMBERID_NIL, "got %d\n", memids[0]);
+    ok(memids[1] == MEMBERID_NIL, "got %d\n", memids[1]);
+    names[1] = firstW;
+
+    hr = ITypeInfo_GetTypeComp(ti, &tcomp);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    for (i = 0; i < count; i++)
+    {
+        static const WCHAR fmtW[] = {'m','e','t','h','o','d','%','u',0};
+
+        wsprintfW(buffer, fmtW, i);
+        hr = ITypeInfo_GetIDsOfNames(ti, names, 3, memids);
+        if (hr != S_OK || memids[0] != i + 1) break;
+    }
+    ok(i == count, "lookup of method%u failed, hr %08x memid %d\n", i, hr, memids[0]);
+
+    for (i = 0; i < count; i++)
+    {
+        static const WCHAR fmtW[] = {'M','E','T','H','O','D','%','u',0};
+
+        wsprintfW(buffer, fmtW, i);
+        hr = ITypeComp_Bind(tcomp, buffer, LHashValOfNameSys(SYS_WIN32, LOCALE_NEUTRAL, buffer),
+                            INVOKE_FUNC, &bound_ti, &desckind, &bindptr);
+        if (hr != S_OK || desckind != DESCKIND_FUNCDESC) break;
+        ok(bindptr.lpfuncdesc->memid == i + 1, "got memid %d\n", bindptr.lpfuncdesc->memid);
+        ITypeInfo_ReleaseFuncDesc(bound_ti, bindptr.lpfuncdesc);
+        ITypeInfo_Release(bound_ti);
+    }
+    ok(i == count, "binding of METHOD%u failed, hr %08x kind %d\n", i, hr, desckind);
+
+    hr = ITypeComp_Bind(tcomp, buffer, 0, INVOKE_PROPERTYGET, &bound_ti, &desckind, &bindptr);
+    ok(hr == TYPE_E_TYPEMISMATCH, "got %08x\n", hr);
+
+    /* changes made after the first lookup must be seen by the next ones */
+    funcdesc.memid = count + 1;
+    hr = ICreateTypeInfo_AddFuncDesc(cti, count, &funcdesc);
+    ok(hr == S_OK, "got %08x\n", hr);
+    names[0] = addedW;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == DISP_E_UNKNOWNNAME, "got %08x\n", hr);
+    hr = ICreateTypeInfo_SetFuncAndParamNames(cti, count, names, 3);
+    ok(hr == S_OK, "got %08x\n", hr);
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 3, memids);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ok(memids[0] == count + 1, "got %d\n", memids[0]);
+    ok(memids[1] == 0, "got %d\n", memids[1]);
+    ok(memids[2] == 1, "got %d\n", memids[2]);
+
+    names[0] = renamedW;
+    hr = ICreateTypeInfo_SetFuncAndParamNames(cti, 0, names, 3);
+    ok(hr == S_OK, "got %08x\n", hr);
+    names[0] = method0W;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == DISP_E_UNKNOWNNAME, "got %08x\n", hr);
+    hr = ITypeComp_Bind(tcomp, renamedW, LHashValOfNameSys(SYS_WIN32, LOCALE_NEUTRAL, renamedW),
+                        INVOKE_FUNC, &bound_ti, &desckind, &bindptr);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ok(desckind == DESCKIND_FUNCDESC, "got %d\n", desckind);
+    if (desckind == DESCKIND_FUNCDESC)
+    {
+        ok(bindptr.lpfuncdesc->memid == 1, "got memid %d\n", bindptr.lpfuncdesc->memid);
+        ITypeInfo_ReleaseFuncDesc(bound_ti, bindptr.lpfuncdesc);
+        ITypeInfo_Release(bound_ti);
+    }
+
+    memset(&vardesc, 0, sizeof(vardesc));
+    vardesc.memid = count + 2;
+    vardesc.varkind = VAR_DISPATCH;
+    vardesc.elemdescVar.tdesc.vt = VT_I4;
+    hr = ICreateTypeInfo_AddVarDesc(cti, 0, &vardesc);
+    ok(hr == S_OK, "got %08x\n", hr);
+    hr = ICreateTypeInfo_SetVarName(cti, 0, propW);
+    ok(hr == S_OK, "got %08x\n", hr);
+    names[0] = propW;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ok(memids[0] == count + 2, "got %d\n", memids[0]);
+    hr = ICreateTypeInfo_SetVarName(cti, 0, prop2W);
+    ok(hr == S_OK, "got %08x\n", hr);
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == DISP_E_UNKNOWNNAME, "got %08x\n", hr);
+    names[0] = prop2W;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ok(memids[0] == count + 2, "got %d\n", memids[0]);
+
+    ITypeComp_Release(tcomp);
+    ITypeInfo_Release(ti);
+    ICreateTypeInfo_Release(cti);
+
+    /* names that aren't plain ASCII are still compared case insensitively */
+    hr = ICreateTypeLib2_CreateTypeInfo(ctl, name2W, TKIND_DISPATCH, &cti);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    funcdesc.memid = 1;
+    funcdesc.cParams = 0;
+    hr = ICreateTypeInfo_AddFuncDesc(cti, 0, &funcdesc);
+    ok(hr == S_OK, "got %08x\n", hr);
+    names[0] = accentW;
+    hr = ICreateTypeInfo_SetFuncAndParamNames(cti, 0, names, 1);
+    ok(hr == S_OK, "got %08x\n", hr);
+
+    hr = ICreateTypeInfo_QueryInterface(cti, &IID_ITypeInfo, (void **)&ti);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ICreateTypeInfo_Release(cti);
+
+    names[0] = accent_upperW;
+    hr = ITypeInfo_GetIDsOfNames(ti, names, 1, memids);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ok(memids[0] == 1, "got %d\n", memids[0]);
+    ITypeInfo_Release(ti);
+
+    hr = ICreateTypeLib2_QueryInterface(ctl, &IID_ITypeLib, (void **)&tl);
+    ok(hr == S_OK, "got %08x\n", hr);
+    ICreateTypeLib2_Release(ctl);
+    ITypeLib_Release(tl);
+
+    /* stdole2 */
+    hr = LoadTypeLib(wszStdOle2, &tl);
+    ok(hr == S_OK, "got %08x\n", hr);
+    if (hr != S_OK) goto done;
+
+    for (j = 0; j < ITypeLib_GetTypeInfoCount(tl); j++)
+    {
+        TYPEATTR *attr;
+        BSTR name;
+        UINT k, n;
+
+        hr = ITypeLib_GetTypeInfo(tl, j, &ti);
+        ok(hr == S_OK, "got %08x\n", hr);
+        hr = ITypeInfo_GetTypeAttr(ti, &attr);
+        ok(hr == S_OK, "got %08x\n", hr);
+        for (k = 0; k < attr->cFuncs; k++)
+        {
+            FUNCDESC *desc;
+
+            hr = ITypeInfo_GetFuncDesc(ti, k, &desc);
+            ok(hr == S_OK, "got %08x\n", hr);
+            hr = ITypeInfo_GetNames(ti, desc->memid, &name, 1, &n);
+            ok(hr == S_OK, "got %08x\n", hr);
+            hr = ITypeInfo_GetIDsOfNames(ti, &name, 1, memids);
+            ok(hr == S_OK, "GetIDsOfNames(%s) failed: %08x\n", wine_dbgstr_w(name), hr);
+            ok(memids[0] == desc->memid, "%s: got memid %d, expected %d\n", wine_dbgstr_w(name),
+               memids[0], desc->memid);
+            SysFreeString(name);
+            ITypeInfo_ReleaseFuncDesc(ti, desc);
+        }
+        ITypeInfo_ReleaseTypeAttr(ti, attr);
+        ITypeInfo_Release(ti);
+    }
+    ITypeLib_Release(tl);
+
+done:
+    DeleteFileA(filenameA);
+}
+
 static void test_SetDocString(void)
 {
     static OLECHAR nameW[] = {'n','a','m','e',0};
@@ -6427,6 +6751,7 @@ START_TEST(typelib)
     test_inheritance();
     test_SetVarHelpContext();
     test_SetFuncAndParamNames();
+    test_name_lookup();
     test_SetDocString();
     test_FindName();
 
@@ -6440,6 +6765,7 @@ START_TEST(typelib)
     test_register_typelib(FALSE);
     test_create_typelibs();
     test_LoadTypeLib();
+    test_LoadTypeLib_threads();
     test_TypeInfo2_GetContainingTypeLib();
     test_LoadRegTypeLib();
     test_GetLibAttr();
@@ -5892,6 +5892,50 @@ static void test_ChangeType_keep_dst(void)
      SysFreeString(bstr);
 }
 
+static void test_ChangeType_numbers(void)
+{
+  static const WCHAR num12W[] = {'1','2',0};
+  static const WCHAR num34W[] = {'3','4',0};
+  VARIANT v1, v2;
+  HRESULT hres;
+
+  /* in place, the source string is freed */
+  V_VT(&v1) = VT_BSTR;
+  V_BSTR(&v1) = SysAllocString(num12W);
+  hres = VariantChangeTypeEx(&v1, &v1, MAKELCID(MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), SORT_DEFAULT), 0, VT_I4);
+  ok(hres == S_OK, "got %08x\n", hres);
+  ok(V_VT(&v1) == VT_I4 && V_I4(&v1) == 12, "got type %d value %d\n", V_VT(&v1), V_I4(&v1));
+
+  /* the destination string is replaced */
+  V_VT(&v2) = VT_BSTR;
+  V_BSTR(&v2) = SysAllocString(num12W);
+  V_I4(&v1) = 34;
+  hres = VariantChangeTypeEx(&v2, &v1, MAKELCID(MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), SORT_DEFAULT), 0, VT_BSTR);
+  ok(hres == S_OK, "got %08x\n", hres);
+  ok(V_VT(&v2) == VT_BSTR && !lstrcmpW(V_BSTR(&v2), num34W), "got type %d\n", V_VT(&v2));
+  ok(V_VT(&v1) == VT_I4 && V_I4(&v1) == 34, "source changed to type %d\n", V_VT(&v1));
+
+  /* the destination is left alone on overflow */
+  V_VT(&v1) = VT_R8;
+  V_R8(&v1) = 1e10;
+  hres = VariantChangeTypeEx(&v2, &v1, 0, 0, VT_I2);
+  ok(hres == DISP_E_OVERFLOW, "got %08x\n", hres);
+  ok(V_VT(&v2) == VT_BSTR && !lstrcmpW(V_BSTR(&v2), num34W), "got type %d\n", V_VT(&v2));
+  VariantClear(&v2);
+
+  V_VT(&v1) = VT_I4;
+  V_I4(&v1) = 56;
+  hres = VariantChangeTypeEx(&v2, &v1, 0, 0, VT_R8);
+  ok(hres == S_OK, "got %08x\n", hres);
+  ok(V_VT(&v2) == VT_R8 && V_R8(&v2) == 56.0, "got type %d\n", V_VT(&v2));
+
+  /* converting to a string over a number */
+  hres = VariantChangeTypeEx(&v2, &v1, 0, 0, VT_BSTR);
+  ok(hres == S_OK, "got %08x\n", hres);
+  ok(V_VT(&v2) == VT_BSTR && V_BSTR(&v2) && SysStringLen(V_BSTR(&v2)) == 2, "got type %d\n", V_VT(&v2));
+  VariantClear(&v2);
+}
+
 /* This tests assumes an empty cache, so it needs to be ran early in the test. */
 static void test_bstr_cache(void)
 {
@@ -5944,6 +5988,70 @@ static void test_bstr_cache(void)
     SysFreeString(str2);
 }
 
+static DWORD WINAPI bstr_alloc_thread(void *arg)
+{
+    unsigned i, len;
+    BSTR str;
+
+    for(i=0; i < 100000; i++)
+    {
+        len = i % 200;
+        str = SysAllocStringLen(NULL, len);
+        if(!str) break;
+        str[0] = str[len] = 0;
+        if(SysStringLen(str) != len) break;
+        SysFreeString(str);
+    }
+    return i;
+}
+
+static DWORD WINAPI bstr_free_thread(void *arg)
+{
+    BSTR *strs = arg;
+    unsigned i;
+
+    for(i=0; i < 64; i++)
+        SysFreeString(strs[i]);
+    return 0;
+}
+
+static void test_bstr_cache_threads(void)
+{
+    HANDLE threads[4];
+    BSTR strs[64], str;
+    DWORD ret;
+    unsigned i;
+
+    static const WCHAR testW[] = {'t','e','s','t',0};
+
+    /* strings allocated on one thread may be freed on another one */
+    for(i=0; i < ARRAY_SIZE(strs); i++)
+    {
+        strs[i] = SysAllocStringLen(testW, i);
+        ok(strs[i] != NULL, "SysAllocStringLen failed\n");
+    }
+    threads[0] = CreateThread(NULL, 0, bstr_free_thread, strs, 0, NULL);
+    ok(!WaitForSingleObject(threads[0], 10000), "wait failed\n");
+    CloseHandle(threads[0]);
+
+    for(i=0; i < ARRAY_SIZE(strs); i++)
+    {
+        str = SysAllocString(testW);
+        ok(str && !lstrcmpW(str, testW), "unexpected string %s\n", wine_dbgstr_w(str));
+        SysFreeString(str);
+    }
+
+    for(i=0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread(NULL, 0, bstr_alloc_thread, NULL, 0, NULL);
+    for(i=0; i < ARRAY_SIZE(threads); i++)
+    {
+        ok(!WaitForSingleObject(threads[i], 10000), "wait failed\n");
+        GetExitCodeThread(threads[i], &ret);
+        ok(ret == 100000, "thread %u failed at iteration %u\n", i, ret);
+        CloseHandle(threads[i]);
+    }
+}
+
 static void write_typelib(int res_no, const char *filename)
 {
     DWORD written;
@@ -6119,6 +6227,7 @@ START_TEST(vartype)
         GetUserDefaultLCID());
 
   test_bstr_cache();
+  test_bstr_cache_threads();
 
   test_VarI1FromI2();
   test_VarI1FromI4();
@@ -6410,6 +6519,7 @@ START_TEST(vartype)
 
   test_NullByRef();
   test_ChangeType_keep_dst();
+  test_ChangeType_numbers();
 
   test_recinfo();
 }
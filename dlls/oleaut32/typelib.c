@@ -1130,6 +1130,19 @@ typedef struct tagITypeLibImpl
     struct list entry;
     WCHAR *path;
     INT index;
+
+    /* MSFT image the type info members are decoded from on first access */
+    IUnknown *msft_file;
+    void *msft_base;
+    DWORD msft_length;
+    MSFT_SegDir msft_segdir;
+    int msft_pending;           /* type infos that haven't been decoded yet */
+    TLBString **msft_names;     /* name and string lists sorted by offset */
+    int msft_name_count;
+    TLBString **msft_strings;
+    int msft_string_count;
+    TLBGuid **msft_guids;       /* guid list indexed by offset */
+    int msft_guid_count;
 } ITypeLibImpl;
 
 static const ITypeLib2Vtbl tlbvt;
@@ -1157,7 +1170,7 @@ static inline ITypeLibImpl *impl_from_ICreateTypeLib2( ICreateTypeLib2 *iface )
 }
 
 /* ITypeLib methods */
-static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength);
+static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength, IUnknown *file);
 static ITypeLib2* ITypeLib2_Constructor_SLTG(LPVOID pLib, DWORD dwTLBLength);
 
 /*======================= ITypeInfo implementation =======================*/
@@ -1226,6 +1239,21 @@ typedef struct tagTLBImplType
     struct list custdata_list;
 } TLBImplType;
 
+/* case insensitive hash index of the member and parameter names */
+typedef struct tagTLBNameIndex
+{
+    BOOL complex;           /* some member names can't be hashed, search linearly */
+    UINT mask;              /* number of buckets - 1 */
+    UINT *func_buckets;     /* first function + 1 of each bucket, 0 if empty */
+    UINT *func_next;        /* next function + 1 in the same bucket */
+    ULONG *func_hashes;
+    UINT *var_buckets;
+    UINT *var_next;
+    ULONG *var_hashes;
+    UINT *param_start;      /* first parameter of each function in param_hashes */
+    ULONG *param_hashes;
+} TLBNameIndex;
+
 /* internal TypeInfo data */
 typedef struct tagITypeInfoImpl
 {
@@ -1264,18 +1292,46 @@ typedef struct tagITypeInfoImpl
 
     struct list *pcustdata_list;
     struct list custdata_list;
+
+    TLBNameIndex *name_index;   /* built on first name lookup */
+
+    /* MSFT typelibs: functions, variables, implemented interfaces and
+     * custom data are decoded on first access */
+    LONG members_pending;
+    int msft_memoffset;
+    int msft_datatype1;
+    int msft_custdata;
 } ITypeInfoImpl;
 
-static inline ITypeInfoImpl *info_impl_from_ITypeComp( ITypeComp *iface )
+static void TLB_load_members(ITypeInfoImpl *info);
+
+/* doesn't decode the members, for the methods that use neither the functions,
+ * the variables, the implemented interfaces nor the custom data */
+static inline ITypeInfoImpl *info_impl_from_ITypeComp_lazy( ITypeComp *iface )
 {
     return CONTAINING_RECORD(iface, ITypeInfoImpl, ITypeComp_iface);
 }
 
-static inline ITypeInfoImpl *impl_from_ITypeInfo2( ITypeInfo2 *iface )
+static inline ITypeInfoImpl *info_impl_from_ITypeComp( ITypeComp *iface )
+{
+    ITypeInfoImpl *This = CONTAINING_RECORD(iface, ITypeInfoImpl, ITypeComp_iface);
+    if (This->members_pending) TLB_load_members(This);
+    return This;
+}
+
+/* doesn't decode the members, see info_impl_from_ITypeComp_lazy */
+static inline ITypeInfoImpl *impl_from_ITypeInfo2_lazy( ITypeInfo2 *iface )
 {
     return CONTAINING_RECORD(iface, ITypeInfoImpl, ITypeInfo2_iface);
 }
 
+static inline ITypeInfoImpl *impl_from_ITypeInfo2( ITypeInfo2 *iface )
+{
+    ITypeInfoImpl *This = CONTAINING_RECORD(iface, ITypeInfoImpl, ITypeInfo2_iface);
+    if (This->members_pending) TLB_load_members(This);
+    return This;
+}
+
 static inline ITypeInfoImpl *impl_from_ITypeInfo( ITypeInfo *iface )
 {
     return impl_from_ITypeInfo2((ITypeInfo2*)iface);
@@ -1283,7 +1339,9 @@ static inline ITypeInfoImpl *impl_from_ITypeInfo( ITypeInfo *iface )
 
 static inline ITypeInfoImpl *info_impl_from_ICreateTypeInfo2( ICreateTypeInfo2 *iface )
 {
-    return CONTAINING_RECORD(iface, ITypeInfoImpl, ICreateTypeInfo2_iface);
+    ITypeInfoImpl *This = CONTAINING_RECORD(iface, ITypeInfoImpl, ICreateTypeInfo2_iface);
+    if (This->members_pending) TLB_load_members(This);
+    return This;
 }
 
 static const ITypeInfo2Vtbl tinfvt;
@@ -1715,6 +1773,173 @@ static inline TLBVarDesc *TLB_get_vardesc_by_name(TLBVarDesc *vardescs,
     return NULL;
 }
 
+/* Hashes names made of ASCII letters, digits and underscores, for which
+ * lstrcmpiW is a plain case insensitive comparison.  Returns 0 for other
+ * names, they are always compared with lstrcmpiW. */
+static ULONG TLB_hash_name(const OLECHAR *name)
+{
+    ULONG hash = 2166136261u;
+
+    if (!name || !*name) return 0;
+    for (; *name; name++)
+    {
+        WCHAR c = *name;
+
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        else if ((c < 'A' || c > 'Z') && (c < '0' || c > '9') && c != '_') return 0;
+        hash = (hash ^ c) * 16777619;
+    }
+    return hash | 1;
+}
+
+static TLBNameIndex *TLB_build_name_index(const ITypeInfoImpl *info)
+{
+    UINT i, j, size = 8, params = 0, n = max(info->typeattr.cFuncs, info->typeattr.cVars);
+    TLBNameIndex *index;
+    UINT *ptr;
+
+    while (size < 2 * n) size <<= 1;
+    for (i = 0; i < info->typeattr.cFuncs; i++) params += info->funcdescs[i].funcdesc.cParams;
+
+    index = heap_alloc(sizeof(*index) + (2 * size + 4 * info->typeattr.cFuncs + 2 * info->typeattr.cVars) * sizeof(UINT)
+                       + (info->typeattr.cFuncs + info->typeattr.cVars + params) * sizeof(ULONG));
+    if (!index) return NULL;
+
+    ptr = (UINT *)(index + 1);
+    index->complex = FALSE;
+    index->mask = size - 1;
+    index->func_buckets = ptr;  ptr += size;
+    index->func_next = ptr;     ptr += info->typeattr.cFuncs;
+    index->var_buckets = ptr;   ptr += size;
+    index->var_next = ptr;      ptr += info->typeattr.cVars;
+    index->param_start = ptr;   ptr += info->typeattr.cFuncs;
+    index->func_hashes = (ULONG *)ptr;
+    index->var_hashes = index->func_hashes + info->typeattr.cFuncs;
+    index->param_hashes = index->var_hashes + info->typeattr.cVars;
+    memset(index->func_buckets, 0, size * sizeof(UINT));
+    memset(index->var_buckets, 0, size * sizeof(UINT));
+
+    /* insert backwards so that each bucket is in declaration order */
+    for (i = info->typeattr.cFuncs; i-- > 0;)
+    {
+        const TLBFuncDesc *func = &info->funcdescs[i];
+        ULONG hash = TLB_hash_name(TLB_get_bstr(func->Name));
+
+        index->func_hashes[i] = hash;
+        index->func_next[i] = 0;
+        if (hash)
+        {
+            index->func_next[i] = index->func_buckets[hash & index->mask];
+            index->func_buckets[hash & index->mask] = i + 1;
+        }
+        else if (TLB_get_bstr(func->Name)) index->complex = TRUE;
+    }
+    for (i = info->typeattr.cVars; i-- > 0;)
+    {
+        const TLBVarDesc *var = &info->vardescs[i];
+        ULONG hash = TLB_hash_name(TLB_get_bstr(var->Name));
+
+        index->var_hashes[i] = hash;
+        index->var_next[i] = 0;
+        if (hash)
+        {
+            index->var_next[i] = index->var_buckets[hash & index->mask];
+            index->var_buckets[hash & index->mask] = i + 1;
+        }
+        else if (TLB_get_bstr(var->Name)) index->complex = TRUE;
+    }
+    for (i = params = 0; i < info->typeattr.cFuncs; i++)
+    {
+        const TLBFuncDesc *func = &info->funcdescs[i];
+
+        index->param_start[i] = params;
+        for (j = 0; j < func->funcdesc.cParams; j++)
+            index->param_hashes[params++] = TLB_hash_name(TLB_get_bstr(func->pParamDesc[j].Name));
+    }
+
+    TRACE("%p: %u functions, %u variables%s\n", info, info->typeattr.cFuncs, info->typeattr.cVars,
+          index->complex ? ", complex names" : "");
+    return index;
+}
+
+static TLBNameIndex *TLB_get_name_index(ITypeInfoImpl *info)
+{
+    TLBNameIndex *index = info->name_index;
+
+    if (index) return index;
+    if (!(index = TLB_build_name_index(info))) return NULL;
+    if (InterlockedCompareExchangePointer((void **)&info->name_index, index, NULL))
+    {
+        heap_free(index);
+        index = info->name_index;
+    }
+    return index;
+}
+
+/* must be called whenever the members or their names change */
+static void TLB_free_name_index(ITypeInfoImpl *info)
+{
+    heap_free(InterlockedExchangePointer((void **)&info->name_index, NULL));
+}
+
+/* returns the index of the first function named name after prev, -1 if none */
+static int TLB_find_func_by_name(ITypeInfoImpl *info, const OLECHAR *name, int prev)
+{
+    const TLBNameIndex *index = TLB_get_name_index(info);
+    ULONG hash = TLB_hash_name(name);
+    int i;
+
+    if (index && !index->complex && hash)
+    {
+        i = (prev == -1 ? index->func_buckets[hash & index->mask] : index->func_next[prev]) - 1;
+        for (; i != -1; i = index->func_next[i] - 1)
+            if (index->func_hashes[i] == hash && !lstrcmpiW(TLB_get_bstr(info->funcdescs[i].Name), name))
+                return i;
+        return -1;
+    }
+
+    for (i = prev + 1; i < info->typeattr.cFuncs; i++)
+        if (!lstrcmpiW(TLB_get_bstr(info->funcdescs[i].Name), name)) return i;
+    return -1;
+}
+
+static TLBVarDesc *TLB_find_var_by_name(ITypeInfoImpl *info, const OLECHAR *name)
+{
+    const TLBNameIndex *index = TLB_get_name_index(info);
+    ULONG hash = TLB_hash_name(name);
+    int i;
+
+    if (index && !index->complex && hash)
+    {
+        for (i = index->var_buckets[hash & index->mask] - 1; i != -1; i = index->var_next[i] - 1)
+            if (index->var_hashes[i] == hash && !lstrcmpiW(TLB_get_bstr(info->vardescs[i].Name), name))
+                return &info->vardescs[i];
+        return NULL;
+    }
+
+    return TLB_get_vardesc_by_name(info->vardescs, info->typeattr.cVars, name);
+}
+
+/* returns the index of the parameter named name of a function, -1 if none */
+static int TLB_find_param_by_name(ITypeInfoImpl *info, UINT func, const OLECHAR *name)
+{
+    const TLBNameIndex *index = TLB_get_name_index(info);
+    const TLBFuncDesc *desc = &info->funcdescs[func];
+    ULONG hash = TLB_hash_name(name);
+    int i;
+
+    for (i = 0; i < desc->funcdesc.cParams; i++)
+    {
+        if (index && hash)
+        {
+            ULONG param_hash = index->param_hashes[index->param_start[func] + i];
+            if (param_hash && param_hash != hash) continue;
+        }
+        if (!lstrcmpiW(name, TLB_get_bstr(desc->pParamDesc[i].Name))) return i;
+    }
+    return -1;
+}
+
 static inline TLBCustData *TLB_get_custdata_by_guid(struct list *custdata_list, REFGUID guid)
 {
     TLBCustData *cust_data;
@@ -2094,9 +2319,19 @@ static HRESULT MSFT_ReadAllGuids(TLBContext *pcx)
 
 static TLBGuid *MSFT_ReadGuid( int offset, TLBContext *pcx)
 {
+    ITypeLibImpl *lib = pcx->pLibInfo;
     TLBGuid *ret;
 
-    LIST_FOR_EACH_ENTRY(ret, &pcx->pLibInfo->guid_list, TLBGuid, entry){
+    if (lib->msft_guids)
+    {
+        int i = offset / (int)sizeof(MSFT_GuidEntry);
+
+        if (offset < 0 || i >= lib->msft_guid_count || lib->msft_guids[i]->offset != offset) return NULL;
+        TRACE_(typelib)("%s\n", debugstr_guid(&lib->msft_guids[i]->guid));
+        return lib->msft_guids[i];
+    }
+
+    LIST_FOR_EACH_ENTRY(ret, &lib->guid_list, TLBGuid, entry){
         if(ret->offset == offset){
             TRACE_(typelib)("%s\n", debugstr_guid(&ret->guid));
             return ret;
@@ -2169,10 +2404,33 @@ static HRESULT MSFT_ReadAllNames(TLBContext *pcx)
     }
 }
 
+/* binary search in a table built by MSFT_BuildStringTable */
+static TLBString *MSFT_FindString( TLBString **table, int count, int offset )
+{
+    int min = 0, max = count - 1;
+
+    while (min <= max)
+    {
+        int pos = (min + max) / 2;
+
+        if (table[pos]->offset == offset)
+        {
+            TRACE_(typelib)("%s\n", debugstr_w(table[pos]->str));
+            return table[pos];
+        }
+        if (table[pos]->offset < offset) min = pos + 1;
+        else max = pos - 1;
+    }
+    return NULL;
+}
+
 static TLBString *MSFT_ReadName( TLBContext *pcx, int offset)
 {
     TLBString *tlbstr;
 
+    if (pcx->pLibInfo->msft_names)
+        return MSFT_FindString(pcx->pLibInfo->msft_names, pcx->pLibInfo->msft_name_count, offset);
+
     LIST_FOR_EACH_ENTRY(tlbstr, &pcx->pLibInfo->name_list, TLBString, entry) {
         if (tlbstr->offset == offset) {
             TRACE_(typelib)("%s\n", debugstr_w(tlbstr->str));
@@ -2187,6 +2445,9 @@ static TLBString *MSFT_ReadString( TLBContext *pcx, int offset)
 {
     TLBString *tlbstr;
 
+    if (pcx->pLibInfo->msft_strings)
+        return MSFT_FindString(pcx->pLibInfo->msft_strings, pcx->pLibInfo->msft_string_count, offset);
+
     LIST_FOR_EACH_ENTRY(tlbstr, &pcx->pLibInfo->string_list, TLBString, entry) {
         if (tlbstr->offset == offset) {
             TRACE_(typelib)("%s\n", debugstr_w(tlbstr->str));
@@ -2645,6 +2906,100 @@ static void TLB_fix_32on64_typeinfo(ITypeInfoImpl *info)
 /*
  * process a typeinfo record
  */
+/* decodes the functions, variables, implemented interfaces and custom data
+ * of a type info */
+static void MSFT_DoMembers(TLBContext *pcx, ITypeInfoImpl *pTI, int memoffset, int datatype1, int custdata)
+{
+    /* functions */
+    if(pTI->typeattr.cFuncs >0 )
+        MSFT_DoFuncs(pcx, pTI, pTI->typeattr.cFuncs,
+		    pTI->typeattr.cVars,
+		    memoffset, &pTI->funcdescs);
+    /* variables */
+    if(pTI->typeattr.cVars >0 )
+        MSFT_DoVars(pcx, pTI, pTI->typeattr.cFuncs,
+		   pTI->typeattr.cVars,
+		   memoffset, &pTI->vardescs);
+    if(pTI->typeattr.cImplTypes >0 ) {
+        switch(pTI->typeattr.typekind)
+        {
+        case TKIND_COCLASS:
+            MSFT_DoImplTypes(pcx, pTI, pTI->typeattr.cImplTypes,
+                datatype1);
+            break;
+        case TKIND_DISPATCH:
+            /* This is not -1 when the interface is a non-base dual interface or
+               when a dispinterface wraps an interface, i.e., the idl 'dispinterface x {interface y;};'.
+               Note however that GetRefTypeOfImplType(0) always returns a ref to IDispatch and
+               not this interface.
+            */
+
+            if (datatype1 != -1)
+            {
+                pTI->impltypes = TLBImplType_Alloc(1);
+                pTI->impltypes[0].hRef = datatype1;
+            }
+            break;
+        default:
+            pTI->impltypes = TLBImplType_Alloc(1);
+            pTI->impltypes[0].hRef = datatype1;
+            break;
+       }
+    }
+    MSFT_CustData(pcx, custdata, pTI->pcustdata_list);
+
+    if (TRACE_ON(typelib))
+      dump_TypeInfo(pTI);
+}
+
+static CRITICAL_SECTION msft_section;
+static CRITICAL_SECTION_DEBUG msft_section_debug =
+{
+    0, 0, &msft_section,
+    { &msft_section_debug.ProcessLocksList, &msft_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": msft_section") }
+};
+static CRITICAL_SECTION msft_section = { &msft_section_debug, -1, 0, 0, 0, 0 };
+
+static void MSFT_FreeTables(ITypeLibImpl *lib)
+{
+    heap_free(lib->msft_names);
+    heap_free(lib->msft_strings);
+    heap_free(lib->msft_guids);
+    lib->msft_names = lib->msft_strings = NULL;
+    lib->msft_guids = NULL;
+    if (lib->msft_file) IUnknown_Release(lib->msft_file);
+    lib->msft_file = NULL;
+    lib->msft_base = NULL;
+}
+
+/* decodes the members of a type info from a lazily loaded MSFT typelib */
+static void TLB_load_members(ITypeInfoImpl *info)
+{
+    ITypeLibImpl *lib = info->pTypeLib;
+    TLBContext cx;
+
+    if (!info->members_pending) return;
+
+    EnterCriticalSection(&msft_section);
+    if (info->members_pending)
+    {
+        TRACE_(typelib)("decoding %s\n", debugstr_w(TLB_get_bstr(info->Name)));
+        cx.oStart = 0;
+        cx.pos = 0;
+        cx.length = lib->msft_length;
+        cx.mapping = lib->msft_base;
+        cx.pTblDir = &lib->msft_segdir;
+        cx.pLibInfo = lib;
+        MSFT_DoMembers(&cx, info, info->msft_memoffset, info->msft_datatype1, info->msft_custdata);
+        InterlockedExchange(&info->members_pending, FALSE);
+
+        /* everything is decoded, the image isn't needed anymore */
+        if (!--lib->msft_pending) MSFT_FreeTables(lib);
+    }
+    LeaveCriticalSection(&msft_section);
+}
+
 static ITypeInfoImpl * MSFT_DoTypeInfo(
     TLBContext *pcx,
     int count,
@@ -2701,50 +3056,21 @@ static ITypeInfoImpl * MSFT_DoTypeInfo(
 /* note: InfoType's Help file and HelpStringDll come from the containing
  * library. Further HelpString and Docstring appear to be the same thing :(
  */
-    /* functions */
-    if(ptiRet->typeattr.cFuncs >0 )
-        MSFT_DoFuncs(pcx, ptiRet, ptiRet->typeattr.cFuncs,
-		    ptiRet->typeattr.cVars,
-		    tiBase.memoffset, &ptiRet->funcdescs);
-    /* variables */
-    if(ptiRet->typeattr.cVars >0 )
-        MSFT_DoVars(pcx, ptiRet, ptiRet->typeattr.cFuncs,
-		   ptiRet->typeattr.cVars,
-		   tiBase.memoffset, &ptiRet->vardescs);
-    if(ptiRet->typeattr.cImplTypes >0 ) {
-        switch(ptiRet->typeattr.typekind)
-        {
-        case TKIND_COCLASS:
-            MSFT_DoImplTypes(pcx, ptiRet, ptiRet->typeattr.cImplTypes,
-                tiBase.datatype1);
-            break;
-        case TKIND_DISPATCH:
-            /* This is not -1 when the interface is a non-base dual interface or
-               when a dispinterface wraps an interface, i.e., the idl 'dispinterface x {interface y;};'.
-               Note however that GetRefTypeOfImplType(0) always returns a ref to IDispatch and
-               not this interface.
-            */
-
-            if (tiBase.datatype1 != -1)
-            {
-                ptiRet->impltypes = TLBImplType_Alloc(1);
-                ptiRet->impltypes[0].hRef = tiBase.datatype1;
-            }
-            break;
-        default:
-            ptiRet->impltypes = TLBImplType_Alloc(1);
-            ptiRet->impltypes[0].hRef = tiBase.datatype1;
-            break;
-       }
+    if (pcx->pLibInfo->msft_file)
+    {
+        ptiRet->members_pending = TRUE;
+        ptiRet->msft_memoffset = tiBase.memoffset;
+        ptiRet->msft_datatype1 = tiBase.datatype1;
+        ptiRet->msft_custdata = tiBase.oCustData;
+        pcx->pLibInfo->msft_pending++;
     }
-    MSFT_CustData(pcx, tiBase.oCustData, ptiRet->pcustdata_list);
+    else
+        MSFT_DoMembers(pcx, ptiRet, tiBase.memoffset, tiBase.datatype1, tiBase.oCustData);
 
     TRACE_(typelib)("%s guid: %s kind:%s\n",
        debugstr_w(TLB_get_bstr(ptiRet->Name)),
        debugstr_guid(TLB_get_guidref(ptiRet->guid)),
        typekind_desc[ptiRet->typeattr.typekind]);
-    if (TRACE_ON(typelib))
-      dump_TypeInfo(ptiRet);
 
     return ptiRet;
 }
@@ -2794,6 +3120,42 @@ static HRESULT MSFT_ReadAllStrings(TLBContext *pcx)
     }
 }
 
+/* builds a table of the strings of a list sorted by offset */
+static TLBString **MSFT_BuildStringTable(struct list *list, int *count)
+{
+    TLBString *str, **table;
+    int i = 0;
+
+    *count = list_count(list);
+    if (!(table = heap_alloc(max(*count, 1) * sizeof(*table)))) return NULL;
+    LIST_FOR_EACH_ENTRY(str, list, TLBString, entry)
+    {
+        if (i && table[i - 1]->offset >= str->offset)
+        {
+            heap_free(table);
+            return NULL;
+        }
+        table[i++] = str;
+    }
+    return table;
+}
+
+/* builds lookup tables for MSFT_ReadName, MSFT_ReadString and MSFT_ReadGuid,
+ * the lists are searched linearly if they can't be built */
+static void MSFT_BuildTables(ITypeLibImpl *lib)
+{
+    TLBGuid *guid;
+    int i = 0;
+
+    lib->msft_names = MSFT_BuildStringTable(&lib->name_list, &lib->msft_name_count);
+    lib->msft_strings = MSFT_BuildStringTable(&lib->string_list, &lib->msft_string_count);
+
+    lib->msft_guid_count = list_count(&lib->guid_list);
+    if (!(lib->msft_guids = heap_alloc(max(lib->msft_guid_count, 1) * sizeof(*lib->msft_guids)))) return;
+    LIST_FOR_EACH_ENTRY(guid, &lib->guid_list, TLBGuid, entry)
+        lib->msft_guids[i++] = guid;
+}
+
 static HRESULT MSFT_ReadAllRefs(TLBContext *pcx)
 {
     TLBRefType *ref;
@@ -3265,6 +3627,28 @@ static HRESULT TLB_Mapping_Open(LPCWSTR path, LPVOID *ppBase, DWORD *pdwTLBLengt
     return TYPE_E_CANTLOADLIBRARY;
 }
 
+/* Returns a cached typelib with a new reference, must be called with
+ * cache_section held.  Typelibs whose last reference is being released
+ * are skipped, they are removed from the cache once they get the lock. */
+static ITypeLibImpl *TLB_find_cached_typelib(const WCHAR *path, INT index)
+{
+    ITypeLibImpl *entry;
+
+    LIST_FOR_EACH_ENTRY(entry, &tlb_cache, ITypeLibImpl, entry)
+    {
+        LONG ref = entry->ref;
+
+        if (strcmpiW(entry->path, path) || entry->index != index) continue;
+        while (ref)
+        {
+            LONG prev = InterlockedCompareExchange(&entry->ref, ref + 1, ref);
+            if (prev == ref) return entry;
+            ref = prev;
+        }
+    }
+    return NULL;
+}
+
 /****************************************************************************
  *	TLB_ReadTypeLib
  *
@@ -3347,18 +3731,14 @@ static HRESULT TLB_ReadTypeLib(LPCWSTR pszFileName, LPWSTR pszPath, UINT cchPath
 
     /* We look the path up in the typelib cache. If found, we just addref it, and return the pointer. */
     EnterCriticalSection(&cache_section);
-    LIST_FOR_EACH_ENTRY(entry, &tlb_cache, ITypeLibImpl, entry)
+    entry = TLB_find_cached_typelib(pszPath, index);
+    LeaveCriticalSection(&cache_section);
+    if (entry)
     {
-        if (!strcmpiW(entry->path, pszPath) && entry->index == index)
-        {
-            TRACE("cache hit\n");
-            *ppTypeLib = &entry->ITypeLib2_iface;
-            ITypeLib2_AddRef(*ppTypeLib);
-            LeaveCriticalSection(&cache_section);
-            return S_OK;
-        }
+        TRACE("cache hit\n");
+        *ppTypeLib = &entry->ITypeLib2_iface;
+        return S_OK;
     }
-    LeaveCriticalSection(&cache_section);
 
     /* now actually load and parse the typelib */
 
@@ -3373,7 +3753,7 @@ static HRESULT TLB_ReadTypeLib(LPCWSTR pszFileName, LPWSTR pszPath, UINT cchPath
         {
             DWORD dwSignature = FromLEDWord(*((DWORD*) pBase));
             if (dwSignature == MSFT_SIGNATURE)
-                *ppTypeLib = ITypeLib2_Constructor_MSFT(pBase, dwTLBLength);
+                *ppTypeLib = ITypeLib2_Constructor_MSFT(pBase, dwTLBLength, pFile);
             else if (dwSignature == SLTG_SIGNATURE)
                 *ppTypeLib = ITypeLib2_Constructor_SLTG(pBase, dwTLBLength);
             else
@@ -3396,10 +3776,14 @@ static HRESULT TLB_ReadTypeLib(LPCWSTR pszFileName, LPWSTR pszPath, UINT cchPath
 	/* We should really canonicalise the path here. */
         impl->index = index;
 
-        /* FIXME: check if it has added already in the meantime */
+        /* another thread may have loaded it in the meantime */
         EnterCriticalSection(&cache_section);
-        list_add_head(&tlb_cache, &impl->entry);
+        if ((entry = TLB_find_cached_typelib(pszPath, index)))
+            *ppTypeLib = &entry->ITypeLib2_iface;
+        else
+            list_add_head(&tlb_cache, &impl->entry);
         LeaveCriticalSection(&cache_section);
+        if (entry) ITypeLib2_Release(&impl->ITypeLib2_iface);
         ret = S_OK;
     }
     else
@@ -3443,8 +3827,11 @@ static ITypeLibImpl* TypeLibImpl_Constructor(void)
  *	ITypeLib2_Constructor_MSFT
  *
  * loading an MSFT typelib from an in-memory image
+ *
+ * If file is not NULL it keeps the image alive, and the members of the type
+ * infos are only decoded when they are first accessed.
  */
-static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
+static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength, IUnknown *file)
 {
     TLBContext cx;
     LONG lPSegDir;
@@ -3496,6 +3883,7 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
     MSFT_ReadAllNames(&cx);
     MSFT_ReadAllStrings(&cx);
     MSFT_ReadAllGuids(&cx);
+    MSFT_BuildTables(pTypeLibImpl);
 
     /* now fill our internal data */
     /* TLIBATTR fields */
@@ -3633,6 +4021,15 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
 
     pTypeLibImpl->dispatch_href = tlbHeader.dispatchpos;
 
+    if (file)
+    {
+        IUnknown_AddRef(file);
+        pTypeLibImpl->msft_file = file;
+        pTypeLibImpl->msft_base = pLib;
+        pTypeLibImpl->msft_length = dwTLBLength;
+        pTypeLibImpl->msft_segdir = tlbSegDir;
+    }
+
     /* type infos */
     if(tlbHeader.nrtypeinfos >= 0 )
     {
@@ -3656,6 +4053,9 @@ static ITypeLib2* ITypeLib2_Constructor_MSFT(LPVOID pLib, DWORD dwTLBLength)
     }
 #endif
 
+    if (!pTypeLibImpl->msft_pending) MSFT_FreeTables(pTypeLibImpl);
+    else TRACE("decoding %d type infos on demand\n", pTypeLibImpl->msft_pending);
+
     TRACE("(%p)\n", pTypeLibImpl);
     return &pTypeLibImpl->ITypeLib2_iface;
 }
@@ -4792,6 +5192,7 @@ static ULONG WINAPI ITypeLib2_fnRelease( ITypeLib2 *iface)
           ITypeInfoImpl_Destroy(This->typeinfos[i]);
       }
       heap_free(This->typeinfos);
+      MSFT_FreeTables(This);
       heap_free(This);
       return 0;
     }
@@ -5047,6 +5448,7 @@ static HRESULT WINAPI ITypeLib2_fnIsName(
     for(tic = 0; tic < This->TypeInfoCount; ++tic){
         ITypeInfoImpl *pTInfo = This->typeinfos[tic];
         if(!TLB_str_memcmp(szNameBuf, pTInfo->Name, nNameBufLen)) goto ITypeLib2_fnIsName_exit;
+        TLB_load_members(pTInfo);
         for(fdc = 0; fdc < pTInfo->typeattr.cFuncs; ++fdc) {
             TLBFuncDesc *pFInfo = &pTInfo->funcdescs[fdc];
             int pc;
@@ -5106,6 +5508,8 @@ static HRESULT WINAPI ITypeLib2_fnFindName(
             goto ITypeLib2_fnFindName_exit;
         }
 
+        TLB_load_members(pTInfo);
+
         for(fdc = 0; fdc < pTInfo->typeattr.cFuncs; ++fdc) {
             TLBFuncDesc *func = &pTInfo->funcdescs[fdc];
 
@@ -5550,7 +5954,7 @@ static HRESULT WINAPI ITypeInfo_fnQueryInterface(
 	REFIID riid,
 	VOID **ppvObject)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
 
     TRACE("(%p)->(IID: %s)\n",This,debugstr_guid(riid));
 
@@ -5578,7 +5982,7 @@ static HRESULT WINAPI ITypeInfo_fnQueryInterface(
  */
 static ULONG WINAPI ITypeInfo_fnAddRef( ITypeInfo2 *iface)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     ULONG ref = InterlockedIncrement(&This->ref);
 
     TRACE("(%p)->ref is %u\n",This, ref);
@@ -5595,6 +5999,10 @@ static void ITypeInfoImpl_Destroy(ITypeInfoImpl *This)
 
     TRACE("destroying ITypeInfo(%p)\n",This);
 
+    /* the members were never decoded */
+    if (This->members_pending)
+        This->typeattr.cFuncs = This->typeattr.cVars = 0;
+
     for (i = 0; i < This->typeattr.cFuncs; ++i)
     {
         int j;
@@ -5635,6 +6043,7 @@ static void ITypeInfoImpl_Destroy(ITypeInfoImpl *This)
 
     TLB_FreeCustData(&This->custdata_list);
 
+    heap_free(This->name_index);
     heap_free(This);
 }
 
@@ -5642,7 +6051,7 @@ static void ITypeInfoImpl_Destroy(ITypeInfoImpl *This)
  */
 static ULONG WINAPI ITypeInfo_fnRelease(ITypeInfo2 *iface)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     ULONG ref = InterlockedDecrement(&This->ref);
 
     TRACE("(%p)->(%u)\n",This, ref);
@@ -5652,7 +6061,10 @@ static ULONG WINAPI ITypeInfo_fnRelease(ITypeInfo2 *iface)
         BOOL not_attached_to_typelib = This->not_attached_to_typelib;
         ITypeLib2_Release(&This->pTypeLib->ITypeLib2_iface);
         if (not_attached_to_typelib)
+        {
+            heap_free(This->name_index);
             heap_free(This);
+        }
         /* otherwise This will be freed when typelib is freed */
     }
 
@@ -5668,7 +6080,7 @@ static ULONG WINAPI ITypeInfo_fnRelease(ITypeInfo2 *iface)
 static HRESULT WINAPI ITypeInfo_fnGetTypeAttr( ITypeInfo2 *iface,
         LPTYPEATTR  *ppTypeAttr)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     SIZE_T size;
 
     TRACE("(%p)\n",This);
@@ -5706,7 +6118,7 @@ static HRESULT WINAPI ITypeInfo_fnGetTypeAttr( ITypeInfo2 *iface,
 static HRESULT WINAPI ITypeInfo_fnGetTypeComp( ITypeInfo2 *iface,
         ITypeComp  * *ppTComp)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
 
     TRACE("(%p)->(%p)\n", This, ppTComp);
 
@@ -6254,7 +6666,8 @@ static HRESULT WINAPI ITypeInfo_fnGetIDsOfNames( ITypeInfo2 *iface,
     ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
     const TLBVarDesc *pVDesc;
     HRESULT ret=S_OK;
-    UINT i, fdc;
+    UINT i;
+    int fdc;
 
     TRACE("(%p) Name %s cNames %d\n", This, debugstr_w(*rgszNames),
             cNames);
@@ -6263,25 +6676,21 @@ static HRESULT WINAPI ITypeInfo_fnGetIDsOfNames( ITypeInfo2 *iface,
     for (i = 0; i < cNames; i++)
         pMemId[i] = MEMBERID_NIL;
 
-    for (fdc = 0; fdc < This->typeattr.cFuncs; ++fdc) {
-        int j;
+    if ((fdc = TLB_find_func_by_name(This, *rgszNames, -1)) != -1) {
         const TLBFuncDesc *pFDesc = &This->funcdescs[fdc];
-        if(!lstrcmpiW(*rgszNames, TLB_get_bstr(pFDesc->Name))) {
-            if(cNames) *pMemId=pFDesc->funcdesc.memid;
-            for(i=1; i < cNames; i++){
-                for(j=0; j<pFDesc->funcdesc.cParams; j++)
-                    if(!lstrcmpiW(rgszNames[i],TLB_get_bstr(pFDesc->pParamDesc[j].Name)))
-                            break;
-                if( j<pFDesc->funcdesc.cParams)
-                    pMemId[i]=j;
-                else
-                   ret=DISP_E_UNKNOWNNAME;
-            };
-            TRACE("-- 0x%08x\n", ret);
-            return ret;
-        }
+        int j;
+
+        if(cNames) *pMemId=pFDesc->funcdesc.memid;
+        for(i=1; i < cNames; i++){
+            if ((j = TLB_find_param_by_name(This, fdc, rgszNames[i])) != -1)
+                pMemId[i]=j;
+            else
+               ret=DISP_E_UNKNOWNNAME;
+        };
+        TRACE("-- 0x%08x\n", ret);
+        return ret;
     }
-    pVDesc = TLB_get_vardesc_by_name(This->vardescs, This->typeattr.cVars, *rgszNames);
+    pVDesc = TLB_find_var_by_name(This, *rgszNames);
     if(pVDesc){
         if(cNames)
             *pMemId = pVDesc->vardesc.memid;
@@ -7591,7 +8000,7 @@ static HRESULT WINAPI ITypeInfo_fnGetDocumentation( ITypeInfo2 *iface,
         MEMBERID memid, BSTR  *pBstrName, BSTR  *pBstrDocString,
         DWORD  *pdwHelpContext, BSTR  *pBstrHelpFile)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     const TLBFuncDesc *pFDesc;
     const TLBVarDesc *pVDesc;
     TRACE("(%p) memid %d Name(%p) DocString(%p)"
@@ -7608,6 +8017,7 @@ static HRESULT WINAPI ITypeInfo_fnGetDocumentation( ITypeInfo2 *iface,
             *pBstrHelpFile=SysAllocString(TLB_get_bstr(This->pTypeLib->HelpFile));
         return S_OK;
     }else {/* for a member */
+        TLB_load_members(This);
         pFDesc = TLB_get_funcdesc_by_memberid(This->funcdescs, This->typeattr.cFuncs, memid);
         if(pFDesc){
             if(pBstrName)
@@ -7801,6 +8211,7 @@ static HRESULT WINAPI ITypeInfo_fnGetRefTypeInfo(
 
         *pTypeInfoImpl = *This;
         pTypeInfoImpl->ref = 0;
+        pTypeInfoImpl->name_index = NULL;
         list_init(&pTypeInfoImpl->custdata_list);
 
         if (This->typeattr.typekind == TKIND_INTERFACE)
@@ -7891,10 +8302,11 @@ static HRESULT WINAPI ITypeInfo_fnGetRefTypeInfo(
                     SysFreeString(libnam);
                 }
 
-                if(SUCCEEDED(result)) {
-                    ref_type->pImpTLInfo->pImpTypeLib = impl_from_ITypeLib(pTLib);
+                /* another thread may have loaded it in the meantime */
+                if(SUCCEEDED(result) &&
+                   !InterlockedCompareExchangePointer((void **)&ref_type->pImpTLInfo->pImpTypeLib,
+                                                      impl_from_ITypeLib(pTLib), NULL))
                     ITypeLib_AddRef(pTLib);
-                }
             }
         }
         if(SUCCEEDED(result)) {
@@ -8048,7 +8460,7 @@ static HRESULT WINAPI ITypeInfo_fnGetMops( ITypeInfo2 *iface, MEMBERID memid,
 static HRESULT WINAPI ITypeInfo_fnGetContainingTypeLib( ITypeInfo2 *iface,
         ITypeLib  * *ppTLib, UINT  *pIndex)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
 
     /* If a pointer is null, we simply ignore it, the ATL in particular passes pIndex as 0 */
     if (pIndex) {
@@ -8073,7 +8485,7 @@ static HRESULT WINAPI ITypeInfo_fnGetContainingTypeLib( ITypeInfo2 *iface,
 static void WINAPI ITypeInfo_fnReleaseTypeAttr( ITypeInfo2 *iface,
         TYPEATTR* pTypeAttr)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     TRACE("(%p)->(%p)\n", This, pTypeAttr);
     heap_free(pTypeAttr);
 }
@@ -8086,7 +8498,7 @@ static void WINAPI ITypeInfo_fnReleaseFuncDesc(
 	ITypeInfo2 *iface,
         FUNCDESC *pFuncDesc)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     SHORT i;
 
     TRACE("(%p)->(%p)\n", This, pFuncDesc);
@@ -8105,7 +8517,7 @@ static void WINAPI ITypeInfo_fnReleaseFuncDesc(
 static void WINAPI ITypeInfo_fnReleaseVarDesc( ITypeInfo2 *iface,
         VARDESC *pVarDesc)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     TRACE("(%p)->(%p)\n", This, pVarDesc);
 
     TLB_FreeVarDesc(pVarDesc);
@@ -8119,7 +8531,7 @@ static void WINAPI ITypeInfo_fnReleaseVarDesc( ITypeInfo2 *iface,
 static HRESULT WINAPI ITypeInfo2_fnGetTypeKind( ITypeInfo2 * iface,
     TYPEKIND *pTypeKind)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     *pTypeKind = This->typeattr.typekind;
     TRACE("(%p) type 0x%0x\n", This,*pTypeKind);
     return S_OK;
@@ -8134,7 +8546,7 @@ static HRESULT WINAPI ITypeInfo2_fnGetTypeKind( ITypeInfo2 * iface,
  */
 static HRESULT WINAPI ITypeInfo2_fnGetTypeFlags( ITypeInfo2 *iface, ULONG *pTypeFlags)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     *pTypeFlags=This->typeattr.wTypeFlags;
     TRACE("(%p) flags 0x%x\n", This,*pTypeFlags);
     return S_OK;
@@ -8354,7 +8766,7 @@ static HRESULT WINAPI ITypeInfo2_fnGetDocumentation2(
 	DWORD *pdwHelpStringContext,
 	BSTR *pbstrHelpStringDll)
 {
-    ITypeInfoImpl *This = impl_from_ITypeInfo2(iface);
+    ITypeInfoImpl *This = impl_from_ITypeInfo2_lazy(iface);
     const TLBFuncDesc *pFDesc;
     const TLBVarDesc *pVDesc;
     TRACE("(%p) memid %d lcid(0x%x)  HelpString(%p) "
@@ -8375,6 +8787,7 @@ static HRESULT WINAPI ITypeInfo2_fnGetDocumentation2(
                 SysAllocString(TLB_get_bstr(This->pTypeLib->HelpStringDll));/* FIXME */
         return S_OK;
     }else {/* for a member */
+        TLB_load_members(This);
         pFDesc = TLB_get_funcdesc_by_memberid(This->funcdescs, This->typeattr.cFuncs, memid);
         if(pFDesc){
             if(pbstrHelpString)
@@ -8669,21 +9082,21 @@ HRESULT WINAPI CreateDispTypeInfo(
 
 static HRESULT WINAPI ITypeComp_fnQueryInterface(ITypeComp * iface, REFIID riid, LPVOID * ppv)
 {
-    ITypeInfoImpl *This = info_impl_from_ITypeComp(iface);
+    ITypeInfoImpl *This = info_impl_from_ITypeComp_lazy(iface);
 
     return ITypeInfo2_QueryInterface(&This->ITypeInfo2_iface, riid, ppv);
 }
 
 static ULONG WINAPI ITypeComp_fnAddRef(ITypeComp * iface)
 {
-    ITypeInfoImpl *This = info_impl_from_ITypeComp(iface);
+    ITypeInfoImpl *This = info_impl_from_ITypeComp_lazy(iface);
 
     return ITypeInfo2_AddRef(&This->ITypeInfo2_iface);
 }
 
 static ULONG WINAPI ITypeComp_fnRelease(ITypeComp * iface)
 {
-    ITypeInfoImpl *This = info_impl_from_ITypeComp(iface);
+    ITypeInfoImpl *This = info_impl_from_ITypeComp_lazy(iface);
 
     return ITypeInfo2_Release(&This->ITypeInfo2_iface);
 }
@@ -8701,7 +9114,7 @@ static HRESULT WINAPI ITypeComp_fnBind(
     const TLBFuncDesc *pFDesc;
     const TLBVarDesc *pVDesc;
     HRESULT hr = DISP_E_MEMBERNOTFOUND;
-    UINT fdc;
+    int fdc;
 
     TRACE("(%p)->(%s, %x, 0x%x, %p, %p, %p)\n", This, debugstr_w(szName), lHash, wFlags, ppTInfo, pDescKind, pBindPtr);
 
@@ -8709,18 +9122,17 @@ static HRESULT WINAPI ITypeComp_fnBind(
     pBindPtr->lpfuncdesc = NULL;
     *ppTInfo = NULL;
 
-    for(fdc = 0; fdc < This->typeattr.cFuncs; ++fdc){
+    for(fdc = TLB_find_func_by_name(This, szName, -1); fdc != -1;
+        fdc = TLB_find_func_by_name(This, szName, fdc)){
         pFDesc = &This->funcdescs[fdc];
-        if (!lstrcmpiW(TLB_get_bstr(pFDesc->Name), szName)) {
-            if (!wFlags || (pFDesc->funcdesc.invkind & wFlags))
-                break;
-            else
-                /* name found, but wrong flags */
-                hr = TYPE_E_TYPEMISMATCH;
-        }
+        if (!wFlags || (pFDesc->funcdesc.invkind & wFlags))
+            break;
+        else
+            /* name found, but wrong flags */
+            hr = TYPE_E_TYPEMISMATCH;
     }
 
-    if (fdc < This->typeattr.cFuncs)
+    if (fdc != -1)
     {
         HRESULT hr = TLB_AllocAndInitFuncDesc(
             &pFDesc->funcdesc,
@@ -8733,7 +9145,7 @@ static HRESULT WINAPI ITypeComp_fnBind(
         ITypeInfo_AddRef(*ppTInfo);
         return S_OK;
     } else {
-        pVDesc = TLB_get_vardesc_by_name(This->vardescs, This->typeattr.cVars, szName);
+        pVDesc = TLB_find_var_by_name(This, szName);
         if(pVDesc){
             HRESULT hr = TLB_AllocAndInitVarDesc(&pVDesc->vardesc, &pBindPtr->lpvardesc);
             if (FAILED(hr))
@@ -10085,6 +10497,9 @@ static HRESULT WINAPI ICreateTypeLib2_fnSaveAllChanges(ICreateTypeLib2 *iface)
 
     TRACE("%p\n", This);
 
+    for(i = 0; i < This->TypeInfoCount; ++i)
+        TLB_load_members(This->typeinfos[i]);
+
     for(i = 0; i < This->TypeInfoCount; ++i)
         if(This->typeinfos[i]->needs_layout)
             ICreateTypeInfo2_LayOut(&This->typeinfos[i]->ICreateTypeInfo2_iface);
@@ -10702,6 +11117,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnAddFuncDesc(ICreateTypeInfo2 *iface,
 
     ++This->typeattr.cFuncs;
 
+    TLB_free_name_index(This);
     This->needs_layout = TRUE;
 
     return S_OK;
@@ -10872,6 +11288,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnAddVarDesc(ICreateTypeInfo2 *iface,
 
     ++This->typeattr.cVars;
 
+    TLB_free_name_index(This);
     This->needs_layout = TRUE;
 
     return S_OK;
@@ -10917,6 +11334,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnSetFuncAndParamNames(ICreateTypeInfo2 *
         par_desc->Name = TLB_append_str(&This->pTypeLib->name_list, *(names + i));
     }
 
+    TLB_free_name_index(This);
     return S_OK;
 }
 
@@ -10934,6 +11352,7 @@ static HRESULT WINAPI ICreateTypeInfo2_fnSetVarName(ICreateTypeInfo2 *iface,
         return TYPE_E_ELEMENTNOTFOUND;
 
     This->vardescs[index].Name = TLB_append_str(&This->pTypeLib->name_list, name);
+    TLB_free_name_index(This);
     return S_OK;
 }
 
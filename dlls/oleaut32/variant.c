@@ -54,6 +54,15 @@ static CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static CRITICAL_SECTION cache_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* Numbers converted to numbers or strings, and strings converted to numbers */
+static inline BOOL VARIANT_IsDirectCoercion(VARTYPE from, VARTYPE to)
+{
+  BOOL from_number = VARIANT_IsScalar(from) && from > VT_NULL && from != VT_ERROR;
+  BOOL to_number = VARIANT_IsScalar(to) && to > VT_NULL && to != VT_ERROR;
+
+  return (from_number && (to_number || to == VT_BSTR)) || (from == VT_BSTR && to_number);
+}
+
 /* Convert a variant from one type to another */
 static inline HRESULT VARIANT_Coerce(VARIANTARG* pd, LCID lcid, USHORT wFlags,
                                      VARIANTARG* ps, VARTYPE vt)
@@ -996,7 +1005,24 @@ HRESULT WINAPI VariantChangeTypeEx(VARIANTARG* pvargDest, VARIANTARG* pvargSrc,
   TRACE("(%s,%s,0x%08x,0x%04x,%s)\n", debugstr_variant(pvargDest),
         debugstr_variant(pvargSrc), lcid, wFlags, debugstr_vt(vt));
 
-  if (vt == VT_CLSID)
+  if (VARIANT_IsDirectCoercion(V_VT(pvargSrc), vt))
+  {
+    VARIANTARG vTmp;
+
+    /* The source is only read, so it doesn't need a private copy, and the
+     * result owns its value so it can be moved to the destination */
+    V_VT(&vTmp) = VT_EMPTY;
+    res = VARIANT_Coerce(&vTmp, lcid, wFlags, pvargSrc, vt);
+    if (SUCCEEDED(res))
+    {
+      V_VT(&vTmp) = vt;
+      if (SUCCEEDED(res = VariantClear(pvargDest)))
+        *pvargDest = vTmp;
+      else
+        VariantClear(&vTmp);
+    }
+  }
+  else if (vt == VT_CLSID)
     res = DISP_E_BADVARTYPE;
   else
   {
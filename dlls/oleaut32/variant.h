@@ -114,6 +114,37 @@ typedef struct tagVARIANT_NUMBER_CHARS
   WCHAR cCurrencyDigitSeparator;
 } VARIANT_NUMBER_CHARS;
 
+/* Types holding their whole value inside the variant, these can be copied
+ * and overwritten without any cleanup */
+static inline BOOL VARIANT_IsScalar(VARTYPE vt)
+{
+  switch (vt)
+  {
+  case VT_EMPTY:
+  case VT_NULL:
+  case VT_I1:
+  case VT_I2:
+  case VT_I4:
+  case VT_I8:
+  case VT_UI1:
+  case VT_UI2:
+  case VT_UI4:
+  case VT_UI8:
+  case VT_INT:
+  case VT_UINT:
+  case VT_R4:
+  case VT_R8:
+  case VT_CY:
+  case VT_DATE:
+  case VT_BOOL:
+  case VT_ERROR:
+  case VT_DECIMAL:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
 unsigned int get_type_size(ULONG*, VARTYPE) DECLSPEC_HIDDEN;
 HRESULT VARIANT_ClearInd(VARIANTARG *) DECLSPEC_HIDDEN;
 BOOL get_date_format(LCID, DWORD, const SYSTEMTIME *,
@@ -6957,6 +6957,67 @@ static void WINAPI NdrBaseTypeFree(PMIDL_STUB_MESSAGE pStubMsg,
    /* nothing to do */
 }
 
+/***********************************************************************
+ *           ndr_simple_type_buffer_size [internal]
+ *
+ * Size a base type whose wire representation is the same as in memory.
+ */
+void ndr_simple_type_buffer_size(PMIDL_STUB_MESSAGE pStubMsg, ULONG size)
+{
+    align_length(&pStubMsg->BufferLength, size);
+    safe_buffer_length_increment(pStubMsg, size);
+}
+
+/***********************************************************************
+ *           ndr_simple_type_marshall [internal]
+ */
+void ndr_simple_type_marshall(PMIDL_STUB_MESSAGE pStubMsg, const unsigned char *pMemory, ULONG size)
+{
+    align_pointer_clear(&pStubMsg->Buffer, size);
+    safe_copy_to_buffer(pStubMsg, pMemory, size);
+}
+
+/***********************************************************************
+ *           ndr_simple_type_unmarshall [internal]
+ *
+ * Unmarshall a base type into existing client memory.
+ */
+void ndr_simple_type_unmarshall(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory, ULONG size)
+{
+    align_pointer(&pStubMsg->Buffer, size);
+    safe_copy_from_buffer(pStubMsg, pMemory, size);
+}
+
+/***********************************************************************
+ *           ndr_simple_carray_buffer_size [internal]
+ *
+ * Size a conformant array of base types without embedded pointers, same
+ * as NdrConformantArrayBufferSize.
+ */
+void ndr_simple_carray_buffer_size(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory,
+                                   PFORMAT_STRING pFormat)
+{
+    ComputeConformance(pStubMsg, pMemory, pFormat + 4, 0);
+    SizeConformance(pStubMsg);
+    align_length(&pStubMsg->BufferLength, pFormat[1] + 1);
+    safe_buffer_length_increment(pStubMsg, safe_multiply(*(const WORD *)(pFormat + 2), pStubMsg->MaxCount));
+}
+
+/***********************************************************************
+ *           ndr_simple_carray_marshall [internal]
+ *
+ * Marshall a conformant array of base types without embedded pointers,
+ * same as NdrConformantArrayMarshall.
+ */
+void ndr_simple_carray_marshall(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory,
+                                PFORMAT_STRING pFormat)
+{
+    ComputeConformance(pStubMsg, pMemory, pFormat + 4, 0);
+    WriteConformance(pStubMsg);
+    align_pointer_clear(&pStubMsg->Buffer, pFormat[1] + 1);
+    safe_copy_to_buffer(pStubMsg, pMemory, safe_multiply(*(const WORD *)(pFormat + 2), pStubMsg->MaxCount));
+}
+
 /***********************************************************************
  *           NdrContextHandleBufferSize [internal]
  */
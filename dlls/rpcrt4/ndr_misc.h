@@ -64,4 +64,12 @@ extern const NDR_FREE       NdrFreer[] DECLSPEC_HIDDEN;
 
 ULONG ComplexStructSize(PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING pFormat) DECLSPEC_HIDDEN;
 
+void ndr_simple_type_buffer_size(PMIDL_STUB_MESSAGE pStubMsg, ULONG size) DECLSPEC_HIDDEN;
+void ndr_simple_type_marshall(PMIDL_STUB_MESSAGE pStubMsg, const unsigned char *pMemory, ULONG size) DECLSPEC_HIDDEN;
+void ndr_simple_type_unmarshall(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory, ULONG size) DECLSPEC_HIDDEN;
+void ndr_simple_carray_buffer_size(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory,
+                                   PFORMAT_STRING pFormat) DECLSPEC_HIDDEN;
+void ndr_simple_carray_marshall(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory,
+                                PFORMAT_STRING pFormat) DECLSPEC_HIDDEN;
+
 #endif  /* __WINE_NDR_MISC_H */
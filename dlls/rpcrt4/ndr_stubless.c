@@ -530,6 +530,311 @@ void client_do_args( PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING pFormat, enum s
     }
 }
 
+/* Procedure plans
+ *
+ * The parameters of a -Oicf procedure are decoded once into a plan that
+ * resolves the type format and the marshalling routines of each of them.
+ * Base types that have the same layout in memory and on the wire are
+ * handled without the routine tables.  Conformant arrays of them are sized
+ * and marshalled directly, but still unmarshalled by the resolved routine,
+ * i.e. NdrConformantArrayUnmarshall. */
+
+enum plan_param_type
+{
+    PLAN_PARAM_GENERIC,
+    PLAN_PARAM_BASETYPE,
+    PLAN_PARAM_CARRAY
+};
+
+struct plan_param
+{
+    PARAM_ATTRIBUTES attr;
+    unsigned short   stack_offset;
+    unsigned char    type;   /* enum plan_param_type */
+    unsigned char    deref;  /* the stack holds a pointer to the parameter */
+    ULONG            size;   /* size of a simple base type */
+    PFORMAT_STRING   format;
+    PFORMAT_STRING   array;  /* FC_CARRAY format of a simple conformant array */
+    NDR_BUFFERSIZE   sizer;
+    NDR_MARSHALL     marshaller;
+    NDR_UNMARSHALL   unmarshaller;
+};
+
+struct proc_plan
+{
+    struct proc_plan     *next;
+    const MIDL_STUB_DESC *stub_desc;
+    PFORMAT_STRING        proc_format;
+    unsigned int          format_size;  /* size of the procedure format, copied after the params */
+    unsigned int          count;
+    struct plan_param     params[1];
+};
+
+#define PLAN_HASH_SIZE 256
+#define MAX_PROC_PLANS 4096
+
+static struct proc_plan *proc_plans[PLAN_HASH_SIZE];
+static unsigned int proc_plan_count;
+
+static CRITICAL_SECTION plan_cs;
+static CRITICAL_SECTION_DEBUG plan_cs_debug =
+{
+    0, 0, &plan_cs,
+    { &plan_cs_debug.ProcessLocksList, &plan_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": plan_cs") }
+};
+static CRITICAL_SECTION plan_cs = { &plan_cs_debug, -1, 0, 0, 0, 0 };
+
+static inline const unsigned char *plan_format( const struct proc_plan *plan )
+{
+    return (const unsigned char *)&plan->params[plan->count];
+}
+
+/* size of base types that are copied as is between memory and the wire */
+static ULONG simple_type_size( unsigned char fc )
+{
+    switch (fc)
+    {
+    case FC_BYTE:
+    case FC_CHAR:
+    case FC_SMALL:
+    case FC_USMALL:
+        return sizeof(UCHAR);
+    case FC_WCHAR:
+    case FC_SHORT:
+    case FC_USHORT:
+        return sizeof(USHORT);
+    case FC_LONG:
+    case FC_ULONG:
+    case FC_ENUM32:
+        return sizeof(ULONG);
+    case FC_FLOAT:
+        return sizeof(float);
+    case FC_DOUBLE:
+        return sizeof(double);
+    case FC_HYPER:
+        return sizeof(ULONGLONG);
+    default:
+        return 0;
+    }
+}
+
+/* conformant array of simple base types without pointers, possibly behind a top-level ref pointer */
+static PFORMAT_STRING get_simple_carray( const MIDL_STUB_MESSAGE *stub_msg, PFORMAT_STRING format )
+{
+    PFORMAT_STRING layout;
+
+    if (format[0] == FC_RP)
+    {
+        if (format[1]) return NULL;
+        format += 2 + *(const SHORT *)(format + 2);
+    }
+    if (format[0] != FC_CARRAY) return NULL;
+    layout = format + 8 + stub_msg->CorrDespIncrement;
+    if (layout[1] != FC_END) return NULL;
+    if (!simple_type_size( layout[0] ) || simple_type_size( layout[0] ) != *(const WORD *)(format + 2))
+        return NULL;
+    return format;
+}
+
+static struct proc_plan *create_proc_plan( const MIDL_STUB_MESSAGE *stub_msg, PFORMAT_STRING proc_format,
+                                           PFORMAT_STRING format, unsigned int count, unsigned int format_size )
+{
+    const NDR_PARAM_OIF *params = (const NDR_PARAM_OIF *)format;
+    struct proc_plan *plan;
+    struct plan_param *param;
+    unsigned int i;
+
+    if (!(plan = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct proc_plan, params[count] ) + format_size )))
+        return NULL;
+
+    plan->stub_desc = stub_msg->StubDesc;
+    plan->proc_format = proc_format;
+    plan->format_size = format_size;
+    plan->count = count;
+    memcpy( (unsigned char *)plan_format( plan ), proc_format, format_size );
+
+    for (i = 0; i < count; i++)
+    {
+        param = &plan->params[i];
+        param->attr = params[i].attr;
+        param->stack_offset = params[i].stack_offset;
+        param->type = PLAN_PARAM_GENERIC;
+        param->size = 0;
+        param->array = NULL;
+
+        if (param->attr.IsBasetype)
+        {
+            param->format = &params[i].u.type_format_char;
+            param->deref = param->attr.IsSimpleRef;
+            param->size = simple_type_size( *param->format );
+#ifdef __x86_64__  /* floats are passed as doubles through varargs functions */
+            if (*param->format == FC_FLOAT && !param->attr.IsSimpleRef) param->size = 0;
+#endif
+            if (param->size) param->type = PLAN_PARAM_BASETYPE;
+        }
+        else
+        {
+            param->format = &stub_msg->StubDesc->pFormatTypes[params[i].u.type_offset];
+            param->deref = !param->attr.IsByValue;
+            if (param->deref && (param->array = get_simple_carray( stub_msg, param->format )))
+                param->type = PLAN_PARAM_CARRAY;
+        }
+
+        param->sizer = NdrBufferSizer[*param->format & NDR_TABLE_MASK];
+        param->marshaller = NdrMarshaller[*param->format & NDR_TABLE_MASK];
+        param->unmarshaller = NdrUnmarshaller[*param->format & NDR_TABLE_MASK];
+        if (!param->sizer || !param->marshaller || !param->unmarshaller)
+        {
+            /* leave the error reporting to the interpreter */
+            HeapFree( GetProcessHeap(), 0, plan );
+            return NULL;
+        }
+
+        TRACE( "param[%u]: type %02x plan %u %s\n", i, *param->format, param->type,
+               debugstr_PROC_PF( param->attr ));
+    }
+    return plan;
+}
+
+/* find the plan of a -Oicf procedure, creating it on first use */
+static const struct proc_plan *get_proc_plan( const MIDL_STUB_MESSAGE *stub_msg, PFORMAT_STRING proc_format,
+                                              PFORMAT_STRING format, unsigned int count )
+{
+    struct proc_plan *plan, *new_plan, **bucket;
+    unsigned int format_size = format + count * sizeof(NDR_PARAM_OIF) - proc_format;
+
+    bucket = &proc_plans[((ULONG_PTR)proc_format >> 2) % PLAN_HASH_SIZE];
+
+    /* plans are never freed, so the buckets can be walked without locking;
+     * the format is compared too since the module may have been reloaded */
+    for (plan = *bucket; plan; plan = plan->next)
+        if (plan->proc_format == proc_format && plan->stub_desc == stub_msg->StubDesc &&
+            plan->format_size == format_size && !memcmp( plan_format( plan ), proc_format, format_size ))
+            return plan;
+
+    if (proc_plan_count >= MAX_PROC_PLANS) return NULL;
+    if (!(new_plan = create_proc_plan( stub_msg, proc_format, format, count, format_size ))) return NULL;
+
+    EnterCriticalSection( &plan_cs );
+    for (plan = *bucket; plan; plan = plan->next)
+        if (plan->proc_format == proc_format && plan->stub_desc == stub_msg->StubDesc &&
+            plan->format_size == format_size && !memcmp( plan_format( plan ), proc_format, format_size ))
+            break;
+    if (!plan && proc_plan_count < MAX_PROC_PLANS)
+    {
+        new_plan->next = *bucket;
+        InterlockedExchangePointer( (void **)bucket, new_plan );
+        proc_plan_count++;
+        plan = new_plan;
+        new_plan = NULL;
+    }
+    LeaveCriticalSection( &plan_cs );
+
+    HeapFree( GetProcessHeap(), 0, new_plan );
+    return plan;
+}
+
+static void client_do_plan_args( PMIDL_STUB_MESSAGE pStubMsg, const struct proc_plan *plan,
+                                 enum stubless_phase phase, void **fpu_args, unsigned char *pRetVal )
+{
+    const struct plan_param *param;
+
+    for (param = plan->params; param < plan->params + plan->count; param++)
+    {
+        unsigned char *pArg = pStubMsg->StackTop + param->stack_offset, *pMemory;
+
+#ifdef __x86_64__  /* floats are passed as doubles through varargs functions */
+        float f;
+
+        if (param->attr.IsBasetype &&
+            *param->format == FC_FLOAT &&
+            !param->attr.IsSimpleRef &&
+            !fpu_args)
+        {
+            f = *(double *)pArg;
+            pArg = (unsigned char *)&f;
+        }
+#endif
+
+        switch (phase)
+        {
+        case STUBLESS_INITOUT:
+            if (*(unsigned char **)pArg)
+            {
+                if (param_needs_alloc(param->attr))
+                    memset( *(unsigned char **)pArg, 0, calc_arg_size( pStubMsg, param->format ));
+                else if (param_is_out_basetype(param->attr))
+                    memset( *(unsigned char **)pArg, 0,
+                            param->size ? param->size : basetype_arg_size( *param->format ));
+            }
+            break;
+        case STUBLESS_CALCSIZE:
+            if (param->attr.IsSimpleRef && !*(unsigned char **)pArg)
+                RpcRaiseException(RPC_X_NULL_REF_POINTER);
+            if (!param->attr.IsIn) break;
+            pMemory = param->deref ? *(unsigned char **)pArg : pArg;
+            switch (param->type)
+            {
+            case PLAN_PARAM_BASETYPE:
+                ndr_simple_type_buffer_size( pStubMsg, param->size );
+                break;
+            case PLAN_PARAM_CARRAY:
+                if (param->array != param->format && !pMemory)
+                    RpcRaiseException(RPC_X_NULL_REF_POINTER);
+                ndr_simple_carray_buffer_size( pStubMsg, pMemory, param->array );
+                break;
+            default:
+                param->sizer( pStubMsg, pMemory, param->format );
+                break;
+            }
+            break;
+        case STUBLESS_MARSHAL:
+            if (!param->attr.IsIn) break;
+            pMemory = param->deref ? *(unsigned char **)pArg : pArg;
+            switch (param->type)
+            {
+            case PLAN_PARAM_BASETYPE:
+                ndr_simple_type_marshall( pStubMsg, pMemory, param->size );
+                break;
+            case PLAN_PARAM_CARRAY:
+                if (param->array != param->format && !pMemory)
+                    RpcRaiseException(RPC_X_NULL_REF_POINTER);
+                ndr_simple_carray_marshall( pStubMsg, pMemory, param->array );
+                break;
+            default:
+                param->marshaller( pStubMsg, pMemory, param->format );
+                break;
+            }
+            break;
+        case STUBLESS_UNMARSHAL:
+            if (!param->attr.IsOut) break;
+            if (param->attr.IsReturn && pRetVal) pArg = pRetVal;
+            if (param->type == PLAN_PARAM_BASETYPE)
+                ndr_simple_type_unmarshall( pStubMsg, param->deref ? *(unsigned char **)pArg : pArg,
+                                            param->size );
+            else
+                param->unmarshaller( pStubMsg, param->deref ? (unsigned char **)pArg : &pArg,
+                                     param->format, 0 );
+            break;
+        case STUBLESS_FREE:
+            if (!param->attr.IsBasetype && param->attr.IsOut && !param->attr.IsByValue)
+                NdrClearOutParameters( pStubMsg, (PFORMAT_STRING)param->format, *(unsigned char **)pArg );
+            break;
+        default:
+            RpcRaiseException(RPC_S_INTERNAL_ERROR);
+        }
+    }
+}
+
+static inline void client_do_phase( PMIDL_STUB_MESSAGE pStubMsg, const struct proc_plan *plan,
+                                    PFORMAT_STRING pFormat, enum stubless_phase phase, void **fpu_args,
+                                    unsigned short number_of_params, unsigned char *pRetVal )
+{
+    if (plan) client_do_plan_args( pStubMsg, plan, phase, fpu_args, pRetVal );
+    else client_do_args( pStubMsg, pFormat, phase, fpu_args, number_of_params, pRetVal );
+}
+
 static unsigned int type_stack_size(unsigned char fc)
 {
     switch (fc)
@@ -675,6 +980,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
     PFORMAT_STRING pHandleFormat;
     /* correlation cache */
     ULONG_PTR NdrCorrCache[256];
+    /* decoded parameters of -Oicf procedures */
+    const struct proc_plan *plan = NULL;
 
     TRACE("pStubDesc %p, pFormat %p, ...\n", pStubDesc, pFormat);
 
@@ -787,6 +1094,9 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
             stubMsg.CorrDespIncrement = 12;
     }
 
+    if (is_oicf_stubdesc(pStubDesc))
+        plan = get_proc_plan(&stubMsg, (PFORMAT_STRING)pProcHeader, pFormat, number_of_params);
+
     /* order of phases:
      * 1. INITOUT - zero [out] parameters (proxies only)
      * 2. CALCSIZE - calculate the buffer size
@@ -803,16 +1113,16 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
         if (pProcHeader->Oi_flags & Oi_OBJECT_PROC)
         {
             TRACE( "INITOUT\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_INITOUT, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, plan, pFormat, STUBLESS_INITOUT, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
         }
 
         __TRY
         {
             /* 2. CALCSIZE */
             TRACE( "CALCSIZE\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, plan, pFormat, STUBLESS_CALCSIZE, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
 
             /* 3. GETBUFFER */
             TRACE( "GETBUFFER\n" );
@@ -842,8 +1152,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
 
             /* 4. MARSHAL */
             TRACE( "MARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, plan, pFormat, STUBLESS_MARSHAL, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
 
             /* 5. SENDRECEIVE */
             TRACE( "SENDRECEIVE\n" );
@@ -880,8 +1190,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
 
             /* 6. UNMARSHAL */
             TRACE( "UNMARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_phase(&stubMsg, plan, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
+                            number_of_params, (unsigned char *)&RetVal);
         }
         __EXCEPT_ALL
         {
@@ -889,8 +1199,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
             {
                 /* 7. FREE */
                 TRACE( "FREE\n" );
-                client_do_args(&stubMsg, pFormat, STUBLESS_FREE, fpu_stack,
-                               number_of_params, (unsigned char *)&RetVal);
+                client_do_phase(&stubMsg, plan, pFormat, STUBLESS_FREE, fpu_stack,
+                                number_of_params, (unsigned char *)&RetVal);
                 RetVal = NdrProxyErrorHandler(GetExceptionCode());
             }
             else
@@ -925,8 +1235,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
     {
         /* 2. CALCSIZE */
         TRACE( "CALCSIZE\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_phase(&stubMsg, plan, pFormat, STUBLESS_CALCSIZE, fpu_stack,
+                        number_of_params, (unsigned char *)&RetVal);
 
         /* 3. GETBUFFER */
         TRACE( "GETBUFFER\n" );
@@ -947,8 +1257,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
 
         /* 4. MARSHAL */
         TRACE( "MARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_phase(&stubMsg, plan, pFormat, STUBLESS_MARSHAL, fpu_stack,
+                        number_of_params, (unsigned char *)&RetVal);
 
         /* 5. SENDRECEIVE */
         TRACE( "SENDRECEIVE\n" );
@@ -974,8 +1284,8 @@ LONG_PTR CDECL DECLSPEC_HIDDEN ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORM
 
         /* 6. UNMARSHAL */
         TRACE( "UNMARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_phase(&stubMsg, plan, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
+                        number_of_params, (unsigned char *)&RetVal);
     }
 
     if (ext_flags.HasNewCorrDesc)
@@ -69,8 +69,15 @@ typedef struct _RpcConnection_np
     IO_STATUS_BLOCK io_status;
     HANDLE event_cache;
     BOOL read_closed;
+    /* ncalrpc shared memory transport */
+    HANDLE shm_marker;
+    struct lrpc_shm *shm;
+    BOOL shm_checked;
 } RpcConnection_np;
 
+static void lrpc_shm_connect(RpcConnection_np *npc);
+static HANDLE lrpc_shm_create_marker(const char *endpoint);
+
 static RpcConnection *rpcrt4_conn_np_alloc(void)
 {
   RpcConnection_np *npc = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(RpcConnection_np));
@@ -200,6 +207,9 @@ static RPC_STATUS rpcrt4_ncalrpc_open(RpcConnection* Connection)
   r = rpcrt4_conn_open_pipe(Connection, pname, TRUE);
   I_RpcFree(pname);
 
+  if (r == RPC_S_OK)
+    lrpc_shm_connect(npc);
+
   return r;
 }
 
@@ -226,6 +236,8 @@ static RPC_STATUS rpcrt4_protseq_ncalrpc_open_endpoint(RpcServerProtseq* protseq
 
   ((RpcConnection_np*)Connection)->listen_pipe = ncalrpc_pipe_name(Connection->Endpoint);
   r = rpcrt4_conn_create_pipe(Connection);
+  if (r == RPC_S_OK)
+    ((RpcConnection_np*)Connection)->shm_marker = lrpc_shm_create_marker(Connection->Endpoint);
 
   EnterCriticalSection(&protseq->cs);
   list_add_head(&protseq->listeners, &Connection->protseq_entry);
@@ -446,6 +458,11 @@ static int rpcrt4_conn_np_close(RpcConnection *conn)
         CloseHandle(connection->event_cache);
         connection->event_cache = 0;
     }
+    if (connection->shm_marker)
+    {
+        CloseHandle(connection->shm_marker);
+        connection->shm_marker = 0;
+    }
     return 0;
 }
 
@@ -470,6 +487,408 @@ static int rpcrt4_conn_np_wait_for_incoming_data(RpcConnection *Connection)
     return -1;
 }
 
+/**** ncalrpc shared memory support ****/
+
+/* Once an ncalrpc connection is established over the named pipe, the client
+ * offers a pair of ring buffers in a shared section with a hello packet.  If
+ * the server accepts it, the packets are exchanged through the rings and the
+ * pipe is only kept for impersonation.  The reader spins for a short while
+ * before sleeping on an event, and the writer only signals the event when the
+ * reader sleeps, so back to back calls don't go through the wineserver. */
+
+#define LRPC_RING_SIZE   0x10000   /* must be a power of 2 */
+#define LRPC_SPIN_COUNT  100
+
+/* like CancelIoEx on the pipe, a cancel only affects a read or write in progress */
+enum lrpc_io_state
+{
+    LRPC_IO_IDLE,
+    LRPC_IO_ACTIVE,
+    LRPC_IO_CANCELLED
+};
+
+struct lrpc_ring
+{
+    ULONG volatile head;           /* total bytes written, wraps around */
+    ULONG volatile tail;           /* total bytes read, wraps around */
+    LONG volatile reader_waiting;
+    LONG volatile writer_waiting;
+    LONG volatile closed;
+    char data[LRPC_RING_SIZE];
+};
+
+struct lrpc_shm_view
+{
+    struct lrpc_ring ring[2];      /* client to server, server to client */
+};
+
+struct lrpc_shm
+{
+    HANDLE mapping;
+    struct lrpc_shm_view *view;
+    struct lrpc_ring *in, *out;
+    HANDLE in_data, in_space;      /* signaled when data is written, and read */
+    HANDLE out_data, out_space;
+    HANDLE peer;                   /* the process at the other end */
+    LONG io_state;                 /* enum lrpc_io_state */
+};
+
+/* sent over the pipe, never a valid packet header because of rpc_ver */
+struct lrpc_hello
+{
+    unsigned char magic[4];
+    DWORD pid;
+    DWORD id;
+    DWORD status;
+};
+
+C_ASSERT(sizeof(struct lrpc_hello) == sizeof(RpcPktCommonHdr));
+
+static const unsigned char lrpc_hello_magic[4] = { 0xff, 'S', 'H', 'M' };
+
+static char *lrpc_shm_marker_name(const char *endpoint)
+{
+    static const char prefix[] = "wine_lrpc_ep_";
+    char *name, *p;
+
+    if (!(name = I_RpcAllocate(sizeof(prefix) + strlen(endpoint))))
+        return NULL;
+    strcat(strcpy(name, prefix), endpoint);
+    for (p = name; *p; p++) if (*p == '\\') *p = '_';
+    return name;
+}
+
+/* the listener keeps a named event to tell clients that it accepts shared memory */
+static HANDLE lrpc_shm_create_marker(const char *endpoint)
+{
+    HANDLE marker;
+    char *name;
+
+    if (!(name = lrpc_shm_marker_name(endpoint)))
+        return 0;
+    marker = CreateEventA(NULL, TRUE, FALSE, name);
+    I_RpcFree(name);
+    return marker;
+}
+
+static void lrpc_shm_free(struct lrpc_shm *shm)
+{
+    if (shm->view)
+    {
+        /* wake up the other end */
+        InterlockedExchange(&shm->out->closed, TRUE);
+        InterlockedExchange(&shm->in->closed, TRUE);
+        if (shm->out_data) SetEvent(shm->out_data);
+        if (shm->in_space) SetEvent(shm->in_space);
+        UnmapViewOfFile(shm->view);
+    }
+    if (shm->mapping) CloseHandle(shm->mapping);
+    if (shm->in_data) CloseHandle(shm->in_data);
+    if (shm->in_space) CloseHandle(shm->in_space);
+    if (shm->out_data) CloseHandle(shm->out_data);
+    if (shm->out_space) CloseHandle(shm->out_space);
+    if (shm->peer) CloseHandle(shm->peer);
+    HeapFree(GetProcessHeap(), 0, shm);
+}
+
+/* the client creates the objects, the server opens them */
+static struct lrpc_shm *lrpc_shm_open(DWORD pid, DWORD id, BOOL server)
+{
+    struct lrpc_shm *shm;
+    HANDLE *events[4];
+    char name[40];
+    int i;
+
+    if (!(shm = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*shm))))
+        return NULL;
+
+    sprintf(name, "wine_lrpc_%08x_%08x", pid, id);
+    if (server)
+        shm->mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name);
+    else
+    {
+        shm->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                          sizeof(*shm->view), name);
+        if (shm->mapping && GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            CloseHandle(shm->mapping);
+            shm->mapping = 0;
+        }
+    }
+    if (!shm->mapping || !(shm->view = MapViewOfFile(shm->mapping, FILE_MAP_READ | FILE_MAP_WRITE,
+                                                     0, 0, sizeof(*shm->view))))
+        goto failed;
+
+    shm->in = &shm->view->ring[server ? 0 : 1];
+    shm->out = &shm->view->ring[server ? 1 : 0];
+    events[0] = server ? &shm->in_data : &shm->out_data;
+    events[1] = server ? &shm->in_space : &shm->out_space;
+    events[2] = server ? &shm->out_data : &shm->in_data;
+    events[3] = server ? &shm->out_space : &shm->in_space;
+    for (i = 0; i < 4; i++)
+    {
+        sprintf(name, "wine_lrpc_%08x_%08x_%d", pid, id, i);
+        if (server)
+            *events[i] = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, name);
+        else
+        {
+            *events[i] = CreateEventA(NULL, FALSE, FALSE, name);
+            if (*events[i] && GetLastError() == ERROR_ALREADY_EXISTS)
+            {
+                CloseHandle(*events[i]);
+                *events[i] = 0;
+            }
+        }
+        if (!*events[i])
+            goto failed;
+    }
+    return shm;
+
+failed:
+    WARN("failed to set up shared memory, error %u\n", GetLastError());
+    lrpc_shm_free(shm);
+    return NULL;
+}
+
+/* wait for the other end to change *counter from value, returns FALSE if it died */
+static BOOL lrpc_shm_wait(struct lrpc_shm *shm, struct lrpc_ring *ring, ULONG volatile *counter,
+                          ULONG value, LONG volatile *waiting, HANDLE event)
+{
+    HANDLE handles[2];
+    DWORD ret = WAIT_OBJECT_0;
+    int i;
+
+    for (i = 0; i < LRPC_SPIN_COUNT; i++)
+    {
+        if (*counter != value || ring->closed || shm->io_state == LRPC_IO_CANCELLED)
+            return TRUE;
+        SwitchToThread();
+    }
+
+    handles[0] = event;
+    handles[1] = shm->peer;
+    InterlockedExchange(waiting, TRUE);
+    if (*counter == value && !ring->closed && shm->io_state != LRPC_IO_CANCELLED)
+        ret = WaitForMultipleObjects(shm->peer ? 2 : 1, handles, FALSE, INFINITE);
+    InterlockedExchange(waiting, FALSE);
+    return ret == WAIT_OBJECT_0;
+}
+
+static int lrpc_shm_read(RpcConnection_np *npc, void *buffer, unsigned int count)
+{
+    struct lrpc_shm *shm = npc->shm;
+    struct lrpc_ring *ring = shm->in;
+    char *data = buffer;
+    unsigned int done = 0, len, pos;
+    ULONG head;
+
+    InterlockedExchange(&shm->io_state, LRPC_IO_ACTIVE);
+    while (done < count)
+    {
+        if (npc->read_closed || shm->io_state == LRPC_IO_CANCELLED)
+            break;
+
+        /* the interlocked read orders the data reads after it */
+        head = InterlockedCompareExchange((LONG volatile *)&ring->head, 0, 0);
+        if (!(len = head - ring->tail))
+        {
+            if (ring->closed || !lrpc_shm_wait(shm, ring, &ring->head, head, &ring->reader_waiting, shm->in_data))
+                break;
+            continue;
+        }
+
+        len = min(len, count - done);
+        pos = ring->tail & (LRPC_RING_SIZE - 1);
+        if (pos + len > LRPC_RING_SIZE)
+        {
+            memcpy(data + done, ring->data + pos, LRPC_RING_SIZE - pos);
+            memcpy(data + done + LRPC_RING_SIZE - pos, ring->data, len - (LRPC_RING_SIZE - pos));
+        }
+        else
+            memcpy(data + done, ring->data + pos, len);
+        InterlockedExchangeAdd((LONG volatile *)&ring->tail, len);
+        if (InterlockedCompareExchange(&ring->writer_waiting, FALSE, TRUE))
+            SetEvent(shm->in_space);
+        done += len;
+    }
+    InterlockedExchange(&shm->io_state, LRPC_IO_IDLE);
+    return done < count ? -1 : done;
+}
+
+static int lrpc_shm_write(struct lrpc_shm *shm, const void *buffer, unsigned int count)
+{
+    struct lrpc_ring *ring = shm->out;
+    const char *data = buffer;
+    unsigned int done = 0, len, pos;
+    ULONG tail;
+
+    InterlockedExchange(&shm->io_state, LRPC_IO_ACTIVE);
+    while (done < count)
+    {
+        if (ring->closed || shm->io_state == LRPC_IO_CANCELLED)
+            break;
+
+        tail = InterlockedCompareExchange((LONG volatile *)&ring->tail, 0, 0);
+        if (!(len = LRPC_RING_SIZE - (ring->head - tail)))
+        {
+            if (!lrpc_shm_wait(shm, ring, &ring->tail, tail, &ring->writer_waiting, shm->out_space))
+                break;
+            continue;
+        }
+
+        len = min(len, count - done);
+        pos = ring->head & (LRPC_RING_SIZE - 1);
+        if (pos + len > LRPC_RING_SIZE)
+        {
+            memcpy(ring->data + pos, data + done, LRPC_RING_SIZE - pos);
+            memcpy(ring->data, data + done + LRPC_RING_SIZE - pos, len - (LRPC_RING_SIZE - pos));
+        }
+        else
+            memcpy(ring->data + pos, data + done, len);
+        InterlockedExchangeAdd((LONG volatile *)&ring->head, len);
+        if (InterlockedCompareExchange(&ring->reader_waiting, FALSE, TRUE))
+            SetEvent(shm->out_data);
+        done += len;
+    }
+    InterlockedExchange(&shm->io_state, LRPC_IO_IDLE);
+    return done < count ? -1 : count;
+}
+
+static void lrpc_shm_connect(RpcConnection_np *npc)
+{
+    static LONG lrpc_shm_id;
+    struct lrpc_hello hello;
+    struct lrpc_shm *shm;
+    HANDLE marker;
+    ULONG pid;
+    char *name;
+
+    if (!(name = lrpc_shm_marker_name(npc->common.Endpoint)))
+        return;
+    marker = OpenEventA(SYNCHRONIZE, FALSE, name);
+    I_RpcFree(name);
+    if (!marker)
+        return;
+    CloseHandle(marker);
+
+    memcpy(hello.magic, lrpc_hello_magic, sizeof(hello.magic));
+    hello.pid = GetCurrentProcessId();
+    hello.id = InterlockedIncrement(&lrpc_shm_id);
+    hello.status = 0;
+    if (!(shm = lrpc_shm_open(hello.pid, hello.id, FALSE)))
+        return;
+
+    /* the server answers with a failure status, or 0 if it opened the objects */
+    if (rpcrt4_conn_np_write(&npc->common, &hello, sizeof(hello)) != sizeof(hello) ||
+        rpcrt4_conn_np_read(&npc->common, &hello, sizeof(hello)) != sizeof(hello) ||
+        memcmp(hello.magic, lrpc_hello_magic, sizeof(hello.magic)) || hello.status)
+    {
+        lrpc_shm_free(shm);
+        return;
+    }
+
+    /* the peer is the process at the other end of the pipe, whatever it claims */
+    if (GetNamedPipeServerProcessId(npc->pipe, &pid))
+        shm->peer = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    npc->shm = shm;
+    TRACE("using shared memory for %s\n", debugstr_a(npc->common.Endpoint));
+}
+
+static void lrpc_shm_accept(RpcConnection_np *npc, const struct lrpc_hello *hello)
+{
+    struct lrpc_hello reply;
+    struct lrpc_shm *shm = NULL;
+    ULONG pid;
+
+    /* only accept objects named after the process at the other end of the pipe */
+    if (!GetNamedPipeClientProcessId(npc->pipe, &pid) || pid != hello->pid)
+        WARN("client claims to be process %04x\n", hello->pid);
+    else if ((shm = lrpc_shm_open(pid, hello->id, TRUE)))
+        shm->peer = OpenProcess(SYNCHRONIZE, FALSE, pid);
+
+    memcpy(reply.magic, lrpc_hello_magic, sizeof(reply.magic));
+    reply.pid = GetCurrentProcessId();
+    reply.id = hello->id;
+    reply.status = shm ? 0 : 1;
+    if (rpcrt4_conn_np_write(&npc->common, &reply, sizeof(reply)) != sizeof(reply))
+    {
+        if (shm) lrpc_shm_free(shm);
+        return;
+    }
+    npc->shm = shm;
+}
+
+static int rpcrt4_ncalrpc_read(RpcConnection *conn, void *buffer, unsigned int count)
+{
+    RpcConnection_np *npc = (RpcConnection_np *)conn;
+    int ret;
+
+    if (npc->shm)
+        return lrpc_shm_read(npc, buffer, count);
+
+    ret = rpcrt4_conn_np_read(conn, buffer, count);
+    if (conn->server && !npc->shm_checked)
+    {
+        /* the first packet from the client may offer shared memory */
+        npc->shm_checked = TRUE;
+        if (ret == sizeof(struct lrpc_hello) && !memcmp(buffer, lrpc_hello_magic, sizeof(lrpc_hello_magic)))
+        {
+            struct lrpc_hello hello;
+
+            memcpy(&hello, buffer, sizeof(hello));
+            lrpc_shm_accept(npc, &hello);
+            return rpcrt4_ncalrpc_read(conn, buffer, count);
+        }
+    }
+    return ret;
+}
+
+static int rpcrt4_ncalrpc_write(RpcConnection *conn, const void *buffer, unsigned int count)
+{
+    RpcConnection_np *npc = (RpcConnection_np *)conn;
+
+    if (npc->shm)
+        return lrpc_shm_write(npc->shm, buffer, count);
+    return rpcrt4_conn_np_write(conn, buffer, count);
+}
+
+static int rpcrt4_ncalrpc_close(RpcConnection *conn)
+{
+    RpcConnection_np *npc = (RpcConnection_np *)conn;
+
+    if (npc->shm)
+    {
+        lrpc_shm_free(npc->shm);
+        npc->shm = NULL;
+    }
+    return rpcrt4_conn_np_close(conn);
+}
+
+static void rpcrt4_ncalrpc_close_read(RpcConnection *conn)
+{
+    RpcConnection_np *npc = (RpcConnection_np *)conn;
+
+    rpcrt4_conn_np_close_read(conn);
+    if (npc->shm)
+        SetEvent(npc->shm->in_data);
+}
+
+static void rpcrt4_ncalrpc_cancel_call(RpcConnection *conn)
+{
+    RpcConnection_np *npc = (RpcConnection_np *)conn;
+
+    if (npc->shm)
+    {
+        if (InterlockedCompareExchange(&npc->shm->io_state, LRPC_IO_CANCELLED, LRPC_IO_ACTIVE) != LRPC_IO_ACTIVE)
+            return;
+        /* wake up a reader waiting for the reply, or a writer waiting for space */
+        SetEvent(npc->shm->in_data);
+        SetEvent(npc->shm->out_space);
+    }
+    else
+        rpcrt4_conn_np_cancel_call(conn);
+}
+
 static size_t rpcrt4_ncacn_np_get_top_of_tower(unsigned char *tower_data,
                                                const char *networkaddr,
                                                const char *endpoint)
@@ -3160,11 +3579,11 @@ static const struct connection_ops conn_protseq_list[] = {
     rpcrt4_conn_np_alloc,
     rpcrt4_ncalrpc_open,
     rpcrt4_ncalrpc_handoff,
-    rpcrt4_conn_np_read,
-    rpcrt4_conn_np_write,
-    rpcrt4_conn_np_close,
-    rpcrt4_conn_np_close_read,
-    rpcrt4_conn_np_cancel_call,
+    rpcrt4_ncalrpc_read,
+    rpcrt4_ncalrpc_write,
+    rpcrt4_ncalrpc_close,
+    rpcrt4_ncalrpc_close_read,
+    rpcrt4_ncalrpc_cancel_call,
     rpcrt4_ncalrpc_np_is_server_listening,
     rpcrt4_conn_np_wait_for_incoming_data,
     rpcrt4_ncalrpc_get_top_of_tower,
@@ -1268,6 +1268,14 @@ static int WINAPI test1_square(ITest1 *iface, int x)
     return x * x;
 }
 
+static int WINAPI test1_sum(ITest1 *iface, int count, int *values)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < count; i++) ret += values[i];
+    return ret;
+}
+
 static const ITest1Vtbl test1_vtbl =
 {
     test1_QueryInterface,
@@ -1275,6 +1283,7 @@ static const ITest1Vtbl test1_vtbl =
     test1_Release,
     test1_GetClassID,
     test1_square,
+    test1_sum,
 };
 
 static HRESULT WINAPI test_cf_QueryInterface(IClassFactory *iface, REFIID iid, void **out)
@@ -1415,6 +1424,144 @@ static void test_delegated_methods(void)
     ok(hr == S_OK, "got %#x\n", hr);
 }
 
+/* channel answering ITest1 calls in place, to time the proxy marshalling alone */
+static HRESULT WINAPI loopback_chan_QueryInterface(IRpcChannelBuffer *iface, REFIID iid, void **out)
+{
+    if (IsEqualGUID(iid, &IID_IUnknown) || IsEqualGUID(iid, &IID_IRpcChannelBuffer))
+    {
+        *out = iface;
+        return S_OK;
+    }
+    *out = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI loopback_chan_AddRef(IRpcChannelBuffer *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI loopback_chan_Release(IRpcChannelBuffer *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI loopback_chan_GetBuffer(IRpcChannelBuffer *iface, RPCOLEMESSAGE *msg, REFIID iid)
+{
+    msg->Buffer = HeapAlloc(GetProcessHeap(), 0, max(msg->cbBuffer, sizeof(int)));
+    return S_OK;
+}
+
+static HRESULT WINAPI loopback_chan_SendReceive(IRpcChannelBuffer *iface, RPCOLEMESSAGE *msg, ULONG *status)
+{
+    int *buffer = msg->Buffer, ret = 0, i;
+
+    switch (msg->iMethod)
+    {
+    case 4:  /* square */
+        ret = buffer[0] * buffer[0];
+        break;
+    case 5:  /* sum, the count is followed by the array conformance and data */
+        ok(buffer[0] == buffer[1], "got count %d conformance %d\n", buffer[0], buffer[1]);
+        for (i = 0; i < buffer[1]; i++) ret += buffer[2 + i];
+        break;
+    default:
+        ok(0, "unexpected method %u\n", msg->iMethod);
+        break;
+    }
+    buffer[0] = ret;
+    msg->cbBuffer = sizeof(int);
+    msg->dataRepresentation = NDR_LOCAL_DATA_REPRESENTATION;
+    *status = 0;
+    return S_OK;
+}
+
+static HRESULT WINAPI loopback_chan_FreeBuffer(IRpcChannelBuffer *iface, RPCOLEMESSAGE *msg)
+{
+    HeapFree(GetProcessHeap(), 0, msg->Buffer);
+    msg->Buffer = NULL;
+    return S_OK;
+}
+
+static HRESULT WINAPI loopback_chan_GetDestCtx(IRpcChannelBuffer *iface, DWORD *dest_context, void **dest_context_data)
+{
+    *dest_context = MSHCTX_LOCAL;
+    *dest_context_data = NULL;
+    return S_OK;
+}
+
+static HRESULT WINAPI loopback_chan_IsConnected(IRpcChannelBuffer *iface)
+{
+    return S_OK;
+}
+
+static const IRpcChannelBufferVtbl loopback_chan_vtbl =
+{
+    loopback_chan_QueryInterface,
+    loopback_chan_AddRef,
+    loopback_chan_Release,
+    loopback_chan_GetBuffer,
+    loopback_chan_SendReceive,
+    loopback_chan_FreeBuffer,
+    loopback_chan_GetDestCtx,
+    loopback_chan_IsConnected
+};
+
+static IRpcChannelBuffer loopback_chan = { (IRpcChannelBufferVtbl *)&loopback_chan_vtbl };
+
+static void test_marshal_throughput(void)
+{
+    static const int calls = 100000, array_calls = 2000, array_count = 4096;
+    IRpcProxyBuffer *proxy;
+    IPSFactoryBuffer *ps;
+    ITest1 *test_obj;
+    DWORD start, square_time, sum_time;
+    int i, ret, sum = 0, *values;
+    HRESULT hr;
+
+    hr = NdrDllGetClassObject(&CLSID_test_ps, &IID_IPSFactoryBuffer, (void **)&ps,
+        &aProxyFileList, &CLSID_test_ps, &gPFactory);
+    ok(hr == S_OK, "got %#x\n", hr);
+
+    hr = IPSFactoryBuffer_CreateProxy(ps, NULL, &IID_ITest1, &proxy, (void **)&test_obj);
+    ok(hr == S_OK, "got %#x\n", hr);
+    hr = IRpcProxyBuffer_Connect(proxy, &loopback_chan);
+    ok(hr == S_OK, "got %#x\n", hr);
+
+    ret = ITest1_square(test_obj, 7);
+    ok(ret == 49, "got %d\n", ret);
+
+    start = GetTickCount();
+    for (i = 0; i < calls; i++)
+        if (ITest1_square(test_obj, i & 0xff) != (i & 0xff) * (i & 0xff)) break;
+    square_time = GetTickCount() - start;
+    ok(i == calls, "square failed after %d calls\n", i);
+
+    values = HeapAlloc(GetProcessHeap(), 0, array_count * sizeof(*values));
+    for (i = 0; i < array_count; i++)
+    {
+        values[i] = i & 0xff;
+        sum += values[i];
+    }
+    ret = ITest1_sum(test_obj, 3, values + 1);
+    ok(ret == 6, "got %d\n", ret);
+
+    start = GetTickCount();
+    for (i = 0; i < array_calls; i++)
+        if (ITest1_sum(test_obj, array_count, values) != sum) break;
+    sum_time = GetTickCount() - start;
+    ok(i == array_calls, "sum failed after %d calls\n", i);
+    HeapFree(GetProcessHeap(), 0, values);
+
+    trace("%d square calls in %u ms, %d sum calls of %d ints in %u ms\n",
+          calls, square_time, array_calls, array_count, sum_time);
+
+    IRpcProxyBuffer_Disconnect(proxy);
+    ITest1_Release(test_obj);
+    IRpcProxyBuffer_Release(proxy);
+    IPSFactoryBuffer_Release(ps);
+}
+
 START_TEST( cstub )
 {
     IPSFactoryBuffer *ppsf;
@@ -1440,6 +1587,7 @@ START_TEST( cstub )
     test_delegating_Invoke(ppsf);
     test_NdrDllRegisterProxy();
     test_delegated_methods();
+    test_marshal_throughput();
 
     OleUninitialize();
 }
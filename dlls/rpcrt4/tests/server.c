@@ -844,6 +844,11 @@ void __cdecl s_stop(void)
   }
 }
 
+void __cdecl s_sleep_for(int ms)
+{
+  Sleep(ms);
+}
+
 void __cdecl s_stop_autolisten(void)
 {
     RPC_STATUS status;
@@ -1616,6 +1621,106 @@ run_tests(void)
   context_handle_test();
 }
 
+static void
+performance_tests(const char *protseq)
+{
+  static const int bulk_count = 64 * 1024;
+  DWORD start, ping_time, bulk_time;
+  int i, *bulk, sum = 0, calls = 2000, bulk_calls = 200;
+
+  start = GetTickCount();
+  for (i = 0; i < calls; i++)
+    if (int_return() != INT_CODE) break;
+  ping_time = GetTickCount() - start;
+  ok(i == calls, "RPC int_return failed after %d calls\n", i);
+
+  bulk = HeapAlloc(GetProcessHeap(), 0, bulk_count * sizeof(*bulk));
+  for (i = 0; i < bulk_count; i++)
+  {
+    bulk[i] = i & 0xff;
+    sum += bulk[i];
+  }
+  start = GetTickCount();
+  for (i = 0; i < bulk_calls; i++)
+    if (sum_conf_array(bulk, bulk_count) != sum) break;
+  bulk_time = GetTickCount() - start;
+  ok(i == bulk_calls, "RPC sum_conf_array failed after %d calls\n", i);
+  HeapFree(GetProcessHeap(), 0, bulk);
+
+  trace("%s: %d round trips in %u ms, %u KB sent in %u ms\n", protseq, calls, ping_time,
+        (DWORD)(bulk_calls * bulk_count * sizeof(*bulk) / 1024), bulk_time);
+}
+
+static void
+large_message_tests(void)
+{
+  /* more than the size of the ncalrpc shared memory rings in both directions */
+  static const int count = 3 * 0x10000 / sizeof(int) + 7;
+  doub_carr_t *dc;
+  int i, *x, sum = 0;
+
+  x = HeapAlloc(GetProcessHeap(), 0, count * sizeof(*x));
+  for (i = 0; i < count; i++)
+  {
+    x[i] = i % 1000;
+    sum += x[i];
+  }
+  ok(sum_conf_array(x, count) == sum, "RPC sum_conf_array\n");
+  HeapFree(GetProcessHeap(), 0, x);
+
+  dc = NULL;
+  make_pyramid_doub_carr(255, &dc);
+  ok(dc->n == 255, "RPC make_pyramid_doub_carr returned %d arrays\n", dc->n);
+  ok(check_pyramid_doub_carr(dc), "RPC make_pyramid_doub_carr\n");
+  free_pyramid_doub_carr(dc);
+}
+
+static DWORD WINAPI cancel_call_thread(void *arg)
+{
+  DWORD status = RPC_S_OK;
+
+  RpcMgmtSetCancelTimeout(0);
+  RpcTryExcept
+  {
+    sleep_for(3000);
+  }
+  RpcExcept(EXCEPTION_EXECUTE_HANDLER)
+  {
+    status = RpcExceptionCode();
+  }
+  RpcEndExcept
+  return status;
+}
+
+static void
+cancel_tests(void)
+{
+  DWORD ret, status;
+  HANDLE thread;
+  int i;
+
+  thread = CreateThread(NULL, 0, cancel_call_thread, NULL, 0, NULL);
+  ok(thread != NULL, "CreateThread failed with error %u\n", GetLastError());
+  Sleep(500); /* let the call reach the server */
+
+  ok(RpcCancelThread(thread) == RPC_S_OK, "RpcCancelThread failed\n");
+  ret = WaitForSingleObject(thread, 2000);
+  ok(ret == WAIT_OBJECT_0, "cancelled call didn't return\n");
+  if (ret != WAIT_OBJECT_0) WaitForSingleObject(thread, INFINITE);
+  GetExitCodeThread(thread, &status);
+  ok(status == RPC_S_CALL_CANCELLED || status == RPC_S_CALL_FAILED,
+     "cancelled call returned %u\n", status);
+  CloseHandle(thread);
+
+  /* a cancel while no call is in progress must not affect the next calls */
+  for (i = 0; i < 100; i++)
+  {
+    ok(RpcCancelThread(GetCurrentThread()) == RPC_S_OK, "RpcCancelThread failed\n");
+    if (int_return() != INT_CODE) break;
+  }
+  ok(i == 100, "RPC int_return failed after %d calls\n", i);
+}
+
 static void
 set_auth_info(RPC_BINDING_HANDLE handle)
 {
@@ -1696,6 +1801,9 @@ client(const char *test)
     ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
     run_tests(); /* can cause RPC_X_BAD_STUB_DATA exception */
+    large_message_tests();
+    cancel_tests();
+    performance_tests("ncalrpc");
     authinfo_test(RPC_PROTSEQ_LRPC, 0);
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
 
@@ -1737,6 +1845,7 @@ todo_wine
 
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
     run_tests();
+    performance_tests("ncacn_np");
     authinfo_test(RPC_PROTSEQ_NMP, 0);
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
     stop();
@@ -30,6 +30,12 @@
 
 #include "tomcrypt.h"
 
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <wmmintrin.h>
+#define HAVE_AES_NI
+#endif
+
 static const ulong32 TE0[256] = {
     0xc66363a5UL, 0xf87c7c84UL, 0xee777799UL, 0xf67b7b8dUL,
     0xfff2f20dUL, 0xd66b6bbdUL, 0xde6f6fb1UL, 0x91c5c554UL,
@@ -934,6 +940,68 @@ static ulong32 setup_mix(ulong32 temp)
           (Te4_0[byte(temp, 3)]);
 }
 
+#ifdef HAVE_AES_NI
+
+static inline void do_cpuid(unsigned int ax, unsigned int *p)
+{
+#ifdef __i386__
+    __asm__("pushl %%ebx\n\t"
+            "cpuid\n\t"
+            "movl %%ebx, %%esi\n\t"
+            "popl %%ebx"
+            : "=a" (p[0]), "=S" (p[1]), "=c" (p[2]), "=d" (p[3])
+            : "0" (ax), "2" (0));
+#else
+    __asm__("cpuid"
+            : "=a" (p[0]), "=b" (p[1]), "=c" (p[2]), "=d" (p[3])
+            : "0" (ax), "2" (0));
+#endif
+}
+
+static int have_aes_ni(void)
+{
+    static int supported = -1;
+
+    if (supported == -1) {
+        unsigned int regs[4];
+
+        do_cpuid(1, regs);
+        supported = (regs[2] & (1 << 25)) != 0;
+    }
+    return supported;
+}
+
+/* The round keys produced by aes_setup are already in the layout the AES
+ * instructions expect (dK is the equivalent inverse cipher schedule), they
+ * just have to be stored in byte order. */
+static void __attribute__((target("aes,sse2"))) aes_ni_encrypt(const unsigned char *pt, unsigned char *ct, const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->eKb;
+    __m128i s;
+    int r;
+
+    s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pt), _mm_loadu_si128(rk));
+    for (r = 1; r < skey->Nr; r++)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(rk + r));
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128(rk + r));
+    _mm_storeu_si128((__m128i *)ct, s);
+}
+
+static void __attribute__((target("aes,sse2"))) aes_ni_decrypt(const unsigned char *ct, unsigned char *pt, const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->dKb;
+    __m128i s;
+    int r;
+
+    s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ct), _mm_loadu_si128(rk));
+    for (r = 1; r < skey->Nr; r++)
+        s = _mm_aesdec_si128(s, _mm_loadu_si128(rk + r));
+    s = _mm_aesdeclast_si128(s, _mm_loadu_si128(rk + r));
+    _mm_storeu_si128((__m128i *)pt, s);
+}
+
+#endif /* HAVE_AES_NI */
+
 int aes_setup(const unsigned char *key, int keylen, int rounds, aes_key *skey)
 {
     int i, j;
@@ -1058,6 +1126,17 @@ int aes_setup(const unsigned char *key, int keylen, int rounds, aes_key *skey)
     *rk++ = *rrk++;
     *rk   = *rrk;
 
+    skey->use_ni = 0;
+#ifdef HAVE_AES_NI
+    if (have_aes_ni()) {
+        for (i = 0; i < 4 * (skey->Nr + 1); i++) {
+            STORE32H(skey->eK[i], skey->eKb + 4 * i);
+            STORE32H(skey->dK[i], skey->dKb + 4 * i);
+        }
+        skey->use_ni = 1;
+    }
+#endif
+
     return CRYPT_OK;
 }
 
@@ -1066,6 +1145,13 @@ void aes_ecb_encrypt(const unsigned char *pt, unsigned char *ct, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef HAVE_AES_NI
+    if (skey->use_ni) {
+        aes_ni_encrypt(pt, ct, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->eK;
 
@@ -1167,6 +1253,13 @@ void aes_ecb_decrypt(const unsigned char *ct, unsigned char *pt, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef HAVE_AES_NI
+    if (skey->use_ni) {
+        aes_ni_decrypt(ct, pt, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->dK;
 
@@ -1252,6 +1252,96 @@ static void test_aes(int keylen)
     ok(result, "%08x\n", GetLastError());
 }
 
+static void test_aes_vectors(void)
+{
+    /* FIPS-197 appendix C */
+    static const BYTE plain[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    static const struct
+    {
+        ALG_ID alg;
+        DWORD key_len;
+        BYTE cipher[16];
+    }
+    tests[] =
+    {
+        { CALG_AES_128, 16, { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+                              0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a } },
+        { CALG_AES_192, 24, { 0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0,
+                              0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91 } },
+        { CALG_AES_256, 32, { 0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+                              0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89 } }
+    };
+    struct
+    {
+        BLOBHEADER header;
+        DWORD key_len;
+        BYTE key[32];
+    } blob;
+    HCRYPTKEY hKey;
+    BYTE data[64], *big;
+    DWORD i, j, len, mode;
+    BOOL result;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        blob.header.bType = PLAINTEXTKEYBLOB;
+        blob.header.bVersion = CUR_BLOB_VERSION;
+        blob.header.reserved = 0;
+        blob.header.aiKeyAlg = tests[i].alg;
+        blob.key_len = tests[i].key_len;
+        for (j = 0; j < sizeof(blob.key); j++) blob.key[j] = j;
+
+        result = CryptImportKey(hProv, (BYTE *)&blob, sizeof(blob.header) + sizeof(DWORD) + blob.key_len,
+                                0, 0, &hKey);
+        ok(result, "test %u: CryptImportKey failed: %08x\n", i, GetLastError());
+        if (!result) continue;
+
+        mode = CRYPT_MODE_ECB;
+        result = CryptSetKeyParam(hKey, KP_MODE, (BYTE *)&mode, 0);
+        ok(result, "%08x\n", GetLastError());
+
+        for (j = 0; j < sizeof(data); j += sizeof(plain))
+            memcpy(data + j, plain, sizeof(plain));
+        len = sizeof(data);
+        result = CryptEncrypt(hKey, 0, FALSE, 0, data, &len, sizeof(data));
+        ok(result, "%08x\n", GetLastError());
+        ok(len == sizeof(data), "got %u\n", len);
+        for (j = 0; j < sizeof(data); j += sizeof(plain))
+            ok(!memcmp(data + j, tests[i].cipher, sizeof(plain)), "test %u: wrong cipher text at %u\n", i, j);
+
+        result = CryptDecrypt(hKey, 0, FALSE, 0, data, &len);
+        ok(result, "%08x\n", GetLastError());
+        for (j = 0; j < sizeof(data); j += sizeof(plain))
+            ok(!memcmp(data + j, plain, sizeof(plain)), "test %u: wrong plain text at %u\n", i, j);
+
+        /* CBC round trip over many blocks */
+        len = 64 * 1024;
+        if ((big = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, len)))
+        {
+            mode = CRYPT_MODE_CBC;
+            result = CryptSetKeyParam(hKey, KP_MODE, (BYTE *)&mode, 0);
+            ok(result, "%08x\n", GetLastError());
+            memset(data, 0, sizeof(data));
+
+            result = CryptSetKeyParam(hKey, KP_IV, data, 0);
+            ok(result, "%08x\n", GetLastError());
+            result = CryptEncrypt(hKey, 0, FALSE, 0, big, &len, len);
+            ok(result, "%08x\n", GetLastError());
+            result = CryptSetKeyParam(hKey, KP_IV, data, 0);
+            ok(result, "%08x\n", GetLastError());
+            result = CryptDecrypt(hKey, 0, FALSE, 0, big, &len);
+            ok(result, "%08x\n", GetLastError());
+            ok(len == 64 * 1024, "got %u\n", len);
+            ok(!big[0] && !memcmp(big, big + 1, len - 1), "test %u: round trip failed\n", i);
+            HeapFree(GetProcessHeap(), 0, big);
+        }
+
+        result = CryptDestroyKey(hKey);
+        ok(result, "%08x\n", GetLastError());
+    }
+}
+
 static void test_sha2(void)
 {
     static const unsigned char sha256hash[32] = {
@@ -3975,6 +4065,7 @@ START_TEST(rsaenh)
     test_aes(128);
     test_aes(192);
     test_aes(256);
+    test_aes_vectors();
     test_sha2();
     test_key_derivation("AES");
     clean_up_aes_environment();
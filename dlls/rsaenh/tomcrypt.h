@@ -132,6 +132,8 @@ typedef struct tag_des3_key {
 typedef struct tag_aes_key {
    ulong32 eK[64], dK[64];
    int Nr;
+   int use_ni;                          /* round keys below are valid */
+   unsigned char eKb[240], dKb[240];    /* byte order round keys for AES-NI */
 } aes_key;
 
 int rc2_setup(const unsigned char *key, int keylen, int bits, int num_rounds, rc2_key *skey);
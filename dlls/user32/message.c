@@ -3002,7 +3002,7 @@ static inline void process_sent_messages(void)
 static HANDLE get_server_queue_handle(void)
 {
     struct user_thread_info *thread_info = get_user_thread_info();
-    HANDLE ret;
+    HANDLE ret, shared = 0;
 
     if (!(ret = thread_info->server_queue))
     {
@@ -3010,15 +3010,47 @@ static HANDLE get_server_queue_handle(void)
         {
             wine_server_call( req );
             ret = wine_server_ptr_handle( reply->handle );
+            shared = wine_server_ptr_handle( reply->shared );
         }
         SERVER_END_REQ;
         thread_info->server_queue = ret;
         if (!ret) ERR( "Cannot get server thread queue\n" );
+        if (shared)
+        {
+            thread_info->shared_queue = MapViewOfFile( shared, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 );
+            CloseHandle( shared );
+        }
     }
     return ret;
 }
 
 
+/***********************************************************************
+ *           is_queue_empty
+ *
+ * Check the queue state shared with the server to find out whether
+ * get_message can return anything, without making a server call.
+ */
+static BOOL is_queue_empty( UINT flags )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    volatile queue_shared_t *shared;
+    UINT filter = flags >> 16, mask;
+
+    get_server_queue_handle();
+    if (!(shared = thread_info->shared_queue)) return FALSE;
+
+    if (!filter) filter = QS_ALLINPUT;
+    mask = filter | QS_SENDMESSAGE;
+    if (filter & QS_POSTMESSAGE) mask |= QS_ALLPOSTMESSAGE;
+    if (shared->wake_bits & mask) return FALSE;
+
+    /* let the server know that we are still checking for messages */
+    shared->peek_count++;
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           wait_message_reply
  *
@@ -3790,7 +3822,7 @@ BOOL WINAPI DECLSPEC_HOTPATCH PeekMessageW( MSG *msg_out, HWND hwnd, UINT first,
     USER_CheckNotLock();
     check_for_driver_events( 0 );
 
-    if (!peek_message( &msg, hwnd, first, last, flags, 0 ))
+    if (is_queue_empty( flags ) || !peek_message( &msg, hwnd, first, last, flags, 0 ))
     {
         DWORD ret;
 
@@ -12411,6 +12411,63 @@ static void test_PeekMessage3(void)
     flush_events();
 }
 
+static DWORD WINAPI peek_message_post_thread( void *arg )
+{
+    DWORD tid = PtrToUlong( arg );
+
+    PostThreadMessageA( tid, WM_USER + 1, 1, 2 );
+    return 0;
+}
+
+static DWORD WINAPI peek_message_send_thread( void *arg )
+{
+    HWND hwnd = arg;
+
+    return SendMessageA( hwnd, WM_GETTEXTLENGTH, 0, 0 ) + 1;
+}
+
+static void test_PeekMessage4(void)
+{
+    HANDLE thread;
+    DWORD ret, start;
+    HWND hwnd;
+    MSG msg;
+
+    flush_events();
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( !ret, "got message %04x\n", msg.message );
+
+    /* a message posted from another thread must be seen right away */
+    thread = CreateThread( NULL, 0, peek_message_post_thread, UlongToPtr( GetCurrentThreadId() ), 0, NULL );
+    ok( !WaitForSingleObject( thread, 5000 ), "thread didn't finish\n" );
+    CloseHandle( thread );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_NOREMOVE );
+    ok( ret && msg.message == WM_USER + 1, "expected WM_USER + 1, got %d %04x\n", ret, msg.message );
+    ret = PeekMessageA( &msg, NULL, WM_USER + 1, WM_USER + 1, PM_REMOVE | PM_QS_POSTMESSAGE );
+    ok( ret && msg.wParam == 1 && msg.lParam == 2, "expected WM_USER + 1, got %d %04x\n", ret, msg.message );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( !ret, "got message %04x\n", msg.message );
+
+    /* sent messages must be processed by PeekMessage */
+    hwnd = CreateWindowA( "SimpleWindowClass", "abc", WS_POPUP, 0, 0, 10, 10, 0, 0, 0, NULL );
+    ok( hwnd != NULL, "CreateWindow failed\n" );
+    flush_events();
+    thread = CreateThread( NULL, 0, peek_message_send_thread, hwnd, 0, NULL );
+    start = GetTickCount();
+    while (WaitForSingleObject( thread, 0 ) == WAIT_TIMEOUT && GetTickCount() - start < 5000)
+        PeekMessageA( &msg, NULL, 0, 0, PM_NOREMOVE );
+    ok( GetExitCodeThread( thread, &ret ) && ret == 4, "got %u\n", ret );
+    CloseHandle( thread );
+    DestroyWindow( hwnd );
+    flush_events();
+
+    PostQuitMessage( 3 );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( ret && msg.message == WM_QUIT && msg.wParam == 3, "expected WM_QUIT, got %d %04x\n", ret, msg.message );
+    ret = PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE );
+    ok( !ret, "got message %04x\n", msg.message );
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -17612,6 +17669,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage4();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
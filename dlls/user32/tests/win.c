@@ -10721,6 +10721,331 @@ static void test_IsWindowEnabled(void)
     DestroyWindow(hwnd);
 }
 
+static BOOL CALLBACK list_children_proc( HWND hwnd, LPARAM lparam )
+{
+    HWND *list = (HWND *)lparam;
+    int i;
+
+    if (GetParent( hwnd ) != list[0]) return TRUE;  /* skip grandchildren */
+    for (i = 1; list[i]; i++);
+    if (i < 7) list[i] = hwnd;
+    return TRUE;
+}
+
+static void check_children_order( HWND parent, int line )
+{
+    HWND list[8] = { parent }, child, found;
+    int i;
+
+    EnumChildWindows( parent, list_children_proc, (LPARAM)list );
+    for (i = 1, child = GetWindow( parent, GW_CHILD ); child; i++, child = GetWindow( child, GW_HWNDNEXT ))
+    {
+        ok_(__FILE__,line)( list[i] == child, "%d: got %p, expected %p\n", i, list[i], child );
+        found = FindWindowExA( parent, i > 1 ? list[i - 1] : 0, NULL, NULL );
+        ok_(__FILE__,line)( found == child, "%d: FindWindowEx returned %p, expected %p\n", i, found, child );
+        ok_(__FILE__,line)( GetParent( child ) == parent, "%d: wrong parent %p\n", i, GetParent( child ) );
+    }
+    ok_(__FILE__,line)( !list[i], "%d: extra window %p\n", i, list[i] );
+}
+
+/* checks the windows of the parent process from a child process */
+static void test_other_process_windows( HWND parent, HWND child, HWND dead, LONG style, DWORD parent_pid,
+                                        DWORD parent_tid )
+{
+    DWORD tid, pid;
+    LONG_PTR id;
+    LONG ret;
+
+    ok( IsWindow( parent ), "parent doesn't exist\n" );
+    ok( IsWindow( child ), "child doesn't exist\n" );
+    ok( !IsWindow( dead ), "destroyed window still exists\n" );
+
+    ok( GetParent( child ) == parent, "wrong parent %p\n", GetParent( child ) );
+    ok( !GetParent( dead ), "got parent %p for a destroyed window\n", GetParent( dead ) );
+
+    ret = GetWindowLongA( child, GWL_STYLE );
+    ok( ret == style, "got style %08x, expected %08x\n", ret, style );
+    id = GetWindowLongPtrA( child, GWLP_ID );
+    ok( id == 104, "wrong id %d\n", (int)id );
+    SetLastError( 0xdeadbeef );
+    ret = GetWindowLongA( dead, GWL_STYLE );
+    ok( !ret, "got style %08x for a destroyed window\n", ret );
+    ok( GetLastError() == ERROR_INVALID_WINDOW_HANDLE, "got error %u\n", GetLastError() );
+
+    pid = 0;
+    tid = GetWindowThreadProcessId( child, &pid );
+    ok( tid == parent_tid, "wrong tid %x, expected %x\n", tid, parent_tid );
+    ok( pid == parent_pid, "wrong pid %x, expected %x\n", pid, parent_pid );
+    pid = 0xdeadbeef;
+    tid = GetWindowThreadProcessId( dead, &pid );
+    ok( !tid, "got tid %x for a destroyed window\n", tid );
+}
+
+static void test_window_tree_consistency(const char *argv0)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    HWND parent, child[5], found;
+    char cmd[MAX_PATH + 100];
+    DWORD tid, pid;
+    LONG_PTR id;
+    int i;
+
+    parent = CreateWindowExA( 0, "static", "parent", WS_POPUP, 0, 0, 100, 100, 0, 0, 0, NULL );
+    ok( parent != 0, "CreateWindowEx failed\n" );
+    for (i = 0; i < 5; i++)
+    {
+        child[i] = CreateWindowExA( 0, i & 1 ? "button" : "static", "child", WS_CHILD,
+                                    i * 10, 0, 10, 10, parent, (HMENU)(INT_PTR)(100 + i), 0, NULL );
+        ok( child[i] != 0, "CreateWindowEx failed\n" );
+    }
+    check_children_order( parent, __LINE__ );
+
+    SetWindowPos( child[0], HWND_BOTTOM, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    SetWindowPos( child[3], HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    SetWindowPos( child[2], child[4], 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    check_children_order( parent, __LINE__ );
+
+    found = FindWindowExA( parent, 0, "button", NULL );
+    ok( found == child[3], "got %p, expected %p\n", found, child[3] );
+    found = FindWindowExA( parent, found, "button", NULL );
+    ok( found == child[1], "got %p, expected %p\n", found, child[1] );
+    found = FindWindowExA( parent, found, "button", NULL );
+    ok( !found, "got %p\n", found );
+
+    id = GetWindowLongPtrA( child[4], GWLP_ID );
+    ok( id == 104, "wrong id %d\n", (int)id );
+    SetWindowLongA( child[4], GWL_STYLE, GetWindowLongA( child[4], GWL_STYLE ) | WS_VISIBLE );
+    ok( GetWindowLongA( child[4], GWL_STYLE ) & WS_VISIBLE, "style not updated\n" );
+    tid = GetWindowThreadProcessId( child[4], &pid );
+    ok( tid == GetCurrentThreadId(), "wrong tid %x\n", tid );
+    ok( pid == GetCurrentProcessId(), "wrong pid %x\n", pid );
+
+    SetParent( child[1], 0 );
+    check_children_order( parent, __LINE__ );
+    SetParent( child[1], parent );
+    check_children_order( parent, __LINE__ );
+
+    DestroyWindow( child[3] );
+    ok( !IsWindow( child[3] ), "window still exists\n" );
+    check_children_order( parent, __LINE__ );
+
+    /* other processes see the same windows */
+    sprintf( cmd, "%s win window_tree %p %p %p %x %x %x", argv0, parent, child[4], child[3],
+             GetWindowLongA( child[4], GWL_STYLE ), GetCurrentProcessId(), GetCurrentThreadId() );
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    ok( CreateProcessA( NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed\n" );
+    winetest_wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+
+    DestroyWindow( parent );
+    ok( !IsWindow( child[0] ), "child still exists\n" );
+}
+
+static BOOL is_point_visible( HWND hwnd, int x, int y )
+{
+    HRGN hrgn = CreateRectRgn( 0, 0, 0, 0 );
+    POINT pt = { x, y };
+    HDC hdc;
+    BOOL ret;
+
+    hdc = GetDCEx( hwnd, 0, DCX_CACHE | DCX_CLIPSIBLINGS );
+    GetRandomRgn( hdc, hrgn, SYSRGN );
+    ReleaseDC( hwnd, hdc );
+    MapWindowPoints( hwnd, 0, &pt, 1 );
+    ret = PtInRegion( hrgn, pt.x, pt.y );
+    DeleteObject( hrgn );
+    return ret;
+}
+
+/* the visible region of a child is its rectangle minus the visible siblings above it */
+static void check_visible_region( HWND hwnd, int pass )
+{
+    HRGN expect, rgn, tmp;
+    HWND sibling;
+    POINT pt = { 0, 0 };
+    RECT rect;
+    HDC hdc;
+
+    GetClientRect( GetParent( hwnd ), &rect );
+    ClientToScreen( GetParent( hwnd ), &pt );
+    OffsetRect( &rect, pt.x, pt.y );
+    expect = CreateRectRgnIndirect( &rect );
+    GetWindowRect( hwnd, &rect );
+    tmp = CreateRectRgnIndirect( &rect );
+    CombineRgn( expect, expect, tmp, RGN_AND );
+    DeleteObject( tmp );
+    for (sibling = GetWindow( hwnd, GW_HWNDPREV ); sibling; sibling = GetWindow( sibling, GW_HWNDPREV ))
+    {
+        if (!IsWindowVisible( sibling )) continue;
+        GetWindowRect( sibling, &rect );
+        tmp = CreateRectRgnIndirect( &rect );
+        CombineRgn( expect, expect, tmp, RGN_DIFF );
+        DeleteObject( tmp );
+    }
+
+    rgn = CreateRectRgn( 0, 0, 0, 0 );
+    hdc = GetDCEx( hwnd, 0, DCX_CACHE | DCX_CLIPSIBLINGS );
+    GetRandomRgn( hdc, rgn, SYSRGN );
+    ReleaseDC( hwnd, hdc );
+    ok( EqualRgn( rgn, expect ), "%d: wrong visible region for %p\n", pass, hwnd );
+    DeleteObject( rgn );
+    DeleteObject( expect );
+}
+
+static void test_visible_region_updates(void)
+{
+    HWND parent, below, above, child[300];
+    int i, j;
+
+    parent = CreateWindowExA( 0, "static", NULL, WS_POPUP | WS_VISIBLE | WS_CLIPCHILDREN,
+                              0, 0, 400, 400, 0, 0, 0, NULL );
+    below = CreateWindowExA( 0, "static", NULL, WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+                             0, 0, 100, 100, parent, 0, 0, NULL );
+    above = CreateWindowExA( 0, "static", NULL, WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+                             50, 50, 100, 100, parent, 0, 0, NULL );
+    SetWindowPos( above, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+
+    ok( is_point_visible( below, 10, 10 ), "point should be visible\n" );
+    ok( !is_point_visible( below, 60, 60 ), "point should be clipped\n" );
+
+    /* moving the sibling away exposes the window */
+    MoveWindow( above, 200, 200, 100, 100, FALSE );
+    ok( is_point_visible( below, 60, 60 ), "point should be visible\n" );
+    MoveWindow( above, 50, 50, 100, 100, FALSE );
+    ok( !is_point_visible( below, 60, 60 ), "point should be clipped\n" );
+
+    /* so does a Z-order change */
+    SetWindowPos( below, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    ok( is_point_visible( below, 60, 60 ), "point should be visible\n" );
+    ok( !is_point_visible( above, 10, 10 ), "point should be clipped\n" );
+
+    /* and hiding the sibling */
+    ShowWindow( below, SW_HIDE );
+    ok( is_point_visible( above, 10, 10 ), "point should be visible\n" );
+    ShowWindow( below, SW_SHOWNA );
+    ok( !is_point_visible( above, 10, 10 ), "point should be clipped\n" );
+
+    /* moving the parent keeps the clipping */
+    MoveWindow( parent, 20, 20, 400, 400, FALSE );
+    ok( !is_point_visible( above, 10, 10 ), "point should be clipped\n" );
+    ok( is_point_visible( above, 60, 60 ), "point should be visible\n" );
+
+    DestroyWindow( below );
+    ok( is_point_visible( above, 10, 10 ), "point should be visible\n" );
+
+    /* many overlapping siblings */
+    for (i = 0; i < ARRAY_SIZE(child); i++)
+        child[i] = CreateWindowExA( 0, "static", NULL, WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS,
+                                    (i % 20) * 15, (i / 20) * 15, 60, 60, parent, 0, 0, NULL );
+
+    for (j = 0; j < 10; j++)
+    {
+        for (i = 0; i < ARRAY_SIZE(child); i++)
+        {
+            SetWindowPos( child[i], 0, (i % 20) * 15 + j, (i / 20) * 15 + j, 60 + j, 60 + j,
+                          SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOREDRAW );
+            if (!(i % 50)) check_visible_region( child[i], j );
+        }
+    }
+
+    /* the regions computed during the moves must not be reused once stale */
+    for (i = 0; i < ARRAY_SIZE(child); i += 10) check_visible_region( child[i], 10 );
+    SetWindowPos( child[0], HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+    for (i = 0; i < ARRAY_SIZE(child); i += 10) check_visible_region( child[i], 11 );
+    ShowWindow( child[0], SW_HIDE );
+    for (i = 10; i < ARRAY_SIZE(child); i += 10) check_visible_region( child[i], 12 );
+
+    DestroyWindow( parent );
+}
+
+static void test_surface_updates(void)
+{
+    HWND hwnd;
+    HDC hdc, screen, mem_dc;
+    HBITMAP bitmap;
+    HBRUSH black = GetStockObject( BLACK_BRUSH ), white = GetStockObject( WHITE_BRUSH );
+    COLORREF color, expect;
+    RECT rect;
+    POINT pt;
+    MSG msg;
+    int i, x, y;
+
+    hwnd = CreateWindowExA( WS_EX_TOPMOST, "static", NULL, WS_POPUP | WS_VISIBLE,
+                            100, 100, 200, 200, 0, 0, 0, NULL );
+    flush_events( TRUE );
+
+    hdc = GetDC( hwnd );
+    SetRect( &rect, 0, 0, 200, 200 );
+    FillRect( hdc, &rect, white );
+    ReleaseDC( hwnd, hdc );
+    flush_events( TRUE );
+
+    /* many small separate changes */
+    hdc = GetDC( hwnd );
+    for (i = 0; i < 16; i++)
+    {
+        SetRect( &rect, (i % 4) * 50 + 5, (i / 4) * 50 + 5, (i % 4) * 50 + 15, (i / 4) * 50 + 15 );
+        FillRect( hdc, &rect, black );
+    }
+    ReleaseDC( hwnd, hdc );
+    flush_events( TRUE );
+
+    screen = GetDC( 0 );
+    pt.x = pt.y = 0;
+    MapWindowPoints( hwnd, 0, &pt, 1 );
+    if (GetPixel( screen, pt.x + 10, pt.y + 10 ) == CLR_INVALID)
+    {
+        skip( "can't read back the screen\n" );
+        ReleaseDC( 0, screen );
+        DestroyWindow( hwnd );
+        return;
+    }
+    for (i = 0; i < 16; i++)
+    {
+        color = GetPixel( screen, pt.x + (i % 4) * 50 + 10, pt.y + (i / 4) * 50 + 10 );
+        ok( color == RGB(0,0,0), "%d: wrong color %08x\n", i, color );
+        color = GetPixel( screen, pt.x + (i % 4) * 50 + 30, pt.y + (i / 4) * 50 + 30 );
+        ok( color == RGB(255,255,255), "%d: wrong color %08x\n", i, color );
+    }
+
+    /* overlapping changes, some of them flushed while others are pending */
+    hdc = GetDC( hwnd );
+    mem_dc = CreateCompatibleDC( hdc );
+    bitmap = CreateCompatibleBitmap( hdc, 200, 200 );
+    SelectObject( mem_dc, bitmap );
+    SetRect( &rect, 0, 0, 200, 200 );
+    FillRect( hdc, &rect, white );
+    FillRect( mem_dc, &rect, white );
+    for (i = 0; i < 2000; i++)
+    {
+        SetRect( &rect, (i * 7) % 190, (i * 13) % 190, (i * 7) % 190 + 10, (i * 13) % 190 + 10 );
+        FillRect( hdc, &rect, i & 1 ? black : white );
+        FillRect( mem_dc, &rect, i & 1 ? black : white );
+        if (!(i % 20)) while (PeekMessageA( &msg, 0, 0, 0, PM_REMOVE )) DispatchMessageA( &msg );
+    }
+    ReleaseDC( hwnd, hdc );
+    flush_events( TRUE );
+
+    for (y = 2; y < 200; y += 5)
+    {
+        for (x = 2; x < 200; x += 5)
+        {
+            expect = GetPixel( mem_dc, x, y );
+            color = GetPixel( screen, pt.x + x, pt.y + y );
+            ok( color == expect, "%d,%d: got %08x, expected %08x\n", x, y, color, expect );
+        }
+    }
+
+    DeleteDC( mem_dc );
+    DeleteObject( bitmap );
+    ReleaseDC( 0, screen );
+    DestroyWindow( hwnd );
+}
+
 START_TEST(win)
 {
     char **argv;
@@ -10759,6 +11084,21 @@ START_TEST(win)
         return;
     }
 
+    if (argc==9 && !strcmp(argv[2], "window_tree"))
+    {
+        HWND parent, child, dead;
+        DWORD style, pid, tid;
+
+        sscanf(argv[3], "%p", &parent);
+        sscanf(argv[4], "%p", &child);
+        sscanf(argv[5], "%p", &dead);
+        sscanf(argv[6], "%x", &style);
+        sscanf(argv[7], "%x", &pid);
+        sscanf(argv[8], "%x", &tid);
+        test_other_process_windows(parent, child, dead, style, pid, tid);
+        return;
+    }
+
     if (argc==3 && !strcmp(argv[2], "winproc_limit"))
     {
         test_winproc_limit();
@@ -10878,6 +11218,9 @@ START_TEST(win)
     test_minimize_window(hwndMain);
     test_destroy_quit();
     test_IsWindowEnabled();
+    test_window_tree_consistency(argv[0]);
+    test_visible_region_updates();
+    test_surface_updates();
 
     /* add the tests above this line */
     if (hhook) UnhookWindowsHookEx(hhook);
@@ -305,6 +305,170 @@ static void free_window_handle( HWND hwnd )
 }
 
 
+/*******************************************************************
+ *           get_shared_window_tree
+ *
+ * Map the window tree published by the server. It is updated under a
+ * sequence lock, so readers have to check that the sequence number didn't
+ * change while they were looking at it, and ask the server otherwise.
+ */
+static const shared_window_tree_t *get_shared_window_tree(void)
+{
+    static const shared_window_tree_t *shared_tree;
+    static BOOL failed;
+    HANDLE handle = 0;
+    void *ptr;
+
+    if (shared_tree || failed) return shared_tree;
+
+    SERVER_START_REQ( get_shared_window_tree )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (handle)
+    {
+        if ((ptr = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 )) &&
+            InterlockedCompareExchangePointer( (void **)&shared_tree, ptr, NULL ))
+            UnmapViewOfFile( ptr );
+        CloseHandle( handle );
+    }
+    if (!shared_tree) failed = TRUE;
+    return shared_tree;
+}
+
+/* full barrier between the sequence number and the tree accesses */
+static inline void shared_tree_barrier(void)
+{
+    LONG dummy;
+    InterlockedExchange( &dummy, 0 );
+}
+
+static inline unsigned int begin_shared_tree_read( const shared_window_tree_t *tree )
+{
+    unsigned int seq = *(volatile const unsigned int *)&tree->seq;
+    shared_tree_barrier();
+    return seq;
+}
+
+static inline BOOL end_shared_tree_read( const shared_window_tree_t *tree, unsigned int seq )
+{
+    shared_tree_barrier();
+    return *(volatile const unsigned int *)&tree->seq == seq;
+}
+
+/* return the shared entry for a window handle, or NULL if it doesn't match */
+static inline const shared_window_t *find_shared_window( const shared_window_tree_t *tree, HWND hwnd )
+{
+    WORD index = USER_HANDLE_TO_INDEX( hwnd );
+    const shared_window_t *win;
+
+    if (index >= NB_USER_HANDLES) return NULL;
+    win = &tree->windows[index];
+    if (!win->handle) return NULL;
+    if (win->handle != (UINT)(UINT_PTR)hwnd && HIWORD(hwnd) && HIWORD(hwnd) != 0xffff) return NULL;
+    return win;
+}
+
+/*******************************************************************
+ *           get_shared_window_info
+ *
+ * Retrieve a consistent copy of the shared information of a window.
+ * Returns FALSE if the server has to be asked instead.
+ */
+static BOOL get_shared_window_info( HWND hwnd, shared_window_t *info )
+{
+    const shared_window_tree_t *tree = get_shared_window_tree();
+    const shared_window_t *win;
+    unsigned int seq;
+    int tries;
+
+    if (!tree) return FALSE;
+
+    for (tries = 0; tries < 8; tries++)
+    {
+        if ((seq = begin_shared_tree_read( tree )) & 1) continue;
+        if (!(win = find_shared_window( tree, hwnd ))) return FALSE;
+        *info = *win;
+        if (end_shared_tree_read( tree, seq )) return TRUE;
+    }
+    return FALSE;
+}
+
+/*******************************************************************
+ *           list_shared_window_children
+ *
+ * Build the children list from the shared window tree.
+ * Returns FALSE if the server has to be asked instead.
+ */
+static BOOL list_shared_window_children( HWND hwnd, ATOM atom, DWORD tid, HWND **ret )
+{
+    const shared_window_tree_t *tree = get_shared_window_tree();
+    const shared_window_t *win;
+    user_handle_t child;
+    HWND *list = NULL, *new_list;
+    unsigned int seq, count = 0, size = 0, steps = 0;
+
+    if (!tree || ((seq = begin_shared_tree_read( tree )) & 1)) return FALSE;
+    if (!(win = find_shared_window( tree, hwnd ))) return FALSE;
+
+    for (child = win->first_child; child; child = win->next_sibling)
+    {
+        /* the tree may be changing under us, don't trust it blindly */
+        if (++steps > NB_USER_HANDLES) goto failed;
+        if (!(win = find_shared_window( tree, wine_server_ptr_handle( child )))) goto failed;
+        if (atom && win->atom != atom) continue;
+        if (tid && win->tid != tid) continue;
+        if (count + 1 >= size)
+        {
+            size = max( 128, size * 2 );
+            if (list) new_list = HeapReAlloc( GetProcessHeap(), 0, list, size * sizeof(HWND) );
+            else new_list = HeapAlloc( GetProcessHeap(), 0, size * sizeof(HWND) );
+            if (!new_list) goto failed;
+            list = new_list;
+        }
+        list[count++] = wine_server_ptr_handle( child );
+    }
+    if (!end_shared_tree_read( tree, seq )) goto failed;
+
+    if (count) list[count] = 0;
+    else HeapFree( GetProcessHeap(), 0, list );
+    *ret = count ? list : NULL;
+    return TRUE;
+
+failed:
+    HeapFree( GetProcessHeap(), 0, list );
+    return FALSE;
+}
+
+/*******************************************************************
+ *           list_shared_window_parents
+ *
+ * Build the parents list from the shared window tree.
+ * Returns FALSE if the server has to be asked instead.
+ */
+static BOOL list_shared_window_parents( HWND hwnd, HWND *list, int size )
+{
+    const shared_window_tree_t *tree = get_shared_window_tree();
+    const shared_window_t *win;
+    unsigned int seq;
+    int pos = 0;
+
+    if (!tree || ((seq = begin_shared_tree_read( tree )) & 1)) return FALSE;
+    if (!(win = find_shared_window( tree, hwnd ))) return FALSE;
+
+    while (win->parent)
+    {
+        if (pos == size - 1) return FALSE;
+        list[pos++] = wine_server_ptr_handle( win->parent );
+        if (!(win = find_shared_window( tree, list[pos - 1] ))) return FALSE;
+    }
+    list[pos] = 0;
+    return end_shared_tree_read( tree, seq );
+}
+
+
 /*******************************************************************
  *           list_window_children
  *
@@ -320,6 +484,9 @@ static HWND *list_window_children( HDESK desktop, HWND hwnd, LPCWSTR class, DWOR
     /* empty class is not the same as NULL class */
     if (!atom && class && !class[0]) return NULL;
 
+    if (!desktop && hwnd && (atom || !class) && list_shared_window_children( hwnd, atom, tid, &list ))
+        return list;
+
     for (;;)
     {
         int count = 0;
@@ -391,7 +558,13 @@ static HWND *list_window_parents( HWND hwnd )
         }
     }
 
-    /* at least one parent belongs to another process, have to query the server */
+    /* at least one parent belongs to another process, use the shared tree or query the server */
+
+    if (list_shared_window_parents( hwnd, list, size ))
+    {
+        if (!list[0]) goto empty;
+        return list;
+    }
 
     for (;;)
     {
@@ -2350,11 +2523,20 @@ static LONG_PTR WIN_GetWindowLong( HWND hwnd, INT offset, UINT size, BOOL unicod
 
     if (wndPtr == WND_OTHER_PROCESS)
     {
+        shared_window_t info;
+
         if (offset == GWLP_WNDPROC)
         {
             SetLastError( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE || offset == GWLP_ID) &&
+            get_shared_window_info( hwnd, &info ))
+        {
+            if (offset == GWL_STYLE) return info.style;
+            if (offset == GWL_EXSTYLE) return info.ex_style;
+            return info.id;
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -2952,6 +3134,7 @@ BOOL WINAPI IsWindow( HWND hwnd )
 {
     WND *ptr;
     BOOL ret;
+    shared_window_t info;
 
     if (!(ptr = WIN_GetPtr( hwnd ))) return FALSE;
     if (ptr == WND_DESKTOP) return TRUE;
@@ -2963,6 +3146,8 @@ BOOL WINAPI IsWindow( HWND hwnd )
     }
 
     /* check other processes */
+    if (get_shared_window_info( hwnd, &info )) return TRUE;
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2980,6 +3165,7 @@ DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
 {
     WND *ptr;
     DWORD tid = 0;
+    shared_window_t info;
 
     if (!(ptr = WIN_GetPtr( hwnd )))
     {
@@ -2997,6 +3183,12 @@ DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
     }
 
     /* check other processes */
+    if (ptr == WND_OTHER_PROCESS && get_shared_window_info( hwnd, &info ))
+    {
+        if (process) *process = info.pid;
+        return info.tid;
+    }
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -3027,7 +3219,16 @@ HWND WINAPI GetParent( HWND hwnd )
     if (wndPtr == WND_DESKTOP) return 0;
     if (wndPtr == WND_OTHER_PROCESS)
     {
-        LONG style = GetWindowLongW( hwnd, GWL_STYLE );
+        shared_window_t info;
+        LONG style;
+
+        if (get_shared_window_info( hwnd, &info ))
+        {
+            if (info.style & WS_POPUP) retvalue = wine_server_ptr_handle( info.owner );
+            else if (info.style & WS_CHILD) retvalue = wine_server_ptr_handle( info.parent );
+            return retvalue;
+        }
+        style = GetWindowLongW( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
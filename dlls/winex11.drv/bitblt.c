@@ -1556,13 +1556,19 @@ DWORD get_pixmap_image( Pixmap pixmap, int width, int height, const XVisualInfo
 }
 
 
+#define MAX_DAMAGE_RECTS 16
+#define FLUSH_PERIOD     50  /* time in ms since the first unflushed change for forcing a flush */
+
 struct x11drv_window_surface
 {
     struct window_surface header;
     Window                window;
     GC                    gc;
     XImage               *image;
-    RECT                  bounds;
+    RECT                  bounds;       /* changes made since the last unlock */
+    RECT                  damage[MAX_DAMAGE_RECTS];  /* changes not flushed yet */
+    int                   damage_count;
+    DWORD                 damage_ticks; /* time of the first change not flushed yet */
     BOOL                  byteswap;
     BOOL                  is_argb;
     DWORD                 alpha_bits;
@@ -1571,6 +1577,9 @@ struct x11drv_window_surface
     void                 *bits;
 #ifdef HAVE_LIBXXSHM
     XShmSegmentInfo       shminfo;
+    XImage               *back_image;   /* second image when the bits have to be converted */
+    XShmSegmentInfo       back_shminfo;
+    BOOL                  use_back;     /* next flush goes to the back image */
 #endif
     CRITICAL_SECTION      crit;
     BITMAPINFO            info;   /* variable size, must be last */
@@ -1813,6 +1822,98 @@ failed:
 }
 #endif /* HAVE_LIBXXSHM */
 
+static inline LONGLONG get_rect_area( const RECT *rect )
+{
+    return (LONGLONG)(rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+/***********************************************************************
+ *           add_damage_rect
+ *
+ * Add a changed rectangle to the damage list, merging it with an existing
+ * one when that doesn't cost much, or when the list is full.
+ */
+static void add_damage_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    RECT merged;
+    LONGLONG growth, best_growth = 0;
+    int i, best = -1;
+
+    if (IsRectEmpty( rect )) return;
+    if (!surface->damage_count) surface->damage_ticks = GetTickCount();
+
+    for (i = 0; i < surface->damage_count; i++)
+    {
+        UnionRect( &merged, &surface->damage[i], rect );
+        growth = get_rect_area( &merged ) - get_rect_area( &surface->damage[i] ) - get_rect_area( rect );
+        if (growth <= 0)  /* overlapping or adjacent, merging is free */
+        {
+            surface->damage[i] = merged;
+            return;
+        }
+        if (best == -1 || growth < best_growth)
+        {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    if (surface->damage_count < MAX_DAMAGE_RECTS) surface->damage[surface->damage_count++] = *rect;
+    else UnionRect( &surface->damage[best], &surface->damage[best], rect );
+}
+
+/***********************************************************************
+ *           update_image_rect
+ *
+ * Convert the surface bits of a rectangle to the image format.
+ */
+static void update_image_rect( struct x11drv_window_surface *surface, XImage *image, const RECT *rect )
+{
+    unsigned char *src = surface->bits;
+    unsigned char *dst = (unsigned char *)image->data;
+
+    if (src != dst)
+    {
+        const int *mapping = NULL;
+        int width_bytes = image->bytes_per_line;
+
+        if (image->bits_per_pixel == 4 || image->bits_per_pixel == 8)
+            mapping = X11DRV_PALETTE_PaletteToXPixel;
+
+        src += rect->top * width_bytes;
+        dst += rect->top * width_bytes;
+        copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
+                             rect->bottom - rect->top, surface->byteswap, mapping, ~0u, surface->alpha_bits );
+    }
+    else if (surface->alpha_bits)
+    {
+        int x, y, stride = image->bytes_per_line / sizeof(ULONG);
+        ULONG *ptr = (ULONG *)dst + rect->top * stride;
+
+        for (y = rect->top; y < rect->bottom; y++, ptr += stride)
+            for (x = rect->left; x < rect->right; x++)
+                ptr[x] |= surface->alpha_bits;
+    }
+}
+
+/***********************************************************************
+ *           put_image_rect
+ */
+static void put_image_rect( struct x11drv_window_surface *surface, XImage *image, const RECT *rect )
+{
+#ifdef HAVE_LIBXXSHM
+    if (image == surface->back_image || surface->shminfo.shmid != -1)
+        XShmPutImage( gdi_display, surface->window, surface->gc, image,
+                      rect->left, rect->top,
+                      surface->header.rect.left + rect->left, surface->header.rect.top + rect->top,
+                      rect->right - rect->left, rect->bottom - rect->top, False );
+    else
+#endif
+    XPutImage( gdi_display, surface->window, surface->gc, image,
+               rect->left, rect->top,
+               surface->header.rect.left + rect->left, surface->header.rect.top + rect->top,
+               rect->right - rect->left, rect->bottom - rect->top );
+}
+
 /***********************************************************************
  *           x11drv_surface_lock
  */
@@ -1829,8 +1930,16 @@ static void x11drv_surface_lock( struct window_surface *window_surface )
 static void x11drv_surface_unlock( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
+    BOOL flush;
 
+    /* the bounds only cover a single drawing operation, so that the damage list stays precise */
+    add_damage_rect( surface, &surface->bounds );
+    reset_bounds( &surface->bounds );
+    flush = surface->damage_count && GetTickCount() - surface->damage_ticks > FLUSH_PERIOD;
     LeaveCriticalSection( &surface->crit );
+
+    /* the app may never go idle, force a flush once in a while */
+    if (flush) window_surface->funcs->flush( window_surface );
 }
 
 /***********************************************************************
@@ -1891,67 +2000,41 @@ static void x11drv_surface_set_region( struct window_surface *window_surface, HR
 static void x11drv_surface_flush( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
-    unsigned char *src = surface->bits;
-    unsigned char *dst = (unsigned char *)surface->image->data;
-    struct bitblt_coords coords;
+    XImage *image = surface->image;
+    RECT rect, surface_rect;
+    int i;
 
     window_surface->funcs->lock( window_surface );
-    coords.x = 0;
-    coords.y = 0;
-    coords.width  = surface->header.rect.right - surface->header.rect.left;
-    coords.height = surface->header.rect.bottom - surface->header.rect.top;
-    SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
-    if (IntersectRect( &coords.visrect, &coords.visrect, &surface->bounds ))
+    add_damage_rect( surface, &surface->bounds );
+    reset_bounds( &surface->bounds );
+    SetRect( &surface_rect, 0, 0, surface->header.rect.right - surface->header.rect.left,
+             surface->header.rect.bottom - surface->header.rect.top );
+
+    if (surface->damage_count)
     {
-        TRACE( "flushing %p %dx%d bounds %s bits %p\n",
-               surface, coords.width, coords.height,
-               wine_dbgstr_rect( &surface->bounds ), surface->bits );
+        TRACE( "flushing %p %dx%d %d rects bits %p\n", surface, surface_rect.right, surface_rect.bottom,
+               surface->damage_count, surface->bits );
 
         if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
-        if (src != dst)
-        {
-            const int *mapping = NULL;
-            int width_bytes = surface->image->bytes_per_line;
-
-            if (surface->image->bits_per_pixel == 4 || surface->image->bits_per_pixel == 8)
-                mapping = X11DRV_PALETTE_PaletteToXPixel;
-
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
-        }
-        else if (surface->alpha_bits)
+#ifdef HAVE_LIBXXSHM
+        /* alternate between the two images, so that we don't overwrite the one
+         * that the X server may still be reading from */
+        if (surface->back_image && surface->use_back) image = surface->back_image;
+#endif
+        for (i = 0; i < surface->damage_count; i++)
         {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
-
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
+            if (!IntersectRect( &rect, &surface->damage[i], &surface_rect )) continue;
+            TRACE( "rect %s\n", wine_dbgstr_rect( &rect ));
+            update_image_rect( surface, image, &rect );
+            put_image_rect( surface, image, &rect );
         }
-
+        XFlush( gdi_display );
 #ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
-        else
+        if (surface->back_image) surface->use_back = !surface->use_back;
 #endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
-        XFlush( gdi_display );
+        surface->damage_count = 0;
     }
-    reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
 }
 
@@ -1979,6 +2062,15 @@ static void x11drv_surface_destroy( struct window_surface *window_surface )
         surface->image->data = NULL;
         XDestroyImage( surface->image );
     }
+#ifdef HAVE_LIBXXSHM
+    if (surface->back_image)
+    {
+        XShmDetach( gdi_display, &surface->back_shminfo );
+        shmdt( surface->back_shminfo.shmaddr );
+        surface->back_image->data = NULL;
+        XDestroyImage( surface->back_image );
+    }
+#endif
     surface->crit.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection( &surface->crit );
     if (surface->region) DeleteObject( surface->region );
@@ -2054,6 +2146,11 @@ struct window_surface *create_surface( Window window, const XVisualInfo *vis, co
         if (!(surface->bits  = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
                                           surface->info.bmiHeader.biSizeImage )))
             goto failed;
+#ifdef HAVE_LIBXXSHM
+        /* the bits are converted anyway, so use two images to avoid overwriting pending uploads */
+        if (surface->shminfo.shmid != -1)
+            surface->back_image = create_shm_image( vis, width, height, &surface->back_shminfo );
+#endif
     }
     else surface->bits = surface->image->data;
 
@@ -243,6 +243,14 @@ typedef struct
 } property_data_t;
 
 
+typedef struct
+{
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   peek_count;
+} queue_shared_t;
+
+
 typedef struct
 {
     int  left;
@@ -252,6 +260,31 @@ typedef struct
 } rectangle_t;
 
 
+typedef struct
+{
+    user_handle_t  handle;
+    user_handle_t  parent;
+    user_handle_t  owner;
+    user_handle_t  first_child;
+    user_handle_t  next_sibling;
+    thread_id_t    tid;
+    process_id_t   pid;
+    atom_t         atom;
+    unsigned int   style;
+    unsigned int   ex_style;
+    unsigned int   id;
+    unsigned int   dpi;
+} shared_window_t;
+
+
+typedef struct
+{
+    unsigned int    seq;
+    unsigned int    __pad;
+    shared_window_t windows[(LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1];
+} shared_window_tree_t;
+
+
 typedef struct
 {
     obj_handle_t    handle;
@@ -3013,7 +3046,7 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    obj_handle_t shared;
 };
 
 
@@ -3667,6 +3700,19 @@ struct get_window_tree_reply
 };
 
 
+struct get_shared_window_tree_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_shared_window_tree_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    char __pad_12[4];
+};
+
+
 struct set_window_pos_request
 {
     struct request_header __header;
@@ -5836,6 +5882,7 @@ enum request
     REQ_get_window_children,
     REQ_get_window_children_from_point,
     REQ_get_window_tree,
+    REQ_get_shared_window_tree,
     REQ_set_window_pos,
     REQ_get_window_rectangles,
     REQ_get_window_text,
@@ -6134,6 +6181,7 @@ union generic_request
     struct get_window_children_request get_window_children_request;
     struct get_window_children_from_point_request get_window_children_from_point_request;
     struct get_window_tree_request get_window_tree_request;
+    struct get_shared_window_tree_request get_shared_window_tree_request;
     struct set_window_pos_request set_window_pos_request;
     struct get_window_rectangles_request get_window_rectangles_request;
     struct get_window_text_request get_window_text_request;
@@ -6430,6 +6478,7 @@ union generic_reply
     struct get_window_children_reply get_window_children_reply;
     struct get_window_children_from_point_reply get_window_children_from_point_reply;
     struct get_window_tree_reply get_window_tree_reply;
+    struct get_shared_window_tree_reply get_shared_window_tree_reply;
     struct set_window_pos_reply set_window_pos_reply;
     struct get_window_rectangles_reply get_window_rectangles_reply;
     struct get_window_text_reply get_window_text_reply;
@@ -6553,6 +6602,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 571
+#define SERVER_PROTOCOL_VERSION 574
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
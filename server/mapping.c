@@ -920,6 +920,28 @@ static enum server_fd_type mapping_get_fd_type( struct fd *fd )
     return FD_TYPE_FILE;
 }
 
+/* create an anonymous mapping that is also mapped read-write in the server */
+struct object *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    struct mapping *mapping;
+    int unix_fd;
+
+    if (!(mapping = (struct mapping *)create_mapping( NULL, NULL, 0, size, SEC_COMMIT, 0, 0, NULL )))
+        return NULL;
+
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1) goto error;
+    if ((*ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, unix_fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        goto error;
+    }
+    return &mapping->obj;
+
+ error:
+    release_object( mapping );
+    return NULL;
+}
+
 int get_page_size(void)
 {
     if (!page_mask) page_mask = sysconf( _SC_PAGESIZE ) - 1;
@@ -28,6 +28,7 @@
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -140,6 +141,9 @@ struct msg_queue
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    struct object         *shared_mapping;  /* mapping of the state shared with the client */
+    queue_shared_t        *shared;          /* state shared with the client */
+    unsigned int           peek_count;      /* last seen client peek count */
 };
 
 struct hotkey
@@ -298,6 +302,14 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->peek_count      = 0;
+        queue->shared_mapping  = create_shared_mapping( sizeof(*queue->shared), (void **)&queue->shared );
+        if (!queue->shared_mapping)
+        {
+            /* not fatal, the client will use server calls instead */
+            queue->shared = NULL;
+            clear_error();
+        }
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -446,11 +458,20 @@ static inline int is_signaled( struct msg_queue *queue )
     return ((queue->wake_bits & queue->wake_mask) || (queue->changed_bits & queue->changed_mask));
 }
 
+/* publish the queue bits to the client, so that it can check for messages without a server call */
+static inline void update_shared_bits( struct msg_queue *queue )
+{
+    if (!queue->shared) return;
+    queue->shared->wake_bits = queue->wake_bits;
+    queue->shared->changed_bits = queue->changed_bits;
+}
+
 /* set some queue bits */
 static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_shared_bits( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -459,6 +480,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_shared_bits( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -900,6 +922,13 @@ static int is_queue_hung( struct msg_queue *queue )
 {
     struct wait_queue_entry *entry;
 
+    /* the client checked for messages without calling us */
+    if (queue->shared && queue->shared->peek_count != queue->peek_count)
+    {
+        queue->peek_count = queue->shared->peek_count;
+        queue->last_get_msg = current_time;
+    }
+
     if (current_time - queue->last_get_msg <= 5 * TICKS_PER_SEC)
         return 0;  /* less than 5 seconds since last get message -> not hung */
 
@@ -1006,6 +1035,11 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shared_mapping)
+    {
+        munmap( queue->shared, sizeof(*queue->shared) );
+        release_object( queue->shared_mapping );
+    }
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -2177,7 +2211,12 @@ DECL_HANDLER(get_msg_queue)
     struct msg_queue *queue = get_current_queue();
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    reply->shared = 0;
+    if (!queue) return;
+    reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    if (queue->shared_mapping)
+        reply->shared = alloc_handle( current->process, queue->shared_mapping,
+                                      SECTION_MAP_READ | SECTION_MAP_WRITE | SECTION_QUERY, 0 );
 }
 
 
@@ -2236,6 +2275,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_shared_bits( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2412,6 +2452,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_shared_bits( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -282,6 +282,7 @@ DECL_HANDLER(get_window_parents);
 DECL_HANDLER(get_window_children);
 DECL_HANDLER(get_window_children_from_point);
 DECL_HANDLER(get_window_tree);
+DECL_HANDLER(get_shared_window_tree);
 DECL_HANDLER(set_window_pos);
 DECL_HANDLER(get_window_rectangles);
 DECL_HANDLER(get_window_text);
@@ -579,6 +580,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_get_window_children,
     (req_handler)req_get_window_children_from_point,
     (req_handler)req_get_window_tree,
+    (req_handler)req_get_shared_window_tree,
     (req_handler)req_set_window_pos,
     (req_handler)req_get_window_rectangles,
     (req_handler)req_get_window_text,
@@ -1511,6 +1513,7 @@ C_ASSERT( FIELD_OFFSET(struct init_atom_table_reply, table) == 8 );
 C_ASSERT( sizeof(struct init_atom_table_reply) == 16 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, shared) == 12 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
@@ -1751,6 +1754,9 @@ C_ASSERT( FIELD_OFFSET(struct get_window_tree_reply, last_sibling) == 28 );
 C_ASSERT( FIELD_OFFSET(struct get_window_tree_reply, first_child) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_window_tree_reply, last_child) == 36 );
 C_ASSERT( sizeof(struct get_window_tree_reply) == 40 );
+C_ASSERT( sizeof(struct get_shared_window_tree_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_window_tree_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_shared_window_tree_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_window_pos_request, swp_flags) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_window_pos_request, paint_flags) == 14 );
 C_ASSERT( FIELD_OFFSET(struct set_window_pos_request, handle) == 16 );
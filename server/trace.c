@@ -2758,6 +2758,7 @@ static void dump_get_msg_queue_request( const struct get_msg_queue_request *req
 static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", shared=%04x", req->shared );
 }
 
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
@@ -3196,6 +3197,15 @@ static void dump_get_window_tree_reply( const struct get_window_tree_reply *req
     fprintf( stderr, ", last_child=%08x", req->last_child );
 }
 
+static void dump_get_shared_window_tree_request( const struct get_shared_window_tree_request *req )
+{
+}
+
+static void dump_get_shared_window_tree_reply( const struct get_shared_window_tree_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_set_window_pos_request( const struct set_window_pos_request *req )
 {
     fprintf( stderr, " swp_flags=%04x", req->swp_flags );
@@ -4712,6 +4722,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_window_children_request,
     (dump_func)dump_get_window_children_from_point_request,
     (dump_func)dump_get_window_tree_request,
+    (dump_func)dump_get_shared_window_tree_request,
     (dump_func)dump_set_window_pos_request,
     (dump_func)dump_get_window_rectangles_request,
     (dump_func)dump_get_window_text_request,
@@ -5006,6 +5017,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_window_children_reply,
     (dump_func)dump_get_window_children_from_point_reply,
     (dump_func)dump_get_window_tree_reply,
+    (dump_func)dump_get_shared_window_tree_reply,
     (dump_func)dump_set_window_pos_reply,
     (dump_func)dump_get_window_rectangles_reply,
     (dump_func)dump_get_window_text_reply,
@@ -5300,6 +5312,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "get_window_children",
     "get_window_children_from_point",
     "get_window_tree",
+    "get_shared_window_tree",
     "set_window_pos",
     "get_window_rectangles",
     "get_window_text",
@@ -33,6 +33,8 @@
 #include "winternl.h"
 
 #include "object.h"
+#include "file.h"
+#include "handle.h"
 #include "request.h"
 #include "thread.h"
 #include "process.h"
@@ -74,6 +76,8 @@ struct window
     rectangle_t      client_rect;     /* client rectangle (relative to parent client area) */
     struct region   *win_region;      /* region for shaped windows (relative to window rect) */
     struct region   *update_region;   /* update region (relative to window rect) */
+    struct region   *vis_cache;       /* cached visible region (relative to window rect) */
+    unsigned int     vis_cache_flags; /* DCX_* flags the visible region was computed with */
     unsigned int     style;           /* window style */
     unsigned int     ex_style;        /* window extended style */
     unsigned int     id;              /* window id */
@@ -123,6 +127,10 @@ static struct window *shell_listview;
 static struct window *progman_window;
 static struct window *taskman_window;
 
+/* window tree shared with the clients */
+static struct object *shared_tree_mapping;
+static shared_window_tree_t *shared_tree;
+
 /* magic HWND_TOP etc. pointers */
 #define WINPTR_TOP       ((struct window *)1L)
 #define WINPTR_BOTTOM    ((struct window *)2L)
@@ -171,6 +179,135 @@ static inline struct window *get_last_child( struct window *win )
     return ptr ? LIST_ENTRY( ptr, struct window, entry ) : NULL;
 }
 
+/* get the entry of the shared window tree for a given window */
+static inline shared_window_t *get_shared_window( struct window *win )
+{
+    return &shared_tree->windows[((win->handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+}
+
+/* the shared tree is updated with a sequence lock, the sequence number is odd during updates */
+static inline void begin_shared_tree_update(void)
+{
+    interlocked_xchg_add( (int *)&shared_tree->seq, 1 );
+}
+
+static inline void end_shared_tree_update(void)
+{
+    interlocked_xchg_add( (int *)&shared_tree->seq, 1 );
+}
+
+/* store the first child and the next sibling links of a window */
+static void set_shared_window_links( struct window *win )
+{
+    shared_window_t *shared = get_shared_window( win );
+    struct window *child = get_first_child( win );
+    struct window *next = win->parent && win->is_linked ? get_next_window( win ) : NULL;
+
+    shared->first_child  = child ? child->handle : 0;
+    shared->next_sibling = next ? next->handle : 0;
+}
+
+/* update the shared information of a window */
+static void update_shared_window( struct window *win )
+{
+    shared_window_t *shared;
+
+    if (!shared_tree) return;
+    shared = get_shared_window( win );
+
+    begin_shared_tree_update();
+    shared->handle   = win->handle;
+    shared->parent   = win->parent ? win->parent->handle : 0;
+    shared->owner    = win->owner;
+    shared->tid      = win->thread ? get_thread_id( win->thread ) : 0;
+    shared->pid      = win->thread ? get_process_id( win->thread->process ) : 0;
+    shared->atom     = win->class ? get_class_atom( win->class ) : DESKTOP_ATOM;
+    shared->style    = win->style;
+    shared->ex_style = win->ex_style;
+    shared->id       = win->id;
+    shared->dpi      = win->dpi;
+    set_shared_window_links( win );
+    end_shared_tree_update();
+}
+
+/* update the shared Z-order links of the children of a window */
+static void update_shared_children( struct window *parent )
+{
+    struct window *child;
+
+    if (!shared_tree || !parent) return;
+
+    begin_shared_tree_update();
+    set_shared_window_links( parent );
+    LIST_FOR_EACH_ENTRY( child, &parent->children, struct window, entry )
+    {
+        set_shared_window_links( child );
+        /* WS_EX_TOPMOST can change while relinking */
+        get_shared_window( child )->ex_style = child->ex_style;
+    }
+    end_shared_tree_update();
+}
+
+/* create the shared window tree, it is filled as windows get created */
+static void create_shared_tree(void)
+{
+    static int failed;
+
+    if (failed) return;
+    if (!(shared_tree_mapping = create_shared_mapping( sizeof(*shared_tree), (void **)&shared_tree )))
+    {
+        /* not fatal, the clients will use server requests instead */
+        shared_tree = NULL;
+        failed = 1;
+        clear_error();
+    }
+}
+
+/* remove a window from the shared tree */
+static void remove_shared_window( struct window *win )
+{
+    if (!shared_tree) return;
+
+    begin_shared_tree_update();
+    memset( get_shared_window( win ), 0, sizeof(shared_window_t) );
+    end_shared_tree_update();
+}
+
+/* free the cached visible regions of a window and all its descendants */
+static void invalidate_visible_tree( struct window *win )
+{
+    struct window *child;
+
+    if (win->vis_cache)
+    {
+        free_region( win->vis_cache );
+        win->vis_cache = NULL;
+    }
+    LIST_FOR_EACH_ENTRY( child, &win->children, struct window, entry )
+        invalidate_visible_tree( child );
+    LIST_FOR_EACH_ENTRY( child, &win->unlinked, struct window, entry )
+        invalidate_visible_tree( child );
+}
+
+/* invalidate the cached visible regions that depend on the position, style or Z-order of a window */
+static void invalidate_visible_cache( struct window *win )
+{
+    struct window *sibling, *parent = win->parent;
+
+    invalidate_visible_tree( win );
+
+    /* top-level windows don't clip each other, and the desktop isn't clipped by its children */
+    if (!parent || is_desktop_window( parent )) return;
+
+    if (parent->vis_cache)
+    {
+        free_region( parent->vis_cache );
+        parent->vis_cache = NULL;
+    }
+    LIST_FOR_EACH_ENTRY( sibling, &parent->children, struct window, entry )
+        if (sibling != win) invalidate_visible_tree( sibling );
+}
+
 /* set the PAINT_PIXEL_FORMAT_CHILD flag on all the parents */
 /* note: we never reset the flag, it's just a heuristic */
 static inline void update_pixel_format_flags( struct window *win )
@@ -240,12 +377,13 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_shared_children( win->parent );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
 static int set_parent_window( struct window *win, struct window *parent )
 {
-    struct window *ptr;
+    struct window *ptr, *old_parent = win->parent;
 
     /* make sure parent is not a child of window */
     for (ptr = parent; ptr; ptr = ptr->parent)
@@ -257,6 +395,8 @@ static int set_parent_window( struct window *win, struct window *parent )
         }
     }
 
+    invalidate_visible_cache( win );  /* from the old position */
+
     if (parent)
     {
         win->parent = parent;
@@ -282,6 +422,10 @@ static int set_parent_window( struct window *win, struct window *parent )
         list_add_head( &win->parent->unlinked, &win->entry );
         win->is_linked = 0;
     }
+    invalidate_visible_cache( win );
+    if (old_parent != win->parent) update_shared_children( old_parent );
+    update_shared_children( win->parent );
+    update_shared_window( win );
     return 1;
 }
 
@@ -420,6 +564,7 @@ static void detach_window_thread( struct window *win )
     /* destroyed when the desktop ref count reaches zero */
     release_object( win->desktop );
     win->thread = NULL;
+    update_shared_window( win );
 }
 
 /* get the process owning the top window of a given desktop */
@@ -495,6 +640,8 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->last_active    = win->handle;
     win->win_region     = NULL;
     win->update_region  = NULL;
+    win->vis_cache      = NULL;
+    win->vis_cache_flags = 0;
     win->style          = 0;
     win->ex_style       = 0;
     win->id             = 0;
@@ -545,7 +692,10 @@ static struct window *create_window( struct window *parent, struct window *owner
         }
     }
 
+    if (!shared_tree_mapping) create_shared_tree();
+
     current->desktop_users++;
+    update_shared_window( win );
     return win;
 
 failed:
@@ -1016,7 +1166,7 @@ static inline struct window *get_top_clipping_window( struct window *win )
 
 
 /* compute the visible region of a window, in window coordinates */
-static struct region *get_visible_region( struct window *win, unsigned int flags )
+static struct region *compute_visible_region( struct window *win, unsigned int flags )
 {
     struct region *tmp = NULL, *region;
     int offset_x, offset_y;
@@ -1095,6 +1245,37 @@ error:
 }
 
 
+/* flags that the visible region depends on */
+#define VIS_CACHE_FLAGS (DCX_PARENTCLIP | DCX_WINDOW | DCX_CLIPCHILDREN)
+
+/* get the visible region of a window, in window coordinates, from the cache if possible */
+static struct region *get_visible_region( struct window *win, unsigned int flags )
+{
+    struct region *region;
+
+    flags &= VIS_CACHE_FLAGS;
+
+    if (win->vis_cache && win->vis_cache_flags == flags)
+    {
+        if (!(region = create_empty_region())) return NULL;
+        if (copy_region( region, win->vis_cache )) return region;
+        free_region( region );
+        return NULL;
+    }
+
+    if (!(region = compute_visible_region( win, flags ))) return NULL;
+
+    /* only one set of flags is cached, the last one used */
+    if (!win->vis_cache && !(win->vis_cache = create_empty_region())) return region;
+    if (copy_region( win->vis_cache, region )) win->vis_cache_flags = flags;
+    else
+    {
+        free_region( win->vis_cache );
+        win->vis_cache = NULL;
+    }
+    return region;
+}
+
 /* clip all children with a custom pixel format out of the visible region */
 static struct region *clip_pixel_format_children( struct window *parent, struct region *parent_clip,
                                                   struct region *region, int offset_x, int offset_y )
@@ -1700,6 +1881,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    invalidate_visible_cache( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1855,6 +2037,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    invalidate_visible_cache( win );
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1876,6 +2059,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        invalidate_visible_cache( win );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1901,7 +2085,10 @@ void destroy_window( struct window *win )
     cleanup_clipboard_window( win->desktop, win->handle );
     free_user_handle( win->handle );
     destroy_properties( win );
+    invalidate_visible_cache( win );
     list_remove( &win->entry );
+    remove_shared_window( win );
+    if (win->parent) update_shared_children( win->parent );
     if (is_desktop_window(win))
     {
         struct desktop *desktop = win->desktop;
@@ -1917,6 +2104,7 @@ void destroy_window( struct window *win )
     detach_window_thread( win );
     if (win->win_region) free_region( win->win_region );
     if (win->update_region) free_region( win->update_region );
+    if (win->vis_cache) free_region( win->vis_cache );
     if (win->class) release_class( win->class );
     free( win->text );
     memset( win, 0x55, sizeof(*win) + win->nb_extra_bytes - 1 );
@@ -1963,6 +2151,7 @@ DECL_HANDLER(create_window)
         win->dpi_awareness = req->awareness;
         win->dpi = req->dpi;
     }
+    update_shared_window( win );
 
     reply->handle    = win->handle;
     reply->parent    = win->parent ? win->parent->handle : 0;
@@ -2025,6 +2214,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shared_window( desktop->top_window );
         }
     }
 
@@ -2037,6 +2227,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shared_window( desktop->msg_window );
         }
     }
 
@@ -2072,6 +2263,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_shared_window( win );
 }
 
 
@@ -2137,6 +2329,10 @@ DECL_HANDLER(set_window_info)
         else win->ex_style = (req->ex_style & ~WS_EX_TOPMOST) | (win->ex_style & WS_EX_TOPMOST);
         if (!(win->ex_style & WS_EX_LAYERED)) win->is_layered = 0;
     }
+    if ((req->flags & SET_WIN_STYLE) && (reply->old_style ^ win->style) & (WS_VISIBLE | WS_MINIMIZE | WS_CLIPSIBLINGS))
+        invalidate_visible_cache( win );
+    if ((req->flags & SET_WIN_EXSTYLE) && (reply->old_ex_style ^ win->ex_style) & WS_EX_TRANSPARENT)
+        invalidate_visible_cache( win );
     if (req->flags & SET_WIN_ID) win->id = req->id;
     if (req->flags & SET_WIN_INSTANCE) win->instance = req->instance;
     if (req->flags & SET_WIN_UNICODE) win->is_unicode = req->is_unicode;
@@ -2146,6 +2342,8 @@ DECL_HANDLER(set_window_info)
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
+
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE | SET_WIN_ID)) update_shared_window( win );
 }
 
 
@@ -2673,6 +2871,8 @@ DECL_HANDLER(update_window_zorder)
         {
             list_remove( &win->entry );
             list_add_before( &ptr->entry, &win->entry );
+            invalidate_visible_cache( win );
+            update_shared_children( win->parent );
         }
         break;
     }
@@ -2880,3 +3080,18 @@ DECL_HANDLER(set_window_layered_info)
     }
     else set_win32_error( ERROR_INVALID_WINDOW_HANDLE );
 }
+
+
+/* get a handle to the window tree shared with the clients */
+DECL_HANDLER(get_shared_window_tree)
+{
+    /* if no window has been created yet the tree is simply empty */
+    if (!shared_tree_mapping) create_shared_tree();
+    if (!shared_tree_mapping)
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+    reply->handle = alloc_handle( current->process, shared_tree_mapping,
+                                  SECTION_MAP_READ | SECTION_QUERY, 0 );
+}